@@ -49,6 +49,9 @@ struct hlmMatchEntry {
 
 std::vector<hlmMatchEntry> ctxt;
 
+// Keeps the multibit benchmarks' results live.
+volatile u32 mmb_sink;
+
 static
 hwlmcb_rv_t hlmSimpleCallback(size_t to, u32 id,
                               UNUSED struct hs_scratch *scratch) {
@@ -219,6 +222,73 @@ int main(){
             );
         }
 
+#ifdef HAVE_VERM16
+        for (size_t i = 0; i < std::size(sizes); i++) {
+            MicroBenchmark bench("Vermicelli16", sizes[i]);
+            run_benchmarks(sizes[i], MAX_LOOPS / sizes[i], matches[m], false, bench,
+                [&](MicroBenchmark &b) {
+                    b.chars.set('a');
+                    b.chars.set('c');
+                    b.chars.set('d');
+                    ue2::vermicelli16Build(b.chars, (u8 *)&b.lo);
+                    memset(b.buf.data(), 'b', b.size);
+                },
+                [&](MicroBenchmark &b) {
+                    return vermicelli16Exec(b.lo, b.buf.data(), b.buf.data() + b.size);
+                }
+            );
+        }
+
+        for (size_t i = 0; i < std::size(sizes); i++) {
+            MicroBenchmark bench("Reverse Vermicelli16", sizes[i]);
+            run_benchmarks(sizes[i], MAX_LOOPS / sizes[i], matches[m], true, bench,
+                [&](MicroBenchmark &b) {
+                    b.chars.set('a');
+                    b.chars.set('c');
+                    b.chars.set('d');
+                    ue2::vermicelli16Build(b.chars, (u8 *)&b.lo);
+                    memset(b.buf.data(), 'b', b.size);
+                },
+                [&](MicroBenchmark &b) {
+                    return rvermicelli16Exec(b.lo, b.buf.data(), b.buf.data() + b.size);
+                }
+            );
+        }
+
+        for (size_t i = 0; i < std::size(sizes); i++) {
+            MicroBenchmark bench("Double Vermicelli16", sizes[i]);
+            run_benchmarks(sizes[i], MAX_LOOPS / sizes[i], matches[m], false, bench,
+                [&](MicroBenchmark &b) {
+                    ue2::flat_set<std::pair<u8, u8>> pairs;
+                    pairs.insert(std::make_pair('a', 'b'));
+                    pairs.insert(std::make_pair('c', 'd'));
+                    ue2::vermicelliDouble16Build(pairs, (u8 *)&b.lo, (u8 *)&b.firsts);
+                    memset(b.buf.data(), 'b', b.size);
+                },
+                [&](MicroBenchmark &b) {
+                    return vermicelliDouble16Exec(b.lo, b.firsts, b.buf.data(),
+                                                  b.buf.data() + b.size);
+                }
+            );
+        }
+
+        for (size_t i = 0; i < std::size(sizes); i++) {
+            MicroBenchmark bench("Double Vermicelli16 Masked", sizes[i]);
+            run_benchmarks(sizes[i], MAX_LOOPS / sizes[i], matches[m], false, bench,
+                [&](MicroBenchmark &b) {
+                    ue2::vermicelliDoubleMasked16Build('a', 'b', CASE_CLEAR, 0xff,
+                                                       (u8 *)&b.lo);
+                    memset(b.buf.data(), 'b', b.size);
+                },
+                [&](MicroBenchmark &b) {
+                    return vermicelliDoubleMasked16Exec(b.lo, 'a' & CASE_CLEAR,
+                                                        CASE_CLEAR, b.buf.data(),
+                                                        b.buf.data() + b.size);
+                }
+            );
+        }
+#endif // HAVE_VERM16
+
         for (size_t i = 0; i < std::size(sizes); i++) {
             //we imitate the noodle unit tests
             std::string str;
@@ -249,5 +319,90 @@ int main(){
         }
     }
 
+    // Multibit: flat (64, 256 bits) and pyramid models, one key in 7 on and
+    // an iterator over one key in 3.
+    const u32 mmb_sizes[] = {64, 256, 4096, 65536};
+    for (size_t i = 0; i < std::size(mmb_sizes); i++) {
+        const u32 total_bits = mmb_sizes[i];
+        const u32 size = ue2::mmbit_size(total_bits);
+        auto init = [&](MicroBenchmark &b) {
+            b.total_bits = total_bits;
+            mmbit_clear(b.buf.data(), total_bits);
+            std::vector<u32> keys;
+            for (u32 k = 0; k < total_bits; k++) {
+                if (k % 7 == 0) {
+                    mmbit_set(b.buf.data(), total_bits, k);
+                }
+                if (k % 3 == 0) {
+                    keys.push_back(k);
+                }
+            }
+            b.iter = ue2::mmbBuildSparseIterator(keys, total_bits);
+        };
+
+        MicroBenchmark any("Multibit Any", size);
+        run_benchmarks(size, MAX_LOOPS / size, 0, false, any, init,
+            [&](MicroBenchmark &b) {
+                mmb_sink += mmbit_any_precise(b.buf.data(), b.total_bits);
+                return b.buf.data() + b.size;
+            }
+        );
+
+        MicroBenchmark iterate("Multibit Iterate", size);
+        run_benchmarks(size, MAX_LOOPS / size / 16, 0, false, iterate, init,
+            [&](MicroBenchmark &b) {
+                for (u32 k = mmbit_iterate(b.buf.data(), b.total_bits, MMB_INVALID);
+                     k != MMB_INVALID;
+                     k = mmbit_iterate(b.buf.data(), b.total_bits, k)) {
+                    mmb_sink += k;
+                }
+                return b.buf.data() + b.size;
+            }
+        );
+
+        MicroBenchmark batch("Multibit Iterate Batch", size);
+        run_benchmarks(size, MAX_LOOPS / size / 16, 0, false, batch, init,
+            [&](MicroBenchmark &b) {
+                u32 keys[MMB_ITER_BATCH];
+                u32 n = 0;
+                do {
+                    n = mmbit_iterate_batch(b.buf.data(), b.total_bits,
+                                            n ? keys[n - 1] : MMB_INVALID,
+                                            keys, MMB_ITER_BATCH);
+                    for (u32 k = 0; k < n; k++) {
+                        mmb_sink += keys[k];
+                    }
+                } while (n == MMB_ITER_BATCH);
+                return b.buf.data() + b.size;
+            }
+        );
+
+        MicroBenchmark sparse("Multibit Sparse Iter", size);
+        run_benchmarks(size, MAX_LOOPS / size / 16, 0, false, sparse, init,
+            [&](MicroBenchmark &b) {
+                struct mmbit_sparse_state s[MAX_SPARSE_ITER_STATES];
+                u32 idx = 0;
+                for (u32 k = mmbit_sparse_iter_begin(b.buf.data(), b.total_bits,
+                                                     &idx, b.iter.data(), s);
+                     k != MMB_INVALID;
+                     k = mmbit_sparse_iter_next(b.buf.data(), b.total_bits, k,
+                                                &idx, b.iter.data(), s)) {
+                    mmb_sink += k;
+                }
+                return b.buf.data() + b.size;
+            }
+        );
+
+        MicroBenchmark sparse_any("Multibit Sparse Iter Any", size);
+        run_benchmarks(size, MAX_LOOPS / size, 0, false, sparse_any, init,
+            [&](MicroBenchmark &b) {
+                struct mmbit_sparse_state s[MAX_SPARSE_ITER_STATES];
+                mmb_sink += mmbit_sparse_iter_any(b.buf.data(), b.total_bits,
+                                                  b.iter.data(), s);
+                return b.buf.data() + b.size;
+            }
+        );
+    }
+
     return 0;
 }
@@ -31,11 +31,14 @@
 #include "nfa/truffle.h"
 #include "nfa/trufflecompile.h"
 #include "nfa/vermicelli.hpp"
+#include "nfa/vermicellicompile.h"
 #include "hwlm/noodle_build.h"
 #include "hwlm/noodle_engine.h"
 #include "hwlm/noodle_internal.h"
 #include "hwlm/hwlm_literal.h"
 #include "util/bytecode_ptr.h"
+#include "util/multibit.h"
+#include "util/multibit_build.h"
 #include "scratch.h"
 
 /*define colour control characters*/
@@ -59,10 +62,17 @@ public:
   ue2::CharReach chars;
   std::vector<u8> buf;
 
+  // Vermicelli16
+  u64a firsts;
+
   // Noodle
   struct hs_scratch scratch;
   ue2::bytecode_ptr<noodTable> nt;
 
+  // Multibit
+  u32 total_bits;
+  std::vector<mmbit_sparse_iter> iter;
+
   MicroBenchmark(char const *label_, size_t size_)
   :label(label_), size(size_), buf(size_) {
   };
@@ -0,0 +1,596 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Threaded scan service: worker pool with flow-affine work stealing.
+ *
+ * Every stream has a bounded single-producer ring of pending buffers and a
+ * "scheduled" flag. The producer that finds the flag clear queues the stream
+ * on its owner's run queue; the worker that dequeues it becomes its owner and
+ * scans its buffers in order, so a stream is only ever being scanned by one
+ * worker. Idle workers steal whole streams from other workers' run queues.
+ */
+
+#include "hs_service.h"
+
+#include "hs.h"
+#include "ue2common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+/** Default depth of each stream's queue of pending buffers. */
+static constexpr u32 DEFAULT_QUEUE_DEPTH = 64;
+
+/** Default maximum number of open streams. */
+static constexpr u32 DEFAULT_MAX_STREAMS = 4096;
+
+/** Maximum number of buffers scanned from one stream before the worker moves
+ * on to the next stream in its run queue. */
+static constexpr u32 MAX_BATCH = 16;
+
+static
+u32 roundUpPow2(u32 x) {
+    u32 p = 1;
+    while (p < x) {
+        p <<= 1;
+    }
+    return p;
+}
+
+struct Item {
+    const char *data = nullptr;
+    u32 length = 0;
+    bool close = false;
+    void *context = nullptr;
+};
+
+/** \brief Bounded lock-free multi-producer/multi-consumer queue of stream
+ * pointers (after Vyukov). */
+class RunQueue {
+public:
+    explicit RunQueue(u32 capacity)
+        : cells(roundUpPow2(max(capacity, 2U))), mask(cells.size() - 1) {
+        for (size_t i = 0; i < cells.size(); i++) {
+            cells[i].seq.store(i, memory_order_relaxed);
+        }
+    }
+
+    bool push(hs_service_stream *s) {
+        size_t pos = tail.load(memory_order_relaxed);
+        for (;;) {
+            Cell &c = cells[pos & mask];
+            size_t seq = c.seq.load(memory_order_acquire);
+            if (seq == pos) {
+                if (tail.compare_exchange_weak(pos, pos + 1,
+                                               memory_order_relaxed)) {
+                    c.stream = s;
+                    c.seq.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos) {
+                return false; // full
+            } else {
+                pos = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    hs_service_stream *pop() {
+        size_t pos = head.load(memory_order_relaxed);
+        for (;;) {
+            Cell &c = cells[pos & mask];
+            size_t seq = c.seq.load(memory_order_acquire);
+            if (seq == pos + 1) {
+                if (head.compare_exchange_weak(pos, pos + 1,
+                                               memory_order_relaxed)) {
+                    hs_service_stream *s = c.stream;
+                    c.seq.store(pos + mask + 1, memory_order_release);
+                    return s;
+                }
+            } else if (seq < pos + 1) {
+                return nullptr; // empty
+            } else {
+                pos = head.load(memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        atomic<size_t> seq;
+        hs_service_stream *stream = nullptr;
+    };
+
+    vector<Cell> cells;
+    const size_t mask;
+    alignas(64) atomic<size_t> head{0};
+    alignas(64) atomic<size_t> tail{0};
+};
+
+struct Worker {
+    Worker(u32 index_in, u32 max_streams)
+        : index(index_in), runq(max_streams) {}
+
+    const u32 index;
+    RunQueue runq;
+    hs_scratch_t *scratch = nullptr;
+    thread thr;
+};
+
+/** \brief Context handed to hs_scan_stream() by a worker. */
+struct MatchContext {
+    const hs_service *svc;
+    u32 worker;
+    void *stream_context;
+};
+
+} // namespace
+
+struct hs_service_stream {
+    hs_service_stream(u32 depth, u32 owner_in, void *context_in)
+        : context(context_in), items(depth), mask(depth - 1),
+          owner(owner_in) {}
+
+    hs_stream_t *id = nullptr;
+    void *context;
+    size_t slot = 0; //!< index in the service's stream registry
+
+    // Ring of pending items: written by the submitting thread, consumed by
+    // the owning worker.
+    vector<Item> items;
+    const size_t mask;
+    alignas(64) atomic<size_t> head{0};
+    alignas(64) atomic<size_t> tail{0};
+
+    atomic<bool> scheduled{false};
+    atomic<u32> owner;
+
+    // Back-pressure: a submitter waiting for room in a full ring sleeps on
+    // space_cv, and the worker wakes it as it consumes items.
+    atomic<bool> space_wanted{false};
+    mutex space_lock;
+    condition_variable space_cv;
+    bool closed = false; //!< producer side: close has been submitted
+
+    // Held by the submitting side until its close request is queued and by
+    // the worker until the close is done; the last to let go frees the stream.
+    atomic<u32> refs{2};
+};
+
+struct hs_service {
+    const hs_database_t *db = nullptr;
+    hs_service_config_t config;
+    u32 depth = 0;
+    vector<unique_ptr<Worker>> workers;
+
+    atomic<bool> stop{false};
+    atomic<u32> idle{0};
+    mutex idle_lock;
+    condition_variable idle_cv;
+
+    atomic<size_t> pending{0};
+    mutex drain_lock;
+    condition_variable drain_cv;
+
+    atomic<u32> next_home{0};
+    mutex streams_lock;
+    vector<hs_service_stream *> streams;
+    vector<size_t> free_slots;
+};
+
+namespace {
+
+static
+int HS_CDECL onMatch(unsigned int id, unsigned long long from,
+                     unsigned long long to, unsigned int flags, void *ctx) {
+    const MatchContext *mc = static_cast<const MatchContext *>(ctx);
+    const hs_service_config_t &config = mc->svc->config;
+    return config.on_match(mc->worker, mc->stream_context, id, from, to, flags,
+                           config.context);
+}
+
+static
+void wakeIdle(hs_service *svc) {
+    // Order the caller's push before the idle check. Paired with the fence in
+    // workerMain(), either we see the worker idle or it sees the new work.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (svc->idle.load() > 0) {
+        lock_guard<mutex> lock(svc->idle_lock);
+        svc->idle_cv.notify_one();
+    }
+}
+
+static
+void completeOne(hs_service *svc) {
+    if (svc->pending.fetch_sub(1) == 1) {
+        lock_guard<mutex> lock(svc->drain_lock);
+        svc->drain_cv.notify_all();
+    }
+}
+
+static
+void schedule(hs_service *svc, hs_service_stream *s) {
+    if (s->scheduled.exchange(true)) {
+        return; // already queued or being scanned
+    }
+    Worker &w = *svc->workers[s->owner.load(memory_order_relaxed)];
+    UNUSED bool ok = w.runq.push(s);
+    assert(ok); // each stream is queued at most once
+    wakeIdle(svc);
+}
+
+static
+void unregisterStream(hs_service *svc, hs_service_stream *s) {
+    lock_guard<mutex> lock(svc->streams_lock);
+    svc->streams[s->slot] = nullptr;
+    svc->free_slots.push_back(s->slot);
+}
+
+static
+void releaseStream(hs_service_stream *s) {
+    if (s->refs.fetch_sub(1) == 1) {
+        delete s;
+    }
+}
+
+/** \brief Scan up to MAX_BATCH pending items of a stream owned by this
+ * worker. */
+static
+void runStream(hs_service *svc, Worker &w, hs_service_stream *s) {
+    s->owner.store(w.index, memory_order_relaxed);
+    const hs_service_config_t &config = svc->config;
+    MatchContext mc{svc, w.index, s->context};
+    match_event_handler cb = config.on_match ? onMatch : nullptr;
+
+    size_t head = s->head.load(memory_order_relaxed);
+    for (u32 n = 0; n < MAX_BATCH; n++) {
+        if (head == s->tail.load(memory_order_acquire)) {
+            break;
+        }
+        const Item item = s->items[head & s->mask];
+        head++;
+        s->head.store(head);
+        if (s->space_wanted.load()) {
+            lock_guard<mutex> lock(s->space_lock);
+            s->space_cv.notify_one();
+        }
+
+        if (item.close) {
+            hs_error_t err = hs_close_stream(s->id, w.scratch, cb, &mc);
+            if (config.on_done) {
+                config.on_done(w.index, s->context, nullptr, nullptr, err,
+                               config.context);
+            }
+            unregisterStream(svc, s);
+            releaseStream(s);
+            completeOne(svc);
+            return;
+        }
+
+        hs_error_t err = hs_scan_stream(s->id, item.data, item.length, 0,
+                                        w.scratch, cb, &mc);
+        if (config.on_done) {
+            config.on_done(w.index, s->context, item.data, item.context, err,
+                           config.context);
+        }
+        completeOne(svc);
+    }
+
+    if (head != s->tail.load(memory_order_acquire)) {
+        // Batch exhausted: go to the back of our own queue.
+        UNUSED bool ok = w.runq.push(s);
+        assert(ok);
+        return;
+    }
+
+    // Ring drained. Clear the flag, then look again: a producer that pushed
+    // after our check saw the flag still set and left the stream to us.
+    s->scheduled.store(false);
+    if (head != s->tail.load() && !s->scheduled.exchange(true)) {
+        UNUSED bool ok = w.runq.push(s);
+        assert(ok);
+    }
+}
+
+/** \brief Find a stream to work on: our own run queue first, then steal from
+ * the others. */
+static
+hs_service_stream *findWork(hs_service *svc, u32 self) {
+    if (hs_service_stream *s = svc->workers[self]->runq.pop()) {
+        return s;
+    }
+    const u32 n = svc->workers.size();
+    for (u32 i = 1; i < n; i++) {
+        if (hs_service_stream *s = svc->workers[(self + i) % n]->runq.pop()) {
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+static
+void workerMain(hs_service *svc, u32 self) {
+    Worker &w = *svc->workers[self];
+    for (;;) {
+        hs_service_stream *s = findWork(svc, self);
+        if (!s) {
+            unique_lock<mutex> lock(svc->idle_lock);
+            svc->idle++;
+            atomic_thread_fence(memory_order_seq_cst);
+            // Look again now that producers can see we are idle.
+            while (!svc->stop.load() && !(s = findWork(svc, self))) {
+                svc->idle_cv.wait(lock);
+            }
+            svc->idle--;
+            if (!s) {
+                return; // stopping
+            }
+        }
+        runStream(svc, w, s);
+    }
+}
+
+static
+void stopWorkers(hs_service *svc) {
+    {
+        lock_guard<mutex> lock(svc->idle_lock);
+        svc->stop.store(true);
+        svc->idle_cv.notify_all();
+    }
+    for (auto &w : svc->workers) {
+        if (w->thr.joinable()) {
+            w->thr.join();
+        }
+    }
+}
+
+static
+void freeService(hs_service *svc) {
+    for (hs_service_stream *s : svc->streams) {
+        if (s) {
+            hs_close_stream(s->id, nullptr, nullptr, nullptr);
+            delete s;
+        }
+    }
+    for (auto &w : svc->workers) {
+        hs_free_scratch(w->scratch);
+    }
+    delete svc;
+}
+
+static
+hs_error_t enqueue(hs_service *svc, hs_service_stream *s, const Item &item,
+                   bool nowait) {
+    size_t tail = s->tail.load(memory_order_relaxed);
+    auto has_room = [s, tail] { return tail - s->head.load() <= s->mask; };
+    if (!has_room()) {
+        if (nowait) {
+            return HS_INSUFFICIENT_SPACE;
+        }
+        // The stream is already scheduled, as its ring is non-empty, so its
+        // worker will make room and wake us.
+        unique_lock<mutex> lock(s->space_lock);
+        s->space_wanted.store(true);
+        s->space_cv.wait(lock, has_room);
+        s->space_wanted.store(false);
+    }
+
+    s->items[tail & s->mask] = item;
+    svc->pending.fetch_add(1);
+    s->tail.store(tail + 1);
+    schedule(svc, s);
+    return HS_SUCCESS;
+}
+
+} // namespace
+
+extern "C" HS_PUBLIC_API
+hs_error_t HS_CDECL hs_service_create(const hs_database_t *db,
+                                      const hs_service_config_t *config,
+                                      hs_service_t **service) {
+    if (!db || !config || !service) {
+        return HS_INVALID;
+    }
+    *service = nullptr;
+
+    size_t stream_size;
+    hs_error_t err = hs_stream_size(db, &stream_size);
+    if (err != HS_SUCCESS) {
+        return err;
+    }
+
+    u32 nworkers = config->workers;
+    if (!nworkers) {
+        nworkers = max(thread::hardware_concurrency(), 1U);
+    }
+
+    unique_ptr<hs_service> svc;
+    try {
+        svc = make_unique<hs_service>();
+        svc->db = db;
+        svc->config = *config;
+        svc->depth = roundUpPow2(config->queue_depth ? config->queue_depth
+                                                     : DEFAULT_QUEUE_DEPTH);
+        if (!svc->config.max_streams) {
+            svc->config.max_streams = DEFAULT_MAX_STREAMS;
+        }
+        for (u32 i = 0; i < nworkers; i++) {
+            svc->workers.push_back(
+                make_unique<Worker>(i, svc->config.max_streams));
+        }
+    } catch (const bad_alloc &) {
+        return HS_NOMEM;
+    }
+
+    for (auto &w : svc->workers) {
+        err = w == svc->workers.front()
+                  ? hs_alloc_scratch(db, &w->scratch)
+                  : hs_clone_scratch(svc->workers.front()->scratch,
+                                     &w->scratch);
+        if (err != HS_SUCCESS) {
+            freeService(svc.release());
+            return err;
+        }
+    }
+
+    try {
+        for (u32 i = 0; i < nworkers; i++) {
+            svc->workers[i]->thr = thread(workerMain, svc.get(), i);
+        }
+    } catch (const system_error &) {
+        stopWorkers(svc.get());
+        freeService(svc.release());
+        return HS_UNKNOWN_ERROR;
+    }
+
+    *service = svc.release();
+    return HS_SUCCESS;
+}
+
+extern "C" HS_PUBLIC_API
+hs_error_t HS_CDECL hs_service_open_stream(hs_service_t *service,
+                                           void *stream_context,
+                                           hs_service_stream_t **stream) {
+    if (!service || !stream) {
+        return HS_INVALID;
+    }
+    *stream = nullptr;
+
+    // Streams are spread over the workers as they are opened; work stealing
+    // evens out whatever imbalance remains.
+    u32 home = service->next_home.fetch_add(1, memory_order_relaxed) %
+               service->workers.size();
+
+    hs_service_stream *s;
+    try {
+        s = new hs_service_stream(service->depth, home, stream_context);
+    } catch (const bad_alloc &) {
+        return HS_NOMEM;
+    }
+
+    hs_error_t err = hs_open_stream(service->db, 0, &s->id);
+    if (err != HS_SUCCESS) {
+        delete s;
+        return err;
+    }
+
+    {
+        lock_guard<mutex> lock(service->streams_lock);
+        if (!service->free_slots.empty()) {
+            s->slot = service->free_slots.back();
+            service->free_slots.pop_back();
+            service->streams[s->slot] = s;
+        } else if (service->streams.size() < service->config.max_streams) {
+            s->slot = service->streams.size();
+            try {
+                service->streams.push_back(s);
+            } catch (const bad_alloc &) {
+                err = HS_NOMEM;
+            }
+        } else {
+            err = HS_INSUFFICIENT_SPACE;
+        }
+    }
+    if (err != HS_SUCCESS) {
+        hs_close_stream(s->id, nullptr, nullptr, nullptr);
+        delete s;
+        return err;
+    }
+
+    *stream = s;
+    return HS_SUCCESS;
+}
+
+extern "C" HS_PUBLIC_API
+hs_error_t HS_CDECL hs_service_submit(hs_service_t *service,
+                                      hs_service_stream_t *stream,
+                                      const char *data, unsigned int length,
+                                      void *data_context, unsigned int flags) {
+    if (!service || !stream || !data || stream->closed ||
+        (flags & ~HS_SERVICE_NOWAIT)) {
+        return HS_INVALID;
+    }
+
+    Item item;
+    item.data = data;
+    item.length = length;
+    item.context = data_context;
+    return enqueue(service, stream, item, flags & HS_SERVICE_NOWAIT);
+}
+
+extern "C" HS_PUBLIC_API
+hs_error_t HS_CDECL hs_service_close_stream(hs_service_t *service,
+                                            hs_service_stream_t *stream) {
+    if (!service || !stream || stream->closed) {
+        return HS_INVALID;
+    }
+
+    Item item;
+    item.close = true;
+    stream->closed = true;
+    hs_error_t err = enqueue(service, stream, item, false);
+    releaseStream(stream);
+    return err;
+}
+
+extern "C" HS_PUBLIC_API
+hs_error_t HS_CDECL hs_service_drain(hs_service_t *service) {
+    if (!service) {
+        return HS_INVALID;
+    }
+
+    unique_lock<mutex> lock(service->drain_lock);
+    service->drain_cv.wait(lock, [service] {
+        return service->pending.load() == 0;
+    });
+    return HS_SUCCESS;
+}
+
+extern "C" HS_PUBLIC_API
+hs_error_t HS_CDECL hs_service_destroy(hs_service_t *service) {
+    if (!service) {
+        return HS_SUCCESS;
+    }
+
+    hs_service_drain(service);
+    stopWorkers(service);
+    freeService(service);
+    return HS_SUCCESS;
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HS_SERVICE_H_
+#define HS_SERVICE_H_
+
+/**
+ * @file
+ * @brief The Hyperscan threaded scan service API definition.
+ *
+ * The scan service is an optional library built on top of the Hyperscan
+ * runtime. It owns a pool of worker threads, each with its own scratch space,
+ * and scans data submitted against streams of a streaming mode database.
+ *
+ * Each stream is owned by one worker at a time, so the data submitted to a
+ * stream is always scanned in submission order. Streams with pending data are
+ * queued on their owner's lock-free run queue; a worker with nothing to do
+ * steals a whole stream from another worker's queue and becomes its owner.
+ */
+
+#include "hs_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * A scan service: a pool of worker threads scanning against one database.
+ */
+typedef struct hs_service hs_service_t;
+
+/**
+ * A stream opened on a scan service.
+ */
+typedef struct hs_service_stream hs_service_stream_t;
+
+/**
+ * Definition of the match handler of a scan service.
+ *
+ * This is called on the worker thread which scanned the data, with the index
+ * of that worker (in the range zero to one less than the number of workers),
+ * so that matches may be gathered into per-worker structures without locking.
+ * The remaining parameters are as for @ref match_event_handler.
+ *
+ * @param worker
+ *      The index of the worker thread which found the match.
+ *
+ * @param stream_context
+ *      The context pointer given to @ref hs_service_open_stream() for the
+ *      stream being scanned.
+ *
+ * @param id
+ *      The ID number of the expression that matched.
+ *
+ * @param from
+ *      The start offset of the match (only valid with SOM flags).
+ *
+ * @param to
+ *      The offset after the last byte that matches the expression.
+ *
+ * @param flags
+ *      This is provided for future use and is unused at present.
+ *
+ * @param context
+ *      The context pointer given in @ref hs_service_config_t.
+ *
+ * @return
+ *      Non-zero if matching should cease for this stream, else zero.
+ */
+typedef int (HS_CDECL *hs_service_match_handler)(unsigned int worker,
+                                                 void *stream_context,
+                                                 unsigned int id,
+                                                 unsigned long long from,
+                                                 unsigned long long to,
+                                                 unsigned int flags,
+                                                 void *context);
+
+/**
+ * Definition of the completion handler of a scan service.
+ *
+ * This is called on a worker thread once a buffer submitted with @ref
+ * hs_service_submit() has been scanned, after which the buffer may be reused
+ * or freed. It is also called when a stream closed with @ref
+ * hs_service_close_stream() has been closed, with a NULL buffer.
+ *
+ * @param worker
+ *      The index of the worker thread which scanned the buffer.
+ *
+ * @param stream_context
+ *      The context pointer given to @ref hs_service_open_stream().
+ *
+ * @param data
+ *      The buffer that was scanned, or NULL for a stream close.
+ *
+ * @param data_context
+ *      The context pointer given to @ref hs_service_submit(), or NULL for a
+ *      stream close.
+ *
+ * @param result
+ *      The result of the scan (or close): @ref HS_SUCCESS, @ref
+ *      HS_SCAN_TERMINATED if a match handler asked for matching to cease, or
+ *      another error code.
+ *
+ * @param context
+ *      The context pointer given in @ref hs_service_config_t.
+ */
+typedef void (HS_CDECL *hs_service_done_handler)(unsigned int worker,
+                                                 void *stream_context,
+                                                 const char *data,
+                                                 void *data_context,
+                                                 hs_error_t result,
+                                                 void *context);
+
+/**
+ * Configuration of a scan service, given to @ref hs_service_create().
+ */
+typedef struct hs_service_config {
+    /**
+     * Number of worker threads, or zero for one per online CPU.
+     */
+    unsigned int workers;
+
+    /**
+     * Maximum number of buffers queued on each stream before @ref
+     * hs_service_submit() applies back-pressure, or zero for the default of
+     * 64. Rounded up to a power of two.
+     */
+    unsigned int queue_depth;
+
+    /**
+     * Maximum number of streams open at once, or zero for the default of
+     * 4096.
+     */
+    unsigned int max_streams;
+
+    /**
+     * Match handler, or NULL to scan without reporting matches.
+     */
+    hs_service_match_handler on_match;
+
+    /**
+     * Completion handler, or NULL.
+     */
+    hs_service_done_handler on_done;
+
+    /**
+     * Context pointer passed to the handlers.
+     */
+    void *context;
+} hs_service_config_t;
+
+/**
+ * @defgroup HS_SERVICE_FLAG Scan service submission flags
+ *
+ * @{
+ */
+
+/**
+ * Submission flag: fail with @ref HS_INSUFFICIENT_SPACE rather than waiting
+ * if the stream's queue is full.
+ */
+#define HS_SERVICE_NOWAIT 1
+
+/** @} */
+
+/**
+ * Create a scan service and start its worker threads.
+ *
+ * @param db
+ *      A compiled streaming mode pattern database. It must not be freed until
+ *      the service has been destroyed.
+ *
+ * @param config
+ *      The service configuration.
+ *
+ * @param service
+ *      On success, a pointer to the new service will be returned in this
+ *      parameter.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_DB_MODE_ERROR if the database is
+ *      not a streaming mode database, other values on failure.
+ */
+hs_error_t HS_CDECL hs_service_create(const hs_database_t *db,
+                                      const hs_service_config_t *config,
+                                      hs_service_t **service);
+
+/**
+ * Open a stream on a scan service.
+ *
+ * @param service
+ *      The scan service.
+ *
+ * @param stream_context
+ *      A context pointer passed to the handlers for this stream.
+ *
+ * @param stream
+ *      On success, a pointer to the new stream will be returned in this
+ *      parameter.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_INSUFFICIENT_SPACE if the maximum
+ *      number of streams are already open, other values on failure.
+ */
+hs_error_t HS_CDECL hs_service_open_stream(hs_service_t *service,
+                                           void *stream_context,
+                                           hs_service_stream_t **stream);
+
+/**
+ * Submit a buffer to be scanned as the next write to a stream.
+ *
+ * The buffer is scanned asynchronously by a worker thread and must not be
+ * modified or freed until the completion handler has been called for it (or
+ * @ref hs_service_drain() has returned). Buffers submitted to one stream are
+ * scanned in order; submissions to one stream must not be made from more than
+ * one thread at once.
+ *
+ * @param service
+ *      The scan service.
+ *
+ * @param stream
+ *      The stream, as returned by @ref hs_service_open_stream().
+ *
+ * @param data
+ *      Pointer to the data to be scanned.
+ *
+ * @param length
+ *      The number of bytes to scan.
+ *
+ * @param data_context
+ *      A context pointer passed to the completion handler for this buffer.
+ *
+ * @param flags
+ *      Flags modifying the behaviour of this call; see @ref HS_SERVICE_FLAG.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_INSUFFICIENT_SPACE if @ref
+ *      HS_SERVICE_NOWAIT was given and the stream's queue is full, other
+ *      values on failure.
+ */
+hs_error_t HS_CDECL hs_service_submit(hs_service_t *service,
+                                      hs_service_stream_t *stream,
+                                      const char *data, unsigned int length,
+                                      void *data_context, unsigned int flags);
+
+/**
+ * Close a stream once all the data submitted to it has been scanned,
+ * reporting any matches at the end of the stream. The stream may not be used
+ * again after this call.
+ *
+ * @param service
+ *      The scan service.
+ *
+ * @param stream
+ *      The stream, as returned by @ref hs_service_open_stream().
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, other values on failure.
+ */
+hs_error_t HS_CDECL hs_service_close_stream(hs_service_t *service,
+                                            hs_service_stream_t *stream);
+
+/**
+ * Wait until all the work submitted to a scan service so far, including
+ * stream closes, has been completed.
+ *
+ * @param service
+ *      The scan service.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, other values on failure.
+ */
+hs_error_t HS_CDECL hs_service_drain(hs_service_t *service);
+
+/**
+ * Wait for all submitted work to complete, then stop the worker threads and
+ * free the scan service. Any streams still open are freed without reporting
+ * matches at the end of the stream.
+ *
+ * @param service
+ *      The scan service. NULL is accepted and ignored.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, other values on failure.
+ */
+hs_error_t HS_CDECL hs_service_destroy(hs_service_t *service);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* HS_SERVICE_H_ */
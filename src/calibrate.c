@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Load-time calibration between alternative database variants.
+ *
+ * Each variant of a multi-target database which can run on this host is
+ * deserialized and timed over a user-supplied sample; the fastest is kept.
+ */
+
+#include <string.h>
+
+#include "hs_common.h"
+#include "hs_internal.h"
+#include "hs_runtime.h"
+#include "ue2common.h"
+#include "database.h"
+#include "rose/rose_internal.h"
+#include "util/timestamp.h"
+
+/** Number of timed scans per variant; the fastest is used. */
+#define CALIBRATE_ROUNDS 3
+
+static
+int HS_CDECL calibrate_on_match(UNUSED unsigned int id,
+                                UNUSED unsigned long long from,
+                                UNUSED unsigned long long to,
+                                UNUSED unsigned int flags, void *ctx) {
+    (*(u64a *)ctx)++;
+    return 0;
+}
+
+// Scan the sample once with the mode the database was compiled for.
+static
+hs_error_t calibrate_scan(const hs_database_t *db, hs_scratch_t *scratch,
+                          const char *sample, unsigned int sample_length,
+                          u64a *matches) {
+    const struct RoseEngine *rose = hs_get_bytecode(db);
+
+    if (rose->mode == HS_MODE_BLOCK) {
+        return hs_scan(db, sample, sample_length, 0, scratch,
+                       calibrate_on_match, matches);
+    }
+
+    if (rose->mode == HS_MODE_VECTORED) {
+        return hs_scan_vector(db, &sample, &sample_length, 1, 0, scratch,
+                              calibrate_on_match, matches);
+    }
+
+    hs_stream_t *stream = NULL;
+    hs_error_t ret = hs_open_stream(db, 0, &stream);
+    if (ret != HS_SUCCESS) {
+        return ret;
+    }
+    ret = hs_scan_stream(stream, sample, sample_length, 0, scratch,
+                         calibrate_on_match, matches);
+    hs_error_t close_ret = hs_close_stream(stream, scratch, calibrate_on_match,
+                                           matches);
+    return ret != HS_SUCCESS ? ret : close_ret;
+}
+
+// Time the fastest of several scans of the sample against the database.
+static
+hs_error_t calibrate_time(const hs_database_t *db, const char *sample,
+                          unsigned int sample_length, u64a *best_ticks) {
+    hs_scratch_t *scratch = NULL;
+    hs_error_t ret = hs_alloc_scratch(db, &scratch);
+    if (ret != HS_SUCCESS) {
+        return ret;
+    }
+
+    // Untimed warm-up scan to fault in the database and scratch.
+    u64a matches = 0;
+    ret = calibrate_scan(db, scratch, sample, sample_length, &matches);
+
+    *best_ticks = ~0ULL;
+    for (u32 i = 0; ret == HS_SUCCESS && i < CALIBRATE_ROUNDS; i++) {
+        u64a start = timestamp_ticks();
+        ret = calibrate_scan(db, scratch, sample, sample_length, &matches);
+        u64a elapsed = timestamp_ticks() - start;
+        *best_ticks = MIN(*best_ticks, elapsed);
+    }
+
+    DEBUG_PRINTF("%llu ticks, %llu matches\n", *best_ticks, matches);
+
+    hs_free_scratch(scratch);
+    return ret;
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_deserialize_database_calibrated(const char *bytes,
+                                                       const size_t length,
+                                                       const char *sample,
+                                                       unsigned int sample_length,
+                                                       hs_database_t **db) {
+    // An empty sample would time nothing but call overhead.
+    if (!bytes || !db || !sample || !sample_length) {
+        return HS_INVALID;
+    }
+
+    *db = NULL;
+
+    u32 count = dbSerializedVariantCount(bytes, length);
+    if (count == 1) {
+        return hs_deserialize_database(bytes, length, db);
+    }
+
+    hs_database_t *best = NULL;
+    u64a best_ticks = ~0ULL;
+    hs_error_t first_err = HS_DB_PLATFORM_ERROR;
+    hs_error_t time_err = HS_SUCCESS;
+
+    const char *timed[64];
+    u32 num_timed = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        hs_database_t *cand = NULL;
+        const char *bytecode = NULL;
+        hs_error_t ret = dbDeserializeVariant(bytes, length, i, &bytecode,
+                                              &cand);
+        if (ret != HS_SUCCESS) {
+            DEBUG_PRINTF("variant %u unusable: %d\n", i, ret);
+            if (ret != HS_DB_PLATFORM_ERROR) {
+                first_err = ret;
+            }
+            continue;
+        }
+
+        // Variants sharing bytecode with one already timed are identical.
+        u32 j = 0;
+        while (j < num_timed && timed[j] != bytecode) {
+            j++;
+        }
+        if (j < num_timed) {
+            hs_free_database(cand);
+            continue;
+        }
+        if (num_timed < ARRAY_LENGTH(timed)) {
+            timed[num_timed++] = bytecode;
+        }
+
+        u64a ticks;
+        ret = calibrate_time(cand, sample, sample_length, &ticks);
+        if (ret != HS_SUCCESS) {
+            // Choose among the variants that could be timed.
+            DEBUG_PRINTF("variant %u could not be timed: %d\n", i, ret);
+            hs_free_database(cand);
+            if (time_err == HS_SUCCESS) {
+                time_err = ret;
+            }
+            continue;
+        }
+
+        DEBUG_PRINTF("variant %u: %llu ticks\n", i, ticks);
+        if (!best || ticks < best_ticks) {
+            if (best) {
+                hs_free_database(best);
+            }
+            best = cand;
+            best_ticks = ticks;
+        } else {
+            hs_free_database(cand);
+        }
+    }
+
+    if (!best) {
+        return time_err != HS_SUCCESS ? time_err : first_err;
+    }
+
+    *db = best;
+    return HS_SUCCESS;
+}
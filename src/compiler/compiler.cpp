@@ -58,9 +58,11 @@
 #include "rose/rose_build.h"
 #include "rose/rose_internal.h"
 #include "som/slot_manager_dump.h"
+#include "som/slot_sharing.h"
 #include "util/bytecode_ptr.h"
 #include "util/compile_error.h"
 #include "util/target_info.h"
+#include "util/usdt.h"
 #include "util/verify_types.h"
 #include "util/ue2string.h"
 
@@ -194,10 +196,21 @@ ParsedExpression::ParsedExpression(unsigned index_in, const char *expression,
                            "combination with HS_FLAG_SOM_LEFTMOST.");
     }
 
+    if ((flags & HS_FLAG_SOM_ON_DEMAND) && (flags & HS_FLAG_SOM_LEFTMOST)) {
+        throw CompileError("HS_FLAG_SOM_ON_DEMAND is not supported in "
+                           "combination with HS_FLAG_SOM_LEFTMOST.");
+    }
+
+    if ((flags & HS_FLAG_SOM_ON_DEMAND) && (flags & HS_FLAG_PREFILTER)) {
+        throw CompileError("HS_FLAG_PREFILTER is not supported in "
+                           "combination with HS_FLAG_SOM_ON_DEMAND.");
+    }
+
     // Set SOM type.
     if (flags & HS_FLAG_SOM_LEFTMOST) {
         expr.som = SOM_LEFT;
     }
+    expr.som_on_demand = flags & HS_FLAG_SOM_ON_DEMAND;
 
     // Set extended parameters, if we have them.
     if (ext) {
@@ -362,6 +375,13 @@ void addExpression(NG &ng, unsigned index, const char *expression,
                            "HS_MODE_SOM_HORIZON_LARGE) must be specified.");
     }
 
+    // Start of match offsets computed on demand refer to the caller's input,
+    // which must be the same as the input the database scans.
+    if (pe.expr.som_on_demand && (cc.transform & HS_MODE_TRANSFORM_RESIZE)) {
+        throw CompileError("HS_FLAG_SOM_ON_DEMAND is not supported with input "
+                           "transforms that change the length of the input.");
+    }
+
     // If this expression is a literal, we can feed it directly to Rose rather
     // than building the NFA graph.
     if (shortcutLiteral(ng, pe)) {
@@ -409,7 +429,8 @@ void addLitExpression(NG &ng, unsigned index, const char *expression,
     // filter out flags not supported by pure literal API.
     u64a not_supported = HS_FLAG_DOTALL | HS_FLAG_ALLOWEMPTY | HS_FLAG_UTF8 |
                          HS_FLAG_UCP | HS_FLAG_PREFILTER | HS_FLAG_COMBINATION |
-                         HS_FLAG_QUIET | HS_FLAG_MULTILINE;
+                         HS_FLAG_QUIET | HS_FLAG_MULTILINE |
+                         HS_FLAG_SOM_ON_DEMAND;
 
     if (flags & not_supported) {
         throw CompileError("Only HS_FLAG_CASELESS, HS_FLAG_SINGLEMATCH and "
@@ -433,7 +454,15 @@ static
 bytecode_ptr<RoseEngine> generateRoseEngine(NG &ng) {
     const u32 minWidth =
         ng.minWidth.is_finite() ? verify_u32(ng.minWidth) : ROSE_BOUND_INF;
+
+    if (ng.cc.grey.somSlotSharing) {
+        UNUSED u32 saved = shareSomSlots(ng.rm, ng.ssm);
+        DEBUG_PRINTF("som slot sharing saved %u slots\n", saved);
+    }
+
+    HS_PROBE0(rose__build__start);
     auto rose = ng.rose->buildRose(minWidth);
+    HS_PROBE1(rose__build__done, rose.size());
 
     if (!rose) {
         DEBUG_PRINTF("error building rose\n");
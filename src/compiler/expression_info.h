@@ -101,6 +101,12 @@ public:
 
     /** \brief Quiet on match. */
     bool quiet;
+
+    /**
+     * \brief Start of match may be computed after the match with
+     * hs_find_start(). (HS_FLAG_SOM_ON_DEMAND)
+     */
+    bool som_on_demand = false;
 };
 
 }
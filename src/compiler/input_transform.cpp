@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Compile-time handling of database input transforms.
+ */
+#include "input_transform.h"
+
+#include "hs_compile.h"
+#include "nfagraph/ng_holder.h"
+#include "nfagraph/ng_prune.h"
+#include "nfagraph/ng_util.h"
+#include "util/charreach.h"
+#include "util/compare.h"
+#include "util/graph_range.h"
+#include "util/ue2string.h"
+
+namespace ue2 {
+
+CharReach transformPreimage(const CharReach &cr, u32 transform) {
+    if (!(transform & HS_MODE_TRANSFORM_LOWERCASE)) {
+        return cr;
+    }
+
+    // Uppercase input bytes are seen as their lowercase equivalents.
+    CharReach out = cr;
+    for (unsigned char c = 'A'; c <= 'Z'; c++) {
+        if (cr.test(mytolower(c))) {
+            out.set(c);
+        } else {
+            out.clear(c);
+        }
+    }
+    return out;
+}
+
+void applyInputTransform(NGHolder &g, u32 transform) {
+    if (!(transform & HS_MODE_TRANSFORM_LOWERCASE)) {
+        return;
+    }
+
+    for (auto v : vertices_range(g)) {
+        if (is_special(v, g)) {
+            continue;
+        }
+        g[v].char_reach = transformPreimage(g[v].char_reach, transform);
+    }
+
+    pruneEmptyVertices(g);
+}
+
+bool applyInputTransform(ue2_literal &lit, u32 transform) {
+    if (!(transform & HS_MODE_TRANSFORM_LOWERCASE)) {
+        return true;
+    }
+
+    ue2_literal out;
+    for (const auto &e : lit) {
+        if (!ourisalpha(e.c)) {
+            out.push_back(e);
+        } else if (e.nocase || myislower(e.c)) {
+            out.push_back(e.c, true);
+        } else {
+            DEBUG_PRINTF("caseful uppercase char can never match\n");
+            return false;
+        }
+    }
+    lit = out;
+    return true;
+}
+
+} // namespace ue2
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Compile-time handling of database input transforms.
+ *
+ * One-to-one byte transforms (such as HS_MODE_TRANSFORM_LOWERCASE) are never
+ * applied to the input at scan time. Instead, every character class in a
+ * pattern is replaced by its preimage under the transform: the set of input
+ * bytes which the transform maps into the class.
+ */
+
+#ifndef COMPILER_INPUT_TRANSFORM_H
+#define COMPILER_INPUT_TRANSFORM_H
+
+#include "ue2common.h"
+
+namespace ue2 {
+
+class CharReach;
+class NGHolder;
+class ue2_literal;
+
+/** \brief Returns the set of input bytes which \a transform maps into \a cr. */
+CharReach transformPreimage(const CharReach &cr, u32 transform);
+
+/** \brief Fold the one-to-one input transforms in \a transform into the
+ * vertex reach of graph \a g. Vertices left with empty reach are pruned. */
+void applyInputTransform(NGHolder &g, u32 transform);
+
+/** \brief Fold the one-to-one input transforms in \a transform into literal
+ * \a lit. Returns false if the literal can no longer match anything. */
+bool applyInputTransform(ue2_literal &lit, u32 transform);
+
+} // namespace ue2
+
+#endif // COMPILER_INPUT_TRANSFORM_H
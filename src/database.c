@@ -109,6 +109,109 @@ hs_error_t HS_CDECL hs_serialize_database(const hs_database_t *db, char **bytes,
     return HS_SUCCESS;
 }
 
+// Returns true if the two databases carry identical bytecode.
+static
+int db_same_bytecode(const hs_database_t *a, const hs_database_t *b) {
+    return a->length == b->length && a->crc32 == b->crc32 &&
+           !memcmp(hs_get_bytecode(a), hs_get_bytecode(b), a->length);
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_serialize_database_multi(const hs_database_t *const *dbs,
+                                                unsigned int count,
+                                                char **bytes,
+                                                size_t *serialized_length) {
+    if (!dbs || !count || !bytes || !serialized_length) {
+        return HS_INVALID;
+    }
+
+    u32 mode = 0;
+    size_t length = HS_DB_MULTI_HEADER_SIZE
+                    + (size_t)count * HS_DB_MULTI_VARIANT_SIZE;
+    for (u32 i = 0; i < count; i++) {
+        const hs_database_t *db = dbs[i];
+        if (!db) {
+            return HS_INVALID;
+        }
+
+        if (!db_correctly_aligned(db)) {
+            return HS_BAD_ALIGN;
+        }
+
+        hs_error_t ret = validDatabase(db);
+        if (ret != HS_SUCCESS) {
+            return ret;
+        }
+
+        // All variants must have been compiled in the same mode.
+        const struct RoseEngine *rose = hs_get_bytecode(db);
+        if (i && rose->mode != mode) {
+            return HS_INVALID;
+        }
+        mode = rose->mode;
+
+        u32 j = 0;
+        while (j < i && !db_same_bytecode(dbs[j], db)) {
+            j++;
+        }
+        if (j == i) {
+            length += db->length;
+        }
+    }
+
+    if (length > UINT32_MAX) {
+        return HS_INVALID;
+    }
+
+    char *out = hs_misc_alloc(length);
+    hs_error_t ret = hs_check_alloc(out);
+    if (ret != HS_SUCCESS) {
+        hs_misc_free(out);
+        return ret;
+    }
+
+    memset(out, 0, length);
+
+    unaligned_store_u32(out, HS_DB_MULTI_MAGIC);
+    unaligned_store_u32(out + sizeof(u32), HS_DB_VERSION);
+    unaligned_store_u32(out + 2 * sizeof(u32), count);
+
+    u32 offset = HS_DB_MULTI_HEADER_SIZE + count * HS_DB_MULTI_VARIANT_SIZE;
+    for (u32 i = 0; i < count; i++) {
+        const hs_database_t *db = dbs[i];
+        char *v = out + HS_DB_MULTI_HEADER_SIZE + i * HS_DB_MULTI_VARIANT_SIZE;
+
+        // Share the bytecode of an earlier identical variant if there is one.
+        u32 j = 0;
+        while (j < i && !db_same_bytecode(dbs[j], db)) {
+            j++;
+        }
+
+        u32 db_offset;
+        if (j < i) {
+            const char *prev = out + HS_DB_MULTI_HEADER_SIZE
+                               + j * HS_DB_MULTI_VARIANT_SIZE;
+            db_offset = unaligned_load_u32(prev + sizeof(u64a)
+                                           + 2 * sizeof(u32));
+        } else {
+            db_offset = offset;
+            memcpy(out + offset, hs_get_bytecode(db), db->length);
+            offset += db->length;
+        }
+
+        memcpy(v, &db->platform, sizeof(u64a));
+        unaligned_store_u32(v + sizeof(u64a), db->length);
+        unaligned_store_u32(v + sizeof(u64a) + sizeof(u32), db->crc32);
+        unaligned_store_u32(v + sizeof(u64a) + 2 * sizeof(u32), db_offset);
+    }
+
+    assert(offset == length);
+
+    *bytes = out;
+    *serialized_length = length;
+    return HS_SUCCESS;
+}
+
 // check that the database header's platform is compatible with the current
 // runtime platform.
 static
@@ -123,9 +226,118 @@ hs_error_t db_check_platform(const u64a p) {
     return HS_SUCCESS;
 }
 
+// Number of optional CPU features (AVX2, AVX512, ...) a platform uses.
+static
+u32 db_platform_features(const u64a p) {
+    u32 features = 0;
+    if (!(p & HS_PLATFORM_NOAVX2)) {
+        features++;
+    }
+    if (!(p & HS_PLATFORM_NOAVX512)) {
+        features++;
+    }
+    if (!(p & HS_PLATFORM_NOAVX512VBMI)) {
+        features++;
+    }
+    return features;
+}
+
+// Check the header of a multi-target container and return its variant count.
+static
+hs_error_t db_decode_multi_count(const char *base, const size_t length,
+                                 u32 *count) {
+    if (length < HS_DB_MULTI_HEADER_SIZE) {
+        return HS_INVALID;
+    }
+
+    u32 version = unaligned_load_u32(base + sizeof(u32));
+    if (version != HS_DB_VERSION) {
+        return HS_DB_VERSION_ERROR;
+    }
+
+    *count = unaligned_load_u32(base + 2 * sizeof(u32));
+    if (!*count || (length - HS_DB_MULTI_HEADER_SIZE)
+                       / HS_DB_MULTI_VARIANT_SIZE < *count) {
+        DEBUG_PRINTF("bad variant count %u\n", *count);
+        return HS_INVALID;
+    }
+
+    return HS_SUCCESS;
+}
+
+// Decode the given variant of a multi-target container into a database
+// header, pointing *bytes at its bytecode.
+static
+hs_error_t db_decode_multi_variant(const char **bytes, const size_t length,
+                                   u32 index, struct hs_database *header) {
+    const char *base = *bytes;
+    const char *v = base + HS_DB_MULTI_HEADER_SIZE
+                    + index * HS_DB_MULTI_VARIANT_SIZE;
+
+    // Zero header so that none of it (e.g. its padding) is uninitialized.
+    memset(header, 0, sizeof(struct hs_database));
+
+    header->magic = HS_DB_MAGIC;
+    header->version = HS_DB_VERSION;
+    header->platform = unaligned_load_u64a(v);
+    header->length = unaligned_load_u32(v + sizeof(u64a));
+    header->crc32 = unaligned_load_u32(v + sizeof(u64a) + sizeof(u32));
+
+    u32 offset = unaligned_load_u32(v + sizeof(u64a) + 2 * sizeof(u32));
+    if (offset > length || length - offset < header->length) {
+        DEBUG_PRINTF("bad variant extent %u+%u\n", offset, header->length);
+        return HS_INVALID;
+    }
+
+    *bytes = base + offset;
+
+    return HS_SUCCESS;
+}
+
+// Decode a multi-target container, selecting the variant that uses the most
+// CPU features supported by the current runtime platform. If no variant is
+// compatible, the first one is selected so that size/info queries still work;
+// deserialization will then fail the platform check.
+static
+hs_error_t db_decode_multi_header(const char **bytes, const size_t length,
+                                  struct hs_database *header) {
+    const char *base = *bytes;
+
+    u32 count;
+    hs_error_t ret = db_decode_multi_count(base, length, &count);
+    if (ret != HS_SUCCESS) {
+        return ret;
+    }
+
+    u32 best = count;
+    u32 best_features = 0;
+    for (u32 i = 0; i < count; i++) {
+        const char *v = base + HS_DB_MULTI_HEADER_SIZE
+                        + i * HS_DB_MULTI_VARIANT_SIZE;
+        u64a platform = unaligned_load_u64a(v);
+        u32 features = db_platform_features(platform);
+        DEBUG_PRINTF("variant %u platform %llx\n", i, platform);
+        if (db_check_platform(platform) != HS_SUCCESS) {
+            continue;
+        }
+        if (best == count || features > best_features) {
+            best = i;
+            best_features = features;
+        }
+    }
+
+    if (best == count) {
+        DEBUG_PRINTF("no compatible variant\n");
+        best = 0;
+    }
+
+    return db_decode_multi_variant(bytes, length, best, header);
+}
+
 // Decode and check the database header, returning appropriate errors or
 // HS_SUCCESS if it's OK. The header should be allocated on the stack
-// and later copied into the deserialized database.
+// and later copied into the deserialized database. Multi-target containers
+// are decoded to the header of their best variant for this platform.
 static
 hs_error_t db_decode_header(const char **bytes, const size_t length,
                             struct hs_database *header) {
@@ -133,6 +345,11 @@ hs_error_t db_decode_header(const char **bytes, const size_t length,
         return HS_INVALID;
     }
 
+    if (length >= sizeof(u32)
+        && unaligned_load_u32(*bytes) == HS_DB_MULTI_MAGIC) {
+        return db_decode_multi_header(bytes, length, header);
+    }
+
     if (length < sizeof(struct hs_database)) {
         return HS_INVALID;
     }
@@ -239,31 +456,18 @@ hs_error_t HS_CDECL hs_deserialize_database_at(const char *bytes,
     return HS_SUCCESS;
 }
 
-HS_PUBLIC_API
-hs_error_t HS_CDECL hs_deserialize_database(const char *bytes,
-                                            const size_t length,
-                                            hs_database_t **db) {
-    if (!bytes || !db) {
-        return HS_INVALID;
-    }
-
-    *db = NULL;
-
-    // Decode and check the header
-    hs_database_t header;
-    hs_error_t ret = db_decode_header(&bytes, length, &header);
-    if (ret != HS_SUCCESS) {
-        return ret;
-    }
-
+// Allocate a new database from a decoded header and its serialized bytecode.
+static
+hs_error_t db_create_deserialized(const struct hs_database *header,
+                                  const char *bytes, hs_database_t **db) {
     // Make sure the serialized database is for our platform
-    ret = db_check_platform(header.platform);
+    hs_error_t ret = db_check_platform(header->platform);
     if (ret != HS_SUCCESS) {
         return ret;
     }
 
     // Allocate space for new database
-    size_t dblength = sizeof(struct hs_database) + header.length;
+    size_t dblength = sizeof(struct hs_database) + header->length;
     struct hs_database *tempdb = hs_database_alloc(dblength);
     ret = hs_check_alloc(tempdb);
     if (ret != HS_SUCCESS) {
@@ -275,7 +479,7 @@ hs_error_t HS_CDECL hs_deserialize_database(const char *bytes,
     memset(tempdb, 0, dblength);
 
     // Copy the decoded header into place
-    memcpy(tempdb, &header, sizeof(header));
+    memcpy(tempdb, header, sizeof(*header));
 
     // Copy the bytecode into the correctly-aligned location, set offsets
     db_copy_bytecode(bytes, tempdb);
@@ -289,6 +493,78 @@ hs_error_t HS_CDECL hs_deserialize_database(const char *bytes,
     return HS_SUCCESS;
 }
 
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_deserialize_database(const char *bytes,
+                                            const size_t length,
+                                            hs_database_t **db) {
+    if (!bytes || !db) {
+        return HS_INVALID;
+    }
+
+    *db = NULL;
+
+    // Decode and check the header
+    hs_database_t header;
+    hs_error_t ret = db_decode_header(&bytes, length, &header);
+    if (ret != HS_SUCCESS) {
+        return ret;
+    }
+
+    return db_create_deserialized(&header, bytes, db);
+}
+
+u32 dbSerializedVariantCount(const char *bytes, const size_t length) {
+    if (!bytes || length < sizeof(u32)
+        || unaligned_load_u32(bytes) != HS_DB_MULTI_MAGIC) {
+        return 1;
+    }
+
+    u32 count;
+    if (db_decode_multi_count(bytes, length, &count) != HS_SUCCESS) {
+        return 1;
+    }
+    return count;
+}
+
+hs_error_t dbDeserializeVariant(const char *bytes, const size_t length,
+                                u32 index, const char **bytecode,
+                                hs_database_t **db) {
+    if (!bytes || !db) {
+        return HS_INVALID;
+    }
+
+    *db = NULL;
+
+    hs_database_t header;
+    hs_error_t ret;
+    if (length >= sizeof(u32)
+        && unaligned_load_u32(bytes) == HS_DB_MULTI_MAGIC) {
+        u32 count;
+        ret = db_decode_multi_count(bytes, length, &count);
+        if (ret != HS_SUCCESS) {
+            return ret;
+        }
+        if (index >= count) {
+            return HS_INVALID;
+        }
+        ret = db_decode_multi_variant(&bytes, length, index, &header);
+    } else {
+        if (index) {
+            return HS_INVALID;
+        }
+        ret = db_decode_header(&bytes, length, &header);
+    }
+    if (ret != HS_SUCCESS) {
+        return ret;
+    }
+
+    if (bytecode) {
+        *bytecode = bytes;
+    }
+
+    return db_create_deserialized(&header, bytes, db);
+}
+
 HS_PUBLIC_API
 hs_error_t HS_CDECL hs_database_size(const hs_database_t *db, size_t *size) {
     if (!size) {
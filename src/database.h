@@ -46,6 +46,9 @@ extern "C"
 #define HS_DB_VERSION HS_VERSION_32BIT
 #define HS_DB_MAGIC   (0xdbdbdbdbU)
 
+/** \brief Magic for a serialized multi-target ("fat") database container. */
+#define HS_DB_MULTI_MAGIC (0xdbdbfa7dU)
+
 // Values in here cannot (easily) change - add new ones!
 
 // CPU type is the low 6 bits (we can't need more than 64, surely!)
@@ -113,6 +116,26 @@ struct hs_database {
     char bytes[];
 };
 
+/*
+ * Serialized multi-target container, produced by hs_serialize_database_multi.
+ * All fields are little-endian u32 (platform is u64a) and may be unaligned:
+ *
+ *     u32 magic;          // HS_DB_MULTI_MAGIC
+ *     u32 version;        // HS_DB_VERSION
+ *     u32 variant_count;
+ *     u32 reserved;
+ *     struct {
+ *         u64a platform;  // as in struct hs_database
+ *         u32 length;     // bytecode length
+ *         u32 crc32;      // bytecode crc
+ *         u32 offset;     // bytecode offset from start of container
+ *         u32 reserved;
+ *     } variants[variant_count];
+ *     char bytecode[];    // identical bytecode blobs are stored only once
+ */
+#define HS_DB_MULTI_HEADER_SIZE  (4 * sizeof(u32))
+#define HS_DB_MULTI_VARIANT_SIZE (sizeof(u64a) + 4 * sizeof(u32))
+
 static really_inline
 const void *hs_get_bytecode(const struct hs_database *db) {
     return ((const char *)db + db->bytecode);
@@ -136,6 +159,20 @@ hs_error_t validDatabase(const hs_database_t *db) {
 
 hs_error_t dbIsValid(const struct hs_database *db);
 
+/** \brief Number of variants in a serialized database; one unless it is a
+ * multi-target container. */
+u32 dbSerializedVariantCount(const char *bytes, const size_t length);
+
+/**
+ * \brief Deserialize the given variant of a serialized database into a newly
+ * allocated database. Returns HS_DB_PLATFORM_ERROR if the variant cannot run
+ * on this platform. If \a bytecode is non-NULL, it is set to the variant's
+ * serialized bytecode, which is shared between identical variants.
+ */
+hs_error_t dbDeserializeVariant(const char *bytes, const size_t length,
+                                u32 index, const char **bytecode,
+                                struct hs_database **db);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -93,6 +93,11 @@ CREATE_DISPATCH(hs_error_t, hs_stream_size, const hs_database_t *database,
 CREATE_DISPATCH(hs_error_t, hs_database_size, const hs_database_t *db,
                 size_t *size);
 CREATE_DISPATCH(hs_error_t, dbIsValid, const hs_database_t *db);
+CREATE_DISPATCH(u32, dbSerializedVariantCount, const char *bytes,
+                const size_t length);
+CREATE_DISPATCH(hs_error_t, dbDeserializeVariant, const char *bytes,
+                const size_t length, u32 index, const char **bytecode,
+                hs_database_t **db);
 CREATE_DISPATCH(hs_error_t, hs_free_database, hs_database_t *db);
 
 CREATE_DISPATCH(hs_error_t, hs_open_stream, const hs_database_t *db,
@@ -112,6 +117,31 @@ CREATE_DISPATCH(hs_error_t, hs_scan_vector, const hs_database_t *db,
 
 CREATE_DISPATCH(hs_error_t, hs_database_info, const hs_database_t *db, char **info);
 
+CREATE_DISPATCH(hs_error_t, hs_scan_resumable, const hs_database_t *db,
+                const char *data, unsigned int length, unsigned int flags,
+                unsigned int max_bytes, unsigned int max_matches,
+                hs_scratch_t *scratch, match_event_handler onEvent,
+                void *context);
+
+CREATE_DISPATCH(hs_error_t, hs_resume_scan, hs_scratch_t *scratch,
+                unsigned int max_bytes, unsigned int max_matches,
+                match_event_handler onEvent, void *context);
+
+CREATE_DISPATCH(hs_error_t, hs_database_capabilities, const hs_database_t *db,
+                unsigned long long *caps);
+
+CREATE_DISPATCH(hs_error_t, hs_scan_scratchless, const hs_database_t *db,
+                const char *data, unsigned int length, unsigned int flags,
+                match_event_handler onEvent, void *context);
+
+CREATE_DISPATCH(hs_error_t, hs_find_start, const hs_database_t *db,
+                unsigned int id, unsigned long long to, const char *data,
+                unsigned int length, unsigned long long data_offset,
+                unsigned long long *from);
+
+CREATE_DISPATCH(hs_error_t, hs_find_start_history, const hs_database_t *db,
+                unsigned int id, unsigned long long *history);
+
 CREATE_DISPATCH(hs_error_t, hs_copy_stream, hs_stream_t **to_id,
                 const hs_stream_t *from_id);
 
@@ -126,6 +156,10 @@ CREATE_DISPATCH(hs_error_t, hs_reset_and_copy_stream, hs_stream_t *to_id,
 CREATE_DISPATCH(hs_error_t, hs_serialize_database, const hs_database_t *db,
                 char **bytes, size_t *length);
 
+CREATE_DISPATCH(hs_error_t, hs_serialize_database_multi,
+                const hs_database_t *const *dbs, unsigned int count,
+                char **bytes, size_t *length);
+
 CREATE_DISPATCH(hs_error_t, hs_deserialize_database, const char *bytes,
                 const size_t length, hs_database_t **db);
 
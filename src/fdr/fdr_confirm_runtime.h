@@ -59,6 +59,11 @@ void confWithBit(const struct FDRConfirm *fdrc, const struct FDR_Runtime_Args *a
         = (const struct LitInfo *)((const u8 *)fdrc + start);
 
     struct hs_scratch *scratch = a->scratch;
+    if (unlikely(scratchAddWork(scratch, 1))) {
+        *control = HWLM_TERMINATE_MATCHING;
+        return;
+    }
+
     assert(!scratch->fdr_conf);
     scratch->fdr_conf = conf;
     scratch->fdr_conf_offset = bit;
@@ -29,6 +29,8 @@
 #ifndef FLOOD_RUNTIME
 #define FLOOD_RUNTIME
 
+#include "util/usdt.h"
+
 #if defined(ARCH_64_BIT)
 #define FLOOD_64
 #else
@@ -187,6 +189,7 @@ const u8 * floodDetect(const struct FDR * fdr,
                      floodSize, j, i, fl->idCount, *control, fl->allGroups);
         DEBUG_PRINTF("mainloopLen %zu mainStart ??? mainEnd ??? len %zu\n",
                      mainLoopLen, len);
+        HS_PROBE4(fdr__flood, fdr, i, floodSize, fl->idCount);
 
         if (fl->idCount && (*control & fl->allGroups)) {
             switch (fl->idCount) {
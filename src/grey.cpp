@@ -66,6 +66,8 @@ Grey::Grey(void) :
                    allowNoodle(true),
                    fdrAllowTeddy(true),
                    fdrAllowFlood(true),
+                   allowLhash(false),
+                   lhashMinLiterals(20000),
                    violetAvoidSuffixes(true),
                    violetAvoidWeakInfixes(true),
                    violetDoubleCut(true),
@@ -83,12 +85,16 @@ Grey::Grey(void) :
                    allowShermanStates(true),
                    allowMcClellan8(true),
                    allowWideStates(true), // enable wide state for McClellan8
+                   allowMcClellanStride2(true),
+                   mcclellanStride2Limit(16384), // 16 KB
+                   orderDfaStatesByDepth(true),
                    highlanderPruneDFA(true),
                    minimizeDFA(true),
                    accelerateDFA(true),
                    accelerateNFA(true),
                    reverseAccelerate(true),
                    squashNFA(true),
+                   simpleNFAExceptions(true),
                    compressNFAState(true),
                    numberNFAStatesWrong(false), /* debugging only */
                    highlanderSquash(true),
@@ -123,7 +129,9 @@ Grey::Grey(void) :
                    earlyMcClellanSuffix(true),
                    allowCountingMiracles(true),
                    allowSomChain(true),
+                   allowSomRevDfa(true),
                    somMaxRevNfaLength(126),
+                   somSlotSharing(true),
                    hamsterAccelForward(true),
                    hamsterAccelReverse(false),
                    miracleHistoryBonus(16),
@@ -141,8 +149,10 @@ Grey::Grey(void) :
                    smallWriteMaxPatterns(10000),
                    smallWriteMaxLiterals(10000),
                    smallWriteMergeBatchSize(20),
+                   allowExactMatch(true),
                    allowTamarama(true), // Tamarama engine
                    tamaChunkSize(100),
+                   allowShengLanes(true), // Sheng lanes engine
                    dumpFlags(0),
                    limitPatternCount(8000000), // 8M patterns
                    limitPatternLength(16000),  // 16K bytes
@@ -150,6 +160,7 @@ Grey::Grey(void) :
                    limitGraphEdges(1000000), // 1M edges
                    limitReportCount(4*8000000),
                    limitLiteralCount(8000000), // 8M literals
+                   limitLhashLiteralCount(16000000), // 16M literals
                    limitLiteralLength(16000),
                    limitLiteralMatcherChars(1073741824), // 1 GB
                    limitLiteralMatcherSize(1073741824), // 1 GB
@@ -244,6 +255,8 @@ void applyGreyOverrides(Grey *g, const string &s) {
         G_UPDATE(allowApproximateMatching);
         G_UPDATE(fdrAllowTeddy);
         G_UPDATE(fdrAllowFlood);
+        G_UPDATE(allowLhash);
+        G_UPDATE(lhashMinLiterals);
         G_UPDATE(violetAvoidSuffixes);
         G_UPDATE(violetAvoidWeakInfixes);
         G_UPDATE(violetDoubleCut);
@@ -261,12 +274,16 @@ void applyGreyOverrides(Grey *g, const string &s) {
         G_UPDATE(allowShermanStates);
         G_UPDATE(allowMcClellan8);
         G_UPDATE(allowWideStates);
+        G_UPDATE(allowMcClellanStride2);
+        G_UPDATE(mcclellanStride2Limit);
+        G_UPDATE(orderDfaStatesByDepth);
         G_UPDATE(highlanderPruneDFA);
         G_UPDATE(minimizeDFA);
         G_UPDATE(accelerateDFA);
         G_UPDATE(accelerateNFA);
         G_UPDATE(reverseAccelerate);
         G_UPDATE(squashNFA);
+        G_UPDATE(simpleNFAExceptions);
         G_UPDATE(compressNFAState);
         G_UPDATE(numberNFAStatesWrong);
         G_UPDATE(allowZombies);
@@ -300,8 +317,10 @@ void applyGreyOverrides(Grey *g, const string &s) {
         G_UPDATE(earlyMcClellanInfix);
         G_UPDATE(earlyMcClellanSuffix);
         G_UPDATE(allowSomChain);
+        G_UPDATE(allowSomRevDfa);
         G_UPDATE(allowCountingMiracles);
         G_UPDATE(somMaxRevNfaLength);
+        G_UPDATE(somSlotSharing);
         G_UPDATE(hamsterAccelForward);
         G_UPDATE(hamsterAccelReverse);
         G_UPDATE(miracleHistoryBonus);
@@ -314,14 +333,17 @@ void applyGreyOverrides(Grey *g, const string &s) {
         G_UPDATE(smallWriteMaxPatterns);
         G_UPDATE(smallWriteMaxLiterals);
         G_UPDATE(smallWriteMergeBatchSize);
+        G_UPDATE(allowExactMatch);
         G_UPDATE(allowTamarama);
         G_UPDATE(tamaChunkSize);
+        G_UPDATE(allowShengLanes);
         G_UPDATE(limitPatternCount);
         G_UPDATE(limitPatternLength);
         G_UPDATE(limitGraphVertices);
         G_UPDATE(limitGraphEdges);
         G_UPDATE(limitReportCount);
         G_UPDATE(limitLiteralCount);
+        G_UPDATE(limitLhashLiteralCount);
         G_UPDATE(limitLiteralLength);
         G_UPDATE(limitLiteralMatcherChars);
         G_UPDATE(limitLiteralMatcherSize);
@@ -67,6 +67,8 @@ struct Grey {
     bool allowNoodle;
     bool fdrAllowTeddy;
     bool fdrAllowFlood;
+    bool allowLhash; //!< off: not yet benchmarked against FDR
+    u32 lhashMinLiterals; //!< literal count at which Lhash replaces FDR
 
     u32  violetAvoidSuffixes; /* 0=never, 1=sometimes, 2=always */
     bool violetAvoidWeakInfixes;
@@ -88,6 +90,9 @@ struct Grey {
     bool allowShermanStates;
     bool allowMcClellan8;
     bool allowWideStates; // enable wide state for McClellan8
+    bool allowMcClellanStride2; // byte-pair table for McClellan8
+    u32 mcclellanStride2Limit; // max McClellan8 byte-pair table size
+    bool orderDfaStatesByDepth; // give shallow DFA states the lowest ids
     bool highlanderPruneDFA;
     bool minimizeDFA;
 
@@ -96,6 +101,7 @@ struct Grey {
     bool reverseAccelerate;
 
     bool squashNFA;
+    bool simpleNFAExceptions; //!< fast path for successor-only exceptions
     bool compressNFAState;
     bool numberNFAStatesWrong;
     bool highlanderSquash;
@@ -140,7 +146,9 @@ struct Grey {
     bool allowCountingMiracles;
 
     bool allowSomChain;
+    bool allowSomRevDfa;
     u32 somMaxRevNfaLength;
+    bool somSlotSharing;
 
     bool hamsterAccelForward;
     bool hamsterAccelReverse; // currently not implemented
@@ -160,10 +168,16 @@ struct Grey {
     u32 smallWriteMaxLiterals; // only try small writes if fewer literals
     u32 smallWriteMergeBatchSize; // number of DFAs to merge in a batch
 
+    // Exact-match table
+    bool allowExactMatch; //!< perfect hash for fully anchored literal sets
+
     // Tamarama engine
     bool allowTamarama;
     u32 tamaChunkSize; //!< max chunk size for exclusivity analysis in Tamarama
 
+    // Sheng lanes engine
+    bool allowShengLanes; //!< pack small outfix DFAs into vector lanes
+
     enum DumpFlags {
         DUMP_NONE       = 0,
         DUMP_BASICS     = 1 << 0, // Dump basic textual data
@@ -190,6 +204,14 @@ struct Grey {
 
     // HWLM literal matcher limits.
     u32 limitLiteralCount;        //!< max number of literals in an HWLM table
+
+    /** \brief Max number of literals in an HWLM table built as Lhash.
+     *
+     * Lhash stays linear to build at this scale, but it is a scalar
+     * fingerprinting matcher: at 1M literals it already scans random text at
+     * only about 27MB/s in a ~51MB table, so this cap trades scan rate and
+     * memory for the ability to compile such sets at all. */
+    u32 limitLhashLiteralCount;
     u32 limitLiteralLength;       //!< max number of characters in a literal
     u32 limitLiteralMatcherChars; //!< max characters in an HWLM literal matcher
     u32 limitLiteralMatcherSize;  //!< max size of an HWLM matcher (in bytes)
@@ -52,6 +52,8 @@
 #include "util/depth.h"
 #include "util/popcount.h"
 #include "util/target_info.h"
+#include "util/usdt.h"
+#include "util/verify_types.h"
 
 #include <cassert>
 #include <cstddef>
@@ -69,6 +71,7 @@ bool validModeFlags(unsigned int mode) {
     static const unsigned allModeFlags = HS_MODE_BLOCK
                                        | HS_MODE_STREAM
                                        | HS_MODE_VECTORED
+                                       | HS_MODE_TRANSFORM_ALL
                                        | HS_MODE_SOM_HORIZON_LARGE
                                        | HS_MODE_SOM_HORIZON_MEDIUM
                                        | HS_MODE_SOM_HORIZON_SMALL;
@@ -118,6 +121,23 @@ bool checkMode(unsigned int mode, hs_compile_error **comp_error) {
         }
     }
 
+    // Transforms which change the length of the input are applied by the
+    // streaming runtime, which cannot map start of match offsets back.
+    if (mode & HS_MODE_TRANSFORM_RESIZE) {
+        if (!(mode & HS_MODE_STREAM)) {
+            *comp_error = generateCompileError("Invalid parameter: "
+                    "length-changing HS_MODE_TRANSFORM_ mode flags may only "
+                    "be set in streaming mode.", -1);
+            return false;
+        }
+        if (somMode) {
+            *comp_error = generateCompileError("Invalid parameter: "
+                    "length-changing HS_MODE_TRANSFORM_ mode flags cannot be "
+                    "combined with HS_MODE_SOM_HORIZON_ mode flags.", -1);
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -233,8 +253,10 @@ hs_compile_multi_int(const char *const *expressions, const unsigned *flags,
                                     : get_current_target();
 
     try {
-        CompileContext cc(isStreaming, isVectored, target_info, g);
+        CompileContext cc(isStreaming, isVectored, target_info, g,
+                          mode & HS_MODE_TRANSFORM_ALL);
         NG ng(cc, elements, somPrecision);
+        HS_PROBE2(compile__start, elements, mode);
 
         for (unsigned int i = 0; i < elements; i++) {
             // Add this expression to the compiler
@@ -253,12 +275,14 @@ hs_compile_multi_int(const char *const *expressions, const unsigned *flags,
         ng.rm.pl.validateSubIDs(ids, expressions, flags, elements);
         // Renumber and assign lkey to reports
         ng.rm.logicalKeyRenumber();
+        HS_PROBE1(compile__parsed, elements);
 
         unsigned length = 0;
         struct hs_database *out = build(ng, &length, 0);
 
         assert(out);    // should have thrown exception on error
         assert(length);
+        HS_PROBE2(compile__done, out, length);
 
         *db = out;
         *comp_error = nullptr;
@@ -356,8 +380,10 @@ hs_compile_lit_multi_int(const char *const *expressions, const unsigned *flags,
                                     : get_current_target();
 
     try {
-        CompileContext cc(isStreaming, isVectored, target_info, g);
+        CompileContext cc(isStreaming, isVectored, target_info, g,
+                          mode & HS_MODE_TRANSFORM_ALL);
         NG ng(cc, elements, somPrecision);
+        HS_PROBE2(compile__start, elements, mode);
 
         for (unsigned int i = 0; i < elements; i++) {
             // Add this expression to the compiler
@@ -377,12 +403,14 @@ hs_compile_lit_multi_int(const char *const *expressions, const unsigned *flags,
         ng.rm.pl.validateSubIDs(ids, expressions, flags, elements);
         // Renumber and assign lkey to reports
         ng.rm.logicalKeyRenumber();
+        HS_PROBE1(compile__parsed, elements);
 
         unsigned length = 0;
         struct hs_database *out = build(ng, &length, 1);
 
         assert(out);    //should have thrown exception on error
         assert(length);
+        HS_PROBE2(compile__done, out, length);
 
         *db = out;
         *comp_error = nullptr;
@@ -454,6 +482,103 @@ hs_error_t HS_CDECL hs_compile_ext_multi(const char * const *expressions,
                                 platform, db, error, Grey());
 }
 
+static
+void applyAlternative(Grey &g, unsigned alt) {
+    if (alt & HS_ALT_NO_TEDDY) {
+        g.fdrAllowTeddy = false;
+    }
+    if (alt & HS_ALT_NO_DFA) {
+        g.allowMcClellan = false;
+    }
+    if (alt & HS_ALT_NO_ACCEL) {
+        g.accelerateDFA = false;
+        g.accelerateNFA = false;
+    }
+}
+
+extern "C" HS_PUBLIC_API
+hs_error_t HS_CDECL hs_compile_ext_multi_alternatives(
+                                     const char * const *expressions,
+                                     const unsigned *flags, const unsigned *ids,
+                                     const hs_expr_ext * const *ext,
+                                     unsigned elements, unsigned mode,
+                                     const hs_platform_info_t *platform,
+                                     const unsigned *alternatives,
+                                     unsigned alt_count, char **bytes,
+                                     size_t *length,
+                                     hs_compile_error_t **error) {
+    if (!error) {
+        return HS_COMPILER_ERROR;
+    }
+    if (!bytes || !length) {
+        *error = generateCompileError("Invalid parameter: bytes or length is "
+                                      "NULL", -1);
+        return HS_COMPILER_ERROR;
+    }
+    if (!alternatives || !alt_count) {
+        *error = generateCompileError("Invalid parameter: no alternatives "
+                                      "supplied", -1);
+        return HS_COMPILER_ERROR;
+    }
+
+    const unsigned all_alts = HS_ALT_NO_TEDDY | HS_ALT_NO_DFA | HS_ALT_NO_ACCEL;
+
+    vector<hs_database_t *> dbs;
+    hs_compile_error_t *first_error = nullptr;
+    for (unsigned i = 0; i < alt_count; i++) {
+        if (alternatives[i] & ~all_alts) {
+            for (auto db : dbs) {
+                hs_free_database(db);
+            }
+            hs_free_compile_error(first_error);
+            *error = generateCompileError("Invalid parameter: unrecognised "
+                                          "alternative flags", -1);
+            return HS_COMPILER_ERROR;
+        }
+
+        Grey g;
+        applyAlternative(g, alternatives[i]);
+
+        hs_database_t *db = nullptr;
+        hs_compile_error_t *comp_error = nullptr;
+        hs_error_t err = hs_compile_multi_int(expressions, flags, ids, ext,
+                                              elements, mode, platform, &db,
+                                              &comp_error, g);
+        if (err != HS_SUCCESS) {
+            // Not every alternative can be built for every pattern set.
+            DEBUG_PRINTF("alternative %u failed\n", alternatives[i]);
+            if (!first_error) {
+                first_error = comp_error;
+            } else {
+                hs_free_compile_error(comp_error);
+            }
+            continue;
+        }
+        dbs.push_back(db);
+    }
+
+    if (dbs.empty()) {
+        *error = first_error;
+        return HS_COMPILER_ERROR;
+    }
+    hs_free_compile_error(first_error);
+
+    hs_error_t err = hs_serialize_database_multi(dbs.data(),
+                                                 verify_u32(dbs.size()),
+                                                 bytes, length);
+    for (auto db : dbs) {
+        hs_free_database(db);
+    }
+
+    if (err != HS_SUCCESS) {
+        *error = const_cast<hs_compile_error_t *>(&hs_enomem);
+        return HS_COMPILER_ERROR;
+    }
+
+    *error = nullptr;
+    return HS_SUCCESS;
+}
+
 extern "C" HS_PUBLIC_API
 hs_error_t HS_CDECL hs_compile_lit(const char *expression, unsigned flags,
                                    const size_t len, unsigned mode,
@@ -104,6 +104,44 @@ hs_error_t HS_CDECL hs_free_database(hs_database_t *db);
 hs_error_t HS_CDECL hs_serialize_database(const hs_database_t *db, char **bytes,
                                           size_t *length);
 
+/**
+ * Serialize several pattern databases, each compiled for a different target
+ * platform, into a single multi-target stream of bytes.
+ *
+ * The databases should all be compiled from the same patterns in the same mode
+ * with different @ref hs_platform_info_t arguments. The resulting bytes may be
+ * passed to @ref hs_deserialize_database(), @ref hs_deserialize_database_at(),
+ * @ref hs_serialized_database_size() and @ref hs_serialized_database_info(),
+ * which will select the variant using the most CPU features supported by the
+ * current host. Variants with identical bytecode are stored only once.
+ *
+ * The allocator callback set by @ref hs_set_misc_allocator() (or @ref
+ * hs_set_allocator()) will be used by this function.
+ *
+ * @param dbs
+ *      An array of compiled pattern databases.
+ *
+ * @param count
+ *      The number of databases in the @p dbs array. Must be at least one.
+ *
+ * @param bytes
+ *      On success, a pointer to an array of bytes will be returned here.
+ *      These bytes can be subsequently relocated or written to disk. The
+ *      caller is responsible for freeing this block.
+ *
+ * @param length
+ *      On success, the number of bytes in the generated byte array will be
+ *      returned here.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_NOMEM if the byte array cannot be
+ *      allocated, @ref HS_INVALID if the databases were compiled in different
+ *      modes, other values may be returned if errors are detected.
+ */
+hs_error_t HS_CDECL hs_serialize_database_multi(const hs_database_t *const *dbs,
+                                                unsigned int count,
+                                                char **bytes, size_t *length);
+
 /**
  * Reconstruct a pattern database from a stream of bytes previously generated
  * by @ref hs_serialize_database().
@@ -583,6 +621,26 @@ hs_error_t HS_CDECL hs_valid_platform(void);
  */
 #define HS_UNKNOWN_ERROR   (-13)
 
+/**
+ * The scan was suspended after exhausting its budget.
+ *
+ * This is returned by @ref hs_scan_resumable() and @ref hs_resume_scan() when
+ * the byte or match budget for the call was used up before the end of the
+ * data was reached. The scan may be continued with @ref hs_resume_scan().
+ */
+#define HS_SCAN_SUSPENDED       (-14)
+
+/**
+ * The scan was halted after exceeding its work budget.
+ *
+ * This is returned by the scan functions when a work budget has been set on
+ * the scratch space with @ref hs_set_scratch_work_limit() using the @ref
+ * HS_WORK_ACTION_ABORT action, and the call exceeded it. As with @ref
+ * HS_SCAN_TERMINATED, a stream which returns this error will not produce any
+ * further matches.
+ */
+#define HS_SCAN_WORK_EXCEEDED   (-15)
+
 /** @} */
 
 #ifdef __cplusplus
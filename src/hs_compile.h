@@ -327,6 +327,9 @@ typedef struct hs_expr_ext {
  *                               syntax.
  *       - HS_FLAG_QUIET - Ignore match reporting for this expression. Used for
  *                         the sub-expressions in logical combinations.
+ *       - HS_FLAG_SOM_ON_DEMAND - Allow the start of match offset to be
+ *                                 computed after a match with
+ *                                 @ref hs_find_start().
  *
  * @param mode
  *      Compiler mode flags that affect the database as a whole. One of @ref
@@ -400,6 +403,9 @@ hs_error_t HS_CDECL hs_compile(const char *expression, unsigned int flags,
  *                               syntax.
  *       - HS_FLAG_QUIET - Ignore match reporting for this expression. Used for
  *                         the sub-expressions in logical combinations.
+ *       - HS_FLAG_SOM_ON_DEMAND - Allow the start of match offset to be
+ *                                 computed after a match with
+ *                                 @ref hs_find_start().
  *
  * @param ids
  *      An array of integers specifying the ID number to be associated with the
@@ -484,6 +490,9 @@ hs_error_t HS_CDECL hs_compile_multi(const char *const *expressions,
  *                               syntax.
  *       - HS_FLAG_QUIET - Ignore match reporting for this expression. Used for
  *                         the sub-expressions in logical combinations.
+ *       - HS_FLAG_SOM_ON_DEMAND - Allow the start of match offset to be
+ *                                 computed after a match with
+ *                                 @ref hs_find_start().
  *
  * @param ids
  *      An array of integers specifying the ID number to be associated with the
@@ -539,6 +548,87 @@ hs_error_t HS_CDECL hs_compile_ext_multi(const char *const *expressions,
                                 const hs_platform_info_t *platform,
                                 hs_database_t **db, hs_compile_error_t **error);
 
+/**
+ * The multiple regular expression compiler producing alternative engine
+ * selections for load-time calibration.
+ *
+ * This function call compiles a group of expressions in the same way as @ref
+ * hs_compile_ext_multi(), once for each requested set of engine alternative
+ * flags (see @ref HS_ALT_FLAG), and serializes the results as a single
+ * multi-target stream of bytes. Alternatives producing identical bytecode are
+ * stored only once, and alternatives that cannot be built for the given
+ * expressions are omitted.
+ *
+ * The winning variant for the current host may be chosen at load time with
+ * @ref hs_deserialize_database_calibrated(); the other deserialization
+ * functions select the first variant.
+ *
+ * @param expressions
+ *      Array of NULL-terminated expressions to compile, as for @ref
+ *      hs_compile_ext_multi().
+ *
+ * @param flags
+ *      Array of flags which modify the behaviour of each expression, as for
+ *      @ref hs_compile_ext_multi().
+ *
+ * @param ids
+ *      An array of integers specifying the ID number to be associated with the
+ *      corresponding pattern in the expressions array, as for @ref
+ *      hs_compile_ext_multi().
+ *
+ * @param ext
+ *      An array of pointers to filled @ref hs_expr_ext_t structures, as for
+ *      @ref hs_compile_ext_multi().
+ *
+ * @param elements
+ *      The number of elements in the input arrays.
+ *
+ * @param mode
+ *      Compiler mode flags that affect the database as a whole. See @ref
+ *      HS_MODE_FLAG for more details.
+ *
+ * @param platform
+ *      If not NULL, the platform structure is used to determine the target
+ *      platform for the database. If NULL, a database suitable for running
+ *      on the current host platform is produced.
+ *
+ * @param alternatives
+ *      Array of engine alternative flags, one per variant to be built. @ref
+ *      HS_ALT_DEFAULT selects the compiler's usual choices.
+ *
+ * @param alt_count
+ *      The number of elements in the @p alternatives array.
+ *
+ * @param bytes
+ *      On success, a pointer to an array of bytes will be returned here. The
+ *      caller is responsible for freeing this block.
+ *
+ * @param length
+ *      On success, the number of bytes in the generated byte array will be
+ *      returned here.
+ *
+ * @param error
+ *      If the compile fails, a pointer to a @ref hs_compile_error_t will be
+ *      returned, providing details of the error condition. The caller is
+ *      responsible for deallocating the buffer using the @ref
+ *      hs_free_compile_error() function.
+ *
+ * @return
+ *      @ref HS_SUCCESS is returned on successful compilation; @ref
+ *      HS_COMPILER_ERROR on failure, with details provided in the @p error
+ *      parameter.
+ */
+hs_error_t HS_CDECL hs_compile_ext_multi_alternatives(
+                                const char *const *expressions,
+                                const unsigned int *flags,
+                                const unsigned int *ids,
+                                const hs_expr_ext_t *const *ext,
+                                unsigned int elements, unsigned int mode,
+                                const hs_platform_info_t *platform,
+                                const unsigned int *alternatives,
+                                unsigned int alt_count, char **bytes,
+                                size_t *length, hs_compile_error_t **error);
+
 /**
  * The basic pure literal expression compiler.
  *
@@ -1010,6 +1100,21 @@ hs_error_t HS_CDECL hs_populate_platform(hs_platform_info_t *platform);
  */
 #define HS_FLAG_QUIET           1024
 
+/**
+ * Compile flag: Enable start of match computation on demand.
+ *
+ * This flag instructs Hyperscan to store the additional information needed to
+ * compute the leftmost start of match offset of this expression with @ref
+ * hs_find_start(), only for the matches the application asks about. Unlike
+ * @ref HS_FLAG_SOM_LEFTMOST, it does not change how the expression is scanned
+ * and adds nothing to stream state: matches are reported with a start offset
+ * of zero, and the application must retain the input needed to compute the
+ * start (see @ref hs_find_start_history()).
+ *
+ * This flag may not be used in combination with @ref HS_FLAG_SOM_LEFTMOST.
+ */
+#define HS_FLAG_SOM_ON_DEMAND   2048
+
 /** @} */
 
 /**
@@ -1141,6 +1246,41 @@ hs_error_t HS_CDECL hs_populate_platform(hs_platform_info_t *platform);
 
 /** @} */
 
+/**
+ * @defgroup HS_ALT_FLAG Engine alternative flags
+ *
+ * These flags select alternative engine implementations when building
+ * variants for calibration with @ref hs_compile_ext_multi_alternatives().
+ * Multiple flags may be or'ed together.
+ *
+ * @{
+ */
+
+/**
+ * Engine alternative flag: use the compiler's usual engine selection.
+ */
+#define HS_ALT_DEFAULT          0
+
+/**
+ * Engine alternative flag: do not use the Teddy literal matcher; small literal
+ * sets are matched with FDR instead.
+ */
+#define HS_ALT_NO_TEDDY         1
+
+/**
+ * Engine alternative flag: do not convert NFA graphs to McClellan DFAs;
+ * LimEx NFAs are used instead where possible.
+ */
+#define HS_ALT_NO_DFA           2
+
+/**
+ * Engine alternative flag: do not build acceleration schemes for DFA or NFA
+ * states.
+ */
+#define HS_ALT_NO_ACCEL         4
+
+/** @} */
+
 /**
  * @defgroup HS_MODE_FLAG Compile mode flags
  *
@@ -1176,6 +1316,53 @@ hs_error_t HS_CDECL hs_populate_platform(hs_platform_info_t *platform);
  */
 #define HS_MODE_VECTORED        4
 
+/**
+ * Compiler mode flag: match against the input as if it had been lowercased.
+ *
+ * Uppercase ASCII letters in the input are treated as their lowercase
+ * equivalents, so that (for example) the pattern "select" will match the input
+ * "SeLeCt", while the pattern "Select" can never match. This transform is
+ * folded into the patterns at compile time and has no scan time cost.
+ *
+ * Input transforms are applied in the following order: @ref
+ * HS_MODE_TRANSFORM_PERCENT_DECODE, then @ref HS_MODE_TRANSFORM_STRIP_NUL and
+ * @ref HS_MODE_TRANSFORM_STRIP_SPACE, then @ref HS_MODE_TRANSFORM_LOWERCASE.
+ */
+#define HS_MODE_TRANSFORM_LOWERCASE (1U << 16)
+
+/**
+ * Compiler mode flag: remove NUL (0x00) bytes from the input before matching.
+ *
+ * This transform changes the length of the input. It is applied by the
+ * streaming runtime as data is scanned, and match offsets are reported in
+ * terms of the original (untransformed) input. It may only be used with @ref
+ * HS_MODE_STREAM, and may not be combined with the HS_MODE_SOM_HORIZON_ mode
+ * flags.
+ */
+#define HS_MODE_TRANSFORM_STRIP_NUL (1U << 17)
+
+/**
+ * Compiler mode flag: remove whitespace (space, \\t, \\n, \\v, \\f and \\r)
+ * from the input before matching.
+ *
+ * This transform changes the length of the input; the restrictions described
+ * for @ref HS_MODE_TRANSFORM_STRIP_NUL apply.
+ */
+#define HS_MODE_TRANSFORM_STRIP_SPACE (1U << 18)
+
+/**
+ * Compiler mode flag: decode URL percent-escapes in the input before matching.
+ *
+ * Each "%XX" sequence, where X is a hexadecimal digit, is replaced by the byte
+ * it encodes; a "%" not followed by two hexadecimal digits is matched as
+ * itself. Escapes split across stream writes are decoded correctly.
+ *
+ * This transform changes the length of the input; the restrictions described
+ * for @ref HS_MODE_TRANSFORM_STRIP_NUL apply. Matches ending inside an escape
+ * sequence are reported at the end of that sequence.
+ */
+#define HS_MODE_TRANSFORM_PERCENT_DECODE (1U << 19)
+
 /**
  * Compiler mode flag: use full precision to track start of match offsets in
  * stream state.
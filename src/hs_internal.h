@@ -80,7 +80,41 @@ extern "C"
                     | HS_FLAG_PREFILTER \
                     | HS_FLAG_SINGLEMATCH \
                     | HS_FLAG_ALLOWEMPTY \
-                    | HS_FLAG_SOM_LEFTMOST)
+                    | HS_FLAG_SOM_LEFTMOST \
+                    | HS_FLAG_SOM_ON_DEMAND)
+
+/** \brief Bitmask of all input transform mode flags. */
+#define HS_MODE_TRANSFORM_ALL ( HS_MODE_TRANSFORM_LOWERCASE \
+                              | HS_MODE_TRANSFORM_STRIP_NUL \
+                              | HS_MODE_TRANSFORM_STRIP_SPACE \
+                              | HS_MODE_TRANSFORM_PERCENT_DECODE)
+
+/** \brief Input transforms which change the length of the input. These are
+ * applied by the streaming runtime; the rest are folded into the patterns. */
+#define HS_MODE_TRANSFORM_RESIZE ( HS_MODE_TRANSFORM_STRIP_NUL \
+                                 | HS_MODE_TRANSFORM_STRIP_SPACE \
+                                 | HS_MODE_TRANSFORM_PERCENT_DECODE)
+
+/**
+ * \brief Internal use only: the size in bytes of a profile table for the
+ * given database.
+ *
+ * Returns HS_INVALID if the library was built without BUILD_TRACE.
+ */
+hs_error_t hs_profile_size(const hs_database_t *db, size_t *size);
+
+/**
+ * \brief Internal use only: attach a profile table, an 8-byte aligned array
+ * of struct profile_slot (see trace.h) of at least hs_profile_size() bytes,
+ * to a scratch space. The table is zeroed, then counts literal matches and
+ * program runs for scans of the given database, indexed by Rose program
+ * offset. Scans of other databases are not counted.
+ *
+ * Pass a NULL buffer to detach the table.
+ */
+hs_error_t hs_set_scratch_profile(hs_scratch_t *scratch,
+                                  const hs_database_t *db, void *buf,
+                                  size_t len);
 
 #ifdef __cplusplus
 } /* extern "C" */
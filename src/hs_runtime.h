@@ -526,6 +526,266 @@ hs_error_t HS_CDECL hs_scan_vector(const hs_database_t *db,
                                    hs_scratch_t *scratch,
                                    match_event_handler onEvent, void *context);
 
+/**
+ * Begin a resumable scan of a single block of data.
+ *
+ * This scans @p data as a single block, as @ref hs_scan() would, but does so
+ * in slices so that at most @p max_bytes bytes are scanned by this call. If
+ * the budget is used up before the end of the data, @ref HS_SCAN_SUSPENDED is
+ * returned and the scan may be continued later with @ref hs_resume_scan().
+ * The matches produced across all calls are identical to those of an
+ * uninterrupted scan, including any reported at the end of the data.
+ *
+ * The continuation is held in the scratch space: no other allocation takes
+ * place. The scratch may be used for other scans while this one is suspended;
+ * starting another resumable scan with the same scratch, or reallocating it
+ * with @ref hs_alloc_scratch(), abandons the suspended scan. The @p data
+ * buffer must remain valid until the scan completes.
+ *
+ * Resumable scans build on the streaming runtime, and so require a database
+ * compiled in vectored (@ref HS_MODE_VECTORED) or streaming (@ref
+ * HS_MODE_STREAM) mode; block mode databases are rejected with @ref
+ * HS_DB_MODE_ERROR. A block mode scan cannot be suspended part way through:
+ * it runs its eager prefixes, anchored matcher and literal matcher each over
+ * the whole block in turn, keeping their progress in scratch as pointers into
+ * the block, and its engines are built without the compressed state and
+ * history needed to stop at one offset and carry on from it later.
+ *
+ * @param db
+ *      A compiled pattern database.
+ *
+ * @param data
+ *      Pointer to the data to be scanned.
+ *
+ * @param length
+ *      The number of bytes to scan.
+ *
+ * @param flags
+ *      Flags modifying the behaviour of this function. This parameter is
+ *      provided for future use and is unused at present.
+ *
+ * @param max_bytes
+ *      The maximum number of bytes to scan in this call, or zero for no limit.
+ *
+ * @param max_matches
+ *      If non-zero, the scan is suspended once at least this many matches have
+ *      been delivered by this call. The match count is checked every few
+ *      kilobytes of data, so more matches than this may be delivered.
+ *
+ * @param scratch
+ *      A per-thread scratch space allocated by @ref hs_alloc_scratch() for this
+ *      database.
+ *
+ * @param onEvent
+ *      Pointer to a match event callback function. If a NULL pointer is given,
+ *      no matches will be returned.
+ *
+ * @param context
+ *      The user defined pointer which will be passed to the callback function.
+ *
+ * @return
+ *      Returns @ref HS_SUCCESS if the scan completed; @ref HS_SCAN_SUSPENDED if
+ *      the budget was used up first; @ref HS_SCAN_TERMINATED if the match
+ *      callback indicated that scanning should stop; other values on error.
+ */
+hs_error_t HS_CDECL hs_scan_resumable(const hs_database_t *db,
+                                      const char *data, unsigned int length,
+                                      unsigned int flags,
+                                      unsigned int max_bytes,
+                                      unsigned int max_matches,
+                                      hs_scratch_t *scratch,
+                                      match_event_handler onEvent,
+                                      void *context);
+
+/**
+ * Continue a resumable scan suspended in the given scratch space.
+ *
+ * @param scratch
+ *      The scratch space given to the @ref hs_scan_resumable() call which
+ *      started the scan.
+ *
+ * @param max_bytes
+ *      The maximum number of bytes to scan in this call, or zero for no limit.
+ *
+ * @param max_matches
+ *      If non-zero, the scan is suspended again once at least this many
+ *      matches have been delivered by this call.
+ *
+ * @param onEvent
+ *      Pointer to a match event callback function. If a NULL pointer is given,
+ *      no matches will be returned.
+ *
+ * @param context
+ *      The user defined pointer which will be passed to the callback function.
+ *
+ * @return
+ *      Returns @ref HS_SUCCESS if the scan completed; @ref HS_SCAN_SUSPENDED if
+ *      the budget was used up first; @ref HS_SCAN_TERMINATED if the match
+ *      callback indicated that scanning should stop; @ref HS_INVALID if no
+ *      scan is suspended in @p scratch; other values on error.
+ */
+hs_error_t HS_CDECL hs_resume_scan(hs_scratch_t *scratch,
+                                   unsigned int max_bytes,
+                                   unsigned int max_matches,
+                                   match_event_handler onEvent,
+                                   void *context);
+
+/**
+ * @defgroup HS_DB_CAP Database capability flags
+ *
+ * @{
+ */
+
+/**
+ * Database capability flag: block-mode scans of this database may be run with
+ * @ref hs_scan_scratchless(), without any scratch space.
+ *
+ * This is set for block-mode databases which reduce to a single set of
+ * literals, or to a single DFA, and whose matches need no further processing
+ * before being reported (e.g. no start of match tracking, logical
+ * combinations or boundary reports).
+ */
+#define HS_DB_CAP_SCRATCHLESS   1ULL
+
+/** @} */
+
+/**
+ * Query the optional runtime capabilities of a database.
+ *
+ * @param db
+ *      A compiled pattern database.
+ *
+ * @param caps
+ *      On success, a bitmask of @ref HS_DB_CAP_SCRATCHLESS and other
+ *      HS_DB_CAP_* flags is written here.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, other values on failure.
+ */
+hs_error_t HS_CDECL hs_database_capabilities(const hs_database_t *db,
+                                             unsigned long long *caps);
+
+/**
+ * The block regular expression scanner for databases which do not need
+ * scratch space.
+ *
+ * This behaves as @ref hs_scan(), but keeps all of its scan state on the
+ * stack: no scratch space is required, and any number of threads may scan
+ * with the same database concurrently. It may only be used with databases for
+ * which @ref hs_database_capabilities() reports @ref HS_DB_CAP_SCRATCHLESS.
+ *
+ * @param db
+ *      A compiled pattern database.
+ *
+ * @param data
+ *      Pointer to the data to be scanned.
+ *
+ * @param length
+ *      The number of bytes to scan.
+ *
+ * @param flags
+ *      Flags modifying the behaviour of this function. This parameter is
+ *      provided for future use and is unused at present.
+ *
+ * @param onEvent
+ *      Pointer to a match event callback function. If a NULL pointer is given,
+ *      no matches will be returned.
+ *
+ * @param context
+ *      The user defined pointer which will be passed to the callback function.
+ *
+ * @return
+ *      Returns @ref HS_SUCCESS on success; @ref HS_SCAN_TERMINATED if the
+ *      match callback indicated that scanning should stop; @ref
+ *      HS_DB_MODE_ERROR if the database cannot be scanned without scratch;
+ *      other values on error.
+ */
+hs_error_t HS_CDECL hs_scan_scratchless(const hs_database_t *db,
+                                        const char *data, unsigned int length,
+                                        unsigned int flags,
+                                        match_event_handler onEvent,
+                                        void *context);
+
+/**
+ * Compute the leftmost start of a match on demand.
+ *
+ * For a pattern compiled with @ref HS_FLAG_SOM_ON_DEMAND, this function finds
+ * the leftmost start offset of a match of the pattern ending at the given end
+ * offset, by scanning the data backwards from that offset. It may be called
+ * from within a match callback or afterwards, with any database mode, and
+ * needs no scratch space.
+ *
+ * The data given must contain the end of the match, and must either start at
+ * the beginning of the input (@p data_offset of zero) or contain at least the
+ * number of bytes before the end of the match reported by @ref
+ * hs_find_start_history(). In streaming mode, the application is responsible
+ * for retaining this much of the stream. A pattern that can only match at the
+ * end of the data (for example, one ending in `$`) is only considered if @p to
+ * is at the end of the given data.
+ *
+ * @param db
+ *      A compiled pattern database.
+ *
+ * @param id
+ *      The ID number of the expression that matched.
+ *
+ * @param to
+ *      The offset after the last byte of the match, as passed to the match
+ *      callback.
+ *
+ * @param data
+ *      Pointer to the input data containing the match.
+ *
+ * @param length
+ *      The number of bytes of input data.
+ *
+ * @param data_offset
+ *      The offset of the first byte of @p data in the input (the stream offset
+ *      in streaming mode, otherwise zero).
+ *
+ * @param from
+ *      On success, the leftmost start offset of the match is written here.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success; @ref HS_INVALID if the expression was not
+ *      compiled with @ref HS_FLAG_SOM_ON_DEMAND, if the data does not contain
+ *      enough of the input, or if no match of the expression ends at @p to;
+ *      other values on error.
+ */
+hs_error_t HS_CDECL hs_find_start(const hs_database_t *db, unsigned int id,
+                                  unsigned long long to, const char *data,
+                                  unsigned int length,
+                                  unsigned long long data_offset,
+                                  unsigned long long *from);
+
+/**
+ * Query how much input must be retained to compute the start of a match on
+ * demand with @ref hs_find_start().
+ *
+ * This is a compile-time property of the expression: the greatest length of
+ * any match of it.
+ *
+ * @param db
+ *      A compiled pattern database.
+ *
+ * @param id
+ *      The ID number of an expression compiled with @ref
+ *      HS_FLAG_SOM_ON_DEMAND.
+ *
+ * @param history
+ *      On success, the number of bytes before the end of a match that may be
+ *      needed is written here, or @ref HS_OFFSET_PAST_HORIZON if matches may
+ *      be of any length (in which case the data must start at the beginning
+ *      of the input).
+ *
+ * @return
+ *      @ref HS_SUCCESS on success; @ref HS_INVALID if the expression was not
+ *      compiled with @ref HS_FLAG_SOM_ON_DEMAND; other values on error.
+ */
+hs_error_t HS_CDECL hs_find_start_history(const hs_database_t *db,
+                                          unsigned int id,
+                                          unsigned long long *history);
+
 /**
  * Allocate a "scratch" space for use by Hyperscan.
  *
@@ -608,6 +868,185 @@ hs_error_t HS_CDECL hs_scratch_size(const hs_scratch_t *scratch,
  */
 hs_error_t HS_CDECL hs_free_scratch(hs_scratch_t *scratch);
 
+/**
+ * @defgroup HS_WORK_ACTION Work budget actions
+ *
+ * @{
+ */
+
+/**
+ * Work budget action: halt the scan, which returns @ref
+ * HS_SCAN_WORK_EXCEEDED.
+ */
+#define HS_WORK_ACTION_ABORT    0
+
+/**
+ * Work budget action: continue the scan to completion, noting that the budget
+ * was exceeded. This may be queried with @ref hs_scratch_work() afterwards.
+ */
+#define HS_WORK_ACTION_FLAG     1
+
+/** @} */
+
+/**
+ * Set a per-call work budget on a scratch space.
+ *
+ * Each scan, stream or close call made with this scratch space counts the
+ * internal work it performs: literal confirmations, match program runs and
+ * engine events. Unlike a timeout this count is independent of the host and
+ * its load, so a budget reproducibly bounds the cost of pathological inputs.
+ * When a call exceeds @p limit units of work, @p action is taken.
+ *
+ * The budget is kept by scratch spaces reallocated by @ref hs_alloc_scratch()
+ * and copied by @ref hs_clone_scratch().
+ *
+ * @param scratch
+ *      A scratch space that is not currently in use.
+ *
+ * @param limit
+ *      The number of units of work a single call may perform, or zero to
+ *      remove the budget.
+ *
+ * @param action
+ *      One of @ref HS_WORK_ACTION_ABORT or @ref HS_WORK_ACTION_FLAG.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_SCRATCH_IN_USE if the scratch space
+ *      is in use, other values on failure.
+ */
+hs_error_t HS_CDECL hs_set_scratch_work_limit(hs_scratch_t *scratch,
+                                              unsigned long long limit,
+                                              unsigned int action);
+
+/**
+ * Retrieve the work done by the last call made with a scratch space.
+ *
+ * Work is only counted while a budget is set with @ref
+ * hs_set_scratch_work_limit(); without one, zero is reported.
+ *
+ * @param scratch
+ *      A scratch space that is not currently in use.
+ *
+ * @param work
+ *      On success, the units of work performed by the last call are written
+ *      here.
+ *
+ * @param exceeded
+ *      Optional; if not NULL, on success this is set to non-zero if the last
+ *      call exceeded the budget set by @ref hs_set_scratch_work_limit().
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_SCRATCH_IN_USE if the scratch space
+ *      is in use, other values on failure.
+ */
+hs_error_t HS_CDECL hs_scratch_work(const hs_scratch_t *scratch,
+                                    unsigned long long *work, int *exceeded);
+
+/**
+ * Attach a trace buffer to a scratch space.
+ *
+ * While a buffer is attached, each scan, stream or close call made with this
+ * scratch space appends a compact binary record of its internal events to
+ * it: literal matches, match program runs, engine activations and runs,
+ * catchup points and reports, bracketed by the start and end of each call.
+ * Recording stops when the buffer is full, and further events are counted as
+ * dropped. The buffer may be written to a file as is and summarised with the
+ * `hstrace` tool.
+ *
+ * Tracing is only available when the library is built with the BUILD_TRACE
+ * CMake option, as it adds a check to every traced event. A buffer is not
+ * carried over to scratch spaces reallocated by @ref hs_alloc_scratch() or
+ * copied by @ref hs_clone_scratch().
+ *
+ * @param scratch
+ *      A scratch space that is not currently in use.
+ *
+ * @param buf
+ *      An 8-byte aligned buffer that will hold the trace, which must remain
+ *      valid while it is attached, or NULL to detach the current buffer.
+ *      Detaching or replacing a buffer stamps its header with the end time,
+ *      which readers use to convert event timestamps to nanoseconds, so a
+ *      trace should be detached before it is saved.
+ *
+ * @param len
+ *      The size of @p buf in bytes.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_BAD_ALIGN if @p buf is not
+ *      aligned, @ref HS_SCRATCH_IN_USE if the scratch space is in use, @ref
+ *      HS_INVALID if @p len is too small to hold the trace header or the
+ *      library was built without trace support, other values on failure.
+ */
+hs_error_t HS_CDECL hs_set_scratch_trace(hs_scratch_t *scratch, void *buf,
+                                         size_t len);
+
+/**
+ * Retrieve the number of bytes of the attached trace buffer in use.
+ *
+ * This is the length to write out when saving the trace to a file.
+ *
+ * @param scratch
+ *      A scratch space that is not currently in use and has a trace buffer
+ *      attached with @ref hs_set_scratch_trace().
+ *
+ * @param size
+ *      On success, the number of bytes of the trace buffer in use.
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_SCRATCH_IN_USE if the scratch space
+ *      is in use, @ref HS_INVALID if no trace buffer is attached, other values
+ *      on failure.
+ */
+hs_error_t HS_CDECL hs_scratch_trace_size(const hs_scratch_t *scratch,
+                                          size_t *size);
+
+/**
+ * Reconstruct a pattern database from a multi-target stream of bytes, choosing
+ * the variant that scans a sample of representative data fastest on this
+ * host.
+ *
+ * Every variant which can run on the current platform is deserialized and
+ * timed scanning @p sample in the mode it was compiled for; the fastest is
+ * returned and the others are freed. This is intended for use with the
+ * output of @ref hs_compile_ext_multi_alternatives() or @ref
+ * hs_serialize_database_multi(), and should be called once at load time, as
+ * each variant is scanned several times. For a stream of bytes holding a
+ * single database this is equivalent to @ref hs_deserialize_database().
+ *
+ * Scratch space for timing is allocated internally, using the allocator set
+ * with @ref hs_set_scratch_allocator() (or @ref hs_set_allocator()).
+ *
+ * @param bytes
+ *      A byte array generated by @ref hs_serialize_database_multi() or @ref
+ *      hs_compile_ext_multi_alternatives().
+ *
+ * @param length
+ *      The length of the byte array.
+ *
+ * @param sample
+ *      Representative data to be scanned for calibration. Matches in the
+ *      sample are discarded. May not be NULL.
+ *
+ * @param sample_length
+ *      The length of the sample in bytes. May not be zero.
+ *
+ * @param db
+ *      On success, a pointer to a newly allocated @ref hs_database_t will be
+ *      returned here. This database can then be used for scanning, and
+ *      eventually freed by the caller using @ref hs_free_database().
+ *
+ * @return
+ *      @ref HS_SUCCESS on success, @ref HS_DB_PLATFORM_ERROR if no variant can
+ *      run on this platform, other values on failure. A variant which fails
+ *      to scan the sample is skipped; an error is only returned if none of
+ *      the variants could be timed.
+ */
+hs_error_t HS_CDECL hs_deserialize_database_calibrated(const char *bytes,
+                                                       const size_t length,
+                                                       const char *sample,
+                                                       unsigned int sample_length,
+                                                       hs_database_t **db);
+
 /**
  * Callback 'from' return value, indicating that the start of this match was
  * too early to be tracked with the requested SOM_HORIZON precision.
@@ -32,6 +32,7 @@
  */
 #include "hwlm.h"
 #include "hwlm_internal.h"
+#include "lhash_engine.h"
 #include "noodle_engine.h"
 #include "scratch.h"
 #include "ue2common.h"
@@ -63,11 +64,11 @@ const u8 *run_hwlm_accel(const union AccelAux *aux, const u8 *ptr,
         DEBUG_PRINTF("double vermicelli-nocase for 0x%02hhx%02hhx\n",
                      aux->dverm.c1, aux->dverm.c2);
         return vermicelliDoubleExec(aux->dverm.c1, aux->dverm.c2, 1, ptr, end);
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
     case ACCEL_VERM16:
         DEBUG_PRINTF("single vermicelli16\n");
         return vermicelli16Exec(aux->verm16.mask, ptr, end);
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
     case ACCEL_SHUFTI:
         DEBUG_PRINTF("single shufti\n");
         return shuftiExec(aux->shufti.lo, aux->shufti.hi, ptr, end);
@@ -193,13 +194,20 @@ hwlm_error_t hwlmExec(const struct HWLM *t, const u8 *buf, size_t len,
         return noodExec(HWLM_C_DATA(t), buf, len, start, cb, scratch);
     }
 
-    assert(t->type == HWLM_ENGINE_FDR);
+    assert(t->type == HWLM_ENGINE_FDR || t->type == HWLM_ENGINE_LHASH);
     const union AccelAux *aa = &t->accel0;
     if ((groups & ~t->accel1_groups) == 0) {
         DEBUG_PRINTF("using hq accel %hhu\n", t->accel1.accel_type);
         aa = &t->accel1;
     }
     do_accel_block(aa, buf, len, &start);
+
+    if (t->type == HWLM_ENGINE_LHASH) {
+        DEBUG_PRINTF("calling lhash (groups=%08llx, start=%zu)\n", groups,
+                     start);
+        return lhashExec(HWLM_C_DATA(t), buf, len, start, cb, scratch, groups);
+    }
+
     DEBUG_PRINTF("calling frankie (groups=%08llx, start=%zu)\n", groups, start);
     return fdrExec(HWLM_C_DATA(t), buf, len, start, cb, scratch, groups);
 }
@@ -235,13 +243,21 @@ hwlm_error_t hwlmExecStreaming(const struct HWLM *t, size_t len, size_t start,
         }
     }
 
-    assert(t->type == HWLM_ENGINE_FDR);
+    assert(t->type == HWLM_ENGINE_FDR || t->type == HWLM_ENGINE_LHASH);
     const union AccelAux *aa = &t->accel0;
     if ((groups & ~t->accel1_groups) == 0) {
         DEBUG_PRINTF("using hq accel %hhu\n", t->accel1.accel_type);
         aa = &t->accel1;
     }
     do_accel_streaming(aa, hbuf, hlen, buf, len, &start);
+
+    if (t->type == HWLM_ENGINE_LHASH) {
+        DEBUG_PRINTF("calling lhash (groups=%08llx, start=%zu)\n", groups,
+                     start);
+        return lhashExecStreaming(HWLM_C_DATA(t), hbuf, hlen, buf, len, start,
+                                  cb, scratch, groups);
+    }
+
     DEBUG_PRINTF("calling frankie (groups=%08llx, start=%zu)\n", groups, start);
     return fdrExecStreaming(HWLM_C_DATA(t), hbuf, hlen, buf, len, start, cb,
                             scratch, groups);
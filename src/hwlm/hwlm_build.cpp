@@ -36,6 +36,7 @@
 #include "hwlm.h"
 #include "hwlm_internal.h"
 #include "hwlm_literal.h"
+#include "lhash_build.h"
 #include "noodle_engine.h"
 #include "noodle_build.h"
 #include "scratch.h"
@@ -117,6 +118,20 @@ bool isNoodleable(const vector<hwlmLiteral> &lits,
     return true;
 }
 
+static
+bool isLhashable(const vector<hwlmLiteral> &lits, const CompileContext &cc) {
+    if (!cc.grey.allowLhash) {
+        return false;
+    }
+
+    if (lits.size() < cc.grey.lhashMinLiterals) {
+        DEBUG_PRINTF("too few literals for lhash\n");
+        return false;
+    }
+
+    return lhashCanBuild(lits);
+}
+
 bytecode_ptr<HWLM> hwlmBuild(const HWLMProto &proto, const CompileContext &cc,
                              UNUSED hwlm_group_t expected_groups) {
     size_t engSize = 0;
@@ -133,6 +148,13 @@ bytecode_ptr<HWLM> hwlmBuild(const HWLMProto &proto, const CompileContext &cc,
             engSize = noodle.size();
         }
         eng = move(noodle);
+    } else if (proto.engType == HWLM_ENGINE_LHASH) {
+        DEBUG_PRINTF("build lhash table\n");
+        auto lhash = lhashBuildTable(lits);
+        if (lhash) {
+            engSize = lhash.size();
+        }
+        eng = move(lhash);
     } else {
         DEBUG_PRINTF("building a new deal\n");
         auto fdr = fdrBuildTable(proto, cc.grey);
@@ -166,9 +188,13 @@ hwlmBuildProto(vector<hwlmLiteral> &lits, bool make_small,
     assert(!lits.empty());
     dumpLits(lits);
 
-    // Check that we haven't exceeded the maximum number of literals.
+    // Check that we haven't exceeded the maximum number of literals. Sets that
+    // Lhash can take have a higher cap of their own.
     if (lits.size() > cc.grey.limitLiteralCount) {
-        throw ResourceLimitError();
+        if (lits.size() > cc.grey.limitLhashLiteralCount
+            || !isLhashable(lits, cc)) {
+            throw ResourceLimitError();
+        }
     }
 
     // Safety and resource limit checks.
@@ -201,6 +227,9 @@ hwlmBuildProto(vector<hwlmLiteral> &lits, bool make_small,
     if (isNoodleable(lits, cc)) {
         DEBUG_PRINTF("build noodle table\n");
         proto = std::make_unique<HWLMProto>(HWLM_ENGINE_NOOD, lits);
+    } else if (isLhashable(lits, cc)) {
+        DEBUG_PRINTF("build lhash table\n");
+        proto = std::make_unique<HWLMProto>(HWLM_ENGINE_LHASH, lits);
     } else {
         DEBUG_PRINTF("building a new deal\n");
         proto = fdrBuildProto(HWLM_ENGINE_FDR, lits, make_small,
@@ -223,6 +252,9 @@ size_t hwlmSize(const HWLM *h) {
     case HWLM_ENGINE_FDR:
         engSize = fdrSize((const FDR *)HWLM_C_DATA(h));
         break;
+    case HWLM_ENGINE_LHASH:
+        engSize = lhashSize((const LHash *)HWLM_C_DATA(h));
+        break;
     }
 
     if (!engSize) {
@@ -34,6 +34,7 @@
 
 #include "hwlm_dump.h"
 #include "hwlm_internal.h"
+#include "lhash_build.h"
 #include "noodle_build.h"
 #include "ue2common.h"
 #include "fdr/fdr_dump.h"
@@ -58,6 +59,9 @@ void hwlmGenerateDumpFiles(const HWLM *h, const string &base) {
     case HWLM_ENGINE_FDR:
         fdrPrintStats((const FDR *)HWLM_C_DATA(h), f);
         break;
+    case HWLM_ENGINE_LHASH:
+        lhashPrintStats((const LHash *)HWLM_C_DATA(h), f);
+        break;
     default:
         fprintf(f, "<unknown hwlm subengine>\n");
     }
@@ -43,10 +43,13 @@
 /** \brief Underlying engine is Noodle. */
 #define HWLM_ENGINE_NOOD    16
 
+/** \brief Underlying engine is Lhash, for very large literal sets. */
+#define HWLM_ENGINE_LHASH   20
+
 /** \brief Main Hamster Wheel Literal Matcher header. Followed by
  * engine-specific structure. */
 struct HWLM {
-    u8 type; /**< HWLM_ENGINE_NOOD or HWLM_ENGINE_FDR */
+    u8 type; /**< HWLM_ENGINE_NOOD, HWLM_ENGINE_FDR or HWLM_ENGINE_LHASH */
     hwlm_group_t accel1_groups; /**< accelerable groups. */
     union AccelAux accel1; /**< used if group mask is subset of accel1_groups */
     union AccelAux accel0; /**< fallback accel scheme */
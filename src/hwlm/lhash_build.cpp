@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * \brief Lhash large-set literal matcher: build code.
+ */
+
+#include "lhash_build.h"
+
+#include "hwlm_literal.h"
+#include "lhash_internal.h"
+#include "util/bitutils.h"
+#include "util/compare.h"
+#include "util/compile_error.h"
+#include "util/verify_types.h"
+#include "ue2common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace ue2 {
+
+/** \brief Filter bits per hash table entry. */
+static constexpr u64a FILTER_BITS_PER_ENTRY = 16;
+
+/** \brief Largest hashed filter, in blocks. */
+static constexpr u64a MAX_FILTER_BLOCKS = 1ULL << 21;
+
+/** \brief Average number of entries per bucket; with LHASH_BUCKET_SLOTS
+ * slots per bucket, few buckets overflow. */
+static constexpr u64a ENTRIES_PER_BUCKET = 4;
+
+static
+u64a roundUpPow2(u64a x) {
+    u64a r = 1;
+    while (r < x) {
+        r <<= 1;
+    }
+    return r;
+}
+
+/** \brief Place bytes in their positions at the end of a window. */
+static
+u64a windowValue(const u8 *bytes, size_t len) {
+    assert(len <= LHASH_WINDOW_LEN);
+    u8 w[LHASH_WINDOW_LEN] = {0};
+    memcpy(w + LHASH_WINDOW_LEN - len, bytes, len);
+    u64a v;
+    memcpy(&v, w, sizeof(v));
+    return v;
+}
+
+/** \brief The hash table key of a literal: its case-folded string. */
+static
+u64a foldedKey(const hwlmLiteral &lit) {
+    const size_t len = lit.s.length();
+    return windowValue((const u8 *)lit.s.c_str(), len) & LHASH_FOLD &
+           lhashKeyMask(len);
+}
+
+/** \brief Build the confirm record for a literal, combining the string with
+ * any supplementary msk/cmp. */
+static
+lhash_lit makeLit(const hwlmLiteral &lit) {
+    const size_t len = lit.s.length();
+    const size_t msk_len = lit.msk.size();
+    assert(msk_len == lit.cmp.size());
+
+    u8 m[LHASH_WINDOW_LEN] = {0};
+    u8 c[LHASH_WINDOW_LEN] = {0};
+    for (size_t i = 0; i < msk_len; i++) {
+        m[LHASH_WINDOW_LEN - msk_len + i] = lit.msk[i];
+        c[LHASH_WINDOW_LEN - msk_len + i] = lit.cmp[i];
+    }
+    for (size_t i = 0; i < len; i++) {
+        u8 ch = lit.s[i];
+        u8 ch_msk = lit.nocase && ourisalpha(ch) ? (u8)CASE_CLEAR : (u8)0xff;
+        m[LHASH_WINDOW_LEN - len + i] |= ch_msk;
+        c[LHASH_WINDOW_LEN - len + i] |= ch & ch_msk;
+    }
+
+    lhash_lit out;
+    memset(&out, 0, sizeof(out));
+    memcpy(&out.msk, m, sizeof(out.msk));
+    memcpy(&out.cmp, c, sizeof(out.cmp));
+    out.groups = lit.groups;
+    out.id = lit.id;
+    out.reach = verify_u8(max(len, msk_len));
+    return out;
+}
+
+static
+void setBit(u8 *bits, u32 bit) {
+    bits[bit / 8] |= 1U << (bit % 8);
+}
+
+bool lhashCanBuild(const vector<hwlmLiteral> &lits) {
+    for (const auto &lit : lits) {
+        if (lit.s.empty() || lit.s.length() > LHASH_WINDOW_LEN ||
+            lit.msk.size() > LHASH_WINDOW_LEN) {
+            DEBUG_PRINTF("literal too long for lhash\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+bytecode_ptr<LHash> lhashBuildTable(const vector<hwlmLiteral> &lits) {
+    assert(!lits.empty());
+    assert(lhashCanBuild(lits));
+
+    // Literals with the same length and folded string share a hash table
+    // entry.
+    vector<u32> entry_of(lits.size());
+    vector<u64a> entry_key;
+    vector<u8> entry_len;
+    vector<u32> entry_lits;
+    unordered_map<u64a, u32> key_map[LHASH_WINDOW_LEN];
+    for (size_t i = 0; i < lits.size(); i++) {
+        const size_t len = lits[i].s.length();
+        const u64a key = foldedKey(lits[i]);
+        auto it = key_map[len - 1].emplace(key, verify_u32(entry_key.size()));
+        if (it.second) {
+            entry_key.push_back(key);
+            entry_len.push_back(verify_u8(len));
+            entry_lits.push_back(0);
+        }
+        entry_of[i] = it.first->second;
+        entry_lits[entry_of[i]]++;
+    }
+
+    const u64a num_entries = entry_key.size();
+    DEBUG_PRINTF("%zu literals, %llu entries\n", lits.size(), num_entries);
+
+    // Literals are stored grouped by entry.
+    vector<u32> entry_first(num_entries);
+    u32 total = 0;
+    for (u64a e = 0; e < num_entries; e++) {
+        entry_first[e] = total;
+        total += entry_lits[e];
+    }
+
+    const u64a num_buckets =
+        roundUpPow2(max(num_entries / ENTRIES_PER_BUCKET, u64a{1}));
+    const u64a num_blocks = min(
+        roundUpPow2(max(num_entries * FILTER_BITS_PER_ENTRY / LHASH_BLOCK_BITS,
+                        u64a{1})),
+        MAX_FILTER_BLOCKS);
+
+    vector<u64a> entry_hash(num_entries);
+    vector<u32> bucket_count(num_buckets, 0);
+    for (u64a e = 0; e < num_entries; e++) {
+        entry_hash[e] = lhashHash(entry_key[e], entry_len[e]);
+        bucket_count[(u32)entry_hash[e] & (num_buckets - 1)]++;
+    }
+
+    u64a num_overflow = 0;
+    for (u32 count : bucket_count) {
+        if (count > LHASH_BUCKET_SLOTS) {
+            num_overflow += count - LHASH_BUCKET_SLOTS;
+        }
+    }
+
+    size_t size = ROUNDUP_CL(sizeof(LHash));
+    const size_t pair_offset = size;
+    size += LHASH_PAIR_BITS / 8;
+    const size_t filter_offset = size;
+    size += num_blocks * (LHASH_BLOCK_BITS / 8);
+    const size_t bucket_offset = size;
+    size += num_buckets * sizeof(lhash_bucket);
+    const size_t overflow_offset = size;
+    size += ROUNDUP_CL(num_overflow * sizeof(lhash_overflow));
+    const size_t lit_offset = size;
+    size += lits.size() * sizeof(lhash_lit);
+
+    if (size > ~0U) {
+        throw ResourceLimitError();
+    }
+
+    DEBUG_PRINTF("%llu buckets, %llu overflow, %llu blocks, %zu bytes\n",
+                 num_buckets, num_overflow, num_blocks, size);
+
+    auto lh = make_zeroed_bytecode_ptr<LHash>(size, 64);
+    u8 *base = (u8 *)lh.get();
+
+    lh->size = verify_u32(size);
+    lh->litCount = verify_u32(lits.size());
+    lh->entryCount = verify_u32(num_entries);
+    lh->bucketMask = verify_u32(num_buckets - 1);
+    lh->blockMask = verify_u32(num_blocks - 1);
+    lh->pairOffset = verify_u32(pair_offset);
+    lh->filterOffset = verify_u32(filter_offset);
+    lh->bucketOffset = verify_u32(bucket_offset);
+    lh->overflowOffset = verify_u32(overflow_offset);
+    lh->litOffset = verify_u32(lit_offset);
+
+    for (u32 len = 1; len <= LHASH_WINDOW_LEN; len++) {
+        if (!key_map[len - 1].empty()) {
+            lh->lens[lh->numLens++] = verify_u8(len);
+        }
+    }
+    assert(lh->numLens);
+    lh->minLen = lh->lens[0];
+    lh->blockLen = min(lh->minLen, u8{LHASH_BLOCK_KEY_MAX});
+
+    // Literal records.
+    auto *lit_out = (lhash_lit *)(base + lit_offset);
+    vector<u32> entry_fill(entry_first);
+    for (size_t i = 0; i < lits.size(); i++) {
+        const u32 e = entry_of[i];
+        u32 idx = entry_fill[e]++;
+        lit_out[idx] = makeLit(lits[i]);
+        lit_out[idx].last = entry_fill[e] == entry_first[e] + entry_lits[e];
+    }
+
+    // Filters.
+    u8 *pairs = base + pair_offset;
+    u8 *filter = base + filter_offset;
+    for (u64a e = 0; e < num_entries; e++) {
+        const u32 block = lhashBlock(lh.get(), entry_key[e]);
+        setBit(filter + block * (LHASH_BLOCK_BITS / 8),
+               lhashBlockBit(entry_hash[e]));
+
+        const u32 cur = (u32)(entry_key[e] >> 56);
+        if (entry_len[e] > 1) {
+            const u32 prev = (u32)(entry_key[e] >> 48) & 0xff;
+            setBit(pairs, cur << 8 | prev);
+        } else {
+            for (u32 prev = 0; prev < 256; prev++) {
+                setBit(pairs, cur << 8 | (prev & CASE_CLEAR));
+            }
+        }
+    }
+
+    // Buckets, with overflow entries in bucket order.
+    auto *buckets = (lhash_bucket *)(base + bucket_offset);
+    auto *overflow = (lhash_overflow *)(base + overflow_offset);
+    u32 overflow_next = 0;
+    for (u64a b = 0; b < num_buckets; b++) {
+        if (bucket_count[b] > LHASH_BUCKET_SLOTS) {
+            buckets[b].overflow = overflow_next;
+            overflow_next += bucket_count[b] - LHASH_BUCKET_SLOTS;
+        }
+    }
+    assert(overflow_next == num_overflow);
+
+    for (u64a e = 0; e < num_entries; e++) {
+        const u32 tag = (u32)(entry_hash[e] >> 32);
+        lhash_bucket &b = buckets[lhashBucket(lh.get(), entry_hash[e])];
+        const u32 slot = b.count++;
+        if (slot < LHASH_BUCKET_SLOTS) {
+            b.tag[slot] = tag;
+            b.lit[slot] = entry_first[e];
+        } else {
+            u32 idx = b.overflow + slot - LHASH_BUCKET_SLOTS;
+            overflow[idx].tag = tag;
+            overflow[idx].lit = entry_first[e];
+        }
+    }
+
+    return lh;
+}
+
+size_t lhashSize(const LHash *lh) {
+    return lh->size;
+}
+
+} // namespace ue2
+
+#ifdef DUMP_SUPPORT
+
+namespace ue2 {
+
+void lhashPrintStats(const LHash *lh, FILE *f) {
+    fprintf(f, "Lhash table\n");
+    fprintf(f, "Literals: %u Entries: %u\n", lh->litCount, lh->entryCount);
+    fprintf(f, "Buckets: %u Filter blocks: %u\n", lh->bucketMask + 1,
+            lh->blockMask + 1);
+
+    const auto *buckets =
+        (const lhash_bucket *)((const u8 *)lh + lh->bucketOffset);
+    u32 overflowed = 0;
+    for (u32 b = 0; b <= lh->bucketMask; b++) {
+        overflowed += buckets[b].count > LHASH_BUCKET_SLOTS;
+    }
+    fprintf(f, "Overflowed buckets: %u\n", overflowed);
+
+    fprintf(f, "Lengths:");
+    for (u32 i = 0; i < lh->numLens; i++) {
+        fprintf(f, " %u", lh->lens[i]);
+    }
+    fprintf(f, "\n");
+}
+
+} // namespace ue2
+
+#endif
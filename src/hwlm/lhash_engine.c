@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Lhash large-set literal matcher: runtime.
+ */
+#include "lhash_engine.h"
+#include "lhash_internal.h"
+#include "scratch.h"
+#include "ue2common.h"
+#include "util/unaligned.h"
+
+#include <string.h>
+
+/** \brief Number of windows examined together by scanBatch(). */
+#define LHASH_BATCH 32
+
+/** \brief Lhash runtime context. */
+struct lhash_ctx {
+    HWLMCallback cb; //!< callback function called on match
+    struct hs_scratch *scratch; //!< scratch to pass to callback
+    hwlm_group_t groups; //!< groups currently switched on
+};
+
+static really_inline
+int filterTest(const u8 *filter, u32 bit) {
+    return filter[bit / 8] & (1U << (bit % 8));
+}
+
+/** \brief Confirm the run of literals starting at \a lit against the window
+ * \a v ending at \a end, with \a avail bytes of data in the window. */
+static really_inline
+hwlm_error_t confirmRun(const struct lhash_lit *lit, u64a v, size_t end,
+                        size_t avail, struct lhash_ctx *ctx) {
+    if (unlikely(scratchAddWork(ctx->scratch, 1))) {
+        return HWLM_TERMINATED;
+    }
+
+    for (;; lit++) {
+        if ((v & lit->msk) == lit->cmp && lit->reach <= avail &&
+            (lit->groups & ctx->groups)) {
+            DEBUG_PRINTF("match @%zu id %u\n", end, lit->id);
+            ctx->groups = ctx->cb(end, lit->id, ctx->scratch);
+            if (ctx->groups == HWLM_TERMINATE_MATCHING) {
+                return HWLM_TERMINATED;
+            }
+        }
+        if (lit->last) {
+            return HWLM_SUCCESS;
+        }
+    }
+}
+
+/** \brief Look up the hash \a h of one length of the window \a v ending at
+ * \a end in the hash table, and confirm any literals found. */
+static really_inline
+hwlm_error_t probeBucket(const struct LHash *lh, u64a h, u64a v, size_t end,
+                         size_t avail, struct lhash_ctx *ctx) {
+    const u8 *base = (const u8 *)lh;
+    const struct lhash_bucket *buckets =
+        (const struct lhash_bucket *)(base + lh->bucketOffset);
+    const struct lhash_overflow *overflow =
+        (const struct lhash_overflow *)(base + lh->overflowOffset);
+    const struct lhash_lit *lits =
+        (const struct lhash_lit *)(base + lh->litOffset);
+
+    const u32 tag = (u32)(h >> 32);
+    const struct lhash_bucket *b = &buckets[lhashBucket(lh, h)];
+    const u32 count = b->count;
+    const u32 inline_count = MIN(count, LHASH_BUCKET_SLOTS);
+    for (u32 j = 0; j < inline_count; j++) {
+        if (b->tag[j] == tag &&
+            confirmRun(&lits[b->lit[j]], v, end, avail, ctx)
+                == HWLM_TERMINATED) {
+            return HWLM_TERMINATED;
+        }
+    }
+    for (u32 j = LHASH_BUCKET_SLOTS; j < count; j++) {
+        const struct lhash_overflow *o =
+            &overflow[b->overflow + j - LHASH_BUCKET_SLOTS];
+        if (o->tag == tag &&
+            confirmRun(&lits[o->lit], v, end, avail, ctx) == HWLM_TERMINATED) {
+            return HWLM_TERMINATED;
+        }
+    }
+
+    return HWLM_SUCCESS;
+}
+
+/** \brief Look up the window \a v ending at \a end.
+ *
+ * Literals longer than \a str_avail bytes cannot match here, and any msk must
+ * fit in the \a avail bytes of data in the window. */
+static really_inline
+hwlm_error_t probe(const struct LHash *lh, u64a v, size_t end,
+                   size_t str_avail, size_t avail, struct lhash_ctx *ctx) {
+    const u8 *base = (const u8 *)lh;
+    if (str_avail < lh->minLen ||
+        !filterTest(base + lh->pairOffset, lhashPairIndex(v))) {
+        return HWLM_SUCCESS;
+    }
+
+    const u64a folded = v & LHASH_FOLD;
+    const u8 *block = base + lh->filterOffset +
+                      lhashBlock(lh, folded) * (LHASH_BLOCK_BITS / 8);
+    for (u32 i = 0; i < lh->numLens; i++) {
+        const u32 len = lh->lens[i];
+        if (len > str_avail) {
+            break;
+        }
+
+        const u64a h = lhashHash(folded & lhashKeyMask(len), len);
+        if (filterTest(block, lhashBlockBit(h)) &&
+            probeBucket(lh, h, v, end, avail, ctx) == HWLM_TERMINATED) {
+            return HWLM_TERMINATED;
+        }
+    }
+
+    return HWLM_SUCCESS;
+}
+
+/** \brief Scan the \a n full windows ending at buf[p] onwards.
+ *
+ * With large literal sets, the hashed filter and buckets do not fit in cache,
+ * so each stage is run over the whole batch, prefetching what the next stage
+ * reads, before any literal is confirmed. Matches are still reported in
+ * order. */
+static really_inline
+hwlm_error_t scanBatch(const struct LHash *lh, const u8 *buf, size_t p,
+                       u32 n, struct lhash_ctx *ctx) {
+    assert(n <= LHASH_BATCH);
+    assert(p >= LHASH_WINDOW_LEN - 1);
+
+    const u8 *base = (const u8 *)lh;
+    const u8 *pairs = base + lh->pairOffset;
+    const u8 *filter = base + lh->filterOffset;
+    const struct lhash_bucket *buckets =
+        (const struct lhash_bucket *)(base + lh->bucketOffset);
+    const u8 *wbuf = buf + p - (LHASH_WINDOW_LEN - 1);
+
+    // Windows which pass the pair filter, and their filter blocks.
+    const u8 *cand_block[LHASH_BATCH];
+    u8 cand_pos[LHASH_BATCH];
+    u32 cands = 0;
+    for (u32 i = 0; i < n; i++) {
+        const u64a v = unaligned_load_u64a(wbuf + i);
+        if (!filterTest(pairs, lhashPairIndex(v))) {
+            continue;
+        }
+        const u8 *block = filter + lhashBlock(lh, v & LHASH_FOLD) *
+                                       (LHASH_BLOCK_BITS / 8);
+        __builtin_prefetch(block);
+        cand_block[cands] = block;
+        cand_pos[cands] = (u8)i;
+        cands++;
+    }
+
+    // Fingerprint each candidate once for each literal length, keeping those
+    // found in the filter block.
+    u64a hit_hash[LHASH_BATCH * LHASH_WINDOW_LEN];
+    u8 hit_pos[LHASH_BATCH * LHASH_WINDOW_LEN];
+    u32 hits = 0;
+    for (u32 k = 0; k < cands; k++) {
+        const u64a folded = unaligned_load_u64a(wbuf + cand_pos[k]) &
+                            LHASH_FOLD;
+        for (u32 j = 0; j < lh->numLens; j++) {
+            const u32 len = lh->lens[j];
+            const u64a h = lhashHash(folded & lhashKeyMask(len), len);
+            if (filterTest(cand_block[k], lhashBlockBit(h))) {
+                __builtin_prefetch(&buckets[lhashBucket(lh, h)]);
+                hit_hash[hits] = h;
+                hit_pos[hits] = cand_pos[k];
+                hits++;
+            }
+        }
+    }
+
+    for (u32 k = 0; k < hits; k++) {
+        const u64a v = unaligned_load_u64a(wbuf + hit_pos[k]);
+        if (probeBucket(lh, hit_hash[k], v, p + hit_pos[k], LHASH_WINDOW_LEN,
+                        ctx) == HWLM_TERMINATED) {
+            return HWLM_TERMINATED;
+        }
+    }
+
+    return HWLM_SUCCESS;
+}
+
+/** \brief Load the window ending at buf[p], for p shorter than a window,
+ * using the history buffer for the earlier bytes where there is any. */
+static really_inline
+u64a loadShortWindow(const u8 *hbuf, size_t hlen, const u8 *buf, size_t p) {
+    assert(p < LHASH_WINDOW_LEN - 1);
+    u8 ALIGN_DIRECTIVE temp[LHASH_WINDOW_LEN];
+    memset(temp, 0, sizeof(temp));
+
+    size_t from_buf = p + 1;
+    size_t from_hist = MIN(hlen, LHASH_WINDOW_LEN - from_buf);
+    if (from_hist) {
+        memcpy(temp + LHASH_WINDOW_LEN - from_buf - from_hist,
+               hbuf + hlen - from_hist, from_hist);
+    }
+    memcpy(temp + LHASH_WINDOW_LEN - from_buf, buf, from_buf);
+    return unaligned_load_u64a(temp);
+}
+
+static really_inline
+hwlm_error_t scan(const struct LHash *lh, const u8 *hbuf, size_t hlen,
+                  const u8 *buf, size_t len, size_t start,
+                  struct lhash_ctx *ctx) {
+    assert(!start || !hlen);
+
+    // The first position at which a literal can end.
+    size_t p = start + lh->minLen - 1;
+    p -= MIN(hlen, (size_t)lh->minLen - 1);
+
+    // Near the start of the scan, not every literal length (or msk) fits.
+    for (; p < len && p < start + LHASH_WINDOW_LEN - 1; p++) {
+        u64a v = p >= LHASH_WINDOW_LEN - 1
+                     ? unaligned_load_u64a(buf + p - (LHASH_WINDOW_LEN - 1))
+                     : loadShortWindow(hbuf, hlen, buf, p);
+        size_t avail = p + 1 + hlen;
+        if (probe(lh, v, p, avail - start, avail, ctx) == HWLM_TERMINATED) {
+            return HWLM_TERMINATED;
+        }
+    }
+
+    while (p < len) {
+        u32 n = (u32)MIN(len - p, (size_t)LHASH_BATCH);
+        if (scanBatch(lh, buf, p, n, ctx) == HWLM_TERMINATED) {
+            return HWLM_TERMINATED;
+        }
+        p += n;
+    }
+
+    return HWLM_SUCCESS;
+}
+
+hwlm_error_t lhashExec(const struct LHash *lh, const u8 *buf, size_t len,
+                       size_t start, HWLMCallback cb,
+                       struct hs_scratch *scratch, hwlm_group_t groups) {
+    assert(lh && buf);
+    DEBUG_PRINTF("lhash scan of %zu bytes from %zu, %u literals\n", len, start,
+                 lh->litCount);
+
+    struct lhash_ctx ctx = {cb, scratch, groups};
+    return scan(lh, NULL, 0, buf, len, start, &ctx);
+}
+
+hwlm_error_t lhashExecStreaming(const struct LHash *lh, const u8 *hbuf,
+                                size_t hlen, const u8 *buf, size_t len,
+                                size_t start, HWLMCallback cb,
+                                struct hs_scratch *scratch,
+                                hwlm_group_t groups) {
+    assert(lh && buf);
+    DEBUG_PRINTF("lhash scan of %zu bytes (%zu hlen) from %zu\n", len, hlen,
+                 start);
+
+    struct lhash_ctx ctx = {cb, scratch, groups};
+
+    // If we've been handed a start offset, no match may start in history.
+    if (start) {
+        return scan(lh, NULL, 0, buf, len, start, &ctx);
+    }
+    return scan(lh, hbuf, hlen, buf, len, 0, &ctx);
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Lhash large-set literal matcher: data structures.
+ *
+ * Lhash is used in place of FDR for very large literal sets. Every position
+ * of the input is first checked against a small filter of the final two
+ * (case-folded) bytes of all literals. Where that passes, the final few bytes
+ * of the folded window select a cache-line sized block of a larger filter, and
+ * a hash of the window is computed and tested in that block for each literal
+ * length present. Only then is a cache-line sized bucket of the hash table
+ * visited to find literals to confirm.
+ *
+ * All HWLM literals are at most eight bytes long, so a literal, along with
+ * any supplementary msk/cmp, is confirmed with a single masked compare
+ * against the eight byte window ending at the match.
+ */
+
+#ifndef LHASH_INTERNAL_H
+#define LHASH_INTERNAL_H
+
+#include "hwlm.h"
+#include "ue2common.h"
+
+/** \brief Maximum number of bytes in a window (and so in a literal). */
+#define LHASH_WINDOW_LEN 8
+
+/** \brief Case-folding mask applied to windows before hashing. */
+#define LHASH_FOLD 0xdfdfdfdfdfdfdfdfULL
+
+/** \brief Number of entries stored in a hash table bucket itself; any more
+ * spill into the overflow array. */
+#define LHASH_BUCKET_SLOTS 7
+
+/** \brief Number of bits in the pair filter, indexed by the final two
+ * case-folded bytes of the window. */
+#define LHASH_PAIR_BITS 65536
+
+/** \brief Number of bits in one (cache line) block of the hashed filter. */
+#define LHASH_BLOCK_BITS 512
+
+/** \brief Maximum number of window bytes used to select a filter block. */
+#define LHASH_BLOCK_KEY_MAX 4
+
+/** \brief One cache line of the hash table. */
+struct lhash_bucket {
+    u32 tag[LHASH_BUCKET_SLOTS]; //!< hash tags of the entries
+    u32 count; //!< total entries, including those in overflow
+    u32 lit[LHASH_BUCKET_SLOTS]; //!< first lhash_lit for each entry
+    u32 overflow; //!< index of the first overflow entry, if any
+};
+
+/** \brief Hash table entry that did not fit in its bucket. */
+struct lhash_overflow {
+    u32 tag;
+    u32 lit;
+};
+
+/** \brief A literal to be confirmed.
+ *
+ * Literals which hash identically (the same length and case-folded string)
+ * are stored contiguously; the final one of a run has \ref last set. */
+struct lhash_lit {
+    u64a msk; //!< confirm mask over the window, including msk/cmp
+    u64a cmp; //!< confirm value over the window
+    hwlm_group_t groups; //!< groups this literal belongs to
+    u32 id; //!< id passed to the callback
+    u8 reach; //!< bytes of window examined by msk
+    u8 last; //!< non-zero for the last literal of a run
+    u8 pad[2];
+};
+
+/** \brief Lhash engine header; followed by the pair filter, hashed filter,
+ * buckets, overflow entries and literals at the given offsets. */
+struct LHash {
+    u32 size; //!< total size of the engine in bytes
+    u32 litCount; //!< number of lhash_lit records
+    u32 entryCount; //!< number of distinct hash table entries
+    u32 bucketMask; //!< number of buckets minus one
+    u32 blockMask; //!< number of blocks in the hashed filter minus one
+    u32 pairOffset; //!< offset of the pair filter
+    u32 filterOffset; //!< offset of the hashed filter
+    u32 bucketOffset; //!< offset of the bucket array
+    u32 overflowOffset; //!< offset of the overflow array
+    u32 litOffset; //!< offset of the literal array
+    u8 minLen; //!< length of the shortest literal
+    u8 blockLen; //!< final bytes of the window which select a filter block
+    u8 numLens; //!< number of entries in \ref lens
+    u8 lens[LHASH_WINDOW_LEN]; //!< distinct literal lengths, ascending
+};
+
+/** \brief Mask selecting the final \a len bytes of a window. */
+static really_inline
+u64a lhashKeyMask(u32 len) {
+    assert(len && len <= LHASH_WINDOW_LEN);
+    return ~0ULL << (8 * (LHASH_WINDOW_LEN - len));
+}
+
+/** \brief Hash of the (masked, case-folded) final \a len bytes of a window.
+ *
+ * The key is shifted down so that every byte of it reaches the high half of
+ * the product, which is folded back into the low half. The low 32 bits select
+ * the bucket and the high 32 bits are the tag; the top bits also select a bit
+ * within a filter block. */
+static really_inline
+u64a lhashHash(u64a key, u32 len) {
+    u64a h = ((key >> (8 * (LHASH_WINDOW_LEN - len))) ^
+              ((u64a)len * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 32);
+}
+
+/** \brief Bucket for the hash of one length of a window. */
+static really_inline
+u32 lhashBucket(const struct LHash *lh, u64a h) {
+    return (u32)h & lh->bucketMask;
+}
+
+/** \brief Filter block selected by a case-folded window.
+ *
+ * Hashed as if a longer literal, so that it is independent of the bucket and
+ * filter bit chosen for a literal of length blockLen. */
+static really_inline
+u32 lhashBlock(const struct LHash *lh, u64a folded) {
+    const u32 len = lh->blockLen;
+    return (u32)lhashHash(folded & lhashKeyMask(len), len + LHASH_WINDOW_LEN) &
+           lh->blockMask;
+}
+
+/** \brief Bit within a filter block for the hash of one length of a
+ * window. */
+static really_inline
+u32 lhashBlockBit(u64a h) {
+    return (u32)(h >> 55) & (LHASH_BLOCK_BITS - 1);
+}
+
+/** \brief Index into the pair filter for a window. */
+static really_inline
+u32 lhashPairIndex(u64a window) {
+    return (u32)(window >> 48) & 0xdfdf;
+}
+
+#endif /* LHASH_INTERNAL_H */
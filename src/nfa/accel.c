@@ -82,7 +82,7 @@ const u8 *run_accel(const union AccelAux *accel, const u8 *c, const u8 *c_end) {
                                   c_end - 1);
         break;
 
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
     case ACCEL_VERM16:
         DEBUG_PRINTF("accel verm16 %p %p\n", c, c_end);
         if (c_end - c < 16) {
@@ -113,7 +113,7 @@ const u8 *run_accel(const union AccelAux *accel, const u8 *c, const u8 *c_end) {
         rv = vermicelliDoubleMasked16Exec(accel->mdverm16.mask, accel->mdverm16.c1,
                                           accel->mdverm16.m1, c, c_end - 1);
         break;
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
 
     case ACCEL_DVERM_MASKED:
         DEBUG_PRINTF("accel dverm masked %p %p\n", c, c_end);
@@ -127,6 +127,33 @@ const u8 *run_accel(const union AccelAux *accel, const u8 *c, const u8 *c_end) {
                                         c, c_end - 1);
         break;
 
+    case ACCEL_TVERM:
+        DEBUG_PRINTF("accel tverm %p %p\n", c, c_end);
+        if (c + 16 + 2 >= c_end) {
+            return c;
+        }
+
+        rv = vermicelliTripleExec(accel->tverm.c1, accel->tverm.c2,
+                                  accel->tverm.c3, accel->tverm.count, c,
+                                  c_end);
+        /* a literal may straddle the end; leave its bytes to the engine */
+        rv = MIN(rv, c_end - 2);
+        break;
+
+    case ACCEL_DVERM_GAP:
+        DEBUG_PRINTF("accel dverm gap %u %p %p\n", accel->gdverm.gap, c,
+                     c_end);
+        if (c + 16 + accel->gdverm.gap >= c_end) {
+            return c;
+        }
+
+        rv = vermicelliDoubleGapExec(accel->gdverm.c1, accel->gdverm.c2,
+                                     accel->gdverm.count, accel->gdverm.gap,
+                                     c, c_end);
+        /* a literal may straddle the end; leave its bytes to the engine */
+        rv = MIN(rv, c_end - accel->gdverm.gap);
+        break;
+
     case ACCEL_SHUFTI:
         DEBUG_PRINTF("accel shufti %p %p\n", c, c_end);
         if (c + 15 >= c_end) {
@@ -44,6 +44,12 @@
 /// Minimum length of the scan buffer for us to attempt acceleration.
 #define ACCEL_MIN_LEN       16
 
+/// Maximum number of literals in a triple-byte or gapped-pair scheme.
+#define ACCEL_MAX_MULTI_LITS 4
+
+/// Maximum distance between the two bytes of a gapped-pair scheme.
+#define ACCEL_MAX_GAP       3
+
 enum AccelType {
     ACCEL_NONE,
     ACCEL_VERM,
@@ -66,6 +72,8 @@ enum AccelType {
     ACCEL_VERM16,
     ACCEL_DVERM16,
     ACCEL_DVERM16_MASKED,
+    ACCEL_TVERM,
+    ACCEL_DVERM_GAP,
 };
 
 /** \brief Structure for accel framework. */
@@ -119,6 +127,22 @@ union AccelAux {
         u8 m1; // used for partial match
         m128 mask;
     } mdverm16;
+    struct {
+        u8 accel_type;
+        u8 offset;
+        u8 count; // number of literals used
+        u8 c1[ACCEL_MAX_MULTI_LITS];
+        u8 c2[ACCEL_MAX_MULTI_LITS];
+        u8 c3[ACCEL_MAX_MULTI_LITS];
+    } tverm;
+    struct {
+        u8 accel_type;
+        u8 offset;
+        u8 count; // number of literals used
+        u8 gap; // distance from c1 to c2
+        u8 c1[ACCEL_MAX_MULTI_LITS];
+        u8 c2[ACCEL_MAX_MULTI_LITS];
+    } gdverm;
     struct {
         u8 accel_type;
         u8 offset;
@@ -30,6 +30,7 @@
 #include "accel_dfa_build_strat.h"
 
 #include "accel.h"
+#include "accelcompile.h"
 #include "grey.h"
 #include "nfagraph/ng_limex_accel.h"
 #include "shufticompile.h"
@@ -42,6 +43,8 @@
 #include "util/small_vector.h"
 #include "util/verify_types.h"
 
+#include <array>
+#include <cstring>
 #include <sstream>
 #include <unordered_map>
 #include <unordered_set>
@@ -327,6 +330,107 @@ set<dstate_id_t> find_region(const raw_dfa &rdfa, dstate_id_t base,
     return region;
 }
 
+/* Finds the three byte strings (and the pairs two apart which cover them)
+ * which can take this state anywhere but where it would have been had it
+ * skipped the first byte. Everything else can be stepped over one byte at a
+ * time, leaving the last two bytes of the buffer to the engine. */
+static
+void find_triple_escapes(const raw_dfa &rdfa, dstate_id_t this_idx,
+                         const vector<CharReach> &rev_map, AccelScheme *out) {
+    const dstate &raw = rdfa.states[this_idx];
+    const u32 alpha_size = rev_map.size();
+    flat_set<array<u8, 3>> triples;
+    flat_set<pair<u8, u8>> gaps;
+    bool triples_ok = true;
+    bool gaps_ok = true;
+    u32 work = 0;
+
+    auto reportless = [&](dstate_id_t s) {
+        return !generates_callbacks(rdfa.kind) || rdfa.states[s].reports.empty();
+    };
+
+    for (u32 i = 0; i < alpha_size && (triples_ok || gaps_ok); i++) {
+        dstate_id_t t = raw.next[i];
+        if (t == this_idx) {
+            continue;
+        }
+        if (!reportless(t)) {
+            return;
+        }
+        const CharReach &cr_i = rev_map[i];
+
+        for (u32 j = 0; j < alpha_size && (triples_ok || gaps_ok); j++) {
+            dstate_id_t x = rdfa.states[t].next[j];
+            dstate_id_t y = raw.next[j];
+            if (x == y) {
+                continue;
+            }
+            if (!reportless(x) || ++work > 256) {
+                return;
+            }
+            const CharReach &cr_j = rev_map[j];
+
+            for (u32 k = 0; k < alpha_size; k++) {
+                if (rdfa.states[x].next[k] == rdfa.states[y].next[k]) {
+                    continue;
+                }
+                const CharReach &cr_k = rev_map[k];
+
+                if (triples_ok) {
+                    if (cr_i.count() * cr_j.count() * cr_k.count()
+                        > ACCEL_MAX_MULTI_LITS) {
+                        triples_ok = false;
+                    } else {
+                        for (auto a = cr_i.find_first(); a != CharReach::npos;
+                             a = cr_i.find_next(a)) {
+                            for (auto b = cr_j.find_first();
+                                 b != CharReach::npos; b = cr_j.find_next(b)) {
+                                for (auto c = cr_k.find_first();
+                                     c != CharReach::npos;
+                                     c = cr_k.find_next(c)) {
+                                    triples.insert({{(u8)a, (u8)b, (u8)c}});
+                                }
+                            }
+                        }
+                        triples_ok = triples.size() <= ACCEL_MAX_MULTI_LITS;
+                    }
+                }
+
+                if (gaps_ok) {
+                    if (cr_i.count() * cr_k.count() > ACCEL_MAX_MULTI_LITS) {
+                        gaps_ok = false;
+                    } else {
+                        for (auto a = cr_i.find_first(); a != CharReach::npos;
+                             a = cr_i.find_next(a)) {
+                            for (auto c = cr_k.find_first();
+                                 c != CharReach::npos; c = cr_k.find_next(c)) {
+                                gaps.emplace((u8)a, (u8)c);
+                            }
+                        }
+                        gaps_ok = gaps.size() <= ACCEL_MAX_MULTI_LITS;
+                    }
+                }
+
+                if (!triples_ok && !gaps_ok) {
+                    return;
+                }
+            }
+        }
+    }
+
+    if (triples_ok && !triples.empty()) {
+        DEBUG_PRINTF("state %hu has %zu triple escapes\n", this_idx,
+                     triples.size());
+        out->triple_byte = std::move(triples);
+    }
+    if (gaps_ok && !gaps.empty()) {
+        DEBUG_PRINTF("state %hu has %zu gapped escapes\n", this_idx,
+                     gaps.size());
+        out->gap_byte = std::move(gaps);
+        out->gap_len = 2;
+    }
+}
+
 AccelScheme
 accel_dfa_build_strat::find_escape_strings(dstate_id_t this_idx) const {
     AccelScheme rv;
@@ -419,6 +523,10 @@ accel_dfa_build_strat::find_escape_strings(dstate_id_t this_idx) const {
         }
     }
 
+    if (!rv.offset && rv.cr.count() > 2) {
+        find_triple_escapes(rdfa, this_idx, rev_map, &rv);
+    }
+
     return rv;
 }
 
@@ -472,8 +580,9 @@ accel_dfa_build_strat::buildAccel(UNUSED dstate_id_t this_idx,
             if (buildDvermMask(info.double_byte, &m1, &m2)) {
                 u8 c1 = info.double_byte.begin()->first & m1;
                 u8 c2 = info.double_byte.begin()->second & m2;
-#ifdef HAVE_SVE2
-                if (vermicelliDoubleMasked16Build(c1, c2, m1, m2, (u8 *)&accel->mdverm16.mask)) {
+#ifdef HAVE_VERM16
+                if (vermicelliDoubleMasked16Pairs(m1, m2) <= DVERM16_MASKED_MAX_PAIRS &&
+                    vermicelliDoubleMasked16Build(c1, c2, m1, m2, (u8 *)&accel->mdverm16.mask)) {
                     accel->accel_type = ACCEL_DVERM16_MASKED;
                     accel->mdverm16.offset = verify_u8(info.double_offset);
                     accel->mdverm16.c1 = c1;
@@ -481,7 +590,7 @@ accel_dfa_build_strat::buildAccel(UNUSED dstate_id_t this_idx,
                     DEBUG_PRINTF("building maskeddouble16-vermicelli for 0x%02hhx%02hhx\n",
                                 c1, c2);
                     return;
-                } else if (info.double_byte.size() <= 8 &&
+                } else if (info.double_byte.size() <= DVERM16_MASKED_MAX_PAIRS &&
                         vermicelliDouble16Build(info.double_byte, (u8 *)&accel->dverm16.mask,
                                                 (u8 *)&accel->dverm16.firsts)) {
                     accel->accel_type = ACCEL_DVERM16;
@@ -489,7 +598,7 @@ accel_dfa_build_strat::buildAccel(UNUSED dstate_id_t this_idx,
                     DEBUG_PRINTF("building double16-vermicelli\n");
                     return;
                 }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
                 accel->accel_type = ACCEL_DVERM_MASKED;
                 accel->dverm.offset = verify_u8(info.double_offset);
                 accel->dverm.c1 = c1;
@@ -501,8 +610,8 @@ accel_dfa_build_strat::buildAccel(UNUSED dstate_id_t this_idx,
                 return;
             }
         }
-#ifdef HAVE_SVE2
-        if (info.double_byte.size() <= 8 &&
+#ifdef HAVE_VERM16
+        if (info.double_byte.size() <= DVERM16_MAX_PAIRS &&
             vermicelliDouble16Build(info.double_byte, (u8 *)&accel->dverm16.mask,
                                     (u8 *)&accel->dverm16.firsts)) {
             accel->accel_type = ACCEL_DVERM16;
@@ -510,7 +619,18 @@ accel_dfa_build_strat::buildAccel(UNUSED dstate_id_t this_idx,
             DEBUG_PRINTF("building double16-vermicelli\n");
             return;
         }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
+    }
+
+    if (info.cr.count() > 2) {
+        AccelAux multi;
+        memset(&multi, 0, sizeof(multi));
+        if (buildAccelMultiByte(info.triple_byte, info.gap_byte, info.gap_len,
+                                &multi)) {
+            *accel = multi;
+            DEBUG_PRINTF("state %hu is multi-byte vermicelli\n", this_idx);
+            return;
+        }
     }
 
     if (double_byte_ok(info) &&
@@ -546,14 +666,14 @@ accel_dfa_build_strat::buildAccel(UNUSED dstate_id_t this_idx,
         return;
     }
 
-#ifdef HAVE_SVE2
-    if (info.cr.count() <= 16) {
+#ifdef HAVE_VERM16
+    if (info.cr.count() <= VERM16_MAX_CHARS) {
         accel->accel_type = ACCEL_VERM16;
         vermicelli16Build(info.cr, (u8 *)&accel->verm16.mask);
         DEBUG_PRINTF("state %hu is vermicelli16\n", this_idx);
         return;
     }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
 
     if (info.cr.count() > max_floating_stop_char()) {
         accel->accel_type = ACCEL_NONE;
@@ -633,6 +753,8 @@ accel_dfa_build_strat::getAccelInfo(const Grey &grey) {
         AccelScheme sds_ei = rv[sds_proxy];
         sds_ei.double_byte.clear(); /* region based on single byte scheme
                                      * may differ from double byte */
+        sds_ei.triple_byte.clear();
+        sds_ei.gap_byte.clear();
         DEBUG_PRINTF("looking to expand offset accel to nearby states, %zu\n",
                      sds_ei.cr.count());
         auto sds_region = find_region(rdfa, sds_proxy, sds_ei);
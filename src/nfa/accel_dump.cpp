@@ -71,6 +71,10 @@ const char *accelName(u8 accel_type) {
         return "double-vermicelli nocase";
     case ACCEL_DVERM_MASKED:
         return "double-vermicelli masked";
+    case ACCEL_TVERM:
+        return "triple-vermicelli";
+    case ACCEL_DVERM_GAP:
+        return "gapped double-vermicelli";
     case ACCEL_RVERM:
         return "reverse vermicelli";
     case ACCEL_RVERM_NOCASE:
@@ -208,6 +212,21 @@ void dumpAccelInfo(FILE *f, const AccelAux &accel) {
         fprintf(f, " [\\x%02hhx\\x%02hhx] & [\\x%02hhx\\x%02hhx]\n",
                 accel.dverm.c1, accel.dverm.c2, accel.dverm.m1, accel.dverm.m2);
         break;
+    case ACCEL_TVERM:
+        for (u32 i = 0; i < accel.tverm.count; i++) {
+            fprintf(f, " [\\x%02hhx\\x%02hhx\\x%02hhx]", accel.tverm.c1[i],
+                    accel.tverm.c2[i], accel.tverm.c3[i]);
+        }
+        fprintf(f, "\n");
+        break;
+    case ACCEL_DVERM_GAP:
+        fprintf(f, " gap %hhu", accel.gdverm.gap);
+        for (u32 i = 0; i < accel.gdverm.count; i++) {
+            fprintf(f, " [\\x%02hhx\\x%02hhx]", accel.gdverm.c1[i],
+                    accel.gdverm.c2[i]);
+        }
+        fprintf(f, "\n");
+        break;
     case ACCEL_SHUFTI: {
         fprintf(f, "\n");
         dumpShuftiMasks(f, (const u8 *)&accel.shufti.lo,
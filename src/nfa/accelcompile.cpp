@@ -36,6 +36,7 @@
 #include "util/bitutils.h"
 #include "util/verify_types.h"
 
+#include <cstring>
 #include <map>
 #include <set>
 #include <vector>
@@ -73,8 +74,8 @@ void buildAccelSingle(const AccelInfo &info, AccelAux *aux) {
         return;
     }
 
-#ifdef HAVE_SVE2
-    if (outs <= 16) {
+#ifdef HAVE_VERM16
+    if (outs <= VERM16_MAX_CHARS) {
         aux->accel_type = ACCEL_VERM16;
         aux->verm16.offset = offset;
         vermicelli16Build(info.single_stops, (u8 *)&aux->verm16.mask);
@@ -209,8 +210,9 @@ void buildAccelDouble(const AccelInfo &info, AccelAux *aux) {
         if (buildDvermMask(info.double_stop2, &m1, &m2)) {
             u8 c1 = info.double_stop2.begin()->first & m1;
             u8 c2 = info.double_stop2.begin()->second & m2;
-#ifdef HAVE_SVE2
-            if (vermicelliDoubleMasked16Build(c1, c2, m1, m2, (u8 *)&aux->mdverm16.mask)) {
+#ifdef HAVE_VERM16
+            if (vermicelliDoubleMasked16Pairs(m1, m2) <= DVERM16_MASKED_MAX_PAIRS &&
+                vermicelliDoubleMasked16Build(c1, c2, m1, m2, (u8 *)&aux->mdverm16.mask)) {
                 aux->accel_type = ACCEL_DVERM16_MASKED;
                 aux->mdverm16.offset = offset;
                 aux->mdverm16.c1 = c1;
@@ -218,7 +220,7 @@ void buildAccelDouble(const AccelInfo &info, AccelAux *aux) {
                 DEBUG_PRINTF("building maskeddouble16-vermicelli for 0x%02hhx%02hhx\n",
                              c1, c2);
                 return;
-            } else if (outs2 <= 8 &&
+            } else if (outs2 <= DVERM16_MASKED_MAX_PAIRS &&
                        vermicelliDouble16Build(info.double_stop2, (u8 *)&aux->dverm16.mask,
                                                (u8 *)&aux->dverm16.firsts)) {
                 aux->accel_type = ACCEL_DVERM16;
@@ -226,7 +228,7 @@ void buildAccelDouble(const AccelInfo &info, AccelAux *aux) {
                 DEBUG_PRINTF("building double16-vermicelli\n");
                 return;
             }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
             aux->accel_type = ACCEL_DVERM_MASKED;
             aux->dverm.offset = offset;
             aux->dverm.c1 = c1;
@@ -236,8 +238,8 @@ void buildAccelDouble(const AccelInfo &info, AccelAux *aux) {
             DEBUG_PRINTF("building maskeddouble-vermicelli for 0x%02hhx%02hhx\n", c1, c2);
             return;
         }
-#ifdef HAVE_SVE2
-        if (outs2 <= 8 &&
+#ifdef HAVE_VERM16
+        if (outs2 <= DVERM16_MAX_PAIRS &&
             vermicelliDouble16Build(info.double_stop2, (u8 *)&aux->dverm16.mask,
                                     (u8 *)&aux->dverm16.firsts)) {
             aux->accel_type = ACCEL_DVERM16;
@@ -245,7 +247,7 @@ void buildAccelDouble(const AccelInfo &info, AccelAux *aux) {
             DEBUG_PRINTF("building double16-vermicelli\n");
             return;
         }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
     }
 
     if (outs1 < outs2 && outs1 <= 2) { // Heuristic from UE-438.
@@ -266,6 +268,56 @@ void buildAccelDouble(const AccelInfo &info, AccelAux *aux) {
     aux->accel_type = ACCEL_NONE;
 }
 
+bool buildAccelMultiByte(const flat_set<array<u8, 3>> &triples,
+                         const flat_set<pair<u8, u8>> &gaps, u32 gap_len,
+                         AccelAux *aux) {
+    assert(aux->accel_type == ACCEL_NONE);
+    bool use_triples = !triples.empty()
+                       && triples.size() <= ACCEL_MAX_MULTI_LITS;
+    bool use_gaps = !gaps.empty() && gaps.size() <= ACCEL_MAX_MULTI_LITS
+                    && gap_len >= 2 && gap_len <= ACCEL_MAX_GAP;
+
+    /* a gapped pair costs two compares a literal to the triple's three, so
+     * only take the triples if there are fewer of them */
+    if (use_triples && use_gaps && gaps.size() <= triples.size()) {
+        use_triples = false;
+    }
+
+    if (use_triples) {
+        aux->accel_type = ACCEL_TVERM;
+        aux->tverm.offset = 0;
+        aux->tverm.count = verify_u8(triples.size());
+        u32 i = 0;
+        for (const auto &lit : triples) {
+            aux->tverm.c1[i] = lit[0];
+            aux->tverm.c2[i] = lit[1];
+            aux->tverm.c3[i] = lit[2];
+            i++;
+        }
+        DEBUG_PRINTF("building triple-vermicelli for %zu literals\n",
+                     triples.size());
+        return true;
+    }
+
+    if (use_gaps) {
+        aux->accel_type = ACCEL_DVERM_GAP;
+        aux->gdverm.offset = 0;
+        aux->gdverm.count = verify_u8(gaps.size());
+        aux->gdverm.gap = verify_u8(gap_len);
+        u32 i = 0;
+        for (const auto &lit : gaps) {
+            aux->gdverm.c1[i] = lit.first;
+            aux->gdverm.c2[i] = lit.second;
+            i++;
+        }
+        DEBUG_PRINTF("building gapped double-vermicelli for %zu literals, "
+                     "gap %u\n", gaps.size(), gap_len);
+        return true;
+    }
+
+    return false;
+}
+
 bool buildAccelAux(const AccelInfo &info, AccelAux *aux) {
     assert(aux->accel_type == ACCEL_NONE);
     if (info.single_stops.none()) {
@@ -276,11 +328,23 @@ bool buildAccelAux(const AccelInfo &info, AccelAux *aux) {
     if (aux->accel_type == ACCEL_NONE) {
         buildAccelDouble(info, aux);
     }
+    if ((aux->accel_type == ACCEL_NONE || aux->accel_type == ACCEL_DSHUFTI)
+        && info.single_stops.count() > 2) {
+        /* the single-byte schemes left stop too often; longer literals are
+         * worth the extra compares */
+        AccelAux multi;
+        memset(&multi, 0, sizeof(multi));
+        if (buildAccelMultiByte(info.triple_stops, info.gap_stops,
+                                info.gap_len, &multi)) {
+            *aux = multi;
+        }
+    }
     if (aux->accel_type == ACCEL_NONE) {
         buildAccelSingle(info, aux);
     }
 
     assert(aux->accel_type == ACCEL_NONE
+           || aux->generic.offset == 0
            || aux->generic.offset == info.single_offset
            || aux->generic.offset == info.double_offset);
     return aux->accel_type != ACCEL_NONE;
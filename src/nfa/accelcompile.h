@@ -33,6 +33,8 @@
 #include "util/charreach.h"
 #include "util/flat_containers.h"
 
+#include <array>
+
 union AccelAux;
 
 namespace ue2 {
@@ -47,10 +49,21 @@ struct AccelInfo {
     flat_set<std::pair<u8, u8>> double_stop2; /**< double-byte accel stop
                                                * literals */
     CharReach single_stops; /**< escapes for single byte acceleration */
+    flat_set<std::array<u8, 3>> triple_stops; /**< triple-byte accel stop
+                                               * literals, offset 0 */
+    flat_set<std::pair<u8, u8>> gap_stops; /**< gapped-pair accel stop
+                                            * literals, offset 0 */
+    u32 gap_len = 0; /**< distance between the bytes of gap_stops */
 };
 
 bool buildAccelAux(const AccelInfo &info, AccelAux *aux);
 
+/* builds a triple-byte or gapped-pair vermicelli from whichever of the given
+ * literal sets is usable and cheaper; returns false if neither is */
+bool buildAccelMultiByte(const flat_set<std::array<u8, 3>> &triples,
+                         const flat_set<std::pair<u8, u8>> &gaps, u32 gap_len,
+                         AccelAux *aux);
+
 /* returns true is the escape set can be handled with a masked double_verm */
 bool buildDvermMask(const flat_set<std::pair<u8, u8>> &escape_set,
                     u8 *m1_out = nullptr, u8 *m2_out = nullptr);
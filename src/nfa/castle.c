@@ -46,8 +46,8 @@
 #include "util/partial_store.h"
 #include "ue2common.h"
 
-#ifdef HAVE_SVE2
-#include "castle_sve.h"
+#ifdef HAVE_VERM16
+#include "castle_verm16.h"
 #endif
 
 static really_inline
@@ -609,12 +609,12 @@ char castleScan(const struct Castle *c, const u8 *buf, const size_t begin,
         return castleScanVerm(c, buf, begin, end, loc);
     case CASTLE_NVERM:
         return castleScanNVerm(c, buf, begin, end, loc);
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
     case CASTLE_VERM16:
         return castleScanVerm16(c, buf, begin, end, loc);
     case CASTLE_NVERM16:
         return castleScanNVerm16(c, buf, begin, end, loc);
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
     case CASTLE_SHUFTI:
         return castleScanShufti(c, buf, begin, end, loc);
     case CASTLE_TRUFFLE:
@@ -710,12 +710,12 @@ char castleRevScan(const struct Castle *c, const u8 *buf, const size_t begin,
         return castleRevScanVerm(c, buf, begin, end, loc);
     case CASTLE_NVERM:
         return castleRevScanNVerm(c, buf, begin, end, loc);
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
     case CASTLE_VERM16:
         return castleRevScanVerm16(c, buf, begin, end, loc);
     case CASTLE_NVERM16:
         return castleRevScanNVerm16(c, buf, begin, end, loc);
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
     case CASTLE_SHUFTI:
         return castleRevScanShufti(c, buf, begin, end, loc);
     case CASTLE_TRUFFLE:
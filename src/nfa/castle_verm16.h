@@ -28,7 +28,7 @@
  */
 
 /** \file
- * \brief Castle for SVE: multi-tenant repeat engine, runtime code.
+ * \brief Castle for verm16: multi-tenant repeat engine, runtime code.
  */
 
 static really_inline
@@ -103,18 +103,18 @@ void writeCastleScanEngine(const CharReach &cr, Castle *c) {
         return;
     }
 
-#ifdef HAVE_SVE2
-    if (cr.count() <= 16) {
+#ifdef HAVE_VERM16
+    if (cr.count() <= VERM16_MAX_CHARS) {
         c->type = CASTLE_NVERM16;
         vermicelli16Build(cr, (u8 *)&c->u.verm16.mask);
         return;
     }
-    if (negated.count() <= 16) {
+    if (negated.count() <= VERM16_MAX_CHARS) {
         c->type = CASTLE_VERM16;
         vermicelli16Build(negated, (u8 *)&c->u.verm16.mask);
         return;
     }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
 
     if (shuftiBuildMasks(negated, (u8 *)&c->u.shuf.mask_lo,
                          (u8 *)&c->u.shuf.mask_hi) != -1) {
@@ -1170,6 +1170,10 @@ AccelScheme gough_build_strat::find_escape_strings(dstate_id_t this_idx) const {
         rv.double_byte.clear();
     }
 
+    /* the margin only covers single and double byte schemes */
+    rv.triple_byte.clear();
+    rv.gap_byte.clear();
+
     return rv;
 }
 
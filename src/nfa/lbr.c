@@ -531,6 +531,6 @@ char lbrFwdScanTruf(const struct NFA *nfa, const u8 *buf,
 #define ENGINE_ROOT_NAME Truf
 #include "lbr_common_impl.h"
 
-#ifdef HAVE_SVE2
-#include "lbr_sve.h"
+#ifdef HAVE_VERM16
+#include "lbr_verm16.h"
 #endif
@@ -31,6 +31,7 @@
 #define LBR_H
 
 #include "ue2common.h"
+#include "util/arch.h"
 
 struct mq;
 struct NFA;
@@ -102,7 +103,7 @@ char nfaExecLbrNVerm_expandState(const struct NFA *nfa, void *dest,
 #define nfaExecLbrNVerm_B_Reverse NFA_API_NO_IMPL
 #define nfaExecLbrNVerm_zombie_status NFA_API_ZOMBIE_NO_IMPL
 
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
 
 // LBR Verm16
 
@@ -146,7 +147,7 @@ char nfaExecLbrNVerm16_expandState(const struct NFA *nfa, void *dest,
 #define nfaExecLbrNVerm16_B_Reverse NFA_API_NO_IMPL
 #define nfaExecLbrNVerm16_zombie_status NFA_API_ZOMBIE_NO_IMPL
 
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
 
 // LBR Shuf
 
@@ -28,7 +28,7 @@
  */
 
 /** \file
- * \brief Large Bounded Repeat (LBR) engine for SVE: runtime code.
+ * \brief Large Bounded Repeat (LBR) engine for verm16: runtime code.
  */
 
 static really_inline
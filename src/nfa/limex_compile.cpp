@@ -62,6 +62,7 @@
 #include "util/verify_types.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdlib>
@@ -107,6 +108,10 @@ struct precalcAccel {
     CharReach double_cr;
     flat_set<pair<u8, u8>> double_lits; /* double-byte accel stop literals */
     u32 double_offset;
+
+    flat_set<array<u8, 3>> triple_lits; /* triple-byte accel stop literals */
+    flat_set<pair<u8, u8>> gap_lits; /* gapped-pair accel stop literals */
+    u32 gap_len = 0;
 };
 
 struct limex_accel_info {
@@ -677,6 +682,10 @@ void fillAccelInfo(build_info &bi) {
             pa.double_cr = as.double_cr;
         }
 
+        pa.triple_lits = as.triple_byte;
+        pa.gap_lits = as.gap_byte;
+        pa.gap_len = as.gap_len;
+
         useful |= state_set;
     }
 
@@ -930,15 +939,26 @@ void buildAccel(const build_info &args, NFAStateSet &accelMask,
         ainfo.double_stop2 = accelOuts[i].stop2;
 
         if (effective_i != IMPOSSIBLE_ACCEL_MASK) {
+            /* friends are squashed when we skip, so the multi-byte schemes
+             * (which have no back-off) must not be used if any are around */
+            bool has_friends = false;
             while (effective_i) {
                 u32 base_accel_id = findAndClearLSB_32(&effective_i);
                 effective_states.set(accelStates[base_accel_id].state);
+                NFAVertex v = accelStates[base_accel_id].v;
+                has_friends |= contains(accel.friends, v)
+                               && !accel.friends.at(v).empty();
             }
 
             if (contains(accel.precalc, effective_states)) {
                 const auto &precalc = accel.precalc.at(effective_states);
                 ainfo.single_offset = precalc.single_offset;
                 ainfo.single_stops = precalc.single_cr;
+                if (!has_friends) {
+                    ainfo.triple_stops = precalc.triple_lits;
+                    ainfo.gap_stops = precalc.gap_lits;
+                    ainfo.gap_len = precalc.gap_len;
+                }
             }
         }
 
@@ -1926,11 +1946,14 @@ struct Factory {
                          const map<ExceptionProto, vector<u32>> &exceptionMap,
                          const vector<u32> &repeatOffsets, implNFA_t *limex,
                          const u32 exceptionsOffset,
+                         const u32 exceptionSuccOffset,
                          const u32 reportListOffset) {
         DEBUG_PRINTF("exceptionsOffset=%u\n", exceptionsOffset);
 
         exception_t *etable = (exception_t *)((char *)limex + exceptionsOffset);
         assert(ISALIGNED(etable));
+        tableRow_t *esucc = (tableRow_t *)((char *)limex + exceptionSuccOffset);
+        assert(ISALIGNED(esucc));
 
         map<u32, ExceptionProto> exception_by_state;
         for (const auto &m : exceptionMap) {
@@ -1966,6 +1989,16 @@ struct Factory {
                                     : repeatOffsets[proto.repeat_index];
             e.repeatOffset = repeat_offset;
 
+            // The runtime takes a fast path through exceptions which only
+            // switch on successors, reading them from the dense copy.
+            maskSetBits(esucc[ecount], proto.succ_states);
+            if (!args.cc.grey.simpleNFAExceptions
+                || e.reports != MO_INVALID_IDX
+                || e.hasSquash != LIMEX_SQUASH_NONE
+                || e.trigger != LIMEX_TRIGGER_NONE) {
+                maskSetBit(limex->exceptionComplexMask, state_id);
+            }
+
             // for the state that can switch it on
             // set this bit in the exception mask
             maskSetBit(limex->exceptionMask, state_id);
@@ -1974,6 +2007,7 @@ struct Factory {
         }
 
         limex->exceptionOffset = exceptionsOffset;
+        limex->exceptionSuccOffset = exceptionSuccOffset;
         limex->exceptionCount = ecount;
 
         if (args.num_states > 64 && args.cc.target_info.has_avx512vbmi()) {
@@ -2304,6 +2338,10 @@ struct Factory {
         const u32 exceptionsOffset = offset;
         offset += sizeof(exception_t) * exceptionCount;
 
+        offset = ROUNDUP_CL(offset);
+        const u32 exceptionSuccOffset = offset;
+        offset += sizeof(tableRow_t) * exceptionCount;
+
         const u32 reportListOffset = offset;
         offset += sizeof(ReportID) * reportList.size();
 
@@ -2354,7 +2392,7 @@ struct Factory {
                      repeatsOffset);
 
         writeExceptions(args, exceptionMap, repeatOffsets, limex, exceptionsOffset,
-                        reportListOffset);
+                        exceptionSuccOffset, reportListOffset);
 
         writeLimexMasks(args, limex);
 
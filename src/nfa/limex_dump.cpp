@@ -313,6 +313,8 @@ void dumpLimexText(const limex_type *limex, FILE *f) {
              size);
     dumpMask(f, "compress_mask", (const u8 *)&limex->compressMask, size);
     dumpMask(f, "emask", (const u8 *)&limex->exceptionMask, size);
+    dumpMask(f, "emask_complex", (const u8 *)&limex->exceptionComplexMask,
+             size);
     dumpMask(f, "zombie", (const u8 *)&limex->zombieMask, size);
 
     // Dump top masks, if there are any.
@@ -32,8 +32,9 @@
  * X-macro generic impl, included into the various LimEx model implementations.
  */
 
-#if !defined(SIZE) || !defined(STATE_T) || !defined(LOAD_FROM_ENG)
-#  error Must define SIZE, STATE_T, LOAD_FROM_ENG in includer.
+#if !defined(SIZE) || !defined(STATE_T) || !defined(ENG_STATE_T) \
+    || !defined(LOAD_FROM_ENG)
+#  error Must define SIZE, STATE_T, ENG_STATE_T, LOAD_FROM_ENG in includer.
 #endif
 
 #include "config.h"
@@ -43,7 +44,10 @@
 
 #define PE_FN                   JOIN(processExceptional, SIZE)
 #define RUN_EXCEPTION_FN        JOIN(runException, SIZE)
+#define GATHER_EXCEPTIONS_FN    JOIN(gatherExceptions, SIZE)
+#define SIMPLE_EXCEPTIONS_FN    JOIN(runSimpleExceptions, SIZE)
 #define ZERO_STATE              JOIN(zero_, STATE_T)
+#define ISZERO_STATE            JOIN(isZero_, STATE_T)
 #define AND_STATE               JOIN(and_, STATE_T)
 #define EQ_STATE(a, b)          (!JOIN(noteq_, STATE_T)((a), (b)))
 #define OR_STATE                JOIN(or_, STATE_T)
@@ -57,8 +61,10 @@
 
 #ifdef ESTATE_ON_STACK
 #define ESTATE_ARG STATE_T estate
+#define ESTATE_ARG_P estate
 #else
 #define ESTATE_ARG const STATE_T *estatep
+#define ESTATE_ARG_P estatep
 #define estate (*estatep)
 #endif
 
@@ -88,6 +94,88 @@
 #define RANK_IN_MASK_FN rank_in_mask32
 #endif
 
+#ifndef RUN_EXCEPTION_FN_ONLY
+
+/** \brief Gather the indices of the exceptions for the states on in \a estate
+ * into \a idx, returning the number found. */
+static really_inline
+u32 GATHER_EXCEPTIONS_FN(ESTATE_ARG, u32 diffmask,
+                         const struct IMPL_NFA_T *limex, u32 *idx) {
+    u32 count = 0;
+
+#if defined(HAVE_AVX512VBMI) && SIZE > 64
+    if (likely(limex->flags & LIMEX_FLAG_EXTRACT_EXP)) {
+        m512 emask = EXPAND_STATE(estate);
+        emask = SHUFFLE_BYTE_STATE(load_m512(&limex->exceptionShufMask), emask);
+        emask = and512(emask, load_m512(&limex->exceptionAndMask));
+        u64a word = eq512mask(emask, load_m512(&limex->exceptionBitMask));
+        do {
+            idx[count++] = FIND_AND_CLEAR_FN(&word);
+        } while (word);
+        return count;
+    }
+#endif
+
+    CHUNK_T chunks[sizeof(STATE_T) / sizeof(CHUNK_T)];
+    CHUNK_T emask_chunks[sizeof(STATE_T) / sizeof(CHUNK_T)];
+#ifdef ESTATE_ON_STACK
+    memcpy(chunks, &estate, sizeof(STATE_T));
+#else
+    memcpy(chunks, estatep, sizeof(STATE_T));
+#endif
+    memcpy(emask_chunks, &limex->exceptionMask, sizeof(STATE_T));
+
+    u32 base_index[sizeof(STATE_T) / sizeof(CHUNK_T)];
+    base_index[0] = 0;
+    for (s32 i = 0; i < (s32)ARRAY_LENGTH(base_index) - 1; i++) {
+        base_index[i + 1] = base_index[i] + POPCOUNT_FN(emask_chunks[i]);
+    }
+
+    do {
+        u32 t = findAndClearLSB_32(&diffmask);
+#ifdef ARCH_64_BIT
+        t >>= 1; // Due to diffmask64, which leaves holes in the bitmask.
+#endif
+        assert(t < ARRAY_LENGTH(chunks));
+        CHUNK_T word = chunks[t];
+        assert(word != 0);
+        do {
+            u32 bit = FIND_AND_CLEAR_FN(&word);
+            idx[count++] = RANK_IN_MASK_FN(emask_chunks[t], bit) + base_index[t];
+        } while (word);
+    } while (diffmask);
+
+    return count;
+}
+
+/** \brief Fast path for an \a estate whose exceptions all do nothing but
+ * switch on successors: no reports, triggers or squashes, so there is no need
+ * to look at the exception records at all. The successor masks are ORed
+ * straight out of the dense copy, two streams at a time. */
+static really_inline
+STATE_T SIMPLE_EXCEPTIONS_FN(ESTATE_ARG, u32 diffmask,
+                             const struct IMPL_NFA_T *limex) {
+    u32 idx[SIZE];
+    u32 count = GATHER_EXCEPTIONS_FN(ESTATE_ARG_P, diffmask, limex, idx);
+    assert(count && count <= limex->exceptionCount);
+
+    const ENG_STATE_T *esucc =
+        (const ENG_STATE_T *)((const char *)limex + limex->exceptionSuccOffset);
+    STATE_T succ0 = ZERO_STATE;
+    STATE_T succ1 = ZERO_STATE;
+    u32 i = 0;
+    for (; i + 1 < count; i += 2) {
+        succ0 = OR_STATE(succ0, LOAD_FROM_ENG(&esucc[idx[i]]));
+        succ1 = OR_STATE(succ1, LOAD_FROM_ENG(&esucc[idx[i + 1]]));
+    }
+    if (i < count) {
+        succ0 = OR_STATE(succ0, LOAD_FROM_ENG(&esucc[idx[i]]));
+    }
+    return OR_STATE(succ0, succ1);
+}
+
+#endif
+
 /** \brief Process a single exception. Returns 1 if exception handling should
  * continue, 0 if an accept callback has instructed us to halt. */
 static really_inline
@@ -229,6 +317,18 @@ int PE_FN(STATE_ARG, ESTATE_ARG, UNUSED u32 diffmask, STATE_T *succ,
         return 0;
     }
 
+    if (ISZERO_STATE(AND_STATE(estate,
+                               LOAD_FROM_ENG(&limex->exceptionComplexMask)))) {
+        DEBUG_PRINTF("only simple exceptions\n");
+        STATE_T esucc = SIMPLE_EXCEPTIONS_FN(ESTATE_ARG_P, diffmask, limex);
+        *succ = OR_STATE(*succ, esucc);
+        ctx->cached_estate = estate;
+        ctx->cached_esucc = esucc;
+        ctx->cached_reports = NULL;
+        ctx->cached_br = 0;
+        return 0;
+    }
+
 #ifndef BIG_MODEL
     STATE_T local_succ = ZERO_STATE;
 #else
@@ -370,6 +470,7 @@ int PE_FN(STATE_ARG, ESTATE_ARG, UNUSED u32 diffmask, STATE_T *succ,
 #endif
 
 #undef ZERO_STATE
+#undef ISZERO_STATE
 #undef AND_STATE
 #undef EQ_STATE
 #undef OR_STATE
@@ -378,12 +479,15 @@ int PE_FN(STATE_ARG, ESTATE_ARG, UNUSED u32 diffmask, STATE_T *succ,
 #undef TESTBIT_STATE
 #undef PE_FN
 #undef RUN_EXCEPTION_FN
+#undef GATHER_EXCEPTIONS_FN
+#undef SIMPLE_EXCEPTIONS_FN
 #undef CONTEXT_T
 #undef EXCEPTION_T
 
 #ifdef estate
 #undef estate
 #endif
+#undef ESTATE_ARG_P
 
 #ifdef BIG_MODEL
 #undef BIG_MODEL
@@ -47,6 +47,9 @@
             Variable length array of NFAAccept structs.
         Exceptions
             Variable length array of NFAExceptionXXX structs.
+        Exception successors
+            Dense array of state bitvectors, one per exception, holding a copy
+            of NFAExceptionXXX.successors for the simple exception fast path.
         Repeat Structure Offsets
             Array of u32 offsets that point at each "Repeat Structure" (below)
         Repeat Structures
@@ -134,6 +137,7 @@ struct LimExNFA##size {                                                     \
     u32 acceptEodOffset; /* rel. to start of LimExNFA */                    \
     u32 exceptionCount;                                                     \
     u32 exceptionOffset; /* rel. to start of LimExNFA */                    \
+    u32 exceptionSuccOffset; /* rel. to start of LimExNFA */                \
     u32 repeatCount;                                                        \
     u32 repeatOffset;                                                       \
     u32 squashOffset; /* rel. to start of LimExNFA; for accept squashing */ \
@@ -153,6 +157,8 @@ struct LimExNFA##size {                                                     \
                                     *  followers */                         \
     u_##size compressMask; /**< switch off before compress */               \
     u_##size exceptionMask;                                                 \
+    u_##size exceptionComplexMask; /**< exceptions that do more than switch
+                                       *  on successors */                  \
     u_##size repeatCyclicMask; /**< also includes tug states */             \
     u_##size zombieMask; /**< zombie if in any of the set states */         \
     u_##size shift[MAX_SHIFT_COUNT];                                        \
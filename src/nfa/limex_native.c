@@ -91,6 +91,25 @@ int processExceptional32(u32 s, u32 estate, UNUSED u32 diffmask, u32 *succ,
         return 0;
     }
 
+    if (!(estate & limex->exceptionComplexMask)) {
+        /* Only simple exceptions: OR their successors straight out of the
+         * dense copy without touching the exception records. */
+        const u32 *esucc =
+            (const u32 *)((const char *)limex + limex->exceptionSuccOffset);
+        u32 orig_estate = estate;
+        u32 local_succ = 0;
+        do {
+            u32 bit = findAndClearLSB_32(&estate);
+            local_succ |= esucc[rank_in_mask32(limex->exceptionMask, bit)];
+        } while (estate);
+        *succ |= local_succ;
+        ctx->cached_estate = orig_estate;
+        ctx->cached_esucc = local_succ;
+        ctx->cached_reports = NULL;
+        ctx->cached_br = 0;
+        return 0;
+    }
+
     u32 orig_estate = estate; // for caching
     u32 local_succ = 0;
     struct proto_cache new_cache = {0, NULL};
@@ -420,7 +420,22 @@ u32 doNormal8(const struct mcclellan *m, const u8 **c_inout, const u8 *end,
     const u32 as = m->alphaShift;
     const u8 *succ_table = (const u8 *)((const char *)m
                                         + sizeof(struct mcclellan));
+    const u8 *pair_table = m->stride2_offset
+                         ? (const u8 *)m + m->stride2_offset : NULL;
     while (c < end && s) {
+        if (pair_table && c + 1 < end) {
+            /* a zero entry means the intermediate state is dead or special
+             * (accel/accept) and must be visited with a single step */
+            u8 s2 = pair_table[(s << (2 * as)) + (m->remap[c[0]] << as)
+                               + m->remap[c[1]]];
+            if (s2) {
+                DEBUG_PRINTF("c: %02hhx %02hhx pair s: %u\n", c[0], c[1], s2);
+                s = s2;
+                c += 2;
+                goto check;
+            }
+        }
+
         u8 cprime = m->remap[*c];
         DEBUG_PRINTF("c: %02hhx '%c' cp:%02hhx\n", *c,
                      ourisprint(*c) ? *c : '?', cprime);
@@ -428,6 +443,7 @@ u32 doNormal8(const struct mcclellan *m, const u8 **c_inout, const u8 *end,
 
         DEBUG_PRINTF("s: %u\n", s);
         c++;
+    check:
         if (do_accel) {
             if (s >= accel_limit) {
                 break;
@@ -958,6 +974,152 @@ char nfaExecMcClellan8_B(const struct NFA *n, u64a offset, const u8 *buffer,
     }
 }
 
+/* Reverse scans are used to find the start of match for SOM: the DFA is built
+ * from a reversed, anchored graph, and each accept reached while walking
+ * backwards from the end of the match reports the offset of a candidate start.
+ * As the graph is triggered, no wide states are ever present. */
+
+static really_inline
+char mcclellanRevExec8(const struct mcclellan *m, u32 *state, const u8 *buf,
+                       size_t len, u64a offset, NfaCallback cb, void *ctxt,
+                       u32 *cached_accept_state, u32 *cached_accept_id) {
+    const u32 as = m->alphaShift;
+    const u32 accept_limit = m->accept_limit_8;
+    const u8 *succ_table = (const u8 *)((const char *)m
+                                        + sizeof(struct mcclellan));
+    u32 s = *state;
+
+    for (size_t i = len; i != 0 && s; i--) {
+        s = succ_table[(s << as) + m->remap[buf[i - 1]]];
+        DEBUG_PRINTF("rev c: %02hhx s: %u\n", buf[i - 1], s);
+        if (s >= accept_limit &&
+            doComplexReport(cb, ctxt, m, s, offset + i - 1, 0,
+                            cached_accept_state, cached_accept_id)
+                == MO_HALT_MATCHING) {
+            return MO_HALT_MATCHING;
+        }
+    }
+
+    *state = s;
+    return MO_CONTINUE_MATCHING;
+}
+
+static really_inline
+char mcclellanRevExec16(const struct mcclellan *m, u32 *state, const u8 *buf,
+                        size_t len, u64a offset, NfaCallback cb, void *ctxt,
+                        u32 *cached_accept_state, u32 *cached_accept_id) {
+    assert(!m->has_wide);
+    const u32 as = m->alphaShift;
+    const u16 *succ_table
+        = (const u16 *)((const char *)m + sizeof(struct mcclellan));
+    assert(ISALIGNED_N(succ_table, 2));
+    const u32 sherman_base = m->sherman_limit;
+    const char *sherman_base_offset
+        = (const char *)m - sizeof(struct NFA) + m->sherman_offset;
+    u32 s = *state & STATE_MASK;
+
+    for (size_t i = len; i != 0 && s; i--) {
+        u8 cprime = m->remap[buf[i - 1]];
+        if (s < sherman_base) {
+            assert(s < m->state_count);
+            s = succ_table[(s << as) + cprime];
+        } else {
+            const char *sherman_state
+                = findShermanState(m, sherman_base_offset, sherman_base, s);
+            s = doSherman16(sherman_state, cprime, succ_table, as);
+        }
+        DEBUG_PRINTF("rev c: %02hhx s: %u (%u)\n", buf[i - 1], s,
+                     s & STATE_MASK);
+
+        if ((s & ACCEPT_FLAG) &&
+            doComplexReport(cb, ctxt, m, s & STATE_MASK, offset + i - 1, 0,
+                            cached_accept_state, cached_accept_id)
+                == MO_HALT_MATCHING) {
+            return MO_HALT_MATCHING;
+        }
+        s &= STATE_MASK;
+    }
+
+    *state = s;
+    return MO_CONTINUE_MATCHING;
+}
+
+static really_inline
+char mcclellanBlockExecReverse(const struct NFA *n, u64a offset,
+                               const u8 *buf, size_t buflen, const u8 *hbuf,
+                               size_t hlen, NfaCallback cb, void *context,
+                               char is16) {
+    assert(buf || hbuf);
+    assert(buflen || hlen);
+
+    const struct mcclellan *m = getImplNfa(n);
+    u32 s = m->start_anchored;
+    u32 cached_accept_state = 0;
+    u32 cached_accept_id = 0;
+
+    if (get_aux(m, s)->accept &&
+        doComplexReport(cb, context, m, s, offset, 0, &cached_accept_state,
+                        &cached_accept_id) == MO_HALT_MATCHING) {
+        return 0;
+    }
+
+    // 'buf' may be null, for example when we're scanning at EOD time.
+    if (buflen) {
+        assert(buf);
+        DEBUG_PRINTF("MAIN BUFFER SCAN, %zu bytes\n", buflen);
+        offset -= buflen;
+        char rv = is16 ? mcclellanRevExec16(m, &s, buf, buflen, offset, cb,
+                                            context, &cached_accept_state,
+                                            &cached_accept_id)
+                       : mcclellanRevExec8(m, &s, buf, buflen, offset, cb,
+                                           context, &cached_accept_state,
+                                           &cached_accept_id);
+        if (rv == MO_HALT_MATCHING) {
+            return 0;
+        }
+    }
+
+    if (hlen && s) {
+        assert(hbuf);
+        DEBUG_PRINTF("HISTORY BUFFER SCAN, %zu bytes\n", hlen);
+        offset -= hlen;
+        char rv = is16 ? mcclellanRevExec16(m, &s, hbuf, hlen, offset, cb,
+                                            context, &cached_accept_state,
+                                            &cached_accept_id)
+                       : mcclellanRevExec8(m, &s, hbuf, hlen, offset, cb,
+                                           context, &cached_accept_state,
+                                           &cached_accept_id);
+        if (rv == MO_HALT_MATCHING) {
+            return 0;
+        }
+    }
+
+    if (offset == 0 && s) {
+        mcclellanCheckEOD(n, s, offset, cb, context);
+    }
+
+    // NOTE: return value is unused.
+    return 0;
+}
+
+char nfaExecMcClellan8_B_Reverse(const struct NFA *n, u64a offset,
+                                 const u8 *buf, size_t buflen,
+                                 const u8 *hbuf, size_t hlen,
+                                 NfaCallback cb, void *context) {
+    assert(n->type == MCCLELLAN_NFA_8);
+    return mcclellanBlockExecReverse(n, offset, buf, buflen, hbuf, hlen, cb,
+                                     context, 0);
+}
+
+char nfaExecMcClellan16_B_Reverse(const struct NFA *n, u64a offset,
+                                  const u8 *buf, size_t buflen,
+                                  const u8 *hbuf, size_t hlen,
+                                  NfaCallback cb, void *context) {
+    assert(n->type == MCCLELLAN_NFA_16);
+    return mcclellanBlockExecReverse(n, offset, buf, buflen, hbuf, hlen, cb,
+                                     context, 1);
+}
+
 char nfaExecMcClellan8_Q(const struct NFA *n, struct mq *q, s64a end) {
     u64a offset = q->offset;
     const u8 *buffer = q->buffer;
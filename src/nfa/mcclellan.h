@@ -55,7 +55,11 @@ char nfaExecMcClellan8_queueCompressState(const struct NFA *nfa,
 char nfaExecMcClellan8_expandState(const struct NFA *nfa, void *dest,
                                    const void *src, u64a offset, u8 key);
 
-#define nfaExecMcClellan8_B_Reverse NFA_API_NO_IMPL
+char nfaExecMcClellan8_B_Reverse(const struct NFA *n, u64a offset,
+                                 const u8 *buf, size_t buflen,
+                                 const u8 *hbuf, size_t hlen,
+                                 NfaCallback cb, void *context);
+
 #define nfaExecMcClellan8_zombie_status NFA_API_ZOMBIE_NO_IMPL
 
 // 16-bit McClellan
@@ -78,7 +82,11 @@ char nfaExecMcClellan16_queueCompressState(const struct NFA *nfa,
 char nfaExecMcClellan16_expandState(const struct NFA *nfa, void *dest,
                                     const void *src, u64a offset, u8 key);
 
-#define nfaExecMcClellan16_B_Reverse NFA_API_NO_IMPL
+char nfaExecMcClellan16_B_Reverse(const struct NFA *n, u64a offset,
+                                  const u8 *buf, size_t buflen,
+                                  const u8 *hbuf, size_t hlen,
+                                  NfaCallback cb, void *context);
+
 #define nfaExecMcClellan16_zombie_status NFA_API_ZOMBIE_NO_IMPL
 
 /**
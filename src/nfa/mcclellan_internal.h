@@ -100,6 +100,11 @@ struct mcclellan {
     u32 haig_offset; /**< reserved for use by Haig, relative to start of NFA */
     u32 wide_offset; /**< offset of the wide state entries to the start of the
                       * nfa structure */
+    u32 stride2_offset; /**< 8 bit only: offset of the byte-pair successor
+                         * table from start of McClellan; 0 if none. Entry
+                         * (s << 2 * alphaShift) + (c1 << alphaShift) + c2 is
+                         * the state after both bytes, or 0 if the state
+                         * after c1 is dead, accel or accept. */
 };
 
 static really_inline
@@ -552,7 +552,7 @@ void fillInAux(mstate_aux *aux, dstate_id_t i, const dfa_info &info,
 /* returns false on error */
 static
 bool allocateFSN16(dfa_info &info, dstate_id_t *sherman_base,
-                   dstate_id_t *wide_limit) {
+                   dstate_id_t *wide_limit, const Grey &grey) {
     info.states[0].impl_id = 0; /* dead is always 0 */
 
     vector<dstate_id_t> norm;
@@ -578,6 +578,11 @@ bool allocateFSN16(dfa_info &info, dstate_id_t *sherman_base,
         }
     }
 
+    /* wide states keep their chain order */
+    const auto rank = state_order_ranks(info.raw, grey);
+    order_by_depth(norm, rank);
+    order_by_depth(sherm, rank);
+
     dstate_id_t next = 1;
     for (const dstate_id_t &s : norm) {
         DEBUG_PRINTF("[norm] mapping state %u to %u\n", s, next);
@@ -622,7 +627,7 @@ bytecode_ptr<NFA> mcclellanCompile16(dfa_info &info, const CompileContext &cc,
 
     u16 count_real_states;
     u16 wide_limit;
-    if (!allocateFSN16(info, &count_real_states, &wide_limit)) {
+    if (!allocateFSN16(info, &count_real_states, &wide_limit, cc.grey)) {
         DEBUG_PRINTF("failed to allocate state numbers, %zu states total\n",
                      info.size());
         return nullptr;
@@ -881,7 +886,7 @@ void fillInBasicState8(const dfa_info &info, mstate_aux *aux, u8 *succ_table,
 static
 void allocateFSN8(dfa_info &info,
                   const map<dstate_id_t, AccelScheme> &accel_escape_info,
-                  u16 *accel_limit, u16 *accept_limit) {
+                  u16 *accel_limit, u16 *accept_limit, const Grey &grey) {
     info.states[0].impl_id = 0; /* dead is always 0 */
 
     vector<dstate_id_t> norm;
@@ -900,6 +905,11 @@ void allocateFSN8(dfa_info &info,
         }
     }
 
+    const auto rank = state_order_ranks(info.raw, grey);
+    order_by_depth(norm, rank);
+    order_by_depth(accel, rank);
+    order_by_depth(accept, rank);
+
     u32 j = 1; /* dead is already at 0 */
     for (const dstate_id_t &s : norm) {
         assert(j <= 256);
@@ -920,6 +930,83 @@ void allocateFSN8(dfa_info &info,
     }
 }
 
+/** \brief True if a DFA state is one the byte-pair table can step through:
+ * not dead, accelerable or accepting. */
+static
+bool isStride2Plain(const dfa_info &info,
+                    const map<dstate_id_t, AccelScheme> &accel_escape_info,
+                    dstate_id_t s) {
+    return s != DEAD_STATE && info.states[s].reports.empty()
+        && !contains(accel_escape_info, s);
+}
+
+/** \brief Size of the byte-pair successor table to build for an 8-bit
+ * McClellan, or zero if it would be too large to stay cache resident or
+ * would rarely be used.
+ *
+ * A pair step is only possible when the state after the first byte is plain,
+ * so the table is skipped unless at least half of the byte transitions out
+ * of plain states lead to plain states. DFAs that mostly sit in accelerated
+ * or accepting states gain nothing from it. */
+static
+size_t stride2TableSize(const dfa_info &info,
+                        const map<dstate_id_t, AccelScheme> &accel_escape_info,
+                        const CompileContext &cc) {
+    if (!cc.grey.allowMcClellanStride2) {
+        return 0;
+    }
+    if (info.strat.getType() != McClellan) {
+        return 0; /* other engines have their own runtimes */
+    }
+
+    size_t size = info.size() << (2 * info.getAlphaShift());
+    DEBUG_PRINTF("stride 2 table would be %zu bytes\n", size);
+    if (size > cc.grey.mcclellanStride2Limit) {
+        return 0;
+    }
+
+    size_t total = 0;
+    size_t pairable = 0;
+    for (dstate_id_t s = 1; s < info.size(); s++) {
+        if (!isStride2Plain(info, accel_escape_info, s)) {
+            continue;
+        }
+        for (u32 c = 0; c < N_CHARS; c++) {
+            dstate_id_t mid = info.states[s].next[info.alpha_remap[c]];
+            total++;
+            if (isStride2Plain(info, accel_escape_info, mid)) {
+                pairable++;
+            }
+        }
+    }
+
+    DEBUG_PRINTF("%zu of %zu transitions can pair\n", pairable, total);
+    if (pairable * 2 < total || !total) {
+        return 0;
+    }
+    return size;
+}
+
+static
+void fillStride2Table(const dfa_info &info, const u8 *succ_table,
+                      u16 accel_limit, u8 *pair_table) {
+    const u32 as = info.getAlphaShift();
+
+    for (u32 s = 0; s < info.size(); s++) {
+        for (u32 c1 = 0; c1 < info.impl_alpha_size; c1++) {
+            u8 mid = succ_table[(s << as) + c1];
+            if (!mid || mid >= accel_limit) {
+                /* leave zero: runtime must take a single step to see it */
+                continue;
+            }
+            for (u32 c2 = 0; c2 < info.impl_alpha_size; c2++) {
+                pair_table[(s << (2 * as)) + (c1 << as) + c2]
+                    = succ_table[(mid << as) + c2];
+            }
+        }
+    }
+}
+
 static
 bytecode_ptr<NFA> mcclellanCompile8(dfa_info &info, const CompileContext &cc,
                                     set<dstate_id_t> *accel_states) {
@@ -940,13 +1027,18 @@ bytecode_ptr<NFA> mcclellanCompile8(dfa_info &info, const CompileContext &cc,
     size_t accel_size = info.strat.accelSize() * accel_escape_info.size();
     size_t accel_offset = ROUNDUP_N(aux_offset + aux_size
                                      + ri->getReportListSize(), 32);
-    size_t total_size = accel_offset + accel_size;
+    size_t stride2_size = stride2TableSize(info, accel_escape_info, cc);
+    size_t stride2_offset = ROUNDUP_CL(accel_offset + accel_size);
+    size_t total_size = stride2_size ? stride2_offset + stride2_size
+                                     : accel_offset + accel_size;
 
     DEBUG_PRINTF("aux_size %zu\n", aux_size);
     DEBUG_PRINTF("aux_offset %zu\n", aux_offset);
     DEBUG_PRINTF("rl size %u\n", ri->getReportListSize());
     DEBUG_PRINTF("accel_size %zu\n", accel_size);
     DEBUG_PRINTF("accel_offset %zu\n", accel_offset);
+    DEBUG_PRINTF("stride2_size %zu\n", stride2_size);
+    DEBUG_PRINTF("stride2_offset %zu\n", stride2_offset);
     DEBUG_PRINTF("total_size %zu\n", total_size);
 
     accel_offset -= sizeof(NFA); /* adj accel offset to be relative to m */
@@ -958,7 +1050,7 @@ bytecode_ptr<NFA> mcclellanCompile8(dfa_info &info, const CompileContext &cc,
     mcclellan *m = (mcclellan *)getMutableImplNfa(nfa.get());
 
     allocateFSN8(info, accel_escape_info, &m->accel_limit_8,
-                 &m->accept_limit_8);
+                 &m->accept_limit_8, cc.grey);
     populateBasicInfo(sizeof(u8), info, total_size, aux_offset, accel_offset,
                       accel_escape_info.size(), arb, single, nfa.get());
 
@@ -987,6 +1079,12 @@ bytecode_ptr<NFA> mcclellanCompile8(dfa_info &info, const CompileContext &cc,
 
     assert(accel_offset + sizeof(NFA) <= total_size);
 
+    if (stride2_size) {
+        fillStride2Table(info, succ_table, m->accel_limit_8,
+                         (u8 *)nfa_base + stride2_offset);
+        m->stride2_offset = verify_u32(stride2_offset - sizeof(NFA));
+    }
+
     DEBUG_PRINTF("rl size %zu\n", ri->size());
 
     if (accel_states && nfa) {
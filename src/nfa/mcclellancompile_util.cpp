@@ -29,10 +29,13 @@
 #include "mcclellancompile_util.h"
 
 #include "rdfa.h"
+#include "grey.h"
 #include "util/container.h"
 #include "util/hash.h"
+#include "util/verify_types.h"
 #include "ue2common.h"
 
+#include <algorithm>
 #include <deque>
 #include <map>
 
@@ -283,4 +286,76 @@ bool is_dead(const raw_dfa &rdfa) {
            rdfa.start_floating == DEAD_STATE;
 }
 
+vector<u32> rank_states_by_depth(const raw_dfa &rdfa) {
+    const size_t n = rdfa.states.size();
+    const u16 top = rdfa.alpha_remap[TOP];
+    const u32 unreached = ~0U;
+
+    /* Breadth-first walk out of the start states. The floating start goes
+     * first as unanchored scanning keeps returning to it. */
+    vector<u32> depth(n, unreached);
+    deque<dstate_id_t> pending;
+    for (dstate_id_t s : {rdfa.start_floating, rdfa.start_anchored}) {
+        if (s != DEAD_STATE && depth[s] == unreached) {
+            depth[s] = 0;
+            pending.emplace_back(s);
+        }
+    }
+
+    vector<u32> in_degree(n, 0);
+    while (!pending.empty()) {
+        dstate_id_t s = pending.front();
+        pending.pop_front();
+        const auto &next = rdfa.states[s].next;
+        for (u16 c = 0; c < next.size(); c++) {
+            if (c == top) {
+                continue;
+            }
+            dstate_id_t t = next[c];
+            in_degree[t]++;
+            if (depth[t] == unreached) {
+                depth[t] = depth[s] + 1;
+                pending.emplace_back(t);
+            }
+        }
+    }
+
+    /* Shallow states first; among equals, prefer those entered on more
+     * symbols. Ties keep the original order so builds are deterministic. */
+    vector<dstate_id_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = verify_u16(i);
+    }
+    stable_sort(order.begin(), order.end(),
+                [&](dstate_id_t a, dstate_id_t b) {
+                    if (depth[a] != depth[b]) {
+                        return depth[a] < depth[b];
+                    }
+                    return in_degree[a] > in_degree[b];
+                });
+
+    vector<u32> rank(n);
+    for (size_t i = 0; i < n; i++) {
+        rank[order[i]] = verify_u32(i);
+    }
+    return rank;
+}
+
+vector<u32> state_order_ranks(const raw_dfa &rdfa, const Grey &grey) {
+    if (!grey.orderDfaStatesByDepth) {
+        return {};
+    }
+    return rank_states_by_depth(rdfa);
+}
+
+void order_by_depth(vector<dstate_id_t> &states, const vector<u32> &rank) {
+    if (rank.empty()) {
+        return;
+    }
+    stable_sort(states.begin(), states.end(),
+                [&rank](dstate_id_t a, dstate_id_t b) {
+                    return rank[a] < rank[b];
+                });
+}
+
 } // namespace ue2
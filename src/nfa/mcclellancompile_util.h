@@ -33,9 +33,12 @@
 #include "ue2common.h"
 
 #include <set>
+#include <vector>
 
 namespace ue2 {
 
+struct Grey;
+
 u32 remove_leading_dots(raw_dfa &raw);
 
 /**
@@ -65,6 +68,30 @@ bool can_die_early(const raw_dfa &raw, u32 age_limit);
  */
 bool is_dead(const raw_dfa &rdfa);
 
+/**
+ * \brief Ranks the states of a DFA by how hot they are likely to be during a
+ * scan: lower is hotter. States are ordered by breadth-first depth from the
+ * start states, then by the number of symbols entering them.
+ *
+ * Used to hand hot states the lowest implementation ids so that their
+ * transition rows share cache lines.
+ */
+std::vector<u32> rank_states_by_depth(const raw_dfa &rdfa);
+
+/**
+ * \brief Returns the state ranks to number a DFA's states by: those from \ref
+ * rank_states_by_depth if Grey::orderDfaStatesByDepth is set, otherwise
+ * empty, which leaves the raw state order alone.
+ */
+std::vector<u32> state_order_ranks(const raw_dfa &rdfa, const Grey &grey);
+
+/**
+ * \brief Puts the hottest of \a states first according to \a rank, as
+ * returned by \ref state_order_ranks; a no-op if \a rank is empty.
+ */
+void order_by_depth(std::vector<dstate_id_t> &states,
+                    const std::vector<u32> &rank);
+
 
 } // namespace ue2
 
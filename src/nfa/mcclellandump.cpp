@@ -433,6 +433,7 @@ void nfaExecMcClellan8_dumpText(const NFA *nfa, FILE *f) {
     dumpCommonHeader(f, m);
     fprintf(f, "accel_limit: %hu, accept_limit %hu\n", m->accel_limit_8,
             m->accept_limit_8);
+    fprintf(f, "stride 2 table: %s\n", m->stride2_offset ? "yes" : "no");
     fprintf(f, "\n");
 
     describeAlphabet(f, m);
@@ -370,7 +370,7 @@ void fillInAux(mstate_aux *aux, dstate_id_t i, const dfa_info &info,
 /* returns false on error */
 static
 bool allocateImplId16(dfa_info &info, dstate_id_t sheng_end,
-                      dstate_id_t *sherman_base) {
+                      dstate_id_t *sherman_base, const Grey &grey) {
     info.states[0].impl_id = 0; /* dead is always 0 */
 
     vector<dstate_id_t> norm;
@@ -402,6 +402,12 @@ bool allocateImplId16(dfa_info &info, dstate_id_t sheng_end,
         }
     }
 
+    const auto rank = state_order_ranks(info.raw, grey);
+    order_by_depth(norm_sheng_succ, rank);
+    order_by_depth(norm, rank);
+    order_by_depth(sherm_sheng_succ, rank);
+    order_by_depth(sherm, rank);
+
     dstate_id_t next_norm = sheng_end;
     for (dstate_id_t s : norm_sheng_succ) {
         info.states[s].impl_id = next_norm++;
@@ -1032,7 +1038,7 @@ bytecode_ptr<NFA> mcshengCompile16(dfa_info &info, dstate_id_t sheng_end,
     }
 
     u16 sherman_limit;
-    if (!allocateImplId16(info, sheng_end, &sherman_limit)) {
+    if (!allocateImplId16(info, sheng_end, &sherman_limit, grey)) {
         DEBUG_PRINTF("failed to allocate state numbers, %zu states total\n",
                      info.size());
         return nullptr;
@@ -1186,7 +1192,7 @@ bytecode_ptr<NFA> mcsheng64Compile16(dfa_info&info, dstate_id_t sheng_end,
     }
 
     u16 sherman_limit;
-    if (!allocateImplId16(info, sheng_end, &sherman_limit)) {
+    if (!allocateImplId16(info, sheng_end, &sherman_limit, grey)) {
         DEBUG_PRINTF("failed to allocate state numbers, %zu states total\n",
                      info.size());
         return nullptr;
@@ -1265,7 +1271,7 @@ void fill_in_succ_table_64_8(NFA *nfa, const dfa_info &info,
 static
 void allocateImplId8(dfa_info &info, dstate_id_t sheng_end,
                      const map<dstate_id_t, AccelScheme> &accel_escape_info,
-                     u16 *accel_limit, u16 *accept_limit) {
+                     u16 *accel_limit, u16 *accept_limit, const Grey &grey) {
     info.states[0].impl_id = 0; /* dead is always 0 */
 
     vector<dstate_id_t> norm;
@@ -1286,6 +1292,11 @@ void allocateImplId8(dfa_info &info, dstate_id_t sheng_end,
         }
     }
 
+    const auto rank = state_order_ranks(info.raw, grey);
+    order_by_depth(norm, rank);
+    order_by_depth(accel, rank);
+    order_by_depth(accept, rank);
+
     u32 j = sheng_end;
     for (const dstate_id_t &s : norm) {
         assert(j <= 256);
@@ -1308,7 +1319,8 @@ void allocateImplId8(dfa_info &info, dstate_id_t sheng_end,
 
 static
 bytecode_ptr<NFA> mcshengCompile8(dfa_info &info, dstate_id_t sheng_end,
-                       const map<dstate_id_t, AccelScheme> &accel_escape_info) {
+                       const map<dstate_id_t, AccelScheme> &accel_escape_info,
+                       const Grey &grey) {
     DEBUG_PRINTF("building mcsheng 8\n");
 
     vector<u32> reports;
@@ -1342,7 +1354,7 @@ bytecode_ptr<NFA> mcshengCompile8(dfa_info &info, dstate_id_t sheng_end,
     mcsheng *m = (mcsheng *)getMutableImplNfa(nfa.get());
 
     allocateImplId8(info, sheng_end, accel_escape_info, &m->accel_limit_8,
-                    &m->accept_limit_8);
+                    &m->accept_limit_8, grey);
 
     populateBasicInfo(sizeof(u8), info, total_size, aux_offset, accel_offset,
                       accel_escape_info.size(), arb, single, nfa.get());
@@ -1361,7 +1373,8 @@ bytecode_ptr<NFA> mcshengCompile8(dfa_info &info, dstate_id_t sheng_end,
 
 static
 bytecode_ptr<NFA> mcsheng64Compile8(dfa_info &info, dstate_id_t sheng_end,
-                      const map<dstate_id_t, AccelScheme> &accel_escape_info) {
+                      const map<dstate_id_t, AccelScheme> &accel_escape_info,
+                      const Grey &grey) {
     DEBUG_PRINTF("building mcsheng 64-8\n");
 
     vector<u32> reports;
@@ -1395,7 +1408,7 @@ bytecode_ptr<NFA> mcsheng64Compile8(dfa_info &info, dstate_id_t sheng_end,
     mcsheng64 *m = (mcsheng64 *)getMutableImplNfa(nfa.get());
 
     allocateImplId8(info, sheng_end, accel_escape_info, &m->accel_limit_8,
-                    &m->accept_limit_8);
+                    &m->accept_limit_8, grey);
 
     populateBasicInfo64(sizeof(u8), info, total_size, aux_offset, accel_offset,
                         accel_escape_info.size(), arb, single, nfa.get());
@@ -1443,7 +1456,7 @@ bytecode_ptr<NFA> mcshengCompile(raw_dfa &raw, const CompileContext &cc,
     if (!using8bit) {
         nfa = mcshengCompile16(info, sheng_end, accel_escape_info, cc.grey);
     } else {
-        nfa = mcshengCompile8(info, sheng_end, accel_escape_info);
+        nfa = mcshengCompile8(info, sheng_end, accel_escape_info, cc.grey);
     }
 
     if (!nfa) {
@@ -1501,7 +1514,7 @@ bytecode_ptr<NFA> mcshengCompile64(raw_dfa &raw, const CompileContext &cc,
             nfa = mcsheng64Compile16(info, sheng_end64, accel_escape_info, cc.grey);
         } else {
             assert(using8bit);
-            nfa = mcsheng64Compile8(info, sheng_end64, accel_escape_info);
+            nfa = mcsheng64Compile8(info, sheng_end64, accel_escape_info, cc.grey);
             assert(nfa);
             assert(nfa->type == MCSHENG_64_NFA_8);
         }
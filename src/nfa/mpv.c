@@ -261,13 +261,13 @@ size_t limitByReach(const struct mpv_kilopuff *kp, const u8 *buf,
     } else if (kp->type == MPV_NVERM) {
         return nvermicelliExec(kp->u.verm.c, 0, buf, buf + length) - buf;
     }
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
     else if (kp->type == MPV_VERM16) {
         return vermicelli16Exec(kp->u.verm16.mask, buf, buf + length) - buf;
     } else if (kp->type == MPV_NVERM16) {
         return nvermicelli16Exec(kp->u.verm16.mask, buf, buf + length) - buf;
     }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
 
     assert(kp->type == MPV_DOT);
     return length;
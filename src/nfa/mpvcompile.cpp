@@ -177,14 +177,14 @@ void writeKiloPuff(const map<ClusterKey, vector<raw_puff>>::const_iterator &it,
         size_t set = reach.find_first();
         assert(set != CharReach::npos);
         kp->u.verm.c = (char)set;
-#ifdef HAVE_SVE2
-    } else if (reach.count() >= 240) {
+#ifdef HAVE_VERM16
+    } else if (reach.count() >= 256 - VERM16_MAX_CHARS) {
         kp->type = MPV_VERM16;
         vermicelli16Build(~reach, (u8 *)&kp->u.verm16.mask);
-    } else if (reach.count() <= 16) {
+    } else if (reach.count() <= VERM16_MAX_CHARS) {
         kp->type = MPV_NVERM16;
         vermicelli16Build(reach, (u8 *)&kp->u.verm16.mask);
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
     } else if (shuftiBuildMasks(~reach, (u8 *)&kp->u.shuf.mask_lo,
                                 (u8 *)&kp->u.shuf.mask_hi) != -1) {
         kp->type = MPV_SHUFTI;
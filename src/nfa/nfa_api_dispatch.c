@@ -45,6 +45,7 @@
 #include "mcsheng.h"
 #include "mpv.h"
 #include "sheng.h"
+#include "shenglanes.h"
 #include "tamarama.h"
 
 #define DISPATCH_CASE(dc_ltype, dc_ftype, dc_func_call)                        \
@@ -54,7 +55,7 @@
 
 // general framework calls
 
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
 #define VERM16_CASES(dbnt_func)                                                \
         DISPATCH_CASE(LBR_NFA_VERM16, LbrVerm16, dbnt_func);                   \
         DISPATCH_CASE(LBR_NFA_NVERM16, LbrNVerm16, dbnt_func);
@@ -89,6 +90,7 @@
         DISPATCH_CASE(SHENG_NFA_64, Sheng64, dbnt_func);                       \
         DISPATCH_CASE(MCSHENG_64_NFA_8, McSheng64_8, dbnt_func);               \
         DISPATCH_CASE(MCSHENG_64_NFA_16, McSheng64_16, dbnt_func);             \
+        DISPATCH_CASE(SHENG_LANES_NFA, ShengLanes, dbnt_func);                 \
         VERM16_CASES(dbnt_func)                                                \
     default:                                                                   \
         assert(0);                                                             \
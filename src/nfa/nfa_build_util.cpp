@@ -341,7 +341,7 @@ const nfa_dispatch_fn NFATraits<LBR_NFA_NVERM>::has_repeats_other_than_firsts =
 const char *NFATraits<LBR_NFA_NVERM>::name = "Lim Bounded Repeat (NV)";
 #endif
 
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
 
 template<> struct NFATraits<LBR_NFA_VERM16> {
     UNUSED static const char *name;
@@ -375,7 +375,7 @@ const nfa_dispatch_fn NFATraits<LBR_NFA_NVERM16>::has_repeats_other_than_firsts
 const char *NFATraits<LBR_NFA_NVERM16>::name = "Lim Bounded Repeat (NV16)";
 #endif
 
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
 
 template<> struct NFATraits<LBR_NFA_SHUF> {
     UNUSED static const char *name;
@@ -526,6 +526,21 @@ const nfa_dispatch_fn NFATraits<MCSHENG_64_NFA_16>::has_repeats_other_than_first
 #if defined(DUMP_SUPPORT)
 const char *NFATraits<MCSHENG_64_NFA_16>::name = "Shengy64 McShengFace 16";
 #endif
+
+template<> struct NFATraits<SHENG_LANES_NFA> {
+    UNUSED static const char *name;
+    static const NFACategory category = NFA_OTHER;
+    static const u32 stateAlign = 1;
+    static const nfa_dispatch_fn has_accel;
+    static const nfa_dispatch_fn has_repeats;
+    static const nfa_dispatch_fn has_repeats_other_than_firsts;
+};
+const nfa_dispatch_fn NFATraits<SHENG_LANES_NFA>::has_accel = dispatch_false;
+const nfa_dispatch_fn NFATraits<SHENG_LANES_NFA>::has_repeats = dispatch_false;
+const nfa_dispatch_fn NFATraits<SHENG_LANES_NFA>::has_repeats_other_than_firsts = dispatch_false;
+#if defined(DUMP_SUPPORT)
+const char *NFATraits<SHENG_LANES_NFA>::name = "Sheng Lanes";
+#endif
 } // namespace
 
 #if defined(DUMP_SUPPORT)
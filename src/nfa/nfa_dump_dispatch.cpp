@@ -42,6 +42,7 @@
 #include "mcsheng_dump.h"
 #include "mpv_dump.h"
 #include "shengdump.h"
+#include "shenglanes_dump.h"
 #include "tamarama_dump.h"
 
 #ifndef DUMP_SUPPORT
@@ -85,6 +86,7 @@ namespace ue2 {
         DISPATCH_CASE(SHENG_NFA_64, Sheng64, dbnt_func);                       \
         DISPATCH_CASE(MCSHENG_64_NFA_8, McSheng64_8, dbnt_func);               \
         DISPATCH_CASE(MCSHENG_64_NFA_16, McSheng64_16, dbnt_func);             \
+        DISPATCH_CASE(SHENG_LANES_NFA, ShengLanes, dbnt_func);                 \
     default:                                                                   \
         assert(0);                                                             \
     }
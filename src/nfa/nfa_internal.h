@@ -39,6 +39,7 @@ extern "C"
 #endif
 
 #include "ue2common.h"
+#include "util/arch.h"
 
 // Constants
 
@@ -66,10 +67,10 @@ enum NFAEngineType {
     LBR_NFA_DOT,        /**< magic pseudo nfa */
     LBR_NFA_VERM,       /**< magic pseudo nfa */
     LBR_NFA_NVERM,      /**< magic pseudo nfa */
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
     LBR_NFA_VERM16,     /**< magic pseudo nfa */
     LBR_NFA_NVERM16,    /**< magic pseudo nfa */
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
     LBR_NFA_SHUF,       /**< magic pseudo nfa */
     LBR_NFA_TRUF,       /**< magic pseudo nfa */
     CASTLE_NFA,         /**< magic pseudo nfa */
@@ -81,6 +82,7 @@ enum NFAEngineType {
     SHENG_NFA_64,       /**< magic pseudo nfa */
     MCSHENG_64_NFA_8,   /**< magic pseudo nfa */
     MCSHENG_64_NFA_16,  /**< magic pseudo nfa */
+    SHENG_LANES_NFA,    /**< magic nfa container */
     /** \brief bogus NFA - not used */
     INVALID_NFA
 };
@@ -223,9 +225,9 @@ static really_inline int isNfaType(u8 t) {
 static really_inline
 int isLbrType(u8 t) {
     return t == LBR_NFA_DOT || t == LBR_NFA_VERM || t == LBR_NFA_NVERM ||
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
            t == LBR_NFA_VERM16 || t == LBR_NFA_NVERM16 ||
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
            t == LBR_NFA_SHUF || t == LBR_NFA_TRUF;
 }
 
@@ -237,7 +239,7 @@ int isContainerType(u8 t) {
 
 static really_inline
 int isMultiTopType(u8 t) {
-    return !isDfaType(t) && !isLbrType(t);
+    return !isDfaType(t) && !isLbrType(t) && t != SHENG_LANES_NFA;
 }
 
 /** Macros used in place of unimplemented NFA API functions for a given
@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Sheng lanes: container engine running several small DFAs in the
+ * lanes of a single vector.
+ *
+ * Every lane is advanced by the same byte shuffle, so the per-byte cost of the
+ * engine is that of a single Sheng regardless of how many DFAs are packed.
+ */
+
+#include "shenglanes.h"
+
+#include "nfa_api.h"
+#include "nfa_api_queue.h"
+#include "nfa_internal.h"
+#include "sheng_internal.h"
+#include "shenglanes_internal.h"
+#include "util/simd_utils.h"
+
+enum MatchMode {
+    CALLBACK_OUTPUT,
+    STOP_AT_MATCH,
+    NO_MATCHES
+};
+
+/** \brief Number of bytes scanned between checks for all lanes being dead. */
+#define SHENG_LANES_DEAD_CHECK_STRIDE 16
+
+static really_inline
+const struct sheng_lanes *get_lanes(const struct NFA *n) {
+    return (const struct sheng_lanes *)getImplNfa(n);
+}
+
+static really_inline
+const struct sstate_aux *get_lane_aux(const struct sheng_lanes *sl, u32 lane,
+                                      u8 id) {
+    assert(lane < sl->n_lanes);
+    u32 offset = sl->aux_offset[lane] - sizeof(struct NFA) +
+                 (id & SHENG_LANES_STATE_MASK) * sizeof(struct sstate_aux);
+    return (const struct sstate_aux *)((const char *)sl + offset);
+}
+
+static really_inline
+const struct report_list *get_lane_rl(const struct sheng_lanes *sl,
+                                      u32 rl_offset) {
+    const struct report_list *rl = (const struct report_list *)
+        ((const char *)sl + rl_offset - sizeof(struct NFA));
+    assert(ISALIGNED(rl));
+    return rl;
+}
+
+static really_inline
+m512 lanesShuffle(m512 masks, m512 state) {
+#if defined(HAVE_SIMD_512_BITS)
+    return pshufb_m512(masks, state);
+#else
+    m512 rv;
+    rv.lo = pshufb_m256(masks.lo, state.lo);
+    rv.hi = pshufb_m256(masks.hi, state.hi);
+    return rv;
+#endif
+}
+
+/** \brief Broadcast each lane's state byte across the lane. Unused lanes are
+ * held in the dead state. */
+static really_inline
+m512 loadLanes(const struct sheng_lanes *sl, const u8 *lane_states) {
+    ALIGN_CL_DIRECTIVE u8 buf[sizeof(m512)];
+    memset(buf, SHENG_LANES_STATE_DEAD, sizeof(buf));
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        memset(buf + i * sizeof(m128), lane_states[i], sizeof(m128));
+    }
+    return load512(buf);
+}
+
+static really_inline
+void storeLanes(const struct sheng_lanes *sl, m512 state, u8 *lane_states) {
+    ALIGN_CL_DIRECTIVE u8 buf[sizeof(m512)];
+    store512(buf, state);
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        lane_states[i] = buf[i * sizeof(m128)];
+    }
+}
+
+static really_inline
+char allLanesDead(const struct sheng_lanes *sl, const u8 *lane_states) {
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        if (!(lane_states[i] & SHENG_LANES_STATE_DEAD)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static really_inline
+char fireLaneReports(const struct sheng_lanes *sl, NfaCallback cb, void *ctxt,
+                     const u8 *lane_states, u64a loc, char eod) {
+    DEBUG_PRINTF("reporting matches @ %llu\n", loc);
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        const struct sstate_aux *aux = get_lane_aux(sl, i, lane_states[i]);
+        u32 rl_offset = eod ? aux->accept_eod : aux->accept;
+        if (!rl_offset) {
+            continue;
+        }
+        const struct report_list *rl = get_lane_rl(sl, rl_offset);
+        DEBUG_PRINTF("lane %u has %u reports\n", i, rl->count);
+        for (u32 j = 0; j < rl->count; j++) {
+            DEBUG_PRINTF("reporting %u\n", rl->report[j]);
+            if (cb(0, loc, rl->report[j], ctxt) == MO_HALT_MATCHING) {
+                return MO_HALT_MATCHING;
+            }
+        }
+    }
+    return MO_CONTINUE_MATCHING;
+}
+
+/** \brief Scans [start, end), advancing all lanes together.
+ *
+ * In STOP_AT_MATCH mode, returns MO_MATCHES_PENDING with *scan_end pointing at
+ * the byte that took a lane into an accept state. */
+static really_inline
+char scanLanes(const struct sheng_lanes *sl, NfaCallback cb, void *ctxt,
+               u8 *lane_states, u64a base_offset, const u8 *buf,
+               const u8 *start, const u8 *end, enum MatchMode mode,
+               const u8 **scan_end) {
+    const char can_die = sl->flags & SHENG_LANES_FLAG_CAN_DIE;
+    if (can_die && allLanesDead(sl, lane_states)) {
+        DEBUG_PRINTF("dead on arrival\n");
+        *scan_end = end;
+        return MO_CONTINUE_MATCHING;
+    }
+
+    const m512 *masks = sl->succ_masks;
+    const m512 accept = set1_64x8(SHENG_LANES_STATE_ACCEPT);
+    const m512 dead = set1_64x8(SHENG_LANES_STATE_DEAD);
+    m512 state = loadLanes(sl, lane_states);
+
+    const u8 *cur = start;
+    while (likely(cur != end)) {
+        state = lanesShuffle(load512(&masks[*cur]), state);
+
+        if (mode != NO_MATCHES && unlikely(isnonzero512(and512(state,
+                                                              accept)))) {
+            storeLanes(sl, state, lane_states);
+            if (mode == STOP_AT_MATCH) {
+                DEBUG_PRINTF("stopping at match @ %lld\n",
+                             (s64a)(cur - start));
+                *scan_end = cur;
+                return MO_MATCHES_PENDING;
+            }
+            u64a match_offset = base_offset + (cur - buf) + 1;
+            if (fireLaneReports(sl, cb, ctxt, lane_states, match_offset, 0) ==
+                MO_HALT_MATCHING) {
+                return MO_HALT_MATCHING;
+            }
+        }
+        cur++;
+
+        if (can_die && !((cur - start) % SHENG_LANES_DEAD_CHECK_STRIDE) &&
+            !isnonzero512(andnot512(state, dead))) {
+            DEBUG_PRINTF("all lanes dead @ %lld\n", (s64a)(cur - start));
+            break;
+        }
+    }
+
+    storeLanes(sl, state, lane_states);
+    *scan_end = end;
+    return MO_CONTINUE_MATCHING;
+}
+
+static really_inline
+void topLanes(const struct sheng_lanes *sl, u8 *lane_states, u64a offset) {
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        if (!offset) {
+            lane_states[i] = sl->anchored[i];
+        } else {
+            lane_states[i] = get_lane_aux(sl, i, lane_states[i])->top;
+        }
+    }
+}
+
+static never_inline
+char runLanes(const struct sheng_lanes *sl, struct mq *q, s64a b_end,
+              enum MatchMode mode) {
+    u8 *lane_states = (u8 *)q->state;
+    const char can_die = sl->flags & SHENG_LANES_FLAG_CAN_DIE;
+
+    if (q->report_current) {
+        DEBUG_PRINTF("reporting current pending matches\n");
+        q->report_current = 0;
+        if (fireLaneReports(sl, q->cb, q->context, lane_states,
+                            q_cur_offset(q), 0) == MO_HALT_MATCHING) {
+            return MO_DEAD;
+        }
+    }
+
+    assert(q_cur_type(q) == MQE_START);
+    s64a start = q_cur_loc(q);
+
+    const u8 *cur_buf;
+    if (start < 0) {
+        DEBUG_PRINTF("negative location, scanning history\n");
+        cur_buf = q->history + q->hlength;
+    } else {
+        cur_buf = q->buffer;
+    }
+
+    if (mode != NO_MATCHES && q_cur_loc(q) > b_end) {
+        DEBUG_PRINTF("current location past buffer end\n");
+        q->items[q->cur].location = b_end;
+        return MO_ALIVE;
+    }
+
+    q->cur++;
+
+    s64a cur_start = start;
+
+    while (1) {
+        s64a end = q_cur_loc(q);
+        if (mode != NO_MATCHES) {
+            end = MIN(end, b_end);
+        }
+        assert(end <= (s64a)q->length);
+        s64a cur_end = end;
+
+        /* we may cross the border between history and current buffer */
+        if (cur_start < 0) {
+            cur_end = MIN(0, cur_end);
+        }
+
+        DEBUG_PRINTF("start: %lld end: %lld\n", cur_start, cur_end);
+
+        if (cur_start != cur_end) {
+            const u8 *scanned = cur_buf;
+            char rv = scanLanes(sl, q->cb, q->context, lane_states, q->offset,
+                                cur_buf, cur_buf + cur_start,
+                                cur_buf + cur_end, mode, &scanned);
+            if (rv == MO_HALT_MATCHING) {
+                return MO_DEAD;
+            }
+            if (rv == MO_MATCHES_PENDING) {
+                assert(q->cur);
+                DEBUG_PRINTF("found a match, setting q location to %zd\n",
+                             scanned - cur_buf + 1);
+                q->cur--;
+                q->items[q->cur].type = MQE_START;
+                q->items[q->cur].location = scanned - cur_buf + 1;
+                return MO_MATCHES_PENDING;
+            }
+            assert(scanned == cur_buf + cur_end);
+            cur_start = cur_end;
+        }
+
+        if (mode != NO_MATCHES && q_cur_loc(q) > b_end) {
+            DEBUG_PRINTF("current location past buffer end\n");
+            q->cur--;
+            q->items[q->cur].type = MQE_START;
+            q->items[q->cur].location = b_end;
+            return MO_ALIVE;
+        }
+
+        /* crossing over into actual buffer */
+        if (cur_start == 0) {
+            cur_buf = q->buffer;
+        }
+
+        /* continue scanning the same buffer */
+        if (end != cur_end) {
+            continue;
+        }
+
+        switch (q_cur_type(q)) {
+        case MQE_END:
+            q->cur++;
+            if (can_die && allLanesDead(sl, lane_states)) {
+                return MO_DEAD;
+            }
+            return MO_ALIVE;
+        case MQE_TOP:
+            topLanes(sl, lane_states, q->offset + cur_start);
+            break;
+        default:
+            assert(!"invalid queue event");
+            break;
+        }
+        q->cur++;
+    }
+}
+
+char nfaExecShengLanes_Q(const struct NFA *n, struct mq *q, s64a end) {
+    return runLanes(get_lanes(n), q, end, CALLBACK_OUTPUT);
+}
+
+char nfaExecShengLanes_Q2(const struct NFA *n, struct mq *q, s64a end) {
+    return runLanes(get_lanes(n), q, end, STOP_AT_MATCH);
+}
+
+char nfaExecShengLanes_QR(const struct NFA *n, struct mq *q, ReportID report) {
+    assert(q_cur_type(q) == MQE_START);
+
+    char rv = runLanes(get_lanes(n), q, 0 /* end */, NO_MATCHES);
+    if (rv && nfaExecShengLanes_inAccept(n, report, q)) {
+        return MO_MATCHES_PENDING;
+    }
+    return rv;
+}
+
+char nfaExecShengLanes_inAccept(const struct NFA *n, ReportID report,
+                                struct mq *q) {
+    assert(n && q);
+
+    const struct sheng_lanes *sl = get_lanes(n);
+    const u8 *lane_states = (const u8 *)q->state;
+
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        const struct sstate_aux *aux = get_lane_aux(sl, i, lane_states[i]);
+        if (!aux->accept) {
+            continue;
+        }
+        const struct report_list *rl = get_lane_rl(sl, aux->accept);
+        for (u32 j = 0; j < rl->count; j++) {
+            if (rl->report[j] == report) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+char nfaExecShengLanes_inAnyAccept(const struct NFA *n, struct mq *q) {
+    assert(n && q);
+
+    const struct sheng_lanes *sl = get_lanes(n);
+    const u8 *lane_states = (const u8 *)q->state;
+
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        if (lane_states[i] & SHENG_LANES_STATE_ACCEPT) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+char nfaExecShengLanes_testEOD(const struct NFA *n, const char *state,
+                               UNUSED const char *streamState, u64a offset,
+                               NfaCallback cb, void *ctxt) {
+    assert(n);
+    return fireLaneReports(get_lanes(n), cb, ctxt, (const u8 *)state, offset,
+                           1);
+}
+
+char nfaExecShengLanes_reportCurrent(const struct NFA *n, struct mq *q) {
+    assert(q_cur_type(q) == MQE_START);
+    fireLaneReports(get_lanes(n), q->cb, q->context, (const u8 *)q->state,
+                    q_cur_offset(q), 0);
+    return 0;
+}
+
+char nfaExecShengLanes_initCompressedState(const struct NFA *n, u64a offset,
+                                           void *state, UNUSED u8 key) {
+    const struct sheng_lanes *sl = get_lanes(n);
+    u8 *lane_states = (u8 *)state;
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        lane_states[i] = offset ? sl->floating[i] : sl->anchored[i];
+    }
+    return !allLanesDead(sl, lane_states);
+}
+
+char nfaExecShengLanes_queueInitState(const struct NFA *n, struct mq *q) {
+    const struct sheng_lanes *sl = get_lanes(n);
+    assert(n->scratchStateSize == sl->n_lanes);
+
+    /* starting in floating state */
+    memcpy(q->state, sl->floating, sl->n_lanes);
+    return 0;
+}
+
+char nfaExecShengLanes_queueCompressState(const struct NFA *n,
+                                          const struct mq *q,
+                                          UNUSED s64a loc) {
+    assert(n->scratchStateSize == n->streamStateSize);
+    memcpy(q->streamState, q->state, n->streamStateSize);
+    return 0;
+}
+
+char nfaExecShengLanes_expandState(const struct NFA *n, void *dest,
+                                   const void *src, UNUSED u64a offset,
+                                   UNUSED u8 key) {
+    assert(n->scratchStateSize == n->streamStateSize);
+    memcpy(dest, src, n->streamStateSize);
+    return 0;
+}
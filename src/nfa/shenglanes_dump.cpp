@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Sheng lanes: container engine running several small DFAs in the
+ * lanes of a single vector, dump code.
+ */
+
+#include "config.h"
+
+#include "shenglanes_dump.h"
+
+#include "nfa_dump_internal.h"
+#include "nfa_internal.h"
+#include "sheng_internal.h"
+#include "shenglanes_internal.h"
+#include "ue2common.h"
+#include "util/dump_util.h"
+
+#include <cstring>
+
+#ifndef DUMP_SUPPORT
+#error No dump support!
+#endif
+
+using namespace std;
+
+namespace ue2 {
+
+static
+void dumpLaneReports(FILE *f, const NFA *nfa, const char *kind, u32 offset) {
+    if (!offset) {
+        return;
+    }
+    const report_list *rl = (const report_list *)((const char *)nfa + offset);
+    fprintf(f, "    %s reports:", kind);
+    for (u32 i = 0; i < rl->count; i++) {
+        fprintf(f, " %u", rl->report[i]);
+    }
+    fprintf(f, "\n");
+}
+
+static
+void dumpLaneMasks(FILE *f, const sheng_lanes *sl, u32 lane) {
+    for (u32 chr = 0; chr < 256; chr++) {
+        u8 buf[sizeof(m512)];
+        memcpy(buf, &sl->succ_masks[chr], sizeof(buf));
+
+        fprintf(f, "    %3u: ", chr);
+        for (u32 s = 0; s < sl->n_states[lane]; s++) {
+            u8 c = buf[lane * sizeof(m128) + s];
+            fprintf(f, "%2u%c", c & SHENG_LANES_STATE_MASK,
+                    (c & SHENG_LANES_STATE_ACCEPT) ? '*' : ' ');
+        }
+        fprintf(f, "\n");
+    }
+}
+
+void nfaExecShengLanes_dump(const NFA *nfa, const string &base) {
+    assert(nfa->type == SHENG_LANES_NFA);
+    const sheng_lanes *sl = (const sheng_lanes *)getImplNfa(nfa);
+
+    StdioFile f(base + ".txt", "w");
+
+    fprintf(f, "Sheng lanes container engine\n");
+    fprintf(f, "\n");
+    fprintf(f, "lanes: %u, engine size: %u, can die: %u\n", sl->n_lanes,
+            sl->length, !!(sl->flags & SHENG_LANES_FLAG_CAN_DIE));
+    fprintf(f, "\n");
+    dumpTextReverse(nfa, f);
+    fprintf(f, "\n");
+
+    for (u32 i = 0; i < sl->n_lanes; i++) {
+        fprintf(f, "lane %u: %u states, anchored start: %u, "
+                   "floating start: %u\n", i, sl->n_states[i],
+                sl->anchored[i] & SHENG_LANES_STATE_MASK,
+                sl->floating[i] & SHENG_LANES_STATE_MASK);
+        const sstate_aux *aux =
+            (const sstate_aux *)((const char *)nfa + sl->aux_offset[i]);
+        for (u32 s = 0; s < sl->n_states[i]; s++) {
+            fprintf(f, "  state %u: top: %u\n", s,
+                    aux[s].top & SHENG_LANES_STATE_MASK);
+            dumpLaneReports(f, nfa, "accept", aux[s].accept);
+            dumpLaneReports(f, nfa, "EOD", aux[s].accept_eod);
+        }
+        fprintf(f, "  transitions:\n");
+        dumpLaneMasks(f, sl, i);
+        fprintf(f, "\n");
+    }
+}
+
+} // namespace ue2
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Sheng lanes: container engine running several small DFAs in the
+ * lanes of a single vector, data structures.
+ */
+
+/* Sheng lanes bytecode layout:
+ * * |-----|
+ * * |     | struct NFA
+ * * |-----|
+ * * |     | struct sheng_lanes
+ * * |     |
+ * * |-----|
+ * * |     | struct sstate_aux[] for lane 0
+ * * |     | ...
+ * * |     | struct sstate_aux[] for lane n - 1
+ * * |-----|
+ * * |     | report lists for all lanes
+ * * |-----|
+ *
+ * Each lane is a Sheng-style DFA of at most 16 states using raw state ids, so
+ * state 0 is always the dead state. Lane i owns bytes [16 * i, 16 * i + 16) of
+ * each successor mask; the current state of a lane is broadcast across its 16
+ * bytes so that one byte shuffle advances every lane at once.
+ */
+
+#ifndef SHENG_LANES_INTERNAL_H
+#define SHENG_LANES_INTERNAL_H
+
+#include "ue2common.h"
+#include "util/simd_types.h"
+
+/** \brief Maximum number of DFAs packed into one engine: four 16-byte lanes
+ * in a 512-bit vector. */
+#define SHENG_LANES_MAX 4
+
+/** \brief Maximum number of states (including the dead state) per lane. */
+#define SHENG_LANES_MAX_STATES 16
+
+#define SHENG_LANES_STATE_ACCEPT 0x10
+#define SHENG_LANES_STATE_DEAD 0x20
+#define SHENG_LANES_STATE_MASK 0xF
+
+#define SHENG_LANES_FLAG_CAN_DIE 0x1
+
+struct sheng_lanes {
+    m512 succ_masks[256];
+    u32 length;
+    u32 aux_offset[SHENG_LANES_MAX]; //!< per-lane sstate_aux arrays
+    u8 n_lanes;
+    u8 flags;
+    u8 n_states[SHENG_LANES_MAX];
+    u8 anchored[SHENG_LANES_MAX];
+    u8 floating[SHENG_LANES_MAX];
+};
+
+#endif // SHENG_LANES_INTERNAL_H
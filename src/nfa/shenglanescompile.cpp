@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Sheng lanes: container engine running several small DFAs in the
+ * lanes of a single vector, compiler code.
+ */
+
+#include "shenglanescompile.h"
+
+#include "grey.h"
+#include "mcclellancompile.h"
+#include "nfa_internal.h"
+#include "rdfa.h"
+#include "sheng_internal.h"
+#include "shenglanes_internal.h"
+#include "util/accel_scheme.h"
+#include "util/compile_context.h"
+#include "util/depth.h"
+#include "util/report_manager.h"
+#include "util/verify_types.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+using namespace std;
+
+namespace ue2 {
+
+bool fitsShengLane(const raw_dfa &rdfa) {
+    return rdfa.states.size() <= SHENG_LANES_MAX_STATES;
+}
+
+/** \brief Largest single-byte escape set for which accelerating the floating
+ * start state is expected to beat running the DFA in a lane. */
+#define SHENG_LANES_ACCEL_MAX_ESCAPES 8
+
+bool shengLaneLosesAccel(raw_dfa &rdfa, const ReportManager &rm,
+                         const Grey &grey) {
+    if (rdfa.start_floating == DEAD_STATE) {
+        return false; /* anchored: the lane dies early instead */
+    }
+
+    mcclellan_build_strat strat(rdfa, rm, true);
+    auto accel = strat.getAccelInfo(grey);
+    auto it = accel.find(rdfa.start_floating);
+    if (it == accel.end()) {
+        return false;
+    }
+
+    // Wide escape sets seldom skip far; multibyte schemes usually do.
+    const AccelScheme &as = it->second;
+    return as.cr.count() <= SHENG_LANES_ACCEL_MAX_ESCAPES
+        || !as.double_byte.empty() || !as.triple_byte.empty()
+        || !as.gap_byte.empty();
+}
+
+static
+u8 laneState(const raw_dfa &rdfa, dstate_id_t id) {
+    assert(id < rdfa.states.size());
+    u8 s = verify_u8(id);
+    if (!rdfa.states[id].reports.empty()) {
+        s |= SHENG_LANES_STATE_ACCEPT;
+    }
+    if (id == DEAD_STATE) {
+        s |= SHENG_LANES_STATE_DEAD;
+    }
+    return s;
+}
+
+static
+bool laneCanDie(const raw_dfa &rdfa) {
+    if (rdfa.start_anchored == DEAD_STATE ||
+        rdfa.start_floating == DEAD_STATE) {
+        return true;
+    }
+    for (dstate_id_t i = 1; i < rdfa.states.size(); i++) {
+        for (u32 chr = 0; chr < 256; chr++) {
+            if (rdfa.states[i].next[rdfa.alpha_remap[chr]] == DEAD_STATE) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static
+bool laneAccepts(const dstate &ds) {
+    return !ds.reports.empty() || !ds.reports_eod.empty();
+}
+
+/**
+ * \brief Returns the shortest and longest number of bytes from a start state
+ * to an accepting state of a lane. The longest is infinite if a cycle lies on
+ * some such path, which is always the case for a floating start.
+ */
+static
+pair<depth, depth> laneWidths(const raw_dfa &rdfa) {
+    const size_t n = rdfa.states.size();
+    assert(n <= SHENG_LANES_MAX_STATES);
+
+    // succ[s] and reach[s] are bitmasks of states one or more steps away.
+    vector<u32> succ(n, 0);
+    for (dstate_id_t s = 1; s < n; s++) {
+        for (u32 chr = 0; chr < 256; chr++) {
+            dstate_id_t t = rdfa.states[s].next[rdfa.alpha_remap[chr]];
+            if (t != DEAD_STATE) {
+                succ[s] |= 1U << t;
+            }
+        }
+    }
+    vector<u32> reach = succ;
+    for (size_t k = 0; k < n; k++) {
+        for (size_t s = 0; s < n; s++) {
+            if (reach[s] & (1U << k)) {
+                reach[s] |= reach[k];
+            }
+        }
+    }
+
+    u32 accepts = 0;
+    u32 live = 0; // reachable from a start
+    for (dstate_id_t s = 0; s < n; s++) {
+        if (laneAccepts(rdfa.states[s])) {
+            accepts |= 1U << s;
+        }
+    }
+    for (dstate_id_t s : {rdfa.start_anchored, rdfa.start_floating}) {
+        if (s != DEAD_STATE) {
+            live |= (1U << s) | reach[s];
+        }
+    }
+
+    // Longest path by relaxation over the live states that lead to an accept;
+    // a cycle among them makes it unbounded.
+    const u32 unseen = ~0U;
+    vector<u32> shortest(n, unseen);
+    vector<u32> longest(n, 0);
+    for (dstate_id_t s : {rdfa.start_anchored, rdfa.start_floating}) {
+        if (s != DEAD_STATE) {
+            shortest[s] = 0;
+        }
+    }
+    bool cyclic = false;
+    for (dstate_id_t s = 1; s < n; s++) {
+        bool useful = (live & (1U << s))
+                      && (((1U << s) | reach[s]) & accepts);
+        if (useful && (reach[s] & (1U << s))) {
+            cyclic = true;
+        }
+    }
+    for (size_t round = 0; round < n; round++) {
+        for (dstate_id_t s = 1; s < n; s++) {
+            if (shortest[s] == unseen) {
+                continue;
+            }
+            for (dstate_id_t t = 1; t < n; t++) {
+                if (!(succ[s] & (1U << t))) {
+                    continue;
+                }
+                shortest[t] = min(shortest[t], shortest[s] + 1);
+                if (!cyclic) {
+                    longest[t] = max(longest[t], longest[s] + 1);
+                }
+            }
+        }
+    }
+
+    depth min_width = depth::infinity();
+    depth max_width(0);
+    for (dstate_id_t s = 1; s < n; s++) {
+        if (!(accepts & (1U << s)) || shortest[s] == unseen) {
+            continue;
+        }
+        min_width = min(min_width, depth(shortest[s]));
+        max_width = max(max_width, depth(longest[s]));
+    }
+    if (cyclic) {
+        max_width = depth::infinity();
+    }
+    if (min_width.is_infinite()) {
+        min_width = depth(0); /* lane never accepts */
+    }
+    return {min_width, max_width};
+}
+
+namespace {
+
+/** \brief Report lists shared between all lanes of the engine. */
+struct lane_report_lists {
+    lane_report_lists(const ReportManager &rm_in) : rm(rm_in) {}
+
+    /** \brief Returns the index of the (possibly remapped) report list. */
+    u32 add(const raw_dfa &rdfa, const flat_set<ReportID> &reports) {
+        flat_set<ReportID> rl;
+        if (has_managed_reports(rdfa.kind)) {
+            for (ReportID id : reports) {
+                rl.insert(rm.getProgramOffset(id));
+            }
+        } else {
+            rl = reports;
+        }
+
+        auto it = rev.find(rl);
+        if (it != rev.end()) {
+            return it->second;
+        }
+        u32 idx = verify_u32(lists.size());
+        lists.emplace_back(rl);
+        rev.emplace(move(rl), idx);
+        return idx;
+    }
+
+    size_t size() const {
+        size_t rv = 0;
+        for (const auto &rl : lists) {
+            rv += sizeof(report_list) + sizeof(ReportID) * rl.size();
+        }
+        return rv;
+    }
+
+    /** \brief Writes the lists at base_offset, returning their offsets. */
+    vector<u32> fill(NFA *n, u32 base_offset) const {
+        vector<u32> offsets;
+        for (const auto &rl : lists) {
+            offsets.emplace_back(base_offset);
+            report_list *p = (report_list *)((char *)n + base_offset);
+            p->count = verify_u32(rl.size());
+            u32 i = 0;
+            for (ReportID report : rl) {
+                p->report[i++] = report;
+            }
+            base_offset += sizeof(report_list) + sizeof(ReportID) * rl.size();
+        }
+        return offsets;
+    }
+
+    vector<flat_set<ReportID>> lists;
+
+private:
+    const ReportManager &rm;
+    map<flat_set<ReportID>, u32> rev;
+};
+
+} // namespace
+
+bytecode_ptr<NFA> shengLanesCompile(const vector<raw_dfa *> &dfas,
+                                    const CompileContext &cc,
+                                    const ReportManager &rm) {
+    if (!cc.grey.allowShengLanes) {
+        DEBUG_PRINTF("Sheng lanes are not allowed!\n");
+        return nullptr;
+    }
+
+    assert(!dfas.empty() && dfas.size() <= SHENG_LANES_MAX);
+    DEBUG_PRINTF("building sheng lanes engine with %zu lanes\n", dfas.size());
+
+    // Gather report lists; index MO_INVALID_IDX means no reports.
+    lane_report_lists rl(rm);
+    vector<vector<u32>> accepts(dfas.size()), accepts_eod(dfas.size());
+    for (size_t i = 0; i < dfas.size(); i++) {
+        raw_dfa &rdfa = *dfas[i];
+        assert(fitsShengLane(rdfa));
+        if (!cc.streaming) {
+            rdfa.stripExtraEodReports();
+        }
+        for (const dstate &ds : rdfa.states) {
+            accepts[i].emplace_back(ds.reports.empty()
+                                        ? MO_INVALID_IDX
+                                        : rl.add(rdfa, ds.reports));
+            accepts_eod[i].emplace_back(ds.reports_eod.empty()
+                                            ? MO_INVALID_IDX
+                                            : rl.add(rdfa, ds.reports_eod));
+        }
+    }
+
+    u32 nfa_size = ROUNDUP_16(sizeof(NFA) + sizeof(sheng_lanes));
+    vector<u32> aux_offsets;
+    u32 offset = nfa_size;
+    for (const raw_dfa *rdfa : dfas) {
+        aux_offsets.emplace_back(offset);
+        offset += sizeof(sstate_aux) * rdfa->states.size();
+    }
+    u32 reports_offset = ROUNDUP_N(offset, alignof(report_list));
+    u32 total_size = ROUNDUP_N(reports_offset + rl.size(), 64);
+
+    DEBUG_PRINTF("NFA: %u, reports: %u, total: %u\n", nfa_size,
+                 reports_offset, total_size);
+
+    auto nfa = make_zeroed_bytecode_ptr<NFA>(total_size);
+    vector<u32> rl_offsets = rl.fill(nfa.get(), reports_offset);
+
+    u32 n_lanes = verify_u32(dfas.size());
+    nfa->type = SHENG_LANES_NFA;
+    nfa->length = total_size;
+    nfa->scratchStateSize = n_lanes;
+    nfa->streamStateSize = n_lanes;
+
+    sheng_lanes *sl = (sheng_lanes *)getMutableImplNfa(nfa.get());
+    sl->length = total_size - sizeof(NFA);
+    sl->n_lanes = verify_u8(n_lanes);
+    sl->flags = SHENG_LANES_FLAG_CAN_DIE;
+
+    // Unused lanes and unused state slots are held in the dead state.
+    memset(sl->succ_masks, SHENG_LANES_STATE_DEAD, sizeof(sl->succ_masks));
+
+    u32 positions = 0;
+    depth min_width = depth::infinity();
+    depth max_width(0);
+    depth max_offset(0);
+    for (u32 i = 0; i < n_lanes; i++) {
+        const raw_dfa &rdfa = *dfas[i];
+        u32 n_states = verify_u32(rdfa.states.size());
+        positions += n_states;
+
+        // The engine can match as early and as late as any of its lanes. A
+        // lane bounds the match offset only if it is anchored.
+        auto widths = laneWidths(rdfa);
+        min_width = min(min_width, widths.first);
+        max_width = max(max_width, widths.second);
+        max_offset = max(max_offset, rdfa.start_floating == DEAD_STATE
+                                         ? widths.second
+                                         : depth::infinity());
+
+        if (rdfa.hasEodReports()) {
+            nfa->flags |= NFA_ACCEPTS_EOD;
+        }
+        if (!laneCanDie(rdfa)) {
+            sl->flags &= ~SHENG_LANES_FLAG_CAN_DIE;
+        }
+
+        sl->aux_offset[i] = aux_offsets[i];
+        sl->n_states[i] = verify_u8(n_states);
+        sl->anchored[i] = laneState(rdfa, rdfa.start_anchored);
+        sl->floating[i] = laneState(rdfa, rdfa.start_floating);
+
+        sstate_aux *aux = (sstate_aux *)((char *)nfa.get() + aux_offsets[i]);
+        for (dstate_id_t s = 0; s < n_states; s++) {
+            const dstate &ds = rdfa.states[s];
+            if (accepts[i][s] != MO_INVALID_IDX) {
+                aux[s].accept = rl_offsets[accepts[i][s]];
+            }
+            if (accepts_eod[i][s] != MO_INVALID_IDX) {
+                aux[s].accept_eod = rl_offsets[accepts_eod[i][s]];
+            }
+            // A top revives a dead lane in its floating start state.
+            aux[s].top = s == DEAD_STATE
+                             ? sl->floating[i]
+                             : laneState(rdfa, ds.next[rdfa.alpha_remap[TOP]]);
+        }
+
+        for (u32 chr = 0; chr < 256; chr++) {
+            u8 *mask = (u8 *)&sl->succ_masks[chr] + i * sizeof(m128);
+            for (dstate_id_t s = 0; s < n_states; s++) {
+                const dstate &ds = rdfa.states[s];
+                mask[s] = laneState(rdfa, ds.next[rdfa.alpha_remap[chr]]);
+            }
+        }
+    }
+
+    nfa->nPositions = positions;
+    nfa->minWidth = verify_u32(min_width);
+    nfa->maxWidth = max_width.is_finite() ? verify_u32(max_width) : 0;
+    nfa->maxOffset = max_offset.is_finite() ? verify_u32(max_offset) : 0;
+    return nfa;
+}
+
+} // namespace ue2
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Sheng lanes: container engine running several small DFAs in the
+ * lanes of a single vector, compiler code.
+ */
+
+#ifndef SHENGLANESCOMPILE_H
+#define SHENGLANESCOMPILE_H
+
+#include "ue2common.h"
+#include "util/bytecode_ptr.h"
+
+#include <vector>
+
+struct NFA;
+
+namespace ue2 {
+
+class ReportManager;
+struct CompileContext;
+struct Grey;
+struct raw_dfa;
+
+/** \brief True if the given DFA is small enough to occupy one lane. */
+bool fitsShengLane(const raw_dfa &rdfa);
+
+/**
+ * \brief True if the given DFA's floating start state can be accelerated well,
+ * i.e. on a narrow set of escape bytes or with a multibyte scheme.
+ *
+ * Lanes are always advanced a byte at a time, so such a DFA is better left in
+ * an engine of its own.
+ */
+bool shengLaneLosesAccel(raw_dfa &rdfa, const ReportManager &rm,
+                         const Grey &grey);
+
+/**
+ * \brief Builds a Sheng lanes engine that runs each of the given DFAs in its
+ * own lane.
+ *
+ * Between one and SHENG_LANES_MAX DFAs may be supplied, each of which must
+ * satisfy \ref fitsShengLane. Returns nullptr if the engine is disabled.
+ */
+bytecode_ptr<NFA> shengLanesCompile(const std::vector<raw_dfa *> &dfas,
+                                    const CompileContext &cc,
+                                    const ReportManager &rm);
+
+} // namespace ue2
+
+#endif // SHENGLANESCOMPILE_H
@@ -97,6 +97,39 @@ const u8 *vermicelliDoubleMaskedExec(char c1, char c2, char m1, char m2, const u
 }
 #endif
 
+#ifdef HAVE_VERM16
+#include "util/simd_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+const u8 *vermicelli16Exec(const m128 mask, const u8 *buf, const u8 *buf_end);
+const u8 *nvermicelli16Exec(const m128 mask, const u8 *buf, const u8 *buf_end);
+const u8 *rvermicelli16Exec(const m128 mask, const u8 *buf, const u8 *buf_end);
+const u8 *rnvermicelli16Exec(const m128 mask, const u8 *buf, const u8 *buf_end);
+const u8 *vermicelliDouble16Exec(const m128 mask, const u64a firsts,
+                                 const u8 *buf, const u8 *buf_end);
+const u8 *vermicelliDoubleMasked16Exec(const m128 mask, char c1, char m1,
+                                       const u8 *buf, const u8 *buf_end);
+#ifdef __cplusplus
+}
+#endif
+#endif // HAVE_VERM16
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* Multi-byte schemes: each returns the first position in [buf, buf_end) at
+ * which one of the count literals starts and fits entirely within the buffer,
+ * or buf_end if there is none. */
+const u8 *vermicelliTripleExec(const u8 *c1, const u8 *c2, const u8 *c3,
+                               u32 count, const u8 *buf, const u8 *buf_end);
+const u8 *vermicelliDoubleGapExec(const u8 *c1, const u8 *c2, u32 count,
+                                  u32 gap, const u8 *buf, const u8 *buf_end);
+#ifdef __cplusplus
+}
 #endif
 
 #endif /* VERMICELLI_HPP */
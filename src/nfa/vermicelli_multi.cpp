@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Vermicelli: triple-byte and gapped-pair acceleration.
+ *
+ * Scans for a small set of literals at once, each literal being either three
+ * consecutive bytes or a pair of bytes a fixed distance apart. These stop far
+ * less often than single or double byte schemes on text-like data.
+ */
+
+#include "vermicelli.hpp"
+#include "accel.h"
+#include "ue2common.h"
+#include "util/arch.h"
+#include "util/bitutils.h"
+#include "util/supervector/supervector.hpp"
+#include "util/match.hpp"
+
+namespace {
+/** \brief Broadcast literal bytes for one scan. */
+template <uint16_t S>
+struct MultiLits {
+    SuperVector<S> c1[ACCEL_MAX_MULTI_LITS];
+    SuperVector<S> c2[ACCEL_MAX_MULTI_LITS];
+    SuperVector<S> c3[ACCEL_MAX_MULTI_LITS];
+    u32 count;
+};
+}
+
+/* Offsets of the second and third bytes of each literal. For gapped pairs the
+ * third byte is unused. */
+template <bool triple>
+static really_inline
+u32 secondOffset(u32 gap) {
+    return triple ? 1 : gap;
+}
+
+template <bool triple>
+static really_inline
+u32 literalSpan(u32 gap) {
+    return triple ? 2 : gap;
+}
+
+template <bool triple>
+static really_inline
+bool matchesAt(const u8 *c1, const u8 *c2, const u8 *c3, u32 count, u32 gap,
+               const u8 *p) {
+    for (u32 i = 0; i < count; i++) {
+        if (p[0] == c1[i] && p[secondOffset<triple>(gap)] == c2[i] &&
+            (!triple || p[2] == c3[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <uint16_t S, bool triple>
+static really_inline
+const u8 *multiBlock(const MultiLits<S> &lits, u32 gap, const u8 *d) {
+    SuperVector<S> data1 = SuperVector<S>::loadu(d);
+    SuperVector<S> data2 = SuperVector<S>::loadu(d + secondOffset<triple>(gap));
+    SuperVector<S> data3;
+    if (triple) {
+        data3 = SuperVector<S>::loadu(d + 2);
+    }
+
+    SuperVector<S> mask = SuperVector<S>::Zeroes();
+    for (u32 i = 0; i < lits.count; i++) {
+        SuperVector<S> m = lits.c1[i].eq(data1) & lits.c2[i].eq(data2);
+        if (triple) {
+            m = m & lits.c3[i].eq(data3);
+        }
+        mask = mask | m;
+    }
+    return first_non_zero_match<S>(d, mask);
+}
+
+template <uint16_t S, bool triple>
+static const u8 *multiExecReal(const u8 *c1, const u8 *c2, const u8 *c3,
+                               u32 count, u32 gap, const u8 *buf,
+                               const u8 *buf_end) {
+    assert(buf < buf_end);
+    assert(count && count <= ACCEL_MAX_MULTI_LITS);
+    const u32 span = literalSpan<triple>(gap);
+
+    // Small ranges.
+    if (buf_end - buf < S + span) {
+        for (; buf + span < buf_end; buf++) {
+            if (matchesAt<triple>(c1, c2, c3, count, gap, buf)) {
+                return buf;
+            }
+        }
+        return buf_end;
+    }
+
+    MultiLits<S> lits;
+    lits.count = count;
+    for (u32 i = 0; i < count; i++) {
+        lits.c1[i] = SuperVector<S>::dup_u8(c1[i]);
+        lits.c2[i] = SuperVector<S>::dup_u8(c2[i]);
+        if (triple) {
+            lits.c3[i] = SuperVector<S>::dup_u8(c3[i]);
+        }
+    }
+
+    const u8 *d = buf;
+    const u8 *rv;
+    for (; d + S + span <= buf_end; d += S) {
+        __builtin_prefetch(d + 64);
+        rv = multiBlock<S, triple>(lits, gap, d);
+        if (rv) return rv;
+    }
+
+    // finish off tail; literals starting before d are already ruled out
+    if (d + span < buf_end) {
+        rv = multiBlock<S, triple>(lits, gap, buf_end - span - S);
+        if (rv) return rv;
+    }
+
+    return buf_end;
+}
+
+extern "C" const u8 *vermicelliTripleExec(const u8 *c1, const u8 *c2,
+                                          const u8 *c3, u32 count,
+                                          const u8 *buf, const u8 *buf_end) {
+    DEBUG_PRINTF("triple verm scan, %u literals over %zu bytes\n", count,
+                 (size_t)(buf_end - buf));
+    return multiExecReal<VECTORSIZE, true>(c1, c2, c3, count, 0, buf, buf_end);
+}
+
+extern "C" const u8 *vermicelliDoubleGapExec(const u8 *c1, const u8 *c2,
+                                             u32 count, u32 gap, const u8 *buf,
+                                             const u8 *buf_end) {
+    DEBUG_PRINTF("gapped double verm scan, %u literals gap %u over %zu "
+                 "bytes\n", count, gap, (size_t)(buf_end - buf));
+    assert(gap >= 2 && gap <= ACCEL_MAX_GAP);
+    return multiExecReal<VECTORSIZE, false>(c1, c2, nullptr, count, gap, buf,
+                                            buf_end);
+}
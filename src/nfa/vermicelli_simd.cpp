@@ -620,3 +620,324 @@ extern "C" const u8 *vermicelliDoubleMaskedExec(char c1, char c2, char m1, char
 
     return vermicelliDoubleMaskedExecReal<VECTORSIZE>(c1, c2, m1, m2, buf, buf_end);
 }
+
+#ifdef HAVE_VERM16
+
+/* verm16 masks are padded with copies of their first entry, so the number of
+ * distinct characters is the length of the prefix before the first repeat.
+ * Each one costs a compare per block, which is why the compiler only builds
+ * verm16 for small sets on targets without a native set match. */
+static really_inline
+u32 vermicelli16Count(const u8 *chars) {
+    u32 count = 1;
+    while (count < 16 && chars[count] != chars[0]) {
+        count++;
+    }
+    return count;
+}
+
+/* Likewise for dverm16 masks, which hold up to eight (first, second) pairs
+ * padded with copies of the first pair. */
+static really_inline
+u32 vermicelliDouble16Count(const u8 *chars) {
+    u32 count = 1;
+    while (count < 8 && (chars[2 * count] != chars[0] ||
+                         chars[2 * count + 1] != chars[1])) {
+        count++;
+    }
+    return count;
+}
+
+template <uint16_t S>
+static really_inline
+SuperVector<S> vermicelli16Mask(SuperVector<S> const data,
+                                SuperVector<S> const *chars, u32 count) {
+    SuperVector<S> mask = chars[0].eq(data);
+    for (u32 i = 1; i < count; i++) {
+        mask = mask | chars[i].eq(data);
+    }
+    return mask;
+}
+
+template <uint16_t S, bool negate>
+static really_inline
+const u8 *vermicelli16Block(SuperVector<S> const data,
+                            SuperVector<S> const *chars, u32 count,
+                            const u8 *buf) {
+    SuperVector<S> mask = vermicelli16Mask(data, chars, count);
+    if (negate) {
+        return first_zero_match_inverted<S>(buf, mask);
+    }
+    return first_non_zero_match<S>(buf, mask);
+}
+
+template <uint16_t S, bool negate>
+static really_inline
+const u8 *rvermicelli16Block(SuperVector<S> const data,
+                             SuperVector<S> const *chars, u32 count,
+                             const u8 *buf) {
+    SuperVector<S> mask = vermicelli16Mask(data, chars, count);
+    if (negate) {
+        return last_zero_match_inverted<S>(buf, mask);
+    }
+    return last_non_zero_match<S>(buf, mask);
+}
+
+template <uint16_t S, bool negate>
+static const u8 *vermicelli16ExecReal(const u8 *mask, const u8 *buf,
+                                      const u8 *buf_end) {
+    assert(buf_end - buf >= S);
+    u32 count = vermicelli16Count(mask);
+    SuperVector<S> chars[16];
+    for (u32 i = 0; i < count; i++) {
+        chars[i] = SuperVector<S>::dup_u8(mask[i]);
+    }
+
+    const u8 *d = buf;
+    const u8 *rv;
+    for (; d + S <= buf_end; d += S) {
+        __builtin_prefetch(d + 64);
+        SuperVector<S> data = SuperVector<S>::loadu(d);
+        rv = vermicelli16Block<S, negate>(data, chars, count, d);
+        if (rv) return rv;
+    }
+
+    // finish off tail; the bytes before d are already known not to match
+    if (d != buf_end) {
+        SuperVector<S> data = SuperVector<S>::loadu(buf_end - S);
+        rv = vermicelli16Block<S, negate>(data, chars, count, buf_end - S);
+        if (rv) return rv;
+    }
+
+    return buf_end;
+}
+
+template <uint16_t S, bool negate>
+static const u8 *rvermicelli16ExecReal(const u8 *mask, const u8 *buf,
+                                       const u8 *buf_end) {
+    assert(buf_end - buf >= S);
+    u32 count = vermicelli16Count(mask);
+    SuperVector<S> chars[16];
+    for (u32 i = 0; i < count; i++) {
+        chars[i] = SuperVector<S>::dup_u8(mask[i]);
+    }
+
+    const u8 *d = buf_end;
+    const u8 *rv;
+    for (; d >= buf + S; d -= S) {
+        __builtin_prefetch(d - 64);
+        SuperVector<S> data = SuperVector<S>::loadu(d - S);
+        rv = rvermicelli16Block<S, negate>(data, chars, count, d - S);
+        if (rv) return rv;
+    }
+
+    // finish off head; the bytes from d onwards are already known not to match
+    if (d != buf) {
+        SuperVector<S> data = SuperVector<S>::loadu(buf);
+        rv = rvermicelli16Block<S, negate>(data, chars, count, buf);
+        if (rv) return rv;
+    }
+
+    return buf - 1;
+}
+
+template <uint16_t S>
+static really_inline
+const u8 *vermicelliDouble16Block(const u8 *d, SuperVector<S> const *firsts,
+                                  SuperVector<S> const *seconds, u32 count) {
+    SuperVector<S> data = SuperVector<S>::loadu(d);
+    SuperVector<S> next = SuperVector<S>::loadu(d + 1);
+    SuperVector<S> mask = firsts[0].eq(data) & seconds[0].eq(next);
+    for (u32 i = 1; i < count; i++) {
+        mask = mask | (firsts[i].eq(data) & seconds[i].eq(next));
+    }
+    return first_non_zero_match<S>(d, mask);
+}
+
+/* Finds the first position starting a pair from the mask, considering only
+ * pairs that lie entirely within [buf, buf_end). Returns NULL if none. */
+template <uint16_t S>
+static const u8 *vermicelliDouble16ExecReal(const u8 *mask, const u8 *buf,
+                                            const u8 *buf_end) {
+    assert(buf_end - buf > S);
+    u32 count = vermicelliDouble16Count(mask);
+    SuperVector<S> firsts[8];
+    SuperVector<S> seconds[8];
+    for (u32 i = 0; i < count; i++) {
+        firsts[i] = SuperVector<S>::dup_u8(mask[2 * i]);
+        seconds[i] = SuperVector<S>::dup_u8(mask[2 * i + 1]);
+    }
+
+    // each block reads one byte past its last pair start
+    const u8 *d = buf;
+    const u8 *rv;
+    for (; d + S < buf_end; d += S) {
+        __builtin_prefetch(d + 64);
+        rv = vermicelliDouble16Block<S>(d, firsts, seconds, count);
+        if (rv) return rv;
+    }
+
+    if (d != buf_end - 1) {
+        rv = vermicelliDouble16Block<S>(buf_end - 1 - S, firsts, seconds,
+                                        count);
+        if (rv) return rv;
+    }
+
+    return nullptr;
+}
+
+static really_inline
+const u8 *vermicelliDouble16Small(const u8 *mask, const u8 *buf,
+                                  const u8 *buf_end) {
+    u32 count = vermicelliDouble16Count(mask);
+    for (; buf + 1 < buf_end; buf++) {
+        for (u32 i = 0; i < count; i++) {
+            if (buf[0] == mask[2 * i] && buf[1] == mask[2 * i + 1]) {
+                return buf;
+            }
+        }
+    }
+    return nullptr;
+}
+
+static really_inline
+bool vermicelli16Contains(const u8 *mask, u32 count, u8 c) {
+    for (u32 i = 0; i < count; i++) {
+        if (mask[i] == c) {
+            return true;
+        }
+    }
+    return false;
+}
+
+extern "C" const u8 *vermicelli16Exec(const m128 mask, const u8 *buf,
+                                      const u8 *buf_end) {
+    DEBUG_PRINTF("verm16 scan over %td bytes\n", buf_end - buf);
+    assert(buf < buf_end);
+    const u8 *chars = (const u8 *)&mask;
+
+    // Small ranges.
+    if (buf_end - buf < VECTORSIZE) {
+        u32 count = vermicelli16Count(chars);
+        for (; buf < buf_end; buf++) {
+            if (vermicelli16Contains(chars, count, *buf)) {
+                break;
+            }
+        }
+        return buf;
+    }
+
+    return vermicelli16ExecReal<VECTORSIZE, false>(chars, buf, buf_end);
+}
+
+extern "C" const u8 *nvermicelli16Exec(const m128 mask, const u8 *buf,
+                                       const u8 *buf_end) {
+    DEBUG_PRINTF("nverm16 scan over %td bytes\n", buf_end - buf);
+    assert(buf < buf_end);
+    const u8 *chars = (const u8 *)&mask;
+
+    // Small ranges.
+    if (buf_end - buf < VECTORSIZE) {
+        u32 count = vermicelli16Count(chars);
+        for (; buf < buf_end; buf++) {
+            if (!vermicelli16Contains(chars, count, *buf)) {
+                break;
+            }
+        }
+        return buf;
+    }
+
+    return vermicelli16ExecReal<VECTORSIZE, true>(chars, buf, buf_end);
+}
+
+extern "C" const u8 *rvermicelli16Exec(const m128 mask, const u8 *buf,
+                                       const u8 *buf_end) {
+    DEBUG_PRINTF("rverm16 scan over %td bytes\n", buf_end - buf);
+    assert(buf < buf_end);
+    const u8 *chars = (const u8 *)&mask;
+
+    // Small ranges.
+    if (buf_end - buf < VECTORSIZE) {
+        u32 count = vermicelli16Count(chars);
+        for (buf_end--; buf_end >= buf; buf_end--) {
+            if (vermicelli16Contains(chars, count, *buf_end)) {
+                break;
+            }
+        }
+        return buf_end;
+    }
+
+    return rvermicelli16ExecReal<VECTORSIZE, false>(chars, buf, buf_end);
+}
+
+extern "C" const u8 *rnvermicelli16Exec(const m128 mask, const u8 *buf,
+                                        const u8 *buf_end) {
+    DEBUG_PRINTF("rnverm16 scan over %td bytes\n", buf_end - buf);
+    assert(buf < buf_end);
+    const u8 *chars = (const u8 *)&mask;
+
+    // Small ranges.
+    if (buf_end - buf < VECTORSIZE) {
+        u32 count = vermicelli16Count(chars);
+        for (buf_end--; buf_end >= buf; buf_end--) {
+            if (!vermicelli16Contains(chars, count, *buf_end)) {
+                break;
+            }
+        }
+        return buf_end;
+    }
+
+    return rvermicelli16ExecReal<VECTORSIZE, true>(chars, buf, buf_end);
+}
+
+extern "C" const u8 *vermicelliDouble16Exec(const m128 mask, const u64a firsts,
+                                            const u8 *buf, const u8 *buf_end) {
+    DEBUG_PRINTF("double verm16 scan over %td bytes\n", buf_end - buf);
+    assert(buf < buf_end);
+    const u8 *chars = (const u8 *)&mask;
+
+    const u8 *rv;
+    if (buf_end - buf > VECTORSIZE) {
+        rv = vermicelliDouble16ExecReal<VECTORSIZE>(chars, buf, buf_end);
+    } else {
+        rv = vermicelliDouble16Small(chars, buf, buf_end);
+    }
+    if (rv) {
+        return rv;
+    }
+
+    /* check for partial match at end */
+    const u8 *first_chars = (const u8 *)&firsts;
+    if (vermicelli16Contains(first_chars, 8, buf_end[-1])) {
+        DEBUG_PRINTF("partial!!!\n");
+        return buf_end - 1;
+    }
+    return buf_end;
+}
+
+extern "C" const u8 *vermicelliDoubleMasked16Exec(const m128 mask, char c1,
+                                                  char m1, const u8 *buf,
+                                                  const u8 *buf_end) {
+    DEBUG_PRINTF("double verm16 masked scan over %td bytes\n", buf_end - buf);
+    assert(buf < buf_end);
+    const u8 *chars = (const u8 *)&mask;
+
+    const u8 *rv;
+    if (buf_end - buf > VECTORSIZE) {
+        rv = vermicelliDouble16ExecReal<VECTORSIZE>(chars, buf, buf_end);
+    } else {
+        rv = vermicelliDouble16Small(chars, buf, buf_end);
+    }
+    if (rv) {
+        return rv;
+    }
+
+    /* check for partial match at end */
+    if ((buf_end[-1] & m1) == (u8)c1) {
+        DEBUG_PRINTF("partial!!!\n");
+        return buf_end - 1;
+    }
+    return buf_end;
+}
+
+#endif // HAVE_VERM16
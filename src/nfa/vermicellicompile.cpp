@@ -245,8 +245,8 @@ bool getDoubleMatchesForMask(char c1, char c2, char m1, char m2,
 }
 
 bool vermicelliDoubleMasked16Build(char c1, char c2, char m1, char m2, u8 *rv) {
-    u8 c1_holes = 8 - __builtin_popcount(m1);
-    u8 c2_holes = 8 - __builtin_popcount(m2);
+    u8 c1_holes = 8 - __builtin_popcount((u8)m1);
+    u8 c2_holes = 8 - __builtin_popcount((u8)m2);
     if (c1_holes + c2_holes > 3) {
         return false;
     }
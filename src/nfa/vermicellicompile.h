@@ -34,6 +34,7 @@
 #define VERM_COMPILE_H
 
 #include "ue2common.h"
+#include "util/arch.h"
 #include "util/charreach.h"
 #include "util/flat_containers.h"
 
@@ -41,6 +42,22 @@
 
 namespace ue2 {
 
+/* Largest sets worth building the verm16 family for on this target. The
+ * builders below accept full masks regardless. */
+#ifdef HAVE_SVE2
+/* SVE2 matches a whole verm16 mask in one instruction. */
+static constexpr u32 VERM16_MAX_CHARS = 16;
+static constexpr u32 DVERM16_MAX_PAIRS = 8;
+static constexpr u32 DVERM16_MASKED_MAX_PAIRS = 8;
+#else
+/* The SuperVector kernels spend a compare per character (two per pair), so
+ * verm16 is only cheaper than shufti/double shufti for small sets. The masked
+ * two-byte form never beats plain masked dverm there. */
+static constexpr u32 VERM16_MAX_CHARS = 3;
+static constexpr u32 DVERM16_MAX_PAIRS = 2;
+static constexpr u32 DVERM16_MASKED_MAX_PAIRS = 0;
+#endif
+
 bool vermicelli16Build(const CharReach &chars, u8 *rv);
 
 bool vermicelliDouble16Build(const flat_set<std::pair<u8, u8>> &twochar,
@@ -48,6 +65,13 @@ bool vermicelliDouble16Build(const flat_set<std::pair<u8, u8>> &twochar,
 
 bool vermicelliDoubleMasked16Build(char c1, char c2, char m1, char m2, u8 *rv);
 
+/** \brief Number of pairs in the masked dverm16 mask for masks m1, m2; each
+ * clear bit doubles it. */
+static really_inline
+u32 vermicelliDoubleMasked16Pairs(u8 m1, u8 m2) {
+    return 1U << (16 - __builtin_popcount(m1) - __builtin_popcount(m2));
+}
+
 } // namespace ue2
 
 #endif // VERM_COMPILE_H
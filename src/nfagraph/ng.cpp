@@ -64,6 +64,7 @@
 #include "ng_width.h"
 #include "ue2common.h"
 #include "compiler/compiler.h"
+#include "compiler/input_transform.h"
 #include "nfa/goughcompile.h"
 #include "rose/rose_build.h"
 #include "smallwrite/smallwrite_build.h"
@@ -330,7 +331,7 @@ bool NG::addGraph(ExpressionInfo &expr, unique_ptr<NGHolder> g_ptr) {
     clearReports(g);
 
     som_type som = expr.som;
-    if (som && isVacuous(g)) {
+    if ((som || expr.som_on_demand) && isVacuous(g)) {
         throw CompileError(expr.index, "Start of match is not "
                            "currently supported for patterns which match an "
                            "empty buffer.");
@@ -361,6 +362,8 @@ bool NG::addGraph(ExpressionInfo &expr, unique_ptr<NGHolder> g_ptr) {
     make_fuzzy(g, e_dist, hamming, cc.grey);
     dumpDotWrapper(g, expr, "02a_post_fuzz", cc.grey);
 
+    applyInputTransform(g, cc.transform);
+
     pruneUseless(g);
     pruneEmptyVertices(g);
 
@@ -381,6 +384,10 @@ bool NG::addGraph(ExpressionInfo &expr, unique_ptr<NGHolder> g_ptr) {
                                        "expression.");
     }
 
+    if (expr.som_on_demand) {
+        makeSomOnDemandNfas(*this, g, expr);
+    }
+
     if (any_of_in(all_reports(g), [&](ReportID id) {
             return rm.getReport(id).minLength;
         })) {
@@ -425,6 +432,7 @@ bool NG::addGraph(ExpressionInfo &expr, unique_ptr<NGHolder> g_ptr) {
     // stop processing.
     if (num_vertices(g) == N_SPECIALS) {
         DEBUG_PRINTF("all vertices claimed by vacuous handling\n");
+        rose->disableExactMatch();
         return true;
     }
 
@@ -435,6 +443,13 @@ bool NG::addGraph(ExpressionInfo &expr, unique_ptr<NGHolder> g_ptr) {
     // Add the pattern to the small write builder.
     smwr->add(g, expr);
 
+    // Offer the pattern to the exact-match table.
+    if (som) {
+        rose->disableExactMatch();
+    } else {
+        rose->addExactMatch(g);
+    }
+
     if (!som) {
         removeSiblingsOfStartDotStar(g);
     }
@@ -575,15 +590,23 @@ bool NG::addHolder(NGHolder &g) {
     return false;
 }
 
-bool NG::addLiteral(const ue2_literal &literal, u32 expr_index,
+bool NG::addLiteral(const ue2_literal &lit_in, u32 expr_index,
                     u32 external_report, bool highlander, som_type som,
                     bool quiet) {
-    assert(!literal.empty());
+    assert(!lit_in.empty());
 
     if (!cc.grey.shortcutLiterals) {
         return false;
     }
 
+    ue2_literal literal = lit_in;
+    if (!applyInputTransform(literal, cc.transform)) {
+        throw CompileError(expr_index, "Pattern can never match.");
+    }
+
+    // These literals are never anchored at both ends.
+    rose->disableExactMatch();
+
     // We can't natively handle arbitrary literals with mixed case sensitivity
     // in Rose -- they require mechanisms like benefits masks, which have
     // length limits etc. Better to let those go through full graph processing.
@@ -145,8 +145,8 @@ bytecode_ptr<NFA> makeLbrNfa(NFAEngineType nfa_type, enum RepeatType rtype,
     return nfa;
 }
 
-#ifdef HAVE_SVE2
-#include "ng_lbr_sve.hpp"
+#ifdef HAVE_VERM16
+#include "ng_lbr_verm16.hpp"
 #endif
 
 static
@@ -275,7 +275,7 @@ bytecode_ptr<NFA> constructLBR(const CharReach &cr, const depth &repeatMin,
         nfa = buildLbrNVerm(cr, repeatMin, repeatMax, minPeriod, is_reset,
                             report);
     }
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
     if (!nfa) {
         nfa = buildLbrVerm16(cr, repeatMin, repeatMax, minPeriod, is_reset,
                              report);
@@ -284,7 +284,7 @@ bytecode_ptr<NFA> constructLBR(const CharReach &cr, const depth &repeatMin,
         nfa = buildLbrNVerm16(cr, repeatMin, repeatMax, minPeriod, is_reset,
                               report);
     }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
     if (!nfa) {
         nfa = buildLbrShuf(cr, repeatMin, repeatMax, minPeriod, is_reset,
                            report);
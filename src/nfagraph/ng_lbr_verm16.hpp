@@ -29,7 +29,7 @@
 
 /**
  * \file
- * \brief Large Bounded Repeat (LBR) engine build code for SVE.
+ * \brief Large Bounded Repeat (LBR) engine build code for verm16.
  */
 
 static
@@ -38,7 +38,7 @@ bytecode_ptr<NFA> buildLbrVerm16(const CharReach &cr, const depth &repeatMin,
                                  bool is_reset, ReportID report) {
     const CharReach escapes(~cr);
 
-    if (escapes.count() > 16) {
+    if (escapes.count() > VERM16_MAX_CHARS) {
         return nullptr;
     }
 
@@ -61,7 +61,7 @@ bytecode_ptr<NFA> buildLbrNVerm16(const CharReach &cr, const depth &repeatMin,
                                   bool is_reset, ReportID report) {
     const CharReach escapes(cr);
 
-    if (escapes.count() > 16) {
+    if (escapes.count() > VERM16_MAX_CHARS) {
         return nullptr;
     }
 
@@ -48,6 +48,8 @@
 #include "util/target_info.h"
 
 #include <algorithm>
+#include <array>
+#include <functional>
 #include <map>
 
 #include <boost/range/adaptor/map.hpp>
@@ -559,6 +561,87 @@ DAccelScheme findBestDoubleAccelScheme(vector<vector<CharReach> > paths,
     return best;
 }
 
+/* Collects the literals (cr0 x cr1 x cr2 for triples, cr0 x cr_gap for gapped
+ * pairs) which begin every escape path. A path which is too short to show its
+ * literal may escape anywhere, so defeats the scheme entirely. */
+static
+bool collectMultiLits(const vector<vector<CharReach>> &paths, u32 len,
+                      const std::function<bool(const vector<CharReach> &)> &add) {
+    for (const auto &path : paths) {
+        bool red_tape = false;
+        for (u32 i = 0; i < len && i < path.size(); i++) {
+            if (path[i].none()) {
+                red_tape = true;
+                break;
+            }
+        }
+        if (red_tape) {
+            continue;
+        }
+        if (path.size() < len || !add(path)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static
+void findMultiByteEscapes(const vector<vector<CharReach>> &paths,
+                          const CharReach &terminating, AccelScheme *rv) {
+    if (terminating.any()) {
+        return;
+    }
+
+    flat_set<array<u8, 3>> triples;
+    bool triples_ok = collectMultiLits(paths, 3,
+        [&](const vector<CharReach> &path) {
+            if (path[0].count() * path[1].count() * path[2].count()
+                > ACCEL_MAX_MULTI_LITS) {
+                return false;
+            }
+            for (auto a = path[0].find_first(); a != CharReach::npos;
+                 a = path[0].find_next(a)) {
+                for (auto b = path[1].find_first(); b != CharReach::npos;
+                     b = path[1].find_next(b)) {
+                    for (auto c = path[2].find_first(); c != CharReach::npos;
+                         c = path[2].find_next(c)) {
+                        triples.insert({{(u8)a, (u8)b, (u8)c}});
+                    }
+                }
+            }
+            return triples.size() <= ACCEL_MAX_MULTI_LITS;
+        });
+    if (triples_ok && !triples.empty()) {
+        DEBUG_PRINTF("%zu triple escapes\n", triples.size());
+        rv->triple_byte = std::move(triples);
+    }
+
+    for (u32 gap = 2; gap <= ACCEL_MAX_GAP; gap++) {
+        flat_set<pair<u8, u8>> gaps;
+        bool gaps_ok = collectMultiLits(paths, gap + 1,
+            [&](const vector<CharReach> &path) {
+                if (path[0].count() * path[gap].count()
+                    > ACCEL_MAX_MULTI_LITS) {
+                    return false;
+                }
+                for (auto a = path[0].find_first(); a != CharReach::npos;
+                     a = path[0].find_next(a)) {
+                    for (auto c = path[gap].find_first(); c != CharReach::npos;
+                         c = path[gap].find_next(c)) {
+                        gaps.emplace((u8)a, (u8)c);
+                    }
+                }
+                return gaps.size() <= ACCEL_MAX_MULTI_LITS;
+            });
+        if (gaps_ok && !gaps.empty()
+            && (rv->gap_byte.empty() || gaps.size() < rv->gap_byte.size())) {
+            DEBUG_PRINTF("%zu gapped escapes at gap %u\n", gaps.size(), gap);
+            rv->gap_byte = std::move(gaps);
+            rv->gap_len = gap;
+        }
+    }
+}
+
 #define MAX_EXPLORE_PATHS 40
 
 AccelScheme findBestAccelScheme(vector<vector<CharReach>> paths,
@@ -572,6 +655,7 @@ AccelScheme findBestAccelScheme(vector<vector<CharReach>> paths,
             rv.double_cr = move(da.double_cr);
             rv.double_offset = da.double_offset;
         }
+        findMultiByteEscapes(paths, terminating, &rv);
     }
 
     improvePaths(paths);
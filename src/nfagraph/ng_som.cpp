@@ -40,6 +40,7 @@
 #include "ng_haig.h"
 #include "ng_limex.h"
 #include "ng_literal_analysis.h"
+#include "ng_mcclellan.h"
 #include "ng_prune.h"
 #include "ng_redundancy.h"
 #include "ng_region.h"
@@ -54,6 +55,7 @@
 #include "ue2common.h"
 #include "compiler/compiler.h"
 #include "nfa/goughcompile.h"
+#include "nfa/mcclellancompile.h"
 #include "nfa/nfa_internal.h" // for MO_INVALID_IDX
 #include "parser/position.h"
 #include "som/som.h"
@@ -1740,8 +1742,40 @@ struct SomRevNfa {
 };
 }
 
+/** \brief Largest number of states for which we prefer a reverse DFA over a
+ * reverse LimEx NFA: such DFAs use an 8-bit state and single table lookup per
+ * byte. */
+static const size_t MAX_SMALL_SOM_REV_DFA_STATES = 256;
+
+/**
+ * \brief Attempt to determinise the reversed graph \a g_rev into a McClellan
+ * DFA. If \a small_only is set, only DFAs with no more than
+ * MAX_SMALL_SOM_REV_DFA_STATES states are accepted.
+ */
 static
-bytecode_ptr<NFA> makeBareSomRevNfa(const NGHolder &g,
+bytecode_ptr<NFA> makeSomRevDfa(const NGHolder &g_rev, const ReportManager &rm,
+                                bool small_only, const CompileContext &cc) {
+    if (!cc.grey.allowSomRevDfa) {
+        return nullptr;
+    }
+
+    assert(g_rev.kind == NFA_REV_PREFIX);
+    auto rdfa = buildMcClellan(g_rev, nullptr, cc.grey);
+    if (!rdfa) {
+        DEBUG_PRINTF("couldn't determinise rev graph\n");
+        return nullptr;
+    }
+    if (small_only && rdfa->states.size() > MAX_SMALL_SOM_REV_DFA_STATES) {
+        DEBUG_PRINTF("rev dfa too large (%zu states)\n", rdfa->states.size());
+        return nullptr;
+    }
+
+    DEBUG_PRINTF("building a rev DFA with %zu states\n", rdfa->states.size());
+    return mcclellanCompile(*rdfa, cc, rm, false);
+}
+
+static
+bytecode_ptr<NFA> makeBareSomRevNfa(const NGHolder &g, const ReportManager &rm,
                                     const CompileContext &cc) {
     // Create a reversed anchored version of this NFA which fires a zero report
     // ID on accept.
@@ -1756,9 +1790,19 @@ bytecode_ptr<NFA> makeBareSomRevNfa(const NGHolder &g,
     reduceGraphEquivalences(g_rev, cc);
     removeRedundancy(g_rev, SOM_NONE);
 
-    DEBUG_PRINTF("building a rev NFA with %zu vertices\n", num_vertices(g_rev));
-
-    auto nfa = constructReversedNFA(g_rev, cc);
+    // Bounded-width patterns usually determinise into a small DFA, which is
+    // cheaper to run backwards over the window than a LimEx NFA. If the NFA
+    // has too many states to build, a larger DFA is still much better than
+    // falling back to SOM-tracking Haig engines.
+    auto nfa = makeSomRevDfa(g_rev, rm, true, cc);
+    if (!nfa) {
+        DEBUG_PRINTF("building a rev NFA with %zu vertices\n",
+                     num_vertices(g_rev));
+        nfa = constructReversedNFA(g_rev, cc);
+    }
+    if (!nfa) {
+        nfa = makeSomRevDfa(g_rev, rm, false, cc);
+    }
     if (!nfa) {
         return nfa;
     }
@@ -1779,7 +1823,7 @@ bytecode_ptr<NFA> makeBareSomRevNfa(const NGHolder &g,
 static
 bool makeSomRevNfa(vector<SomRevNfa> &som_nfas, const NGHolder &g,
                    const ReportID report, const NFAVertex sink,
-                   const CompileContext &cc) {
+                   const ReportManager &rm, const CompileContext &cc) {
     // Clone the graph with ONLY the given report vertices on the given sink.
     NGHolder g2;
     cloneHolder(g2, g);
@@ -1793,7 +1837,7 @@ bool makeSomRevNfa(vector<SomRevNfa> &som_nfas, const NGHolder &g,
 
     renumber_vertices(g2); // for findMinWidth, findMaxWidth.
 
-    auto nfa = makeBareSomRevNfa(g2, cc);
+    auto nfa = makeBareSomRevNfa(g2, rm, cc);
     if (!nfa) {
         DEBUG_PRINTF("couldn't build rev nfa\n");
         return false;
@@ -1827,10 +1871,10 @@ bool doSomRevNfa(NG &ng, NGHolder &g, const CompileContext &cc) {
     vector<SomRevNfa> som_nfas;
 
     for (auto report : reports) {
-        if (!makeSomRevNfa(som_nfas, g, report, g.accept, cc)) {
+        if (!makeSomRevNfa(som_nfas, g, report, g.accept, rm, cc)) {
             return false;
         }
-        if (!makeSomRevNfa(som_nfas, g, report, g.acceptEod, cc)) {
+        if (!makeSomRevNfa(som_nfas, g, report, g.acceptEod, rm, cc)) {
             return false;
         }
     }
@@ -1862,7 +1906,7 @@ u32 doSomRevNfaPrefix(NG &ng, const ExpressionInfo &expr, NGHolder &g,
     assert(maxWidth <= depth(ng.maxSomRevHistoryAvailable));
     assert(all_reports(g).size() == 1);
 
-    auto nfa = makeBareSomRevNfa(g, cc);
+    auto nfa = makeBareSomRevNfa(g, ng.rm, cc);
     if (!nfa) {
         throw CompileError(expr.index, "Pattern is too large.");
     }
@@ -3143,4 +3187,42 @@ sombe_rv doSomWithHaig(NG &ng, NGHolder &g, const ExpressionInfo &expr,
     return rv;
 }
 
+void makeSomOnDemandNfas(NG &ng, const NGHolder &g,
+                         const ExpressionInfo &expr) {
+    const ReportManager &rm = ng.rm;
+
+    // One reverse NFA per report and sink: reports may carry different offset
+    // adjustments, and EOD accepts only apply to matches at the end of data.
+    for (auto report : all_reports(g)) {
+        const Report &ir = rm.getReport(report);
+        for (auto sink : {g.accept, g.acceptEod}) {
+            NGHolder g2;
+            cloneHolder(g2, g);
+            clearProperInEdges(g2, sink == g.accept ? g2.acceptEod
+                                                    : g2.accept);
+            pruneAllOtherReports(g2, report);
+
+            if (in_degree(g2.accept, g2) == 0 &&
+                in_degree(g2.acceptEod, g2) == 1) {
+                DEBUG_PRINTF("no work to do for this sink\n");
+                continue;
+            }
+
+            renumber_vertices(g2); // for findMinWidth, findMaxWidth.
+
+            auto nfa = makeBareSomRevNfa(g2, ng.rm, ng.cc);
+            if (!nfa) {
+                throw CompileError(expr.index, "Pattern is too large.");
+            }
+
+            DEBUG_PRINTF("on-demand SOM nfa for id %u report %u%s, width "
+                         "[%u,%u]\n", expr.report, report,
+                         sink == g.acceptEod ? " (eod)" : "", nfa->minWidth,
+                         nfa->maxWidth);
+            ng.ssm.addOnDemandNfa(expr.report, ir.offsetAdjust,
+                                  sink == g.acceptEod, move(nfa));
+        }
+    }
+}
+
 } // namespace ue2
@@ -76,6 +76,13 @@ sombe_rv doSomWithHaig(NG &ng, NGHolder &h, const ExpressionInfo &expr,
 
 void makeReportsSomPass(ReportManager &rm, NGHolder &g);
 
+/** \brief Build the reverse NFAs used to compute the start of match of the
+ * given expression on demand (HS_FLAG_SOM_ON_DEMAND), and hand them to the
+ * SOM slot manager. The graph is not modified.
+ *
+ * May throw "Pattern too large" if a reverse NFA cannot be built. */
+void makeSomOnDemandNfas(NG &ng, const NGHolder &g, const ExpressionInfo &expr);
+
 } // namespace ue2
 
 #endif // NG_SOM_H
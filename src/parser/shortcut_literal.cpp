@@ -175,6 +175,12 @@ bool shortcutLiteral(NG &ng, const ParsedExpression &pe) {
         return false;
     }
 
+    // On-demand SOM needs the graph to build its reverse NFA.
+    if (expr.som_on_demand) {
+        DEBUG_PRINTF("on-demand som not allowed\n");
+        return false;
+    }
+
     ConstructLiteralVisitor vis;
     try {
         assert(pe.component);
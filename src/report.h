@@ -323,6 +323,7 @@ int roseDeliverReport(u64a offset, ReportID onmatch, s32 offset_adjust,
     DEBUG_PRINTF(">> reporting match @[%llu,%llu] for sig %u ctxt %p <<\n",
                  from_offset, to_offset, onmatch, ci->userContext);
 
+    traceEvent(scratch, TRACE_REPORT, 0, onmatch, to_offset);
     int halt = ci->userCallback(onmatch, from_offset, to_offset, flags,
                                 ci->userContext);
     if (halt) {
@@ -372,6 +373,7 @@ int roseDeliverSomReport(u64a from_offset, u64a to_offset, ReportID onmatch,
     DEBUG_PRINTF(">> reporting match @[%llu,%llu] for sig %u ctxt %p <<\n",
                  from_offset, to_offset, onmatch, ci->userContext);
 
+    traceEvent(scratch, TRACE_REPORT, 0, onmatch, to_offset);
     int halt = ci->userCallback(onmatch, from_offset, to_offset, flags,
                                 ci->userContext);
 
@@ -311,7 +311,9 @@ void runEagerPrefixesBlock(const struct RoseEngine *t,
         pushQueueAt(q, 2, MQE_END, loc);
         nfaQueueInitState(nfa, q);
 
+        traceQueueExec(scratch, q);
         char alive = nfaQueueExecToMatch(q->nfa, q, loc);
+        traceQueueExecEnd(scratch, q, alive);
 
         if (!alive) {
             DEBUG_PRINTF("queue %u dead, squashing\n", qi);
@@ -39,6 +39,7 @@
 #include "nfa/mpv.h"
 #include "som/som_runtime.h"
 #include "util/fatbit.h"
+#include "util/usdt.h"
 #include "report.h"
 
 typedef struct queue_match PQ_T;
@@ -182,7 +183,10 @@ hwlmcb_rv_t runExistingNfaToNextMatch(const struct RoseEngine *t, u32 qi,
 
     assert(q_cur_loc(q) <= loc);
 
+    scratchAddWork(scratch, q->end - q->cur);
+    traceQueueExec(scratch, q);
     char alive = nfaQueueExecToMatch(q->nfa, q, loc);
+    traceQueueExecEnd(scratch, q, alive);
 
     /* exit via gift shop */
     if (alive == MO_MATCHES_PENDING) {
@@ -234,7 +238,10 @@ hwlmcb_rv_t runNewNfaToNextMatch(const struct RoseEngine *t, u32 qi,
     char alive = 1;
 
 restart:
+    scratchAddWork(scratch, q->end - q->cur);
+    traceQueueExec(scratch, q);
     alive = nfaQueueExecToMatch(q->nfa, q, loc);
+    traceQueueExecEnd(scratch, q, alive);
 
     if (alive == MO_MATCHES_PENDING) {
         DEBUG_PRINTF("we have pending matches at %lld\n", q_cur_loc(q));
@@ -492,7 +499,10 @@ char blast_queue(struct hs_scratch *scratch, struct mq *q, u32 qi, s64a to_loc,
     q->report_current = report_current;
     DEBUG_PRINTF("queue %u blasting, %u/%u [%lld/%lld]\n", qi, q->cur, q->end,
                  q_cur_loc(q), to_loc);
+    scratchAddWork(scratch, q->end - q->cur);
+    traceQueueExec(scratch, q);
     char alive = nfaQueueExec(q->nfa, q, to_loc);
+    traceQueueExecEnd(scratch, q, alive);
     q->cb = roseNfaAdaptor;
     assert(!q->report_current);
 
@@ -587,7 +597,10 @@ void streamInitSufPQ(const struct RoseEngine *t, char *state,
         ensureQueueActive(t, qi, qCount, q, scratch);
         ensureEnd(q, qi, length);
 
+        scratchAddWork(scratch, q->end - q->cur);
+        traceQueueExec(scratch, q);
         char alive = nfaQueueExecToMatch(q->nfa, q, length);
+        traceQueueExecEnd(scratch, q, alive);
 
         if (alive == MO_MATCHES_PENDING) {
             DEBUG_PRINTF("we have pending matches at %lld\n", q_cur_loc(q));
@@ -651,7 +664,10 @@ void blockInitSufPQ(const struct RoseEngine *t, char *state,
 
         DEBUG_PRINTF("adding qi=%u to pq\n", qi);
 
+        scratchAddWork(scratch, q->end - q->cur);
+        traceQueueExec(scratch, q);
         char alive = nfaQueueExecToMatch(q->nfa, q, length);
+        traceQueueExecEnd(scratch, q, alive);
 
         if (alive == MO_MATCHES_PENDING) {
             DEBUG_PRINTF("we have pending matches at %lld\n", q_cur_loc(q));
@@ -860,6 +876,9 @@ hwlmcb_rv_t roseCatchUpAll(s64a loc, struct hs_scratch *scratch) {
 
     const struct RoseEngine *t = scratch->core_info.rose;
     char *state = scratch->core_info.state;
+    HS_PROBE2(catchup__all, t, scratch->core_info.buf_offset + loc);
+    traceEvent(scratch, TRACE_CATCHUP, TRACE_CATCHUP_ALL, 0,
+               scratch->core_info.buf_offset + loc);
 
     hwlmcb_rv_t rv = buildSufPQ(t, state, loc, loc, scratch);
     if (rv != HWLM_CONTINUE_MATCHING) {
@@ -886,6 +905,9 @@ hwlmcb_rv_t roseCatchUpSuf(s64a loc, struct hs_scratch *scratch) {
 
     const struct RoseEngine *t = scratch->core_info.rose;
     char *state = scratch->core_info.state;
+    HS_PROBE2(catchup__suf, t, scratch->core_info.buf_offset + loc);
+    traceEvent(scratch, TRACE_CATCHUP, TRACE_CATCHUP_SUF, 0,
+               scratch->core_info.buf_offset + loc);
 
     hwlmcb_rv_t rv = buildSufPQ(t, state, loc, loc, scratch);
     if (rv != HWLM_CONTINUE_MATCHING) {
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Exact-match table: runtime.
+ */
+
+#ifndef EXACT_MATCH_H
+#define EXACT_MATCH_H
+
+#include "rose.h"
+#include "rose_internal.h"
+#include "runtime.h"
+#include "exact_match_hash.h"
+#include "scratch.h"
+#include "util/compare.h"
+
+/**
+ * \brief Match the whole block against the exact-match table, delivering
+ * every report of each literal equal to it.
+ */
+static really_inline
+void roseExactMatchExec(const struct RoseEngine *t,
+                        struct hs_scratch *scratch) {
+    assert(t->exactTableOffset);
+    const struct RoseExactTable *et = getByOffset(t, t->exactTableOffset);
+    const u8 *buf = scratch->core_info.buf;
+    const size_t len = scratch->core_info.len;
+
+    if (len > et->maxLen) {
+        DEBUG_PRINTF("len=%zu longer than any literal\n", len);
+        return;
+    }
+
+    const char *base = (const char *)et;
+    const u32 *seeds = (const u32 *)(base + et->seedOffset);
+    const struct RoseExactSlot *slots =
+        (const struct RoseExactSlot *)(base + et->slotOffset);
+    const struct RoseExactEntry *entries =
+        (const struct RoseExactEntry *)(base + et->entryOffset);
+
+    const u64a h = exactMatchHash(buf, len);
+    const u32 seed = seeds[exactMatchBucket(h, et->bucketCount)];
+    const struct RoseExactSlot *slot =
+        &slots[exactMatchSlot(h, seed, et->slotCount)];
+    DEBUG_PRINTF("slot %u: len=%u, %u entries\n",
+                 (u32)(slot - slots), slot->len, slot->count);
+    if (slot->len != len) {
+        return;
+    }
+
+    const struct RoseExactEntry *e = entries + slot->first;
+    const struct RoseExactEntry *end = e + slot->count;
+    for (; e != end; e++) {
+        const u8 *lit = (const u8 *)base + e->str_offset;
+        if (cmpForward(buf, lit, len, e->nocase)) {
+            continue;
+        }
+        if (roseReportAdaptor(0, len, e->program, scratch)
+            == MO_HALT_MATCHING) {
+            return;
+        }
+    }
+}
+
+#endif // EXACT_MATCH_H
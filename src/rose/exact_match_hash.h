@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Hash functions shared by the exact-match table build and runtime.
+ */
+
+#ifndef EXACT_MATCH_HASH_H
+#define EXACT_MATCH_HASH_H
+
+#include "ue2common.h"
+#include "util/bitutils.h"
+#include "util/partial_store.h"
+#include "util/unaligned.h"
+
+#define EXACT_HASH_MULT1 0x9e3779b97f4a7c15ULL
+#define EXACT_HASH_MULT2 0xff51afd7ed558ccdULL
+
+/**
+ * \brief Hash of a whole buffer for the exact-match table.
+ *
+ * Every byte has its case bit cleared, so that caseless and caseful literals
+ * which differ only in case share a key.
+ */
+static really_inline
+u64a exactMatchHash(const u8 *buf, size_t len) {
+    u64a h = (u64a)len * EXACT_HASH_MULT1;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        u64a v = unaligned_load_u64a(buf + i) & OCTO_CASE_CLEAR;
+        h = (h ^ v) * EXACT_HASH_MULT2;
+        h ^= h >> 31;
+    }
+    if (i < len) {
+        u64a v = partial_load_u64a(buf + i, (u32)(len - i)) & OCTO_CASE_CLEAR;
+        h = (h ^ v) * EXACT_HASH_MULT2;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+/** \brief First-level bucket, which selects the seed for \ref
+ * exactMatchSlot(). */
+static really_inline
+u32 exactMatchBucket(u64a h, u32 bucketCount) {
+    return (u32)(((h >> 32) * bucketCount) >> 32);
+}
+
+/** \brief Slot for a hash, given the seed of its bucket. */
+static really_inline
+u32 exactMatchSlot(u64a h, u32 seed, u32 slotCount) {
+    u64a x = (h ^ ((u64a)seed * EXACT_HASH_MULT1)) * EXACT_HASH_MULT2;
+    x ^= x >> 32;
+    return (u32)(((x & 0xffffffffULL) * slotCount) >> 32);
+}
+
+#endif // EXACT_MATCH_HASH_H
@@ -138,6 +138,8 @@ hwlmcb_rv_t roseHandleChainMatch(const struct RoseEngine *t,
         pushQueueAt(q, 0, MQE_START, 0);
     } else if (isQueueFull(q)) {
         DEBUG_PRINTF("queue %u full -> catching up nfas\n", qi);
+        traceEvent(scratch, TRACE_QUEUE_FULL, 0, qi,
+                   scratch->core_info.buf_offset + loc);
         /* we know it is a chained nfa and the suffixes/outfixes must already
          * be known to be consistent */
         if (ensureMpvQueueFlushed(t, scratch, qi, loc, in_catchup)
@@ -164,7 +166,9 @@ event_enqueued:
         /* we may not run the nfa; need to ensure state is fine  */
         DEBUG_PRINTF("empty run\n");
         pushQueueNoMerge(q, MQE_END, loc);
+        traceQueueExec(scratch, q);
         char alive = nfaQueueExec(q->nfa, q, loc);
+        traceQueueExecEnd(scratch, q, alive);
         if (alive) {
             scratch->tctxt.mpv_inactive = 0;
             q->cur = q->end = 0;
@@ -211,6 +215,7 @@ int roseAnchoredCallback(u64a start, u64a end, u32 id, void *ctx) {
     }
 
     // Note that the "id" we have been handed is the program offset.
+    profileLiteral(scratch, id);
     const u8 flags = ROSE_PROG_FLAG_IN_ANCHORED;
     if (roseRunProgram(t, scratch, id, start, real_end, flags)
                        == HWLM_TERMINATE_MATCHING) {
@@ -491,6 +496,8 @@ hwlmcb_rv_t roseCallback_i(size_t end, u32 id, struct hs_scratch *scratch) {
     DEBUG_PRINTF("last end %llu\n", tctx->lastEndOffset);
 
     DEBUG_PRINTF("STATE groups=0x%016llx\n", tctx->groups);
+    traceEvent(scratch, TRACE_LITERAL, 0, id, real_end);
+    profileLiteral(scratch, id);
 
     if (can_stop_matching(scratch)) {
         DEBUG_PRINTF("received a match when we're already dead!\n");
@@ -45,6 +45,7 @@
 #include "util/exhaust.h"
 #include "util/fatbit.h"
 #include "util/multibit.h"
+#include "util/usdt.h"
 
 /* Callbacks, defined in catchup.c */
 
@@ -89,6 +90,8 @@ void initQueue(struct mq *q, u32 qi, const struct RoseEngine *t,
     DEBUG_PRINTF("qi=%u, offset=%llu, fullState=%u, streamState=%u, "
                  "state=%u\n", qi, q->offset, info->fullStateOffset,
                  info->stateOffset, *(u32 *)q->state);
+    HS_PROBE4(engine__activate, t, qi, q->nfa->type, q->offset);
+    traceEvent(scratch, TRACE_QUEUE_INIT, q->nfa->type, qi, q->offset);
 }
 
 /** \brief Initialize the queue for a leftfix (prefix/infix) engine. */
@@ -125,6 +128,8 @@ void initRoseQueue(const struct RoseEngine *t, u32 qi,
     DEBUG_PRINTF("qi=%u, offset=%llu, fullState=%u, streamState=%u, "
                  "state=%u\n", qi, q->offset, info->fullStateOffset,
                  info->stateOffset, *(u32 *)q->state);
+    HS_PROBE4(engine__activate, t, qi, q->nfa->type, q->offset);
+    traceEvent(scratch, TRACE_QUEUE_INIT, q->nfa->type, qi, q->offset);
 }
 
 /** returns 0 if space for two items (top and end) on the queue */
@@ -313,6 +318,41 @@ hwlmcb_rv_t roseHaltIfExhausted(const struct RoseEngine *t,
     return HWLM_CONTINUE_MATCHING;
 }
 
+/** \brief Switch off any literal groups which can no longer lead to a match
+ * now that exhaustion key \a ekey has been set. */
+static really_inline
+void roseSquashExhaustedGroups(const struct RoseEngine *t,
+                               struct hs_scratch *scratch, u32 ekey) {
+    if (!t->ekeyGroupsOffset) {
+        return;
+    }
+
+    assert(ekey < t->ekeyCount);
+    const rose_group *ekey_groups = getByOffset(t, t->ekeyGroupsOffset);
+    rose_group groups = ekey_groups[ekey] & scratch->tctxt.groups;
+    if (!groups) {
+        return;
+    }
+
+    const u32 *group_lists = getByOffset(t, t->groupEkeyListOffset);
+    const char *evec = scratch->core_info.exhaustionVector;
+    while (groups) {
+        u32 group_id = findAndClearLSB_64(&groups);
+        assert(group_lists[group_id]);
+
+        /* INVALID_EKEY terminated list */
+        const u32 *ekeys = getByOffset(t, group_lists[group_id]);
+        while (*ekeys != INVALID_EKEY && isExhausted(t, evec, *ekeys)) {
+            ++ekeys;
+        }
+        if (*ekeys == INVALID_EKEY) {
+            DEBUG_PRINTF("all ekeys of group %u exhausted, squashing\n",
+                         group_id);
+            scratch->tctxt.groups &= ~(1ULL << group_id);
+        }
+    }
+}
+
 static really_inline
 hwlmcb_rv_t ensureQueueFlushed_i(const struct RoseEngine *t,
                                  struct hs_scratch *scratch, u32 qi, s64a loc,
@@ -331,7 +371,9 @@ hwlmcb_rv_t ensureQueueFlushed_i(const struct RoseEngine *t,
          * We can use the full catchups as it will short circuit as we are
          * already at this location. It also saves waking everybody up */
         pushQueueNoMerge(q, MQE_END, loc);
-        nfaQueueExec(q->nfa, q, loc);
+        traceQueueExec(scratch, q);
+        char alive = nfaQueueExec(q->nfa, q, loc);
+        traceQueueExecEnd(scratch, q, alive);
         q->cur = q->end = 0;
         pushQueueAt(q, 0, MQE_START, loc);
     } else if (!in_catchup) {
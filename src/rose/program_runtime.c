@@ -204,11 +204,15 @@ hwlmcb_rv_t roseTriggerSuffix(const struct RoseEngine *t,
         pushQueueAt(q, 0, MQE_START, 0);
     } else if (isQueueFull(q)) {
         DEBUG_PRINTF("queue %u full -> catching up nfas\n", qi);
+        traceEvent(scratch, TRACE_QUEUE_FULL, 0, qi,
+                   scratch->core_info.buf_offset + loc);
         if (info->eod) {
             /* can catch up suffix independently no pq */
             q->context = NULL;
             pushQueueNoMerge(q, MQE_END, loc);
-            nfaQueueExecRose(q->nfa, q, MO_INVALID_IDX);
+            traceQueueExec(scratch, q);
+            char alive = nfaQueueExecRose(q->nfa, q, MO_INVALID_IDX);
+            traceQueueExecEnd(scratch, q, alive);
             q->cur = q->end = 0;
             pushQueueAt(q, 0, MQE_START, loc);
         } else if (ensureQueueFlushed(t, scratch, qi, loc)
@@ -224,7 +228,9 @@ hwlmcb_rv_t roseTriggerSuffix(const struct RoseEngine *t,
         /* we may not run the nfa; need to ensure state is fine  */
         DEBUG_PRINTF("empty run\n");
         pushQueueNoMerge(q, MQE_END, loc);
+        traceQueueExec(scratch, q);
         char alive = nfaQueueExec(nfa, q, loc);
+        traceQueueExecEnd(scratch, q, alive);
         if (alive) {
             q->cur = q->end = 0;
             pushQueueAt(q, 0, MQE_START, loc);
@@ -341,7 +347,9 @@ char roseTestLeftfix(const struct RoseEngine *t, struct hs_scratch *scratch,
 
         pushQueueNoMerge(q, MQE_END, loc);
 
+        traceQueueExec(scratch, q);
         char rv = nfaQueueExecRose(q->nfa, q, leftfixReport);
+        traceQueueExecEnd(scratch, q, rv);
         if (!rv) { /* nfa is dead */
             DEBUG_PRINTF("leftfix %u died while trying to catch up\n", ri);
             goto nfa_dead;
@@ -449,8 +457,12 @@ void roseTriggerInfix(const struct RoseEngine *t, struct hs_scratch *scratch,
             /* still full - reduceInfixQueue did nothing */
             DEBUG_PRINTF("queue %u full (%u items) -> catching up nfa\n", qi,
                          q->end - q->cur);
+            traceEvent(scratch, TRACE_QUEUE_FULL, 0, qi,
+                       scratch->core_info.buf_offset + loc);
             pushQueueNoMerge(q, MQE_END, loc);
-            nfaQueueExecRose(q->nfa, q, MO_INVALID_IDX);
+            traceQueueExec(scratch, q);
+            char rv = nfaQueueExecRose(q->nfa, q, MO_INVALID_IDX);
+            traceQueueExecEnd(scratch, q, rv);
 
             q->cur = q->end = 0;
             pushQueueAt(q, 0, MQE_START, loc);
@@ -477,6 +489,7 @@ hwlmcb_rv_t roseReport(const struct RoseEngine *t, struct hs_scratch *scratch,
         return HWLM_CONTINUE_MATCHING;
     }
 
+    roseSquashExhaustedGroups(t, scratch, ekey);
     return roseHaltIfExhausted(t, scratch);
 }
 
@@ -496,6 +509,7 @@ hwlmcb_rv_t roseReportComb(const struct RoseEngine *t,
         return HWLM_CONTINUE_MATCHING;
     }
 
+    roseSquashExhaustedGroups(t, scratch, ekey);
     return roseHaltIfExhausted(t, scratch);
 }
 
@@ -543,6 +557,7 @@ hwlmcb_rv_t roseReportSom(const struct RoseEngine *t,
         return HWLM_CONTINUE_MATCHING;
     }
 
+    roseSquashExhaustedGroups(t, scratch, ekey);
     return roseHaltIfExhausted(t, scratch);
 }
 
@@ -568,6 +583,7 @@ hwlmcb_rv_t roseSetExhaust(const struct RoseEngine *t,
     assert(!isExhausted(ci->rose, ci->exhaustionVector, ekey));
 
     markAsMatched(ci->rose, ci->exhaustionVector, ekey);
+    roseSquashExhaustedGroups(t, scratch, ekey);
 
     return roseHaltIfExhausted(t, scratch);
 }
@@ -1809,7 +1825,10 @@ hwlmcb_rv_t roseSuffixesEod(const struct RoseEngine *rose,
 
         /* rose exec is used as we don't want to / can't raise matches in the
          * history buffer. */
-        if (!nfaQueueExecRose(q->nfa, q, MO_INVALID_IDX)) {
+        traceQueueExec(scratch, q);
+        char alive = nfaQueueExecRose(q->nfa, q, MO_INVALID_IDX);
+        traceQueueExecEnd(scratch, q, alive);
+        if (!alive) {
             DEBUG_PRINTF("nfa is dead\n");
             continue;
         }
@@ -2142,6 +2161,13 @@ hwlmcb_rv_t roseRunProgram(const struct RoseEngine *t,
     assert(programOffset >= sizeof(struct RoseEngine));
     assert(programOffset < t->size);
 
+    traceEvent(scratch, TRACE_PROGRAM, prog_flags, programOffset, end);
+    profileProgram(scratch, programOffset);
+    if (unlikely(scratchAddWork(scratch, 1))) {
+        DEBUG_PRINTF("work budget exceeded\n");
+        return HWLM_TERMINATE_MATCHING;
+    }
+
     const char in_anchored = prog_flags & ROSE_PROG_FLAG_IN_ANCHORED;
     const char in_catchup = prog_flags & ROSE_PROG_FLAG_IN_CATCHUP;
     const char from_mpv = prog_flags & ROSE_PROG_FLAG_FROM_MPV;
@@ -2837,16 +2863,14 @@ hwlmcb_rv_t roseRunProgram(const struct RoseEngine *t,
 
                 const u8 *roles = getRoleState(scratch->core_info.state);
 
-                u32 idx = 0;
-                u32 i = mmbit_sparse_iter_begin(roles, t->rolesWithStateCount,
-                                                &idx, it, si_state);
-                if (i == MMB_INVALID) {
+                if (!mmbit_sparse_iter_any(roles, t->rolesWithStateCount, it,
+                                           si_state)) {
                     DEBUG_PRINTF("no states in sparse iter are on\n");
                     assert(ri->fail_jump); // must progress
                     pc += ri->fail_jump;
                     PROGRAM_NEXT_INSTRUCTION_JUMP
                 }
-                DEBUG_PRINTF("state %u (idx=%u) is on\n", i, idx);
+                DEBUG_PRINTF("some state in sparse iter is on\n");
                 fatbit_clear(scratch->handled_roles);
             }
             PROGRAM_NEXT_INSTRUCTION
@@ -3090,6 +3114,13 @@ hwlmcb_rv_t roseRunProgram_l(const struct RoseEngine *t,
     assert(programOffset >= sizeof(struct RoseEngine));
     assert(programOffset < t->size);
 
+    traceEvent(scratch, TRACE_PROGRAM, prog_flags, programOffset, end);
+    profileProgram(scratch, programOffset);
+    if (unlikely(scratchAddWork(scratch, 1))) {
+        DEBUG_PRINTF("work budget exceeded\n");
+        return HWLM_TERMINATE_MATCHING;
+    }
+
     const char in_catchup = prog_flags & ROSE_PROG_FLAG_IN_CATCHUP;
     const char from_mpv = prog_flags & ROSE_PROG_FLAG_FROM_MPV;
 
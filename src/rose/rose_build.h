@@ -105,6 +105,14 @@ public:
      * true on success. */
     virtual bool addAnchoredAcyclic(const NGHolder &graph) = 0;
 
+    /** \brief Offers a whole pattern graph to the exact-match table. Graphs
+     * which are not fully anchored literals disable the table. */
+    virtual void addExactMatch(const NGHolder &graph) = 0;
+
+    /** \brief Disables the exact-match table, for a pattern which is not
+     * offered to it. */
+    virtual void disableExactMatch() = 0;
+
     virtual bool validateMask(const std::vector<CharReach> &mask,
                               const flat_set<ReportID> &reports,
                               bool anchored, bool eod) const = 0;
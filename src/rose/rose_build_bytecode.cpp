@@ -31,10 +31,13 @@
 #include "ue2common.h"
 #include "grey.h"
 #include "hs_compile.h" // for HS_MODE_*
+#include "hs_internal.h" // for HS_MODE_TRANSFORM_RESIZE
+#include "transform.h"
 #include "rose_build_add_internal.h"
 #include "rose_build_anchored.h"
 #include "rose_build_dump.h"
 #include "rose_build_engine_blob.h"
+#include "rose_build_exact.h"
 #include "rose_build_exclusive.h"
 #include "rose_build_groups.h"
 #include "rose_build_infix.h"
@@ -61,6 +64,7 @@
 #include "nfa/nfa_build_util.h"
 #include "nfa/nfa_internal.h"
 #include "nfa/shengcompile.h"
+#include "nfa/shenglanescompile.h"
 #include "nfa/shufticompile.h"
 #include "nfa/tamaramacompile.h"
 #include "nfa/tamarama_internal.h"
@@ -106,6 +110,7 @@
 #include <vector>
 #include <utility>
 
+#include <boost/graph/topological_sort.hpp>
 #include <boost/range/adaptor/map.hpp>
 
 using namespace std;
@@ -352,6 +357,41 @@ u8 pickRuntimeImpl(const RoseBuildImpl &build, const RoseResources &resources,
     return ROSE_RUNTIME_FULL_ROSE;
 }
 
+/**
+ * \brief True if block scans of this engine can be run without scratch, i.e.
+ * by a single literal matcher or DFA pass whose programs only deliver reports.
+ */
+static
+bool isScratchless(const RoseBuildImpl &build, const RoseResources &resources,
+                   const RoseEngine &proto) {
+    if (build.cc.streaming || build.cc.vectored) {
+        return false;
+    }
+
+    if (proto.runtimeImpl != ROSE_RUNTIME_PURE_LITERAL &&
+        proto.runtimeImpl != ROSE_RUNTIME_SINGLE_OUTFIX) {
+        return false;
+    }
+
+    if (resources.has_scratch_instr || resources.has_lit_delay ||
+        resources.has_lit_check || resources.has_anchored) {
+        DEBUG_PRINTF("programs need scratch\n");
+        return false;
+    }
+
+    if (proto.hasSom || proto.ckeyCount) {
+        return false;
+    }
+
+    if (proto.boundary.reportEodOffset || proto.boundary.reportZeroOffset ||
+        proto.boundary.reportZeroEodOffset) {
+        DEBUG_PRINTF("has boundary reports\n");
+        return false;
+    }
+
+    return proto.ekeyCount <= ROSE_SCRATCHLESS_MAX_EKEYS;
+}
+
 /**
  * \brief True if this Rose engine needs to run MPV catch up in front of
  * non-MPV reports.
@@ -404,6 +444,11 @@ void fillStateOffsets(const RoseBuildImpl &build, u32 rolesWithStateCount,
     curr_offset += longLitStreamStateRequired;
     so->longLitState_size = longLitStreamStateRequired;
 
+    so->transform = curr_offset;
+    so->transform_size = (build.cc.transform & HS_MODE_TRANSFORM_RESIZE)
+                             ? TRANSFORM_STATE_SIZE : 0;
+    curr_offset += so->transform_size;
+
     // ONE WHOLE BYTE for each active leftfix with lag.
     so->leftfixLagTable = curr_offset;
     curr_offset += laggedRoseCount;
@@ -1663,6 +1708,14 @@ public:
         return nullptr;
     }
 
+    bytecode_ptr<NFA> operator()(LanesProto &lanes) const {
+        vector<raw_dfa *> dfas;
+        for (auto &rdfa : lanes.dfas) {
+            dfas.emplace_back(rdfa.get());
+        }
+        return shengLanesCompile(dfas, build.cc, build.rm);
+    }
+
 private:
     const RoseBuildImpl &build;
 };
@@ -2362,6 +2415,39 @@ void addSomRevNfas(build_context &bc, RoseEngine &proto,
     proto.somRevOffsetOffset = bc.engine_blob.add_range(nfa_offsets);
 }
 
+static
+void addSomOnDemandNfas(build_context &bc, RoseEngine &proto,
+                        const SomSlotManager &ssm) {
+    const auto &nfas = ssm.getOnDemandNfas();
+    if (nfas.empty()) {
+        return;
+    }
+
+    vector<RoseSomOnDemand> table;
+    table.reserve(nfas.size());
+    for (const auto &m : nfas) {
+        assert(m.nfa);
+        RoseSomOnDemand entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.id = m.id;
+        entry.nfaOffset = bc.engine_blob.add(*m.nfa, m.nfa->length);
+        entry.adjust = m.adjust;
+        entry.eod = m.eod ? 1 : 0;
+        DEBUG_PRINTF("wrote on-demand SOM NFA for id %u (len %u) to offset "
+                     "%u\n", entry.id, m.nfa->length, entry.nfaOffset);
+        table.emplace_back(entry);
+    }
+
+    // Sorted by id so that the runtime can find a pattern's NFAs quickly.
+    stable_sort(table.begin(), table.end(),
+                [](const RoseSomOnDemand &a, const RoseSomOnDemand &b) {
+                    return a.id < b.id;
+                });
+
+    proto.somOnDemandCount = verify_u32(table.size());
+    proto.somOnDemandOffset = bc.engine_blob.add_range(table);
+}
+
 static
 void recordResources(RoseResources &resources, const RoseBuildImpl &build,
                      const vector<raw_dfa> &anchored_dfas,
@@ -2637,10 +2723,302 @@ bool hasUsefulStops(const left_build_info &build) {
     return false;
 }
 
+/** \brief Returns the greatest offset at which a match ending at the given
+ * offset can trigger this report, or MAX_OFFSET if it is unbounded. */
+static
+u64a reportMaxTriggerOffset(const Report &ir) {
+    if (ir.maxOffset == MAX_OFFSET) {
+        return MAX_OFFSET;
+    }
+    // The report fires at the trigger offset plus its adjustment.
+    if (ir.offsetAdjust < 0) {
+        return ir.maxOffset + (u64a)(-(s64a)ir.offsetAdjust);
+    }
+    return ir.maxOffset;
+}
+
+/**
+ * \brief Finds, for each role, the greatest end offset of a match of its
+ * literal that can still lead to a report: the role's own maximum offset,
+ * tightened by the offset bounds (such as HS_EXT_FLAG_MAX_OFFSET) on
+ * everything it leads to. ROSE_BOUND_INF if unbounded.
+ */
+static
+unordered_map<RoseVertex, u32> findRoleMaxOffsets(const RoseBuildImpl &build) {
+    const RoseGraph &g = build.g;
+
+    // Reverse topological order: successors before their predecessors.
+    vector<RoseVertex> v_order;
+    v_order.reserve(num_vertices(g));
+    boost::topological_sort(g, back_inserter(v_order));
+
+    unordered_map<RoseVertex, u32> role_max;
+    role_max.reserve(num_vertices(g));
+
+    for (auto v : v_order) {
+        if (build.isAnyStart(v)) {
+            role_max[v] = ROSE_BOUND_INF;
+            continue;
+        }
+
+        bool has_out = false;
+        u64a out_max = 0;
+        for (ReportID id : g[v].reports) {
+            has_out = true;
+            ENSURE_AT_LEAST(&out_max,
+                            reportMaxTriggerOffset(build.rm.getReport(id)));
+        }
+        if (g[v].suffix) {
+            for (ReportID id : all_reports(suffix_id(g[v].suffix))) {
+                has_out = true;
+                ENSURE_AT_LEAST(&out_max,
+                                reportMaxTriggerOffset(build.rm.getReport(id)));
+            }
+        }
+        for (auto w : adjacent_vertices_range(v, g)) {
+            // Successor literals end no earlier than this one.
+            has_out = true;
+            ENSURE_AT_LEAST(&out_max, (u64a)role_max.at(w));
+        }
+
+        u32 max_offset = g[v].max_offset;
+        if (has_out && out_max < max_offset) {
+            max_offset = (u32)out_max;
+        }
+        DEBUG_PRINTF("role %zu: max offset %u (graph %u)\n", g[v].index,
+                     max_offset, g[v].max_offset);
+        role_max[v] = max_offset;
+    }
+
+    return role_max;
+}
+
+/** \brief Returns the greatest end offset of a match of the given literal that
+ * can lead to a report, or ROSE_BOUND_INF if there is no such bound. */
+static
+u32 literalMaxOffset(const RoseBuildImpl &build,
+                     const unordered_map<RoseVertex, u32> &role_max,
+                     u32 lit_id) {
+    const auto &lit = build.literals.at(lit_id);
+    if (lit.table == ROSE_EVENT || lit.table == ROSE_EOD_ANCHORED) {
+        return ROSE_BOUND_INF;
+    }
+
+    // Undelayed literals have no roles of their own; their matches are only
+    // used for the roles of their delayed versions, which end later.
+    const auto &info = build.literal_info.at(lit_id);
+    flat_set<RoseVertex> verts = info.vertices;
+    for (u32 delayed_id : info.delayed_ids) {
+        insert(&verts, build.literal_info.at(delayed_id).vertices);
+    }
+
+    if (verts.empty()) {
+        return ROSE_BOUND_INF;
+    }
+
+    u32 max_offset = 0;
+    for (auto v : verts) {
+        ENSURE_AT_LEAST(&max_offset, role_max.at(v));
+    }
+    return max_offset;
+}
+
+/**
+ * \brief In streaming mode, build the table of literal groups which can be
+ * switched off once the stream passes the maximum offset at which any of their
+ * literals can lead to a report.
+ */
+static
+void writeGroupRetireTable(const RoseBuildImpl &build,
+                           const unordered_map<RoseVertex, u32> &role_max,
+                           build_context &bc, RoseEngine &proto) {
+    if (!build.cc.streaming) {
+        return;
+    }
+
+    vector<u32> group_max(ROSE_GROUPS_MAX, 0);
+    rose_group used = 0;
+    for (u32 lit_id = 0; lit_id < build.literal_info.size(); lit_id++) {
+        rose_group groups = build.literal_info[lit_id].group_mask;
+        if (!groups) {
+            continue;
+        }
+        u32 max_offset = literalMaxOffset(build, role_max, lit_id);
+        used |= groups;
+        while (groups) {
+            u32 group_id = findAndClearLSB_64(&groups);
+            ENSURE_AT_LEAST(&group_max[group_id], max_offset);
+        }
+    }
+
+    // The boundary group is never switched off: EOD and boundary programs
+    // rely on it, and a stream with no groups on is considered exhausted.
+    used &= ~build.boundary_group_mask;
+
+    map<u32, rose_group> retire;
+    for (u32 i = 0; i < ROSE_GROUPS_MAX; i++) {
+        if ((used & (1ULL << i)) && group_max[i] != ROSE_BOUND_INF) {
+            DEBUG_PRINTF("group %u retires at offset %u\n", i, group_max[i]);
+            retire[group_max[i]] |= 1ULL << i;
+        }
+    }
+
+    if (retire.empty()) {
+        return;
+    }
+
+    vector<RoseGroupRetire> table;
+    rose_group groups = 0;
+    for (const auto &m : retire) {
+        groups |= m.second;
+        RoseGroupRetire entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.offset = m.first;
+        entry.groups = groups;
+        table.emplace_back(entry);
+    }
+
+    proto.groupRetireCount = verify_u32(table.size());
+    proto.groupRetireOffset = bc.engine_blob.add_range(table);
+}
+
+/** \brief Limit on the number of exhaustion keys a literal group may depend on
+ * and still be squashed when they are all exhausted. */
+static constexpr size_t MAX_GROUP_EKEYS = 64;
+
+/**
+ * \brief Finds, for each role, the exhaustion keys of all the reports it can
+ * lead to. The set is {INVALID_EKEY} if the role can lead to a report without
+ * an exhaustion key (or do other work), in which case exhaustion can never
+ * make it redundant.
+ */
+static
+unordered_map<RoseVertex, flat_set<u32>>
+findRoleEkeys(const RoseBuildImpl &build) {
+    const RoseGraph &g = build.g;
+    const flat_set<u32> poisoned = {INVALID_EKEY};
+
+    // Reverse topological order: successors before their predecessors.
+    vector<RoseVertex> v_order;
+    v_order.reserve(num_vertices(g));
+    boost::topological_sort(g, back_inserter(v_order));
+
+    unordered_map<RoseVertex, flat_set<u32>> role_ekeys;
+    role_ekeys.reserve(num_vertices(g));
+
+    for (auto v : v_order) {
+        if (build.isAnyStart(v)) {
+            role_ekeys[v] = poisoned;
+            continue;
+        }
+
+        set<ReportID> reports(begin(g[v].reports), end(g[v].reports));
+        if (g[v].suffix) {
+            insert(&reports, all_reports(suffix_id(g[v].suffix)));
+        }
+
+        flat_set<u32> ekeys;
+        for (ReportID id : reports) {
+            ekeys.insert(build.rm.getReport(id).ekey);
+        }
+        for (auto w : adjacent_vertices_range(v, g)) {
+            insert(&ekeys, role_ekeys.at(w));
+        }
+
+        if (ekeys.empty() || contains(ekeys, INVALID_EKEY) ||
+            ekeys.size() > MAX_GROUP_EKEYS) {
+            ekeys = poisoned;
+        }
+        role_ekeys[v] = move(ekeys);
+    }
+
+    return role_ekeys;
+}
+
+/**
+ * \brief Build the tables used to squash literal groups at runtime once every
+ * exhaustion key their literals can lead to has been set (for example, when
+ * all of their patterns are HS_FLAG_SINGLEMATCH and have matched).
+ */
+static
+void writeExhaustGroupTables(const RoseBuildImpl &build, build_context &bc,
+                             RoseEngine &proto) {
+    const u32 ekeyCount = build.rm.numEkeys();
+    if (!ekeyCount) {
+        return;
+    }
+
+    const auto role_ekeys = findRoleEkeys(build);
+
+    vector<flat_set<u32>> group_ekeys(ROSE_GROUPS_MAX);
+    // The boundary group is never squashed: EOD and boundary programs rely on
+    // it, and a stream with no groups on is considered exhausted.
+    rose_group poisoned = build.boundary_group_mask;
+    for (u32 lit_id = 0; lit_id < build.literal_info.size(); lit_id++) {
+        const auto &info = build.literal_info[lit_id];
+        if (!info.group_mask) {
+            continue;
+        }
+
+        // As for offset bounds, undelayed literals only serve the roles of
+        // their delayed versions.
+        flat_set<RoseVertex> verts = info.vertices;
+        for (u32 delayed_id : info.delayed_ids) {
+            insert(&verts, build.literal_info.at(delayed_id).vertices);
+        }
+
+        const auto &lit = build.literals.at(lit_id);
+        bool poison = verts.empty() || lit.table == ROSE_EVENT;
+        flat_set<u32> ekeys;
+        for (auto v : verts) {
+            insert(&ekeys, role_ekeys.at(v));
+        }
+        if (poison || contains(ekeys, INVALID_EKEY)) {
+            poisoned |= info.group_mask;
+            continue;
+        }
+
+        rose_group groups = info.group_mask;
+        while (groups) {
+            u32 group_id = findAndClearLSB_64(&groups);
+            insert(&group_ekeys[group_id], ekeys);
+        }
+    }
+
+    vector<rose_group> ekey_groups(ekeyCount, 0);
+    vector<u32> group_lists(ROSE_GROUPS_MAX, 0);
+    bool any = false;
+    for (u32 i = 0; i < ROSE_GROUPS_MAX; i++) {
+        const auto &ekeys = group_ekeys[i];
+        if ((poisoned & (1ULL << i)) || ekeys.empty() ||
+            ekeys.size() > MAX_GROUP_EKEYS) {
+            continue;
+        }
+        DEBUG_PRINTF("group %u dies with %zu ekeys\n", i, ekeys.size());
+        for (u32 ekey : ekeys) {
+            assert(ekey < ekeyCount);
+            ekey_groups[ekey] |= 1ULL << i;
+        }
+        vector<u32> ekey_list(ekeys.begin(), ekeys.end());
+        ekey_list.emplace_back(INVALID_EKEY); /* terminator */
+        group_lists[i] = bc.engine_blob.add_range(ekey_list);
+        any = true;
+    }
+
+    if (!any) {
+        return;
+    }
+
+    proto.ekeyGroupsOffset = bc.engine_blob.add_range(ekey_groups);
+    proto.groupEkeyListOffset = bc.engine_blob.add_range(group_lists);
+}
+
 static
 void buildLeftInfoTable(const RoseBuildImpl &tbi, build_context &bc,
                         const set<u32> &eager_queues, u32 leftfixBeginQueue,
-                        u32 leftfixCount, vector<LeftNfaInfo> &leftTable,
+                        u32 leftfixCount,
+                        const unordered_map<RoseVertex, u32> &role_max,
+                        vector<LeftNfaInfo> &leftTable,
                         u32 *laggedRoseCount, size_t *history) {
     const RoseGraph &g = tbi.g;
     const CompileContext &cc = tbi.cc;
@@ -2718,11 +3096,20 @@ void buildLeftInfoTable(const RoseBuildImpl &tbi, build_context &bc,
         // Update the max delay.
         ENSURE_AT_LEAST(&left.maxLag, lbi.lag);
 
+        // Track the last offset at which a successor role could match.
+        ENSURE_AT_LEAST(&left.maxOffset, role_max.at(v));
+
         if (contains(g[v].literals, tbi.eod_event_literal_id)) {
             left.eod_check = 1;
         }
     }
 
+    for (auto &left : leftTable) {
+        if (left.maxOffset == ROSE_BOUND_INF || left.eod_check) {
+            left.maxOffset = 0; // unbounded
+        }
+    }
+
     DEBUG_PRINTF("built %u roses with lag indices\n", lagIndex);
     *laggedRoseCount = lagIndex;
 }
@@ -3189,6 +3576,13 @@ set<ReportID> findEngineReports(const RoseBuildImpl &build) {
         insert(&reports, all_reports(outfix));
     }
 
+    // As does the exact-match table.
+    if (canBuildExactMatchTable(build)) {
+        for (const auto &el : build.exact_literals) {
+            reports.insert(el.report);
+        }
+    }
+
     const auto &g = build.g;
     for (auto v : vertices_range(g)) {
         if (g[v].suffix) {
@@ -3620,6 +4014,7 @@ bytecode_ptr<RoseEngine> RoseBuildImpl::buildFinalEngine(u32 minWidth) {
     } else {
         proto.mode = HS_MODE_STREAM;
     }
+    proto.transform = cc.transform & HS_MODE_TRANSFORM_RESIZE;
 
     DerivedBoundaryReports dboundary(boundary);
 
@@ -3679,9 +4074,10 @@ bytecode_ptr<RoseEngine> RoseBuildImpl::buildFinalEngine(u32 minWidth) {
 
     u32 laggedRoseCount = 0;
     vector<LeftNfaInfo> leftInfoTable;
+    const auto role_max = findRoleMaxOffsets(*this);
     buildLeftInfoTable(*this, bc, eager_queues, proto.leftfixBeginQueue,
-                       queue_count - proto.leftfixBeginQueue, leftInfoTable,
-                       &laggedRoseCount, &historyRequired);
+                       queue_count - proto.leftfixBeginQueue, role_max,
+                       leftInfoTable, &laggedRoseCount, &historyRequired);
 
     // Information only needed for program construction.
     ProgramBuild prog_build(floatingMinLiteralMatchOffset,
@@ -3723,11 +4119,16 @@ bytecode_ptr<RoseEngine> RoseBuildImpl::buildFinalEngine(u32 minWidth) {
                                 longLitLengthThreshold, &historyRequired,
                                 &longLitStreamStateRequired);
 
+    proto.exactTableOffset = buildExactMatchTable(*this, bc.engine_blob);
+
     proto.lastByteHistoryIterOffset = buildLastByteIter(g, bc);
     proto.eagerIterOffset = writeEagerQueueIter(
         eager_queues, proto.leftfixBeginQueue, queue_count, bc.engine_blob);
 
     addSomRevNfas(bc, proto, ssm);
+    addSomOnDemandNfas(bc, proto, ssm);
+    writeGroupRetireTable(*this, role_max, bc, proto);
+    writeExhaustGroupTables(*this, bc, proto);
 
     writeDkeyInfo(rm, bc.engine_blob, proto);
     writeLeftInfo(bc.engine_blob, proto, leftInfoTable);
@@ -3856,6 +4257,7 @@ bytecode_ptr<RoseEngine> RoseBuildImpl::buildFinalEngine(u32 minWidth) {
     proto.hasOutfixesInSmallBlock = hasNonSmallBlockOutfix(outfixes);
     proto.canExhaust = rm.patternSetCanExhaust();
     proto.hasSom = hasSom;
+    proto.scratchless = isScratchless(*this, bc.resources, proto);
 
     /* populate anchoredDistance, floatingDistance, floatingMinDistance, etc */
     fillMatcherDistances(*this, &proto);
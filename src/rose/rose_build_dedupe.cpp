@@ -28,6 +28,7 @@
 
 #include "rose_build_impl.h"
 #include "nfa/castlecompile.h"
+#include "nfa/mcclellancompile_util.h"
 #include "nfagraph/ng_repeat.h"
 #include "smallwrite/smallwrite_build.h"
 #include "util/compile_context.h"
@@ -79,6 +80,25 @@ bool requiresDedupe(const NGHolder &h, const flat_set<ReportID> &reports,
     return false;
 }
 
+/** \brief Lanes run independently, so two lanes raising the same report can
+ * both fire it at the same offset. */
+static
+bool requiresDedupe(const LanesProto &lanes,
+                    const flat_set<ReportID> &reports) {
+    bool seen = false;
+    for (const auto &rdfa : lanes.dfas) {
+        auto lane_reports = all_reports(*rdfa);
+        if (!has_intersection(lane_reports, reports)) {
+            continue;
+        }
+        if (seen) {
+            return true;
+        }
+        seen = true;
+    }
+    return false;
+}
+
 class RoseDedupeAuxImpl : public RoseDedupeAux {
 public:
     explicit RoseDedupeAuxImpl(const RoseBuildImpl &build_in);
@@ -369,6 +389,10 @@ bool RoseDedupeAuxImpl::requiresDedupeSupport(
             requiresDedupe(*out.holder(), reports, build.cc.grey)) {
             return true;
         }
+
+        if (out.lanes() && requiresDedupe(*out.lanes(), reports)) {
+            return true;
+        }
     }
 
     /* mpv */
@@ -52,6 +52,7 @@
 #include "util/graph_range.h"
 #include "util/multibit.h"
 #include "util/multibit_build.h"
+#include "util/report_manager.h"
 #include "util/ue2string.h"
 
 #include <iomanip>
@@ -1762,6 +1763,9 @@ void dumpNfaNotes(ofstream &fout, const RoseEngine *t, const NFA *n) {
         fout << "prefix";
     }
     fout << " maxlag=" << left->maxLag;
+    if (left->maxOffset) {
+        fout << " maxoffset=" << left->maxOffset;
+    }
     if (left->stopTable) {
         fout << " miracles";
     }
@@ -1851,6 +1855,9 @@ void dumpComponentInfoCsv(const RoseEngine *t, const string &base) {
                 kind = NFA_PREFIX;
             }
             notes << "maxlag=" << left->maxLag << ";";
+            if (left->maxOffset) {
+                notes << "maxoffset=" << left->maxOffset << ";";
+            }
             if (left->stopTable) {
                 notes << "miracles;";
             }
@@ -2113,6 +2120,12 @@ void roseDumpText(const RoseEngine *t, FILE *f) {
     if (t->runtimeImpl == ROSE_RUNTIME_SINGLE_OUTFIX) {
         fprintf(f, " soleOutfix");
     }
+    if (t->exactTableOffset) {
+        fprintf(f, " exactMatch");
+    }
+    if (t->transform) {
+        fprintf(f, " inputTransform");
+    }
     fprintf(f, "\n");
 
     fprintf(f, "dkey count           : %u\n", t->dkeyCount);
@@ -2172,6 +2185,14 @@ void roseDumpText(const RoseEngine *t, FILE *f) {
 
     fprintf(f, "initial groups       : 0x%016llx\n", t->initialGroups);
     fprintf(f, "floating groups      : 0x%016llx\n", t->floating_group_mask);
+    if (t->groupRetireCount) {
+        const auto *retire = (const RoseGroupRetire *)loadFromByteCodeOffset(
+            t, t->groupRetireOffset);
+        for (u32 i = 0; i < t->groupRetireCount; i++) {
+            fprintf(f, "  retired at %-8llu: 0x%016llx\n", retire[i].offset,
+                    retire[i].groups);
+        }
+    }
     fprintf(f, "handled key count    : %u\n", t->handledKeyCount);
     fprintf(f, "\n");
 
@@ -2215,7 +2236,9 @@ void roseDumpStructRaw(const RoseEngine *t, FILE *f) {
     DUMP_U8(t, canExhaust);
     DUMP_U8(t, hasSom);
     DUMP_U8(t, somHorizon);
+    DUMP_U8(t, scratchless);
     DUMP_U32(t, mode);
+    DUMP_U32(t, transform);
     DUMP_U32(t, historyRequired);
     DUMP_U32(t, ekeyCount);
     DUMP_U32(t, lkeyCount);
@@ -2239,6 +2262,7 @@ void roseDumpStructRaw(const RoseEngine *t, FILE *f) {
     DUMP_U32(t, drmatcherOffset);
     DUMP_U32(t, sbmatcherOffset);
     DUMP_U32(t, longLitTableOffset);
+    DUMP_U32(t, exactTableOffset);
     DUMP_U32(t, amatcherMinWidth);
     DUMP_U32(t, fmatcherMinWidth);
     DUMP_U32(t, eodmatcherMinWidth);
@@ -2296,6 +2320,8 @@ void roseDumpStructRaw(const RoseEngine *t, FILE *f) {
     DUMP_U32(t, stateOffsets.groups_size);
     DUMP_U32(t, stateOffsets.longLitState);
     DUMP_U32(t, stateOffsets.longLitState_size);
+    DUMP_U32(t, stateOffsets.transform);
+    DUMP_U32(t, stateOffsets.transform_size);
     DUMP_U32(t, stateOffsets.somLocation);
     DUMP_U32(t, stateOffsets.somValid);
     DUMP_U32(t, stateOffsets.somWritable);
@@ -2316,6 +2342,12 @@ void roseDumpStructRaw(const RoseEngine *t, FILE *f) {
     DUMP_U32(t, ematcherRegionSize);
     DUMP_U32(t, somRevCount);
     DUMP_U32(t, somRevOffsetOffset);
+    DUMP_U32(t, somOnDemandCount);
+    DUMP_U32(t, somOnDemandOffset);
+    DUMP_U32(t, groupRetireCount);
+    DUMP_U32(t, groupRetireOffset);
+    DUMP_U32(t, ekeyGroupsOffset);
+    DUMP_U32(t, groupEkeyListOffset);
     fprintf(f, "}\n");
     fprintf(f, "sizeof(RoseEngine) = %zu\n", sizeof(RoseEngine));
 }
@@ -2363,6 +2395,144 @@ void roseDumpLiteralMatchers(const RoseEngine *t, const string &base) {
     }
 }
 
+/** \brief Adds the pattern ids of the external reports that the given
+ * literal's roles, and any roles reachable from them, may raise. */
+static
+void reachablePatterns(const RoseBuildImpl &build,
+                       const rose_literal_info &lit_info, set<u32> &patterns) {
+    const RoseGraph &g = build.g;
+
+    auto add_report = [&](ReportID id) {
+        const Report &ir = build.rm.getReport(id);
+        if (isExternalReport(ir)) {
+            patterns.insert(ir.onmatch);
+        }
+    };
+
+    vector<RoseVertex> work(lit_info.vertices.begin(),
+                            lit_info.vertices.end());
+    set<RoseVertex> seen(work.begin(), work.end());
+    while (!work.empty()) {
+        RoseVertex v = work.back();
+        work.pop_back();
+
+        for (ReportID id : g[v].reports) {
+            add_report(id);
+        }
+        if (g[v].suffix) {
+            for (ReportID id : all_reports(suffix_id(g[v].suffix))) {
+                add_report(id);
+            }
+        }
+        for (auto w : adjacent_vertices_range(v, g)) {
+            if (seen.insert(w).second) {
+                work.emplace_back(w);
+            }
+        }
+    }
+}
+
+namespace {
+struct ProfileMapEntry {
+    set<string> kinds;
+    set<u32> patterns;
+    vector<string> literals;
+};
+}
+
+/**
+ * \brief Dumps a tab-separated map from Rose program offset to the literals
+ * and pattern ids behind the program, for tools that profile scans by program
+ * offset (see hs_set_scratch_profile()).
+ *
+ * Each line holds: program offset, kinds of program (comma-separated),
+ * pattern ids (comma-separated), then one column per literal, escaped.
+ */
+static
+void dumpRoseProfileMap(const RoseBuildImpl &build,
+                        const vector<LitFragment> &fragments,
+                        const RoseEngine *t, const string &filename) {
+    map<u32, ProfileMapEntry> entries;
+
+    for (const auto &frag : fragments) {
+        set<u32> patterns;
+        vector<string> literals;
+        for (u32 lit_id : frag.lit_ids) {
+            const auto &lit = build.literals.at(lit_id);
+            literals.emplace_back(escapeString(lit.s.get_string()));
+            reachablePatterns(build, build.literal_info.at(lit_id), patterns);
+        }
+
+        auto add_frag = [&](u32 offset, const char *kind) {
+            if (!offset || offset == ROSE_INVALID_PROG_OFFSET) {
+                return;
+            }
+            auto &e = entries[offset];
+            e.kinds.insert(kind);
+            insert(&e.patterns, patterns);
+            insert(&e.literals, e.literals.end(), literals);
+        };
+        add_frag(frag.lit_program_offset, "literal");
+        add_frag(frag.delay_program_offset, "delay");
+    }
+
+    auto add_table = [&](u32 table_offset, u32 count, const char *kind) {
+        if (!table_offset) {
+            return;
+        }
+        const u32 *programs =
+            (const u32 *)loadFromByteCodeOffset(t, table_offset);
+        for (u32 i = 0; i < count; i++) {
+            if (programs[i]) {
+                entries[programs[i]].kinds.insert(kind);
+            }
+        }
+    };
+    add_table(t->anchoredProgramOffset, t->anchored_count, "anchored");
+    add_table(t->delayProgramOffset, t->delay_count, "delayed");
+
+    if (t->reportProgramOffset) {
+        const u32 *programs =
+            (const u32 *)loadFromByteCodeOffset(t, t->reportProgramOffset);
+        for (u32 i = 0; i < t->reportProgramCount; i++) {
+            if (!programs[i]) {
+                continue;
+            }
+            auto &e = entries[programs[i]];
+            e.kinds.insert("report");
+            if (i >= build.rm.numReports()) {
+                continue;
+            }
+            const Report &ir = build.rm.getReport(i);
+            if (isExternalReport(ir)) {
+                e.patterns.insert(ir.onmatch);
+            }
+        }
+    }
+
+    if (t->eodProgramOffset) {
+        entries[t->eodProgramOffset].kinds.insert("eod");
+    }
+    if (t->flushCombProgramOffset) {
+        entries[t->flushCombProgramOffset].kinds.insert("flush-comb");
+    }
+    if (t->lastFlushCombProgramOffset) {
+        entries[t->lastFlushCombProgramOffset].kinds.insert("last-flush-comb");
+    }
+
+    ofstream os(filename);
+    for (const auto &m : entries) {
+        const auto &e = m.second;
+        os << m.first << '\t' << as_string_list(e.kinds) << '\t'
+           << as_string_list(e.patterns);
+        for (const auto &lit : e.literals) {
+            os << '\t' << lit;
+        }
+        os << endl;
+    }
+    os.close();
+}
+
 void dumpRose(const RoseBuildImpl &build, const vector<LitFragment> &fragments,
               const map<left_id, u32> &leftfix_queue_map,
               const map<suffix_id, u32> &suffix_queue_map,
@@ -2393,6 +2563,8 @@ void dumpRose(const RoseBuildImpl &build, const vector<LitFragment> &fragments,
 
     // Literals
     dumpRoseLiterals(build, fragments, grey);
+    dumpRoseProfileMap(build, fragments, t, grey.dumpPath +
+                                            "/rose_profile_map.txt");
 
     f = StdioFile(grey.dumpPath + "/rose_struct.txt", "w");
     roseDumpStructRaw(t, f);
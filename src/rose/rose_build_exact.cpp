@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Rose build: exact-match table for fully anchored literal sets.
+ *
+ * When every pattern can only match a whole block, and spells out one of a
+ * small number of literals (e.g. /^GET$/i), a block scan needs a single lookup:
+ * the block is hashed and compared against the literals in the one slot of a
+ * minimal perfect hash that can hold it.
+ *
+ * The perfect hash is built by hash and displace: keys are divided into
+ * buckets by their hash, and each bucket, largest first, is given a seed which
+ * sends its keys to distinct free slots.
+ */
+
+#include "rose_build_exact.h"
+
+#include "exact_match_hash.h"
+#include "rose_build_engine_blob.h"
+#include "rose_build_impl.h"
+#include "rose_internal.h"
+#include "nfagraph/ng_holder.h"
+#include "util/bytecode_ptr.h"
+#include "util/charreach.h"
+#include "util/compile_context.h"
+#include "util/container.h"
+#include "util/report_manager.h"
+#include "util/verify_types.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace ue2 {
+
+/** \brief Largest number of literals one pattern may contribute. */
+static constexpr size_t MAX_LITERALS_PER_PATTERN = 64;
+
+/** \brief Largest character class which is expanded into one literal per
+ * character. */
+static constexpr size_t MAX_CLASS_SIZE = 8;
+
+/** \brief Average number of keys in a first-level bucket. */
+static constexpr u32 KEYS_PER_BUCKET = 4;
+
+/**
+ * \brief Find the literals spelled out by every path through a fully anchored
+ * graph whose matches are only at EOD. Returns false if the graph is not of
+ * that form.
+ */
+static
+bool findExactLiterals(const NGHolder &g, const ReportManager &rm,
+                       size_t max_len, vector<exact_literal> &out) {
+    for (auto v : adjacent_vertices_range(g.startDs, g)) {
+        if (v != g.startDs) {
+            DEBUG_PRINTF("not anchored\n");
+            return false;
+        }
+    }
+
+    vector<pair<NFAVertex, ue2_literal>> stack;
+    for (auto v : adjacent_vertices_range(g.start, g)) {
+        if (v == g.startDs) {
+            continue;
+        }
+        if (is_special(v, g)) {
+            DEBUG_PRINTF("vacuous\n");
+            return false;
+        }
+        stack.emplace_back(v, ue2_literal());
+    }
+
+    while (!stack.empty()) {
+        NFAVertex v = stack.back().first;
+        ue2_literal prefix = std::move(stack.back().second);
+        stack.pop_back();
+
+        // Also bounds the walk around any cycle.
+        if (prefix.length() >= max_len) {
+            DEBUG_PRINTF("too long\n");
+            return false;
+        }
+
+        const CharReach &cr = g[v].char_reach;
+        vector<ue2_literal> lits;
+        if (cr.isCaselessChar()) {
+            lits.emplace_back(prefix);
+            lits.back().push_back((char)cr.find_first(), true);
+        } else if (cr.count() <= MAX_CLASS_SIZE) {
+            for (size_t c = cr.find_first(); c != CharReach::npos;
+                 c = cr.find_next(c)) {
+                lits.emplace_back(prefix);
+                lits.back().push_back((char)c, false);
+            }
+        } else {
+            DEBUG_PRINTF("wide class\n");
+            return false;
+        }
+
+        for (auto w : adjacent_vertices_range(v, g)) {
+            if (w == g.acceptEod) {
+                for (ReportID id : g[v].reports) {
+                    const Report &report = rm.getReport(id);
+                    if (report.type != EXTERNAL_CALLBACK ||
+                        report.minLength) {
+                        DEBUG_PRINTF("unsupported report\n");
+                        return false;
+                    }
+                    for (const auto &lit : lits) {
+                        out.emplace_back(lit, id);
+                    }
+                }
+            } else if (is_special(w, g)) {
+                DEBUG_PRINTF("matches before EOD\n");
+                return false;
+            } else {
+                for (const auto &lit : lits) {
+                    stack.emplace_back(w, lit);
+                }
+            }
+        }
+
+        if (out.size() + stack.size() > MAX_LITERALS_PER_PATTERN) {
+            DEBUG_PRINTF("too many literals\n");
+            return false;
+        }
+    }
+
+    return all_of(begin(out), end(out), [](const exact_literal &el) {
+        return !mixed_sensitivity(el.lit);
+    });
+}
+
+void RoseBuildImpl::addExactMatch(const NGHolder &graph) {
+    if (!exact_match_ok) {
+        return;
+    }
+
+    vector<exact_literal> lits;
+    if (!findExactLiterals(graph, rm, cc.grey.limitLiteralLength, lits)) {
+        disableExactMatch();
+        return;
+    }
+
+    DEBUG_PRINTF("graph gives %zu exact literals\n", lits.size());
+    insert(&exact_literals, exact_literals.end(), lits);
+}
+
+void RoseBuildImpl::disableExactMatch() {
+    DEBUG_PRINTF("exact-match table disabled\n");
+    exact_match_ok = false;
+    exact_literals.clear();
+}
+
+bool canBuildExactMatchTable(const RoseBuildImpl &build) {
+    return build.exact_match_ok && !build.exact_literals.empty() &&
+           !build.hasSom && !build.rm.numCkeys();
+}
+
+/** \brief Block contents with the case bit of every byte cleared, as hashed
+ * by \ref exactMatchHash(). */
+static
+string caseClearedKey(const ue2_literal &lit) {
+    string key = lit.get_string();
+    for (auto &c : key) {
+        c = (char)((u8)c & CASE_CLEAR);
+    }
+    return key;
+}
+
+/**
+ * \brief Choose a seed for each bucket which sends every key in it to a
+ * distinct free slot. Returns false if no seed could be found for a bucket.
+ */
+static
+bool assignSlots(const vector<u64a> &hashes, u32 bucket_count,
+                 vector<u32> &seeds, vector<u32> &slot_of) {
+    const u32 n = verify_u32(hashes.size());
+    const u32 max_seed = max(1U << 16, min(n, 1U << 24) * 16);
+
+    vector<vector<u32>> buckets(bucket_count);
+    for (u32 i = 0; i < n; i++) {
+        buckets[exactMatchBucket(hashes[i], bucket_count)].emplace_back(i);
+    }
+
+    vector<u32> order(bucket_count);
+    iota(begin(order), end(order), 0);
+    stable_sort(begin(order), end(order), [&](u32 a, u32 b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    seeds.assign(bucket_count, 0);
+    slot_of.assign(n, 0);
+    vector<bool> taken(n, false);
+    vector<u32> slots;
+
+    for (u32 b : order) {
+        const auto &keys = buckets[b];
+        if (keys.empty()) {
+            break;
+        }
+
+        u32 seed = 0;
+        for (;; seed++) {
+            if (seed == max_seed) {
+                DEBUG_PRINTF("no seed for bucket %u (%zu keys)\n", b,
+                             keys.size());
+                return false;
+            }
+            slots.clear();
+            for (u32 k : keys) {
+                u32 s = exactMatchSlot(hashes[k], seed, n);
+                if (taken[s] ||
+                    find(begin(slots), end(slots), s) != end(slots)) {
+                    break;
+                }
+                slots.emplace_back(s);
+            }
+            if (slots.size() == keys.size()) {
+                break;
+            }
+        }
+
+        seeds[b] = seed;
+        for (size_t i = 0; i < keys.size(); i++) {
+            taken[slots[i]] = true;
+            slot_of[keys[i]] = slots[i];
+        }
+    }
+
+    return true;
+}
+
+u32 buildExactMatchTable(const RoseBuildImpl &build, RoseEngineBlob &blob) {
+    if (!canBuildExactMatchTable(build)) {
+        return 0;
+    }
+
+    const auto &lits = build.exact_literals;
+
+    // Group the literals by key; literals differing only in case share one.
+    unordered_map<string, u32> key_ids;
+    vector<vector<u32>> key_lits;
+    vector<u64a> hashes;
+    for (u32 i = 0; i < lits.size(); i++) {
+        string key = caseClearedKey(lits[i].lit);
+        auto it = key_ids.emplace(key, verify_u32(key_lits.size()));
+        if (it.second) {
+            key_lits.emplace_back();
+            hashes.emplace_back(
+                exactMatchHash((const u8 *)key.data(), key.size()));
+        }
+        key_lits[it.first->second].emplace_back(i);
+    }
+
+    const u32 key_count = verify_u32(key_lits.size());
+    const u32 bucket_count = max(1U, key_count / KEYS_PER_BUCKET);
+
+    vector<u32> seeds;
+    vector<u32> slot_of;
+    if (!assignSlots(hashes, bucket_count, seeds, slot_of)) {
+        return 0;
+    }
+
+    vector<u32> key_in_slot(key_count);
+    for (u32 k = 0; k < key_count; k++) {
+        key_in_slot[slot_of[k]] = k;
+    }
+
+    // Lay out the strings, sharing duplicates.
+    const size_t headerSize = ROUNDUP_16(sizeof(RoseExactTable));
+    const size_t seedSize = ROUNDUP_16(byte_length(seeds));
+    const size_t slotSize = ROUNDUP_16(key_count * sizeof(RoseExactSlot));
+    const size_t entrySize = ROUNDUP_16(lits.size() * sizeof(RoseExactEntry));
+    const size_t strOffset = headerSize + seedSize + slotSize + entrySize;
+
+    vector<u8> strings;
+    unordered_map<string, u32> str_offsets;
+    vector<RoseExactSlot> slots(key_count);
+    vector<RoseExactEntry> entries;
+    entries.reserve(lits.size());
+    u32 max_len = 0;
+
+    for (u32 s = 0; s < key_count; s++) {
+        const auto &members = key_lits[key_in_slot[s]];
+        RoseExactSlot &slot = slots[s];
+        slot.len = verify_u32(lits[members.front()].lit.length());
+        slot.first = verify_u32(entries.size());
+        slot.count = verify_u32(members.size());
+        max_len = max(max_len, slot.len);
+
+        for (u32 i : members) {
+            const auto &el = lits[i];
+            const string &str = el.lit.get_string();
+            auto it = str_offsets.emplace(
+                str, verify_u32(strOffset + strings.size()));
+            if (it.second) {
+                strings.insert(strings.end(), str.begin(), str.end());
+            }
+
+            RoseExactEntry e;
+            memset(&e, 0, sizeof(e));
+            e.str_offset = it.first->second;
+            e.program = build.rm.getProgramOffset(el.report);
+            e.nocase = el.lit.any_nocase() ? 1 : 0;
+            entries.emplace_back(e);
+        }
+    }
+
+    const size_t tabSize = ROUNDUP_16(strOffset + strings.size());
+    auto table = make_zeroed_bytecode_ptr<char>(tabSize, 16);
+    assert(table); // otherwise would have thrown std::bad_alloc
+
+    RoseExactTable *header = (RoseExactTable *)table.get();
+    header->size = verify_u32(tabSize);
+    header->bucketCount = bucket_count;
+    header->slotCount = key_count;
+    header->maxLen = max_len;
+    header->seedOffset = verify_u32(headerSize);
+    header->slotOffset = verify_u32(headerSize + seedSize);
+    header->entryOffset = verify_u32(headerSize + seedSize + slotSize);
+
+    copy_bytes(table.get() + header->seedOffset, seeds);
+    copy_bytes(table.get() + header->slotOffset, slots);
+    copy_bytes(table.get() + header->entryOffset, entries);
+    copy_bytes(table.get() + strOffset, strings);
+
+    DEBUG_PRINTF("built exact-match table: %zu literals, %u keys, "
+                 "%u buckets, size=%zu\n", lits.size(), key_count,
+                 bucket_count, tabSize);
+
+    return blob.add(table);
+}
+
+} // namespace ue2
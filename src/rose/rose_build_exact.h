@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Rose build: exact-match table for fully anchored literal sets.
+ */
+
+#ifndef ROSE_BUILD_EXACT_H
+#define ROSE_BUILD_EXACT_H
+
+#include "ue2common.h"
+#include "util/ue2string.h"
+
+#include <utility>
+
+namespace ue2 {
+
+class RoseBuildImpl;
+class RoseEngineBlob;
+
+/** \brief A literal which matches only a whole block, and its report. */
+struct exact_literal {
+    exact_literal(ue2_literal lit_in, ReportID report_in)
+        : lit(std::move(lit_in)), report(report_in) {}
+
+    ue2_literal lit;
+    ReportID report;
+};
+
+/** \brief True if the exact-match table can handle every pattern. */
+bool canBuildExactMatchTable(const RoseBuildImpl &build);
+
+/**
+ * \brief Build the exact-match table, returning its offset in the engine blob
+ * or zero if it could not be built.
+ *
+ * Report programs must already have been written for its reports.
+ */
+u32 buildExactMatchTable(const RoseBuildImpl &build, RoseEngineBlob &blob);
+
+} // namespace ue2
+
+#endif // ROSE_BUILD_EXACT_H
@@ -30,6 +30,7 @@
 #define ROSE_BUILD_IMPL_H
 
 #include "rose_build.h"
+#include "rose_build_exact.h"
 #include "rose_build_util.h"
 #include "rose_common.h"
 #include "rose_graph.h"
@@ -402,12 +403,20 @@ struct MpvProto {
     std::vector<raw_puff> triggered_puffettes;
 };
 
+/** \brief Small DFA outfixes packed into the lanes of a single Sheng lanes
+ * engine. */
+struct LanesProto {
+    std::vector<std::unique_ptr<raw_dfa>> dfas;
+};
+
 struct OutfixInfo {
     template<class T>
     explicit OutfixInfo(std::unique_ptr<T> x) : proto(std::move(x)) {}
 
     explicit OutfixInfo(MpvProto mpv_in) : proto(std::move(mpv_in)) {}
 
+    explicit OutfixInfo(LanesProto lanes_in) : proto(std::move(lanes_in)) {}
+
     u32 get_queue(QueueIndexFactory &qif);
 
     u32 get_queue() const {
@@ -449,6 +458,9 @@ struct OutfixInfo {
     MpvProto *mpv() {
         return boost::get<MpvProto>(&proto);
     }
+    LanesProto *lanes() {
+        return boost::get<LanesProto>(&proto);
+    }
 
     // Convenience const accessor functions.
 
@@ -467,6 +479,9 @@ struct OutfixInfo {
     const MpvProto *mpv() const {
         return boost::get<MpvProto>(&proto);
     }
+    const LanesProto *lanes() const {
+        return boost::get<LanesProto>(&proto);
+    }
 
     /**
      * \brief Variant wrapping the various engine types. If this is
@@ -477,7 +492,8 @@ struct OutfixInfo {
         std::unique_ptr<NGHolder>,
         std::unique_ptr<raw_dfa>,
         std::unique_ptr<raw_som_dfa>,
-        MpvProto> proto = boost::blank();
+        MpvProto,
+        LanesProto> proto = boost::blank();
 
     RevAccInfo rev_info;
     u32 maxBAWidth = 0; //!< max bi-anchored width
@@ -519,6 +535,9 @@ public:
 
     bool addAnchoredAcyclic(const NGHolder &graph) override;
 
+    void addExactMatch(const NGHolder &graph) override;
+    void disableExactMatch() override;
+
     bool validateMask(const std::vector<CharReach> &mask,
                       const flat_set<ReportID> &reports, bool anchored,
                       bool eod) const override;
@@ -630,6 +649,13 @@ public:
 
     std::vector<OutfixInfo> outfixes;
 
+    /** \brief Literals for the exact-match table, one per report. */
+    std::vector<exact_literal> exact_literals;
+
+    /** \brief False once a pattern has been added which cannot be represented
+     * in the exact-match table. */
+    bool exact_match_ok;
+
     /** \brief MPV outfix entry. Null if not used, and moved into the outfixes
      * list before we start building the bytecode (at which point it is set to
      * null again). */
@@ -442,8 +442,8 @@ void findForwardAccelScheme(const vector<AccelString> &lits,
     }
 
     const CharReach &cr = reach[min_offset];
-#ifdef HAVE_SVE2
-    if (min_count <= 16) {
+#ifdef HAVE_VERM16
+    if (min_count <= VERM16_MAX_CHARS) {
         vermicelli16Build(cr, (u8 *)&aux->verm16.mask);
         DEBUG_PRINTF("built verm16 for %s (%zu chars, offset %u)\n",
                      describeClass(cr).c_str(), cr.count(), min_offset);
@@ -451,7 +451,7 @@ void findForwardAccelScheme(const vector<AccelString> &lits,
         aux->verm16.offset = verify_u8(min_offset);
         return;
     }
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
 
     if (-1 !=
         shuftiBuildMasks(cr, (u8 *)&aux->shufti.lo, (u8 *)&aux->shufti.hi)) {
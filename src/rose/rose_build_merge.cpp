@@ -43,6 +43,8 @@
 #include "nfa/mcclellancompile.h"
 #include "nfa/nfa_build_util.h"
 #include "nfa/rdfa_merge.h"
+#include "nfa/shenglanes_internal.h"
+#include "nfa/shenglanescompile.h"
 #include "nfagraph/ng_holder.h"
 #include "nfagraph/ng_haig.h"
 #include "nfagraph/ng_is_equal.h"
@@ -2361,17 +2363,19 @@ void mergeOutfixNfas(RoseBuildImpl &tbi, vector<NGHolder *> &nfas) {
 
 namespace {
 struct MergeMcClellan {
-    MergeMcClellan(const ReportManager &rm_in, const Grey &grey_in)
-        : rm(rm_in), grey(grey_in) {}
+    MergeMcClellan(const ReportManager &rm_in, const Grey &grey_in,
+                   size_t max_states_in = DFA_MERGE_MAX_STATES)
+        : rm(rm_in), grey(grey_in), max_states(max_states_in) {}
 
     unique_ptr<raw_dfa> operator()(const raw_dfa *d1, const raw_dfa *d2) const {
         assert(d1 && d2);
-        return mergeTwoDfas(d1, d2, DFA_MERGE_MAX_STATES, &rm, grey);
+        return mergeTwoDfas(d1, d2, max_states, &rm, grey);
     }
 
 private:
     const ReportManager &rm;
     const Grey &grey;
+    const size_t max_states; //!< state limit for merged result.
 };
 
 struct MergeHaig {
@@ -2490,6 +2494,91 @@ void mergeOutfixDfas(RoseBuildImpl &tbi, vector<raw_dfa *> &dfas) {
     removeDeadOutfixes(outfixes);
 }
 
+/**
+ * Packs small DFA outfixes into the lanes of Sheng lanes engines, so that they
+ * are advanced together in one pass rather than each through its own queue.
+ * DFAs that still fit in a lane once merged with each other are merged first;
+ * the rest are grouped up to SHENG_LANES_MAX at a time, which avoids the state
+ * blow-up of merging them into a product DFA. DFAs whose start state
+ * accelerates well are left alone, as lanes cannot accelerate. Packed DFAs
+ * are removed from \p dfas.
+ */
+static
+void packOutfixLanes(RoseBuildImpl &tbi, vector<raw_dfa *> &dfas) {
+    if (!tbi.cc.grey.allowShengLanes) {
+        return;
+    }
+
+    auto fits = [&tbi](raw_dfa &rdfa) {
+        return fitsShengLane(rdfa)
+            && !shengLaneLosesAccel(rdfa, tbi.rm, tbi.cc.grey);
+    };
+
+    vector<raw_dfa *> small, rest;
+    for (auto *rdfa : dfas) {
+        if (fits(*rdfa)) {
+            small.emplace_back(rdfa);
+        } else {
+            rest.emplace_back(rdfa);
+        }
+    }
+
+    DEBUG_PRINTF("%zu of %zu dfas fit in a lane\n", small.size(), dfas.size());
+    if (small.size() < 2) {
+        return;
+    }
+
+    vector<OutfixInfo> &outfixes = tbi.outfixes;
+
+    unordered_map<raw_dfa *, size_t> dfa_mapping;
+    for (size_t i = 0; i < outfixes.size(); i++) {
+        auto *rdfa = outfixes[i].rdfa();
+        if (rdfa) {
+            dfa_mapping[rdfa] = i;
+        }
+    }
+
+    chunkedDfaMerge(small, dfa_mapping, outfixes,
+                    MergeMcClellan(tbi.rm, tbi.cc.grey,
+                                   SHENG_LANES_MAX_STATES));
+
+    // Minimisation is not guaranteed to bring a merged DFA back in budget.
+    vector<raw_dfa *> lanes;
+    for (auto *rdfa : small) {
+        if (fits(*rdfa)) {
+            lanes.emplace_back(rdfa);
+        } else {
+            rest.emplace_back(rdfa);
+        }
+    }
+
+    for (size_t i = 0; i < lanes.size(); i += SHENG_LANES_MAX) {
+        size_t count = min(lanes.size() - i, (size_t)SHENG_LANES_MAX);
+        if (count < 2) {
+            rest.emplace_back(lanes[i]);
+            continue;
+        }
+
+        DEBUG_PRINTF("packing %zu dfas into lanes\n", count);
+        LanesProto proto;
+        OutfixInfo &winner = outfixes.at(dfa_mapping.at(lanes[i]));
+        for (size_t j = i; j < i + count; j++) {
+            OutfixInfo &outfix = outfixes.at(dfa_mapping.at(lanes[j]));
+            assert(outfix.rdfa() == lanes[j]);
+            proto.dfas.emplace_back(
+                move(boost::get<unique_ptr<raw_dfa>>(outfix.proto)));
+            if (&outfix != &winner) {
+                mergeOutfixInfo(winner, outfix);
+                outfix.clear();
+            }
+        }
+        winner.proto = move(proto);
+    }
+
+    removeDeadOutfixes(outfixes);
+    dfas.swap(rest);
+}
+
 static
 void mergeOutfixCombo(RoseBuildImpl &tbi, const ReportManager &rm,
                       const Grey &grey) {
@@ -2615,6 +2704,7 @@ void mergeOutfixes(RoseBuildImpl &tbi) {
                  dfas.size(), nfas.size());
 
     mergeOutfixNfas(tbi, nfas);
+    packOutfixLanes(tbi, dfas);
     mergeOutfixDfas(tbi, dfas);
     mergeOutfixHaigs(tbi, som_dfas, 255);
     mergeOutfixHaigs(tbi, som_dfas, 8192);
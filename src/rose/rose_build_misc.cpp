@@ -77,6 +77,7 @@ RoseBuildImpl::RoseBuildImpl(ReportManager &rm_in,
       hasSom(false),
       group_end(0),
       ematcher_region_size(0),
+      exact_match_ok(cc_in.grey.allowExactMatch && !cc_in.streaming),
       eod_event_literal_id(MO_INVALID_IDX),
       max_rose_anchored_floating_overlap(0),
       rm(rm_in),
@@ -548,6 +549,14 @@ public:
         }
         return reports;
     }
+
+    set<ReportID> operator()(const LanesProto &lanes) const {
+        set<ReportID> reports;
+        for (const auto &rdfa : lanes.dfas) {
+            insert(&reports, all_reports(*rdfa));
+        }
+        return reports;
+    }
 };
 }
 
@@ -2563,8 +2563,32 @@ void recordLongLiterals(vector<ue2_case_string> &longLiterals,
     }
 }
 
+/**
+ * \brief True if the given instruction only inspects the match offset and
+ * exhaustion keys, and so can be run by the scratch-free block scan.
+ */
+static
+bool isScratchlessInstr(RoseInstructionCode code) {
+    switch (code) {
+    case ROSE_INSTR_END:
+    case ROSE_INSTR_CHECK_LIT_EARLY:
+    case ROSE_INSTR_CHECK_GROUPS:
+    case ROSE_INSTR_CHECK_BOUNDS:
+    case ROSE_INSTR_CHECK_EXHAUSTED:
+    case ROSE_INSTR_REPORT:
+    case ROSE_INSTR_REPORT_EXHAUST:
+    case ROSE_INSTR_FINAL_REPORT:
+        return true;
+    default:
+        return false;
+    }
+}
+
 void recordResources(RoseResources &resources, const RoseProgram &program) {
     for (const auto &ri : program) {
+        if (!isScratchlessInstr(ri->code())) {
+            resources.has_scratch_instr = true;
+        }
         switch (ri->code()) {
         case ROSE_INSTR_TRIGGER_SUFFIX:
             resources.has_suffixes = true;
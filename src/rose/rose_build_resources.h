@@ -52,6 +52,8 @@ struct RoseResources {
     bool has_anchored_large = false; /* mcclellan 16 anchored dfa */
     bool has_floating = false;
     bool has_eod = false;
+    bool has_scratch_instr = false; /* program needs more than report/bounds
+                                     * checks, so cannot run without scratch */
 };
 
 }
@@ -147,6 +147,8 @@ struct LeftNfaInfo {
     char eager; /**< nfa should be run eagerly to first match or death */
     char eod_check; /**< nfa is used by the event eod literal */
     u32 countingMiracleOffset; /** if not 0, offset to RoseCountingMiracle. */
+    u32 maxOffset; /**< non zero: no successor role can match beyond this
+                    * stream offset */
     rose_group squash_mask; /* & mask applied when rose nfa dies */
 };
 
@@ -249,6 +251,13 @@ struct RoseStateOffsets {
     /** Size of the long literal state. */
     u32 longLitState_size;
 
+    /** State for runtime input transforms: user input offset and any
+     * held-back bytes of an incomplete escape. See transform.h. */
+    u32 transform;
+
+    /** Size of the input transform state, zero if no transform is applied. */
+    u32 transform_size;
+
     /** Packed SOM location slots. */
     u32 somLocation;
 
@@ -310,6 +319,10 @@ struct RoseBoundaryReports {
 #define ROSE_RUNTIME_PURE_LITERAL  1
 #define ROSE_RUNTIME_SINGLE_OUTFIX 2
 
+/** \brief Largest number of exhaustion keys a scratchless engine may use; the
+ * exhaustion vector for such an engine is kept on the stack. */
+#define ROSE_SCRATCHLESS_MAX_EKEYS 256
+
 /**
  * \brief Runtime structure header for Rose.
  *
@@ -341,7 +354,11 @@ struct RoseEngine {
     u8  hasSom; /**< has at least one pattern which tracks SOM. */
     u8  somHorizon; /**< width in bytes of SOM offset storage (governed by
                         SOM precision) */
+    u8  scratchless; /**< block scans may run without scratch, see
+                      * hs_scan_scratchless() */
     u32 mode; /**< scanning mode, one of HS_MODE_{BLOCK,STREAM,VECTORED} */
+    u32 transform; /**< length-changing input transforms (HS_MODE_TRANSFORM_
+                    * flags) applied by the streaming runtime, or zero */
     u32 historyRequired; /**< max amount of history required for streaming */
     u32 ekeyCount; /**< number of exhaustion keys */
     u32 lkeyCount; /**< number of logical keys */
@@ -369,6 +386,8 @@ struct RoseEngine {
     u32 drmatcherOffset; // offset of the delayed rebuild table (bytes)
     u32 sbmatcherOffset; // offset of the small-block literal matcher (bytes)
     u32 longLitTableOffset; // offset of the long literal table
+    u32 exactTableOffset; /**< offset of the exact-match table, used instead
+                            * of everything else for block scans */
     u32 amatcherMinWidth; /**< minimum number of bytes required for a pattern
                            * involved with the anchored table to produce a full
                            * match. */
@@ -477,6 +496,18 @@ struct RoseEngine {
     u32 ematcherRegionSize; /* max region size to pass to ematcher */
     u32 somRevCount; /**< number of som reverse nfas */
     u32 somRevOffsetOffset; /**< offset to array of offsets to som rev nfas */
+    u32 somOnDemandCount; /**< number of on-demand som nfas */
+    u32 somOnDemandOffset; /**< offset to array of struct RoseSomOnDemand,
+                            * sorted by id */
+    u32 groupRetireCount; /**< number of struct RoseGroupRetire entries */
+    u32 groupRetireOffset; /**< offset to array of struct RoseGroupRetire,
+                            * sorted by offset */
+    u32 ekeyGroupsOffset; /**< offset to rose_group per ekey: the groups whose
+                           * literals only lead to reports with that ekey (and
+                           * others), or 0 if none */
+    u32 groupEkeyListOffset; /**< offset to u32 per group: offset of the
+                              * INVALID_EKEY-terminated list of ekeys which
+                              * must all be set for that group to die */
     u32 longLitStreamState; // size in bytes
 
     struct scatter_full_plan state_init;
@@ -554,6 +585,61 @@ struct RoseLongLitHashEntry {
     u32 str_len;
 };
 
+/**
+ * \brief Exact-match table header.
+ *
+ * Used when every pattern matches only a whole block exactly, i.e. is a fully
+ * anchored literal: a minimal perfect hash of the (case-cleared) block selects
+ * the only slot which can hold it.
+ *
+ * In memory, we follow this with:
+ *   -# u32 seed per bucket
+ *   -# struct RoseExactSlot per slot
+ *   -# struct RoseExactEntry per (literal, report), grouped by slot
+ *   -# literal strings
+ */
+struct RoseExactTable {
+    u32 size; //!< total size of the table, including strings
+    u32 bucketCount; //!< number of first-level buckets
+    u32 slotCount; //!< number of slots, one per distinct key
+    u32 maxLen; //!< longest literal
+    u32 seedOffset; //!< offset of seeds, relative to table base
+    u32 slotOffset; //!< offset of slots, relative to table base
+    u32 entryOffset; //!< offset of entries, relative to table base
+};
+
+/** \brief One of these per distinct key in the exact-match table. */
+struct RoseExactSlot {
+    u32 len; //!< length of every literal in this slot
+    u32 first; //!< index of the first entry for this slot
+    u32 count; //!< number of entries for this slot
+};
+
+/** \brief One of these per (literal, report) in the exact-match table. */
+struct RoseExactEntry {
+    u32 str_offset; //!< offset of the literal, relative to table base
+    u32 program; //!< offset of the report program to run
+    u8 nocase; //!< literal is caseless and stored upper-case
+};
+
+/** \brief One of these per reverse NFA used to compute the start of a match
+ * on demand (HS_FLAG_SOM_ON_DEMAND). A pattern may have several. */
+struct RoseSomOnDemand {
+    u32 id; //!< external (user) report ID
+    u32 nfaOffset; //!< offset of the reverse NFA, relative to RoseEngine
+    s32 adjust; //!< match end is reported at the NFA's end plus this
+    u8 eod; //!< only applies to matches at the end of the data
+};
+
+/** \brief Streaming mode: groups whose literals can no longer produce a match
+ * once the stream has reached a given offset (due to HS_EXT_FLAG_MAX_OFFSET
+ * and other bounds on the roles they lead to). Entries are sorted by offset
+ * and their group masks are cumulative. */
+struct RoseGroupRetire {
+    u64a offset; //!< all literal matches in these groups end by this offset
+    rose_group groups; //!< groups which may be switched off from here on
+};
+
 static really_inline
 const struct anchored_matcher_info *getALiteralMatcher(
         const struct RoseEngine *t) {
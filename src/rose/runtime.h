@@ -35,6 +35,7 @@
 
 #include "rose_internal.h"
 #include "scratch.h"
+#include "nfa/nfa_api_queue.h"
 #include "util/partial_store.h"
 
 /*
@@ -157,4 +158,28 @@ void updateMinMatchOffsetFromMpv(struct RoseContext *tctxt, u64a offset) {
     tctxt->minMatchOffset = offset;
     tctxt->minNonMpvMatchOffset = MAX(tctxt->minNonMpvMatchOffset, offset);
 }
+
+/** \brief Record the start of a run of the engine queue \a q in the scan
+ * trace, before it is handed to nfaQueueExec() or a variant. */
+static really_inline
+void traceQueueExec(struct hs_scratch *scratch, const struct mq *q) {
+#if defined(HS_TRACE)
+    u32 events = q->end - q->cur;
+    u64a loc = q->cur < q->end ? q->offset + q_cur_loc(q) : q->offset;
+    traceEvent(scratch, TRACE_QUEUE_EXEC, (u16)MIN(events, 0xffffU),
+               (u32)(q - scratch->queues), loc);
+#else
+    (void)scratch;
+    (void)q;
+#endif
+}
+
+/** \brief Record the end of a run of the engine queue \a q in the scan
+ * trace; \a alive is the engine's return value. */
+static really_inline
+void traceQueueExecEnd(struct hs_scratch *scratch, const struct mq *q,
+                       char alive) {
+    traceEvent(scratch, TRACE_QUEUE_EXEC_END, (u16)(alive != 0),
+               (u32)(q - scratch->queues), 0);
+}
 #endif
@@ -304,7 +304,9 @@ char roseCatchUpLeftfix(const struct RoseEngine *t, char *state,
     debugQueue(q);
 #endif
 
+    traceQueueExec(scratch, q);
     char rv = nfaQueueExecRose(nfa, q, MO_INVALID_IDX);
+    traceQueueExecEnd(scratch, q, rv);
     if (!rv) { /* nfa is dead */
         DEBUG_PRINTF("died catching up to stream boundary\n");
         return 0;
@@ -343,6 +345,8 @@ void roseCatchUpLeftfixes(const struct RoseEngine *t, char *state,
     const u32 arCount = t->activeLeftCount;
     const struct LeftNfaInfo *left_table = getLeftTable(t);
     const struct mmbit_sparse_iter *it = getActiveLeftIter(t);
+    const u64a end_offset = scratch->core_info.buf_offset
+                          + scratch->core_info.len;
 
     struct mmbit_sparse_state si_state[MAX_SPARSE_ITER_STATES];
 
@@ -354,7 +358,10 @@ void roseCatchUpLeftfixes(const struct RoseEngine *t, char *state,
         u32 qi = ri + t->leftfixBeginQueue;
         DEBUG_PRINTF("leftfix %u of %u, maxLag=%u, infix=%d\n", ri, arCount,
                      left->maxLag, (int)left->infix);
-        if (!roseCatchUpLeftfix(t, state, scratch, qi, left)) {
+        // No successor role can match once the stream passes the leftfix's
+        // max offset, so there is no need to keep it alive.
+        if ((left->maxOffset && end_offset >= left->maxOffset)
+            || !roseCatchUpLeftfix(t, state, scratch, qi, left)) {
             DEBUG_PRINTF("removing rose %u from active list\n", ri);
             DEBUG_PRINTF("groups old=%016llx mask=%016llx\n",
                          scratch->tctxt.groups, left->squash_mask);
@@ -378,19 +385,43 @@ void roseSaveNfaStreamState(const struct RoseEngine *t, char *state,
         mmbit_unset(aa, aaCount, 0);
     }
 
-    for (u32 qi = mmbit_iterate(aa, aaCount, MMB_INVALID); qi != MMB_INVALID;
-         qi = mmbit_iterate(aa, aaCount, qi)) {
-        DEBUG_PRINTF("saving stream state for qi=%u\n", qi);
+    u32 qis[MMB_ITER_BATCH];
+    u32 n = 0;
+    do {
+        n = mmbit_iterate_batch(aa, aaCount, n ? qis[n - 1] : MMB_INVALID,
+                                qis, MMB_ITER_BATCH);
+        for (u32 i = 0; i < n; i++) {
+            u32 qi = qis[i];
+            DEBUG_PRINTF("saving stream state for qi=%u\n", qi);
 
-        struct mq *q = queues + qi;
+            struct mq *q = queues + qi;
 
-        // If it's active, it should have an active queue (as we should have
-        // done some work!)
-        assert(fatbit_isset(scratch->aqa, t->queueCount, qi));
+            // If it's active, it should have an active queue (as we should
+            // have done some work!)
+            assert(fatbit_isset(scratch->aqa, t->queueCount, qi));
 
-        const struct NFA *nfa = getNfaByQueue(t, qi);
-        saveStreamState(nfa, q, q_cur_loc(q));
+            const struct NFA *nfa = getNfaByQueue(t, qi);
+            saveStreamState(nfa, q, q_cur_loc(q));
+        }
+    } while (n == MMB_ITER_BATCH);
+}
+
+/** \brief Returns the groups whose literals can no longer lead to a match once
+ * the stream has reached the given offset. */
+static really_inline
+rose_group retiredGroups(const struct RoseEngine *t, u64a offset) {
+    const struct RoseGroupRetire *table = (const struct RoseGroupRetire *)
+        ((const char *)t + t->groupRetireOffset);
+    rose_group groups = 0;
+
+    // Entries are sorted by offset and their group masks are cumulative.
+    for (u32 i = 0; i < t->groupRetireCount && table[i].offset <= offset;
+         i++) {
+        groups = table[i].groups;
     }
+
+    DEBUG_PRINTF("retired groups at offset %llu: %016llx\n", offset, groups);
+    return groups;
 }
 
 static rose_inline
@@ -407,6 +438,9 @@ void ensureStreamNeatAndTidy(const struct RoseEngine *t, char *state,
     roseCatchUpLeftfixes(t, state, scratch);
     roseFlushLastByteHistory(t, scratch, offset + length);
     tctxt->lastEndOffset = offset + length;
+    if (t->groupRetireCount) {
+        tctxt->groups &= ~retiredGroups(t, offset + length);
+    }
     storeGroups(t, state, tctxt->groups);
     storeLongLiteralState(t, state, scratch);
 }
@@ -490,7 +524,9 @@ void runEagerPrefixesStream(const struct RoseEngine *t,
             nfaQueueInitState(nfa, q);
         }
 
+        traceQueueExec(scratch, q);
         char alive = nfaQueueExecToMatch(q->nfa, q, loc);
+        traceQueueExecEnd(scratch, q, alive);
 
         if (!alive) {
             DEBUG_PRINTF("queue %u dead, squashing\n", qi);
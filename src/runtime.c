@@ -45,7 +45,9 @@
 #include "nfa/nfa_rev_api.h"
 #include "nfa/sheng.h"
 #include "smallwrite/smallwrite_internal.h"
+#include "rose/exact_match.h"
 #include "rose/rose.h"
+#include "rose/rose_program.h"
 #include "rose/runtime.h"
 #include "database.h"
 #include "report.h"
@@ -54,9 +56,11 @@
 #include "som/som_stream.h"
 #include "state.h"
 #include "stream_compress.h"
+#include "transform.h"
 #include "ue2common.h"
 #include "util/exhaust.h"
 #include "util/multibit.h"
+#include "util/usdt.h"
 
 static really_inline
 void prefetch_data(const char *data, unsigned length) {
@@ -111,6 +115,11 @@ char validScratch(const struct RoseEngine *t, const struct hs_scratch *s) {
         return 0;
     }
 
+    if (t->transform && !s->transformSize) {
+        DEBUG_PRINTF("no input transform buffer\n");
+        return 0;
+    }
+
     /* TODO: add quick rose sanity checks */
 
     return 1;
@@ -150,7 +159,8 @@ void populateCoreInfo(struct hs_scratch *s, const struct RoseEngine *rose,
 }
 
 #define STATUS_VALID_BITS                                                      \
-    (STATUS_TERMINATED | STATUS_EXHAUSTED | STATUS_DELAY_DIRTY | STATUS_ERROR)
+    (STATUS_TERMINATED | STATUS_EXHAUSTED | STATUS_DELAY_DIRTY |               \
+     STATUS_ERROR | STATUS_WORK_EXCEEDED)
 
 /** \brief Retrieve status bitmask from stream state. */
 static really_inline
@@ -167,6 +177,17 @@ void setStreamStatus(char *state, u8 status) {
     *(u8 *)(state + ROSE_STATE_OFFSET_STATUS_FLAGS) = status;
 }
 
+/** \brief Error to return for a scan halted by STATUS_TERMINATED: either the
+ * user callback asked us to stop or the work budget ran out. */
+static really_inline
+hs_error_t scanTerminatedError(const struct hs_scratch *scratch) {
+    assert(told_to_stop_matching(scratch));
+    if (scratch->core_info.status & STATUS_WORK_EXCEEDED) {
+        return HS_SCAN_WORK_EXCEEDED;
+    }
+    return HS_SCAN_TERMINATED;
+}
+
 /** \brief Initialise SOM state. Used in both block and streaming mode. */
 static really_inline
 void initSomState(const struct RoseEngine *rose, char *state) {
@@ -270,7 +291,9 @@ void soleOutfixBlockExec(const struct RoseEngine *t,
     pushQueueAt(q, 1, MQE_TOP, 0);
     pushQueueAt(q, 2, MQE_END, scratch->core_info.len);
 
+    traceQueueExec(scratch, q);
     char rv = nfaQueueExec(q->nfa, q, scratch->core_info.len);
+    traceQueueExecEnd(scratch, q, rv);
 
     if (rv && nfaAcceptsEod(nfa) && len == scratch->core_info.len) {
         nfaCheckFinalState(nfa, q->state, q->streamState, q->length, q->cb,
@@ -312,11 +335,10 @@ void runSmallWriteEngine(const struct SmallWriteEngine *smwr,
     }
 }
 
-HS_PUBLIC_API
-hs_error_t HS_CDECL hs_scan(const hs_database_t *db, const char *data,
-                            unsigned length, unsigned flags,
-                            hs_scratch_t *scratch, match_event_handler onEvent,
-                            void *userCtx) {
+static really_inline
+hs_error_t scanBlock(const hs_database_t *db, const char *data,
+                     unsigned length, unsigned flags, hs_scratch_t *scratch,
+                     match_event_handler onEvent, void *userCtx) {
     if (unlikely(!scratch || !data)) {
         return HS_INVALID;
     }
@@ -342,6 +364,7 @@ hs_error_t HS_CDECL hs_scan(const hs_database_t *db, const char *data,
     if (unlikely(markScratchInUse(scratch))) {
         return HS_SCRATCH_IN_USE;
     }
+    traceCallBegin(scratch, TRACE_CALL_BLOCK, length, 0);
 
     if (rose->minWidth > length) {
         DEBUG_PRINTF("minwidth=%u > length=%u\n", rose->minWidth, length);
@@ -397,6 +420,12 @@ hs_error_t HS_CDECL hs_scan(const hs_database_t *db, const char *data,
         goto done_scan;
     }
 
+    // Every pattern is a fully anchored literal, so a single lookup will do.
+    if (rose->exactTableOffset) {
+        roseExactMatchExec(rose, scratch);
+        goto done_scan;
+    }
+
     // Is this a small write case?
     if (rose->smallWriteOffset) {
         const struct SmallWriteEngine *smwr = getSmallWrite(rose);
@@ -432,14 +461,14 @@ done_scan:
         return HS_UNKNOWN_ERROR;
     } else if (told_to_stop_matching(scratch)) {
         unmarkScratchInUse(scratch);
-        return HS_SCAN_TERMINATED;
+        return scanTerminatedError(scratch);
     }
 
     if (rose->hasSom) {
         int halt = flushStoredSomMatches(scratch, ~0ULL);
         if (halt) {
             unmarkScratchInUse(scratch);
-            return HS_SCAN_TERMINATED;
+            return scanTerminatedError(scratch);
         }
     }
 
@@ -462,18 +491,395 @@ set_retval:
                 return HS_UNKNOWN_ERROR;
             }
             unmarkScratchInUse(scratch);
-            return HS_SCAN_TERMINATED;
+            return scanTerminatedError(scratch);
         }
     }
 
     DEBUG_PRINTF("done. told_to_stop_matching=%d\n",
                  told_to_stop_matching(scratch));
-    hs_error_t rv = told_to_stop_matching(scratch) ? HS_SCAN_TERMINATED
-                                                   : HS_SUCCESS;
+    hs_error_t rv = told_to_stop_matching(scratch)
+                        ? scanTerminatedError(scratch) : HS_SUCCESS;
     unmarkScratchInUse(scratch);
     return rv;
 }
 
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_scan(const hs_database_t *db, const char *data,
+                            unsigned length, unsigned flags,
+                            hs_scratch_t *scratch, match_event_handler onEvent,
+                            void *userCtx) {
+    HS_PROBE2(scan__start, db, length);
+    hs_error_t rv = scanBlock(db, data, length, flags, scratch, onEvent,
+                              userCtx);
+    HS_PROBE3(scan__done, db, length, rv);
+    return rv;
+}
+
+/** \brief True if the outfix or small write engine \a nfa can be run by
+ * @ref hs_scan_scratchless(), which only drives block-mode DFAs. */
+static really_inline
+char scratchlessNfa(const struct NFA *nfa) {
+    return nfa->type == MCCLELLAN_NFA_8 || nfa->type == MCCLELLAN_NFA_16 ||
+           nfa->type == SHENG_NFA;
+}
+
+static really_inline
+char scratchlessCapable(const struct RoseEngine *rose) {
+    if (!rose->scratchless || rose->mode != HS_MODE_BLOCK) {
+        return 0;
+    }
+
+    if (rose->smallWriteOffset &&
+        !scratchlessNfa(getSmwrNfa(getSmallWrite(rose)))) {
+        return 0;
+    }
+
+    if (rose->runtimeImpl == ROSE_RUNTIME_SINGLE_OUTFIX) {
+        return scratchlessNfa(getNfaByQueue(rose, 0));
+    }
+
+    return rose->runtimeImpl == ROSE_RUNTIME_PURE_LITERAL;
+}
+
+#define SL_PROGRAM_CASE(name)                                                  \
+    case ROSE_INSTR_##name: {                                                  \
+        DEBUG_PRINTF("sl_instruction: " #name "\n");                           \
+        const struct ROSE_STRUCT_##name *ri =                                  \
+            (const struct ROSE_STRUCT_##name *)pc;
+
+#define SL_PROGRAM_NEXT_INSTRUCTION                                            \
+    pc += ROUNDUP_N(sizeof(*ri), ROSE_INSTR_MIN_ALIGN);                        \
+    break;                                                                     \
+    }
+
+#define SL_PROGRAM_NEXT_INSTRUCTION_JUMP continue;
+
+/**
+ * \brief Run a report program for a scratchless scan.
+ *
+ * Only the instructions accepted by the compiler for scratchless engines are
+ * handled here; they need nothing beyond the core info and exhaustion vector
+ * held in the stack scratch.
+ */
+static really_inline
+int scratchlessRunProgram(const struct RoseEngine *rose,
+                          struct hs_scratch *scratch, u32 programOffset,
+                          u64a end) {
+    assert(programOffset >= sizeof(struct RoseEngine));
+    assert(programOffset < rose->size);
+
+    struct core_info *ci = &scratch->core_info;
+    const char *pc = getByOffset(rose, programOffset);
+
+    for (;;) {
+        assert(ISALIGNED_N(pc, ROSE_INSTR_MIN_ALIGN));
+        const u8 code = *(const u8 *)pc;
+
+        switch (code) {
+            SL_PROGRAM_CASE(END) {
+                return MO_CONTINUE_MATCHING;
+            }
+            SL_PROGRAM_NEXT_INSTRUCTION
+
+            SL_PROGRAM_CASE(CHECK_LIT_EARLY) {
+                if (end < ri->min_offset) {
+                    pc += ri->fail_jump;
+                    SL_PROGRAM_NEXT_INSTRUCTION_JUMP
+                }
+            }
+            SL_PROGRAM_NEXT_INSTRUCTION
+
+            SL_PROGRAM_CASE(CHECK_GROUPS) {
+                // Groups are never squashed in a scratchless engine.
+                if (!(ri->groups & rose->initialGroups)) {
+                    return MO_CONTINUE_MATCHING;
+                }
+            }
+            SL_PROGRAM_NEXT_INSTRUCTION
+
+            SL_PROGRAM_CASE(CHECK_BOUNDS) {
+                if (end < ri->min_bound || end > ri->max_bound) {
+                    pc += ri->fail_jump;
+                    SL_PROGRAM_NEXT_INSTRUCTION_JUMP
+                }
+            }
+            SL_PROGRAM_NEXT_INSTRUCTION
+
+            SL_PROGRAM_CASE(CHECK_EXHAUSTED) {
+                if (isExhausted(rose, ci->exhaustionVector, ri->ekey)) {
+                    pc += ri->fail_jump;
+                    SL_PROGRAM_NEXT_INSTRUCTION_JUMP
+                }
+            }
+            SL_PROGRAM_NEXT_INSTRUCTION
+
+            SL_PROGRAM_CASE(REPORT) {
+                if (roseDeliverReport(end, ri->onmatch, ri->offset_adjust,
+                                      scratch, INVALID_EKEY)
+                    == MO_HALT_MATCHING) {
+                    return MO_HALT_MATCHING;
+                }
+            }
+            SL_PROGRAM_NEXT_INSTRUCTION
+
+            SL_PROGRAM_CASE(REPORT_EXHAUST) {
+                if (roseDeliverReport(end, ri->onmatch, ri->offset_adjust,
+                                      scratch, ri->ekey) == MO_HALT_MATCHING) {
+                    return MO_HALT_MATCHING;
+                }
+                if (isAllExhausted(rose, ci->exhaustionVector)) {
+                    ci->status |= STATUS_EXHAUSTED;
+                    return MO_HALT_MATCHING;
+                }
+            }
+            SL_PROGRAM_NEXT_INSTRUCTION
+
+            SL_PROGRAM_CASE(FINAL_REPORT) {
+                return roseDeliverReport(end, ri->onmatch, ri->offset_adjust,
+                                         scratch, INVALID_EKEY)
+                               == MO_HALT_MATCHING
+                           ? MO_HALT_MATCHING
+                           : MO_CONTINUE_MATCHING;
+            }
+            SL_PROGRAM_NEXT_INSTRUCTION
+
+        default:
+            assert(0); // rejected at compile time
+            ci->status |= STATUS_ERROR;
+            return MO_HALT_MATCHING;
+        }
+    }
+}
+
+#undef SL_PROGRAM_CASE
+#undef SL_PROGRAM_NEXT_INSTRUCTION
+#undef SL_PROGRAM_NEXT_INSTRUCTION_JUMP
+
+static
+hwlmcb_rv_t scratchlessLiteralCallback(size_t end, u32 id,
+                                       struct hs_scratch *scratch) {
+    const struct RoseEngine *rose = scratch->core_info.rose;
+    DEBUG_PRINTF("id=%u end=%zu\n", id, end);
+
+    // Literal matcher offsets are inclusive of the final byte.
+    if (scratchlessRunProgram(rose, scratch, id, (u64a)end + 1)
+        == MO_HALT_MATCHING) {
+        return HWLM_TERMINATE_MATCHING;
+    }
+    return rose->initialGroups;
+}
+
+static
+int scratchlessNfaCallback(UNUSED u64a start, u64a end, ReportID id,
+                           void *context) {
+    struct hs_scratch *scratch = context;
+    DEBUG_PRINTF("id=%u end=%llu\n", id, end);
+
+    // Our match ID is the program offset.
+    return scratchlessRunProgram(scratch->core_info.rose, scratch, id, end);
+}
+
+static really_inline
+void scratchlessDfaExec(const struct NFA *nfa, u64a offset, const u8 *buf,
+                        size_t len, struct hs_scratch *scratch) {
+    assert(scratchlessNfa(nfa));
+    if (nfa->type == MCCLELLAN_NFA_8) {
+        nfaExecMcClellan8_B(nfa, offset, buf, len, scratchlessNfaCallback,
+                            scratch);
+    } else if (nfa->type == MCCLELLAN_NFA_16) {
+        nfaExecMcClellan16_B(nfa, offset, buf, len, scratchlessNfaCallback,
+                             scratch);
+    } else {
+        nfaExecSheng_B(nfa, offset, buf, len, scratchlessNfaCallback,
+                       scratch);
+    }
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_database_capabilities(const hs_database_t *db,
+                                             unsigned long long *caps) {
+    if (unlikely(!caps)) {
+        return HS_INVALID;
+    }
+
+    *caps = 0;
+
+    hs_error_t err = validDatabase(db);
+    if (unlikely(err != HS_SUCCESS)) {
+        return err;
+    }
+
+    const struct RoseEngine *rose = hs_get_bytecode(db);
+    if (unlikely(!ISALIGNED_16(rose))) {
+        return HS_INVALID;
+    }
+
+    if (scratchlessCapable(rose)) {
+        *caps |= HS_DB_CAP_SCRATCHLESS;
+    }
+
+    return HS_SUCCESS;
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_scan_scratchless(const hs_database_t *db,
+                                        const char *data, unsigned length,
+                                        UNUSED unsigned flags,
+                                        match_event_handler onEvent,
+                                        void *userCtx) {
+    if (unlikely(!data)) {
+        return HS_INVALID;
+    }
+
+    hs_error_t err = validDatabase(db);
+    if (unlikely(err != HS_SUCCESS)) {
+        return err;
+    }
+
+    const struct RoseEngine *rose = hs_get_bytecode(db);
+    if (unlikely(!ISALIGNED_16(rose))) {
+        return HS_INVALID;
+    }
+
+    if (unlikely(!scratchlessCapable(rose))) {
+        return HS_DB_MODE_ERROR;
+    }
+
+    if (rose->minWidth > length || !length) {
+        DEBUG_PRINTF("minwidth=%u > length=%u\n", rose->minWidth, length);
+        return HS_SUCCESS;
+    }
+
+    if (rose->maxBiAnchoredWidth != ROSE_BOUND_INF
+        && length > rose->maxBiAnchoredWidth) {
+        DEBUG_PRINTF("block len=%u longer than maxBAWidth=%u\n", length,
+                     rose->maxBiAnchoredWidth);
+        return HS_SUCCESS;
+    }
+
+    /* Only the core info and the FDR confirm fields of this scratch are used;
+     * none of its (absent) heap regions are touched. It is zeroed so that any
+     * optional facility (tracing, profiling, work limits) reads as off. */
+    struct hs_scratch scratch;
+    u8 evec[ROSE_SCRATCHLESS_MAX_EKEYS / 8];
+    assert(rose->ekeyCount <= ROSE_SCRATCHLESS_MAX_EKEYS);
+
+    memset(&scratch, 0, sizeof(scratch));
+    scratch.magic = SCRATCH_MAGIC;
+    scratch.work_limit = ~0ULL;
+    scratch.core_info.userContext = userCtx;
+    scratch.core_info.userCallback = onEvent ? onEvent : null_onEvent;
+    scratch.core_info.rose = rose;
+    scratch.core_info.exhaustionVector = (char *)evec;
+    scratch.core_info.buf = (const u8 *)data;
+    scratch.core_info.len = length;
+    if (rose->ekeyCount) {
+        clearEvec(rose, (char *)evec);
+    }
+
+    const u8 *buf = (const u8 *)data;
+
+    if (rose->smallWriteOffset) {
+        const struct SmallWriteEngine *smwr = getSmallWrite(rose);
+        if (length < smwr->largestBuffer) {
+            if (length > smwr->start_offset) {
+                scratchlessDfaExec(getSmwrNfa(smwr), smwr->start_offset,
+                                   buf + smwr->start_offset,
+                                   length - smwr->start_offset, &scratch);
+            }
+            goto done_scan;
+        }
+    }
+
+    if (rose->runtimeImpl == ROSE_RUNTIME_PURE_LITERAL) {
+        hwlmExec(getFLiteralMatcher(rose), buf, length, 0,
+                 scratchlessLiteralCallback, &scratch,
+                 rose->initialGroups & rose->floating_group_mask);
+    } else {
+        assert(rose->runtimeImpl == ROSE_RUNTIME_SINGLE_OUTFIX);
+        scratchlessDfaExec(getNfaByQueue(rose, 0), 0, buf, length, &scratch);
+    }
+
+done_scan:
+    if (unlikely(internal_matching_error(&scratch))) {
+        return HS_UNKNOWN_ERROR;
+    }
+    return told_to_stop_matching(&scratch) ? HS_SCAN_TERMINATED : HS_SUCCESS;
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_find_start_history(const hs_database_t *db,
+                                          unsigned int id,
+                                          unsigned long long *history) {
+    if (unlikely(!history)) {
+        return HS_INVALID;
+    }
+
+    hs_error_t err = validDatabase(db);
+    if (unlikely(err != HS_SUCCESS)) {
+        return err;
+    }
+
+    const struct RoseEngine *rose = hs_get_bytecode(db);
+    if (unlikely(!ISALIGNED_16(rose))) {
+        return HS_INVALID;
+    }
+
+    u64a rv;
+    if (!somOnDemandHistory(rose, id, &rv)) {
+        DEBUG_PRINTF("no on-demand som for id %u\n", id);
+        return HS_INVALID;
+    }
+
+    *history = rv; /* ~0ULL, i.e. HS_OFFSET_PAST_HORIZON, if unbounded */
+    return HS_SUCCESS;
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_find_start(const hs_database_t *db, unsigned int id,
+                                  unsigned long long to, const char *data,
+                                  unsigned int length,
+                                  unsigned long long data_offset,
+                                  unsigned long long *from) {
+    if (unlikely(!from || !data)) {
+        return HS_INVALID;
+    }
+
+    hs_error_t err = validDatabase(db);
+    if (unlikely(err != HS_SUCCESS)) {
+        return err;
+    }
+
+    const struct RoseEngine *rose = hs_get_bytecode(db);
+    if (unlikely(!ISALIGNED_16(rose))) {
+        return HS_INVALID;
+    }
+
+    u64a history;
+    if (!somOnDemandHistory(rose, id, &history)) {
+        DEBUG_PRINTF("no on-demand som for id %u\n", id);
+        return HS_INVALID;
+    }
+
+    // The data must contain the end of the match, and reach back either to
+    // the start of the input or far enough to contain the whole match.
+    if (to < data_offset || to > data_offset + length) {
+        return HS_INVALID;
+    }
+    if (data_offset && to - data_offset < history) {
+        DEBUG_PRINTF("need %llu bytes of history, have %llu\n", history,
+                     to - data_offset);
+        return HS_INVALID;
+    }
+
+    if (!findSomOnDemand(rose, id, to, (const u8 *)data, length, data_offset,
+                         from)) {
+        return HS_INVALID;
+    }
+
+    return HS_SUCCESS;
+}
+
 static really_inline
 void maintainHistoryBuffer(const struct RoseEngine *rose, char *state,
                            const char *buffer, size_t length) {
@@ -528,6 +934,11 @@ void init_stream(struct hs_stream *s, const struct RoseEngine *rose,
     setStreamStatus(state, 0);
     roseInitState(rose, state);
 
+    if (rose->transform) {
+        memset(state + rose->stateOffsets.transform, 0,
+               rose->stateOffsets.transform_size);
+    }
+
     clearEvec(rose, state + rose->stateOffsets.exhausted);
     if (rose->ckeyCount) {
         clearLvec(rose, state + rose->stateOffsets.logicalVec,
@@ -628,6 +1039,30 @@ void soleOutfixEodExec(hs_stream_t *id, hs_scratch_t *scratch) {
                        scratch);
 }
 
+/** \brief Match callback mapping decoded stream offsets back to the user's
+ * input for databases with an input transform. */
+static
+int HS_CDECL transform_onEvent(unsigned int id, unsigned long long from,
+                               unsigned long long to, unsigned int flags,
+                               void *ctx) {
+    const struct transform_info *ti = ctx;
+    u64a end = ti->ostart;
+    if (to > ti->dbase) {
+        u64a i = to - ti->dbase - 1;
+        assert(i < ti->len);
+        end = ti->obase + ti->map[i];
+    }
+    DEBUG_PRINTF("match %u at decoded %llu, input %llu\n", id, to, end);
+    return ti->userCallback(id, from, end, flags, ti->userContext);
+}
+
+static
+hs_error_t scanStreamTransformed(hs_stream_t *id, const char *data,
+                                 unsigned length, unsigned flags,
+                                 hs_scratch_t *scratch,
+                                 match_event_handler onEvent, void *context,
+                                 char final);
+
 static really_inline
 void report_eod_matches(hs_stream_t *id, hs_scratch_t *scratch,
                         match_event_handler onEvent, void *context) {
@@ -643,6 +1078,28 @@ void report_eod_matches(hs_stream_t *id, hs_scratch_t *scratch,
         return;
     }
 
+    if (rose->transform) {
+        /* scan any escape prefix still held back, then report EOD matches at
+         * the end of the user's input */
+        scanStreamTransformed(id, "", 0, 0, scratch, onEvent, context, 1);
+        status = getStreamStatus(state);
+        if (status & (STATUS_TERMINATED | STATUS_EXHAUSTED | STATUS_ERROR)) {
+            DEBUG_PRINTF("stream broken by held-back bytes\n");
+            return;
+        }
+
+        struct transform_state ts;
+        loadTransformState(&ts, state + rose->stateOffsets.transform);
+        struct transform_info *ti = &scratch->transform;
+        ti->userCallback = onEvent;
+        ti->userContext = context;
+        ti->len = 0;
+        ti->dbase = id->offset;
+        ti->ostart = ts.offset;
+        onEvent = transform_onEvent;
+        context = ti;
+    }
+
     populateCoreInfo(scratch, rose, state, onEvent, context, NULL, 0,
                      getHistory(state, rose, id->offset),
                      getHistoryAmount(rose, id->offset), id->offset, status, 0);
@@ -762,6 +1219,7 @@ hs_error_t HS_CDECL hs_reset_and_copy_stream(hs_stream_t *to_id,
         if (unlikely(markScratchInUse(scratch))) {
             return HS_SCRATCH_IN_USE;
         }
+        traceCallBegin(scratch, TRACE_CALL_CLOSE, 0, to_id->offset);
         report_eod_matches(to_id, scratch, onEvent, context);
         if (unlikely(internal_matching_error(scratch))) {
             unmarkScratchInUse(scratch);
@@ -859,7 +1317,10 @@ void soleOutfixStreamExec(struct hs_stream *stream_state,
         pushQueueAt(q, 1, MQE_END, scratch->core_info.len);
     }
 
-    if (nfaQueueExec(q->nfa, q, scratch->core_info.len)) {
+    traceQueueExec(scratch, q);
+    char alive = nfaQueueExec(q->nfa, q, scratch->core_info.len);
+    traceQueueExecEnd(scratch, q, alive);
+    if (alive) {
         nfaQueueCompressState(nfa, q, scratch->core_info.len);
     } else if (!told_to_stop_matching(scratch)) {
         scratch->core_info.status |= STATUS_EXHAUSTED;
@@ -887,7 +1348,8 @@ hs_error_t hs_scan_stream_internal(hs_stream_t *id, const char *data,
         if (status & STATUS_ERROR) {
             return HS_UNKNOWN_ERROR;
         } else if (status & STATUS_TERMINATED) {
-            return HS_SCAN_TERMINATED;
+            return (status & STATUS_WORK_EXCEEDED) ? HS_SCAN_WORK_EXCEEDED
+                                                   : HS_SCAN_TERMINATED;
         } else {
             return HS_SUCCESS;
         }
@@ -930,7 +1392,7 @@ hs_error_t hs_scan_stream_internal(hs_stream_t *id, const char *data,
             DEBUG_PRINTF("halting scan\n");
             setStreamStatus(state, scratch->core_info.status);
             if (told_to_stop_matching(scratch)) {
-                return HS_SCAN_TERMINATED;
+                return scanTerminatedError(scratch);
             } else {
                 assert(scratch->core_info.status & STATUS_EXHAUSTED);
                 return HS_SUCCESS;
@@ -970,12 +1432,106 @@ hs_error_t hs_scan_stream_internal(hs_stream_t *id, const char *data,
             storeSomToStream(scratch, id->offset);
         }
     } else if (told_to_stop_matching(scratch)) {
-        return HS_SCAN_TERMINATED;
+        return scanTerminatedError(scratch);
     }
 
     return HS_SUCCESS;
 }
 
+/**
+ * \brief Scan user data through the input transform of the stream's database.
+ *
+ * The data is decoded a chunk at a time into scratch, and each chunk scanned
+ * as a stream write while it is still in cache. An escape sequence split by
+ * the end of the data is held back in stream state for the next write, unless
+ * \a final is set.
+ */
+static
+hs_error_t scanStreamTransformed(hs_stream_t *id, const char *data,
+                                 unsigned length, unsigned flags,
+                                 hs_scratch_t *scratch,
+                                 match_event_handler onEvent, void *context,
+                                 char final) {
+    const struct RoseEngine *rose = id->rose;
+    char *tstate = getMultiState(id) + rose->stateOffsets.transform;
+    struct transform_state ts;
+    loadTransformState(&ts, tstate);
+
+    struct transform_info *ti = &scratch->transform;
+    ti->userCallback = onEvent;
+    ti->userContext = context;
+    ti->map = scratch->transform_map;
+    match_event_handler cb = onEvent ? transform_onEvent : NULL;
+
+    /* we decode the held-back bytes followed by the new data; positions are
+     * relative to the first held-back byte */
+    const u8 *in = (const u8 *)data;
+    const size_t plen = ts.pending_len;
+    const size_t total = plen + length;
+    const u64a obase = ts.offset - plen;
+    size_t pos = 0;
+
+    while (pos < total) {
+        size_t used;
+        u32 n;
+        if (pos < plen) {
+            /* complete the held-back escape with the head of the data */
+            u8 tmp[2 * TRANSFORM_MAX_PENDING];
+            size_t tlen = plen - pos;
+            size_t extra = MIN(length, TRANSFORM_MAX_PENDING);
+            memcpy(tmp, ts.pending + pos, tlen);
+            memcpy(tmp + tlen, in, extra);
+            tlen += extra;
+            n = transformDecode(rose->transform, tmp, tlen,
+                                final && tlen == total - pos,
+                                scratch->transform_buf, scratch->transform_map,
+                                scratch->transformSize, &used);
+        } else {
+            n = transformDecode(rose->transform, in + (pos - plen),
+                                total - pos, final, scratch->transform_buf,
+                                scratch->transform_map, scratch->transformSize,
+                                &used);
+        }
+
+        if (!used) {
+            DEBUG_PRINTF("holding back %zu bytes\n", total - pos);
+            break;
+        }
+
+        ti->len = n;
+        ti->dbase = id->offset;
+        ti->obase = obase + pos;
+        ti->ostart = obase + pos;
+        pos += used;
+
+        if (!n) {
+            continue;
+        }
+
+        hs_error_t ret = hs_scan_stream_internal(id,
+                                                 (const char *)scratch->transform_buf,
+                                                 n, flags, scratch, cb, ti);
+        if (ret != HS_SUCCESS) {
+            return ret;
+        }
+
+        if (getStreamStatus(getMultiState(id)) & STATUS_EXHAUSTED) {
+            DEBUG_PRINTF("stream exhausted\n");
+            return HS_SUCCESS;
+        }
+    }
+
+    assert(total - pos <= TRANSFORM_MAX_PENDING);
+    ts.pending_len = (u8)(total - pos);
+    for (u32 i = 0; i < ts.pending_len; i++, pos++) {
+        ts.pending[i] = pos < plen ? ts.pending[pos] : in[pos - plen];
+    }
+    ts.offset = obase + total;
+    storeTransformState(tstate, &ts);
+
+    return HS_SUCCESS;
+}
+
 HS_PUBLIC_API
 hs_error_t HS_CDECL hs_scan_stream(hs_stream_t *id, const char *data,
                                    unsigned length, unsigned flags,
@@ -989,8 +1545,17 @@ hs_error_t HS_CDECL hs_scan_stream(hs_stream_t *id, const char *data,
     if (unlikely(markScratchInUse(scratch))) {
         return HS_SCRATCH_IN_USE;
     }
-    hs_error_t rv = hs_scan_stream_internal(id, data, length, flags, scratch,
-                                            onEvent, context);
+    traceCallBegin(scratch, TRACE_CALL_STREAM, length, id->offset);
+    HS_PROBE3(stream__scan__start, id, id->offset, length);
+    hs_error_t rv;
+    if (id->rose->transform) {
+        rv = scanStreamTransformed(id, data, length, flags, scratch, onEvent,
+                                   context, 0);
+    } else {
+        rv = hs_scan_stream_internal(id, data, length, flags, scratch, onEvent,
+                                     context);
+    }
+    HS_PROBE3(stream__scan__done, id, id->offset, rv);
     unmarkScratchInUse(scratch);
     return rv;
 }
@@ -1010,6 +1575,7 @@ hs_error_t HS_CDECL hs_close_stream(hs_stream_t *id, hs_scratch_t *scratch,
         if (unlikely(markScratchInUse(scratch))) {
             return HS_SCRATCH_IN_USE;
         }
+        traceCallBegin(scratch, TRACE_CALL_CLOSE, 0, id->offset);
         report_eod_matches(id, scratch, onEvent, context);
         if (unlikely(internal_matching_error(scratch))) {
             unmarkScratchInUse(scratch);
@@ -1039,6 +1605,7 @@ hs_error_t HS_CDECL hs_reset_stream(hs_stream_t *id, UNUSED unsigned int flags,
         if (unlikely(markScratchInUse(scratch))) {
             return HS_SCRATCH_IN_USE;
         }
+        traceCallBegin(scratch, TRACE_CALL_CLOSE, 0, id->offset);
         report_eod_matches(id, scratch, onEvent, context);
         if (unlikely(internal_matching_error(scratch))) {
             unmarkScratchInUse(scratch);
@@ -1101,14 +1668,11 @@ void dumpData(const char *data, size_t len) {
 }
 #endif
 
-HS_PUBLIC_API
-hs_error_t HS_CDECL hs_scan_vector(const hs_database_t *db,
-                                   const char * const * data,
-                                   const unsigned int *length,
-                                   unsigned int count,
-                                   UNUSED unsigned int flags,
-                                   hs_scratch_t *scratch,
-                                   match_event_handler onEvent, void *context) {
+static really_inline
+hs_error_t scanVector(const hs_database_t *db, const char * const * data,
+                      const unsigned int *length, unsigned int count,
+                      hs_scratch_t *scratch, match_event_handler onEvent,
+                      void *context) {
     if (unlikely(!scratch || !data || !length)) {
         return HS_INVALID;
     }
@@ -1134,6 +1698,7 @@ hs_error_t HS_CDECL hs_scan_vector(const hs_database_t *db,
     if (unlikely(markScratchInUse(scratch))) {
         return HS_SCRATCH_IN_USE;
     }
+    traceCallBegin(scratch, TRACE_CALL_VECTOR, count, 0);
 
     hs_stream_t *id = (hs_stream_t *)(scratch->bstate);
 
@@ -1163,7 +1728,7 @@ hs_error_t HS_CDECL hs_scan_vector(const hs_database_t *db,
             return HS_UNKNOWN_ERROR;
         } else if (told_to_stop_matching(scratch)) {
             unmarkScratchInUse(scratch);
-            return HS_SCAN_TERMINATED;
+            return scanTerminatedError(scratch);
         }
     }
 
@@ -1172,6 +1737,213 @@ hs_error_t HS_CDECL hs_scan_vector(const hs_database_t *db,
     return HS_SUCCESS;
 }
 
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_scan_vector(const hs_database_t *db,
+                                   const char * const * data,
+                                   const unsigned int *length,
+                                   unsigned int count,
+                                   UNUSED unsigned int flags,
+                                   hs_scratch_t *scratch,
+                                   match_event_handler onEvent, void *context) {
+    HS_PROBE2(vector__scan__start, db, count);
+    hs_error_t rv = scanVector(db, data, length, count, scratch, onEvent,
+                               context);
+    HS_PROBE2(vector__scan__done, db, rv);
+    return rv;
+}
+
+/** \brief With a match budget, the number of bytes scanned between checks of
+ * the match count. */
+#define RESUME_MATCH_CHECK_INTERVAL 4096
+
+struct resume_count_ctx {
+    match_event_handler onEvent;
+    void *context;
+    u32 matches;
+};
+
+static
+int HS_CDECL resume_count_cb(unsigned int id, unsigned long long from,
+                             unsigned long long to, unsigned int flags,
+                             void *ctx) {
+    struct resume_count_ctx *rc = ctx;
+    rc->matches++;
+    return rc->onEvent(id, from, to, flags, rc->context);
+}
+
+/**
+ * \brief Continue the resumable scan held in scratch, scanning at most
+ * \a max_bytes bytes, or stopping at the next check after \a max_matches
+ * matches (zero for no limit).
+ */
+static
+hs_error_t resumeScanInternal(hs_scratch_t *scratch, unsigned int max_bytes,
+                              unsigned int max_matches,
+                              match_event_handler onEvent, void *context) {
+    struct resume_info *ri = &scratch->resume;
+    hs_stream_t *id = (hs_stream_t *)scratch->rstate;
+    assert(ri->rose && id->rose == ri->rose);
+
+    u32 budget = ri->length - ri->scanned;
+    if (max_bytes) {
+        budget = MIN(budget, max_bytes);
+    }
+
+    match_event_handler cb = onEvent;
+    void *cb_ctx = context;
+    struct resume_count_ctx rc;
+    u32 step = budget;
+    if (max_matches && onEvent) {
+        rc.onEvent = onEvent;
+        rc.context = context;
+        rc.matches = 0;
+        cb = resume_count_cb;
+        cb_ctx = &rc;
+        step = RESUME_MATCH_CHECK_INTERVAL;
+    }
+
+    while (budget) {
+        u32 len = MIN(step, budget);
+        hs_error_t ret;
+        if (ri->rose->transform) {
+            ret = scanStreamTransformed(id, ri->data + ri->scanned, len,
+                                        ri->flags, scratch, cb, cb_ctx, 0);
+        } else {
+            ret = hs_scan_stream_internal(id, ri->data + ri->scanned, len,
+                                          ri->flags, scratch, cb, cb_ctx);
+        }
+        if (ret != HS_SUCCESS) {
+            ri->rose = NULL;
+            return ret;
+        }
+
+        ri->scanned += len;
+        budget -= len;
+
+        if (getStreamStatus(getMultiState(id)) & STATUS_EXHAUSTED) {
+            DEBUG_PRINTF("stream exhausted at %u\n", ri->scanned);
+            ri->scanned = ri->length;
+            break;
+        }
+
+        if (cb_ctx == &rc && rc.matches >= max_matches) {
+            DEBUG_PRINTF("match budget used up at %u\n", ri->scanned);
+            break;
+        }
+    }
+
+    if (ri->scanned < ri->length) {
+        DEBUG_PRINTF("suspending at %u/%u\n", ri->scanned, ri->length);
+        return HS_SCAN_SUSPENDED;
+    }
+
+    /* the end of the block: close stream */
+    ri->rose = NULL;
+    if (onEvent) {
+        report_eod_matches(id, scratch, onEvent, context);
+
+        if (unlikely(internal_matching_error(scratch))) {
+            return HS_UNKNOWN_ERROR;
+        } else if (told_to_stop_matching(scratch)) {
+            return scanTerminatedError(scratch);
+        }
+    }
+
+    return HS_SUCCESS;
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_scan_resumable(const hs_database_t *db,
+                                      const char *data, unsigned int length,
+                                      unsigned int flags,
+                                      unsigned int max_bytes,
+                                      unsigned int max_matches,
+                                      hs_scratch_t *scratch,
+                                      match_event_handler onEvent,
+                                      void *context) {
+    if (unlikely(!scratch || !data)) {
+        return HS_INVALID;
+    }
+
+    hs_error_t err = validDatabase(db);
+    if (unlikely(err != HS_SUCCESS)) {
+        return err;
+    }
+
+    const struct RoseEngine *rose = hs_get_bytecode(db);
+    if (unlikely(!ISALIGNED_16(rose))) {
+        return HS_INVALID;
+    }
+
+    /* Block bytecode cannot be suspended: roseBlockExec() makes separate
+     * whole-buffer passes with its progress held in scratch, and its engines
+     * carry no compressed stream state or history to resume from. */
+    if (unlikely(rose->mode == HS_MODE_BLOCK)) {
+        return HS_DB_MODE_ERROR;
+    }
+
+    if (unlikely(!validScratch(rose, scratch))) {
+        return HS_INVALID;
+    }
+
+    if (unlikely(sizeof(struct hs_stream) + rose->stateOffsets.end
+                 > scratch->rStateSize)) {
+        DEBUG_PRINTF("bad resumable state size\n");
+        return HS_INVALID;
+    }
+
+    if (unlikely(markScratchInUse(scratch))) {
+        return HS_SCRATCH_IN_USE;
+    }
+    traceCallBegin(scratch, TRACE_CALL_BLOCK, length, 0);
+
+    /* any previously suspended scan is abandoned */
+    hs_stream_t *id = (hs_stream_t *)scratch->rstate;
+    init_stream(id, rose, 1); /* open stream */
+
+    struct resume_info *ri = &scratch->resume;
+    ri->rose = rose;
+    ri->data = data;
+    ri->length = length;
+    ri->scanned = 0;
+    ri->flags = flags;
+
+    hs_error_t ret = resumeScanInternal(scratch, max_bytes, max_matches,
+                                        onEvent, context);
+    unmarkScratchInUse(scratch);
+    return ret;
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_resume_scan(hs_scratch_t *scratch,
+                                   unsigned int max_bytes,
+                                   unsigned int max_matches,
+                                   match_event_handler onEvent,
+                                   void *context) {
+    if (unlikely(!scratch || !ISALIGNED_CL(scratch)
+                 || scratch->magic != SCRATCH_MAGIC)) {
+        return HS_INVALID;
+    }
+
+    if (unlikely(markScratchInUse(scratch))) {
+        return HS_SCRATCH_IN_USE;
+    }
+
+    if (unlikely(!scratch->resume.rose)) {
+        DEBUG_PRINTF("no suspended scan\n");
+        unmarkScratchInUse(scratch);
+        return HS_INVALID;
+    }
+    traceCallBegin(scratch, TRACE_CALL_BLOCK,
+                   scratch->resume.length - scratch->resume.scanned,
+                   scratch->resume.scanned);
+
+    hs_error_t ret = resumeScanInternal(scratch, max_bytes, max_matches,
+                                        onEvent, context);
+    unmarkScratchInUse(scratch);
+    return ret;
+}
+
 HS_PUBLIC_API
 hs_error_t HS_CDECL hs_compress_stream(const hs_stream_t *stream, char *buf,
                                        size_t buf_space, size_t *used_space) {
@@ -1258,6 +2030,7 @@ hs_error_t HS_CDECL hs_reset_and_expand_stream(hs_stream_t *to_stream,
         if (unlikely(markScratchInUse(scratch))) {
             return HS_SCRATCH_IN_USE;
         }
+        traceCallBegin(scratch, TRACE_CALL_CLOSE, 0, to_stream->offset);
         report_eod_matches(to_stream, scratch, onEvent, context);
         if (unlikely(internal_matching_error(scratch))) {
             unmarkScratchInUse(scratch);
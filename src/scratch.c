@@ -38,11 +38,13 @@
 #include "hs_runtime.h"
 #include "scratch.h"
 #include "state.h"
+#include "transform.h"
 #include "ue2common.h"
 #include "database.h"
 #include "nfa/nfa_api_queue.h"
 #include "rose/rose_internal.h"
 #include "util/fatbit.h"
+#include "util/timestamp.h"
 
 /**
  * Determine the space required for a correctly aligned array of fatbit
@@ -79,6 +81,8 @@ hs_error_t alloc_scratch(const hs_scratch_t *proto, hs_scratch_t **scratch) {
     u32 bStateSize = proto->bStateSize;
     u32 tStateSize = proto->tStateSize;
     u32 fullStateSize = proto->fullStateSize;
+    u32 rStateSize = proto->rStateSize;
+    u32 transformSize = proto->transformSize;
     u32 anchored_literal_region_len = proto->anchored_literal_region_len;
     u32 anchored_literal_fatbit_size = proto->anchored_literal_fatbit_size;
 
@@ -103,6 +107,8 @@ hs_error_t alloc_scratch(const hs_scratch_t *proto, hs_scratch_t **scratch) {
     size_t size = queue_size + 63
                   + bStateSize + tStateSize
                   + fullStateSize + 63 /* cacheline padding */
+                  + rStateSize + 7
+                  + transformSize * (sizeof(u32) + 1) + 3
                   + proto->handledKeyFatbitSize /* handled roles */
                   + activeQueueArraySize /* active queue array */
                   + 2 * deduperLogSize /* need odd and even logs */
@@ -137,6 +143,11 @@ hs_error_t alloc_scratch(const hs_scratch_t *proto, hs_scratch_t **scratch) {
     s->scratchSize = alloc_size;
     s->scratch_alloc = (char *)s_tmp;
     s->fdr_conf = NULL;
+    memset(&s->resume, 0, sizeof(s->resume)); /* not carried over */
+    s->trace = NULL; /* nor is the trace buffer */
+    s->trace_call = 0;
+    s->profile = NULL; /* or profile table */
+    s->profile_rose = NULL;
 
     // each of these is at an offset from the previous
     char *current = (char *)s + sizeof(*s);
@@ -227,6 +238,18 @@ hs_error_t alloc_scratch(const hs_scratch_t *proto, hs_scratch_t **scratch) {
     s->fullStateSize = fullStateSize;
     current += fullStateSize;
 
+    current = ROUNDUP_PTR(current, 8);
+    s->rstate = (char *)current;
+    s->rStateSize = rStateSize;
+    current += rStateSize;
+
+    current = ROUNDUP_PTR(current, alignof(u32));
+    s->transform_map = (u32 *)current;
+    current += transformSize * sizeof(u32);
+    s->transform_buf = (u8 *)current;
+    s->transformSize = transformSize;
+    current += transformSize;
+
     *scratch = s;
 
     // Don't get too big for your boots
@@ -356,6 +379,24 @@ hs_error_t HS_CDECL hs_alloc_scratch(const hs_database_t *db,
         proto->bStateSize = bStateSize;
     }
 
+    /* resumable block scans keep a full stream state (inc header) */
+    u32 rStateSize = 0;
+    if (rose->mode != HS_MODE_BLOCK) {
+        rStateSize = sizeof(struct hs_stream) + rose->stateOffsets.end;
+    }
+
+    if (rStateSize > proto->rStateSize) {
+        resize = 1;
+        proto->rStateSize = rStateSize;
+    }
+
+    /* databases with a runtime input transform decode into scratch */
+    u32 transformSize = rose->transform ? TRANSFORM_CHUNK_SIZE : 0;
+    if (transformSize > proto->transformSize) {
+        resize = 1;
+        proto->transformSize = transformSize;
+    }
+
     u32 fullStateSize = rose->scratchStateSize;
     if (fullStateSize > proto->fullStateSize) {
         resize = 1;
@@ -441,3 +482,192 @@ hs_error_t HS_CDECL hs_scratch_size(const hs_scratch_t *scratch, size_t *size) {
 
     return HS_SUCCESS;
 }
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_set_scratch_work_limit(hs_scratch_t *scratch,
+                                              unsigned long long limit,
+                                              unsigned int action) {
+    if (!scratch || !ISALIGNED_CL(scratch) ||
+        scratch->magic != SCRATCH_MAGIC) {
+        return HS_INVALID;
+    }
+
+    if (action != HS_WORK_ACTION_ABORT && action != HS_WORK_ACTION_FLAG) {
+        return HS_INVALID;
+    }
+
+    if (scratch->in_use) {
+        return HS_SCRATCH_IN_USE;
+    }
+
+    scratch->work_budget = limit;
+    scratch->work_action = action == HS_WORK_ACTION_FLAG ? WORK_ACTION_FLAG
+                                                         : WORK_ACTION_ABORT;
+    return HS_SUCCESS;
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_scratch_work(const hs_scratch_t *scratch,
+                                    unsigned long long *work, int *exceeded) {
+    if (!work || !scratch || !ISALIGNED_CL(scratch) ||
+        scratch->magic != SCRATCH_MAGIC) {
+        return HS_INVALID;
+    }
+
+    if (scratch->in_use) {
+        return HS_SCRATCH_IN_USE;
+    }
+
+    *work = scratch->work;
+    if (exceeded) {
+        *exceeded = scratch->work_exceeded;
+    }
+    return HS_SUCCESS;
+}
+
+#if defined(HS_TRACE)
+void traceRecord(struct trace_header *trace, u8 type, u16 aux, u32 id,
+                 u64a offset) {
+    if (unlikely(trace->count == trace->capacity)) {
+        trace->dropped++;
+        return;
+    }
+
+    struct trace_record *rec = (struct trace_record *)(trace + 1) +
+                               trace->count++;
+    rec->ticks = timestamp_ticks();
+    rec->offset = offset;
+    rec->id = id;
+    rec->aux = aux;
+    rec->type = type;
+    rec->reserved = 0;
+}
+#endif
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_set_scratch_trace(hs_scratch_t *scratch, void *buf,
+                                         size_t len) {
+    if (!scratch || !ISALIGNED_CL(scratch) ||
+        scratch->magic != SCRATCH_MAGIC) {
+        return HS_INVALID;
+    }
+
+    if (scratch->in_use) {
+        return HS_SCRATCH_IN_USE;
+    }
+
+#if defined(HS_TRACE)
+    /* Sample the clocks again so that readers can scale ticks to time. */
+    if (scratch->trace) {
+        scratch->trace->end_ns = timestamp_ns();
+        scratch->trace->end_ticks = timestamp_ticks();
+    }
+#endif
+
+    if (!buf) {
+        scratch->trace = NULL;
+        return HS_SUCCESS;
+    }
+
+#if defined(HS_TRACE)
+    if (!ISALIGNED_N(buf, 8)) {
+        return HS_BAD_ALIGN;
+    }
+
+    if (len < sizeof(struct trace_header)) {
+        return HS_INVALID;
+    }
+
+    struct trace_header *trace = buf;
+    memset(trace, 0, sizeof(*trace));
+    trace->magic = TRACE_MAGIC;
+    trace->version = TRACE_VERSION;
+    trace->record_size = sizeof(struct trace_record);
+    trace->capacity = (len - sizeof(*trace)) / sizeof(struct trace_record);
+    trace->base_ns = timestamp_ns();
+    trace->base_ticks = timestamp_ticks();
+    trace->end_ns = trace->base_ns;
+    trace->end_ticks = trace->base_ticks;
+    scratch->trace = trace;
+    scratch->trace_call = 0;
+    return HS_SUCCESS;
+#else
+    (void)len;
+    return HS_INVALID;
+#endif
+}
+
+HS_PUBLIC_API
+hs_error_t HS_CDECL hs_scratch_trace_size(const hs_scratch_t *scratch,
+                                          size_t *size) {
+    if (!size || !scratch || !ISALIGNED_CL(scratch) ||
+        scratch->magic != SCRATCH_MAGIC || !scratch->trace) {
+        return HS_INVALID;
+    }
+
+    if (scratch->in_use) {
+        return HS_SCRATCH_IN_USE;
+    }
+
+    const struct trace_header *trace = scratch->trace;
+    *size = sizeof(*trace) + trace->count * sizeof(struct trace_record);
+    return HS_SUCCESS;
+}
+
+hs_error_t hs_profile_size(const hs_database_t *db, size_t *size) {
+    if (!size) {
+        return HS_INVALID;
+    }
+
+    hs_error_t err = validDatabase(db);
+    if (unlikely(err != HS_SUCCESS)) {
+        return err;
+    }
+
+#if defined(HS_TRACE)
+    const struct RoseEngine *rose = hs_get_bytecode(db);
+    *size = ROUNDUP_N(rose->size, PROFILE_SLOT_BYTES) / PROFILE_SLOT_BYTES *
+            sizeof(struct profile_slot);
+    return HS_SUCCESS;
+#else
+    return HS_INVALID;
+#endif
+}
+
+hs_error_t hs_set_scratch_profile(hs_scratch_t *scratch,
+                                  const hs_database_t *db, void *buf,
+                                  size_t len) {
+    if (!scratch || !ISALIGNED_CL(scratch) ||
+        scratch->magic != SCRATCH_MAGIC) {
+        return HS_INVALID;
+    }
+
+    if (scratch->in_use) {
+        return HS_SCRATCH_IN_USE;
+    }
+
+    if (!buf) {
+        scratch->profile = NULL;
+        scratch->profile_rose = NULL;
+        return HS_SUCCESS;
+    }
+
+    size_t size;
+    hs_error_t err = hs_profile_size(db, &size);
+    if (err != HS_SUCCESS) {
+        return err;
+    }
+
+    if (!ISALIGNED_N(buf, 8)) {
+        return HS_BAD_ALIGN;
+    }
+
+    if (len < size) {
+        return HS_INVALID;
+    }
+
+    memset(buf, 0, size);
+    scratch->profile = buf;
+    scratch->profile_rose = hs_get_bytecode(db);
+    return HS_SUCCESS;
+}
@@ -38,6 +38,7 @@
 
 #include "hs_common.h"
 #include "ue2common.h"
+#include "trace.h"
 #include "rose/rose_types.h"
 
 #ifdef __cplusplus
@@ -87,6 +88,42 @@ struct catchup_pq {
 /** \brief Status flag: Unexpected Rose program error. */
 #define STATUS_ERROR        (1U << 3)
 
+/** \brief Status flag: the scan was halted as its work budget was exceeded.
+ * Always set together with STATUS_TERMINATED. */
+#define STATUS_WORK_EXCEEDED (1U << 4)
+
+/** \brief Work budget action: halt the scan with HS_SCAN_WORK_EXCEEDED. */
+#define WORK_ACTION_ABORT   0
+
+/** \brief Work budget action: record that the budget was exceeded and carry
+ * on scanning. */
+#define WORK_ACTION_FLAG    1
+
+/** \brief Continuation of a suspended resumable block scan; see
+ * hs_scan_resumable(). The stream state itself lives in hs_scratch::rstate. */
+struct resume_info {
+    const struct RoseEngine *rose; /**< engine, or NULL if nothing suspended */
+    const char *data; /**< user buffer being scanned */
+    u32 length; /**< total length of user buffer */
+    u32 scanned; /**< bytes of user buffer already scanned */
+    u32 flags; /**< flags given when the scan was started */
+};
+
+/** \brief Maps match offsets in the decoded chunk being scanned back to the
+ * user's input, for databases with a runtime input transform. */
+struct transform_info {
+    /** \brief user-supplied match callback */
+    int (HS_CDECL *userCallback)(unsigned int id, unsigned long long from,
+                                 unsigned long long to, unsigned int flags,
+                                 void *ctx);
+    void *userContext; /**< user-supplied context */
+    const u32 *map; /**< per decoded byte, its end in the input from obase */
+    u32 len; /**< number of decoded bytes in the chunk */
+    u64a dbase; /**< decoded stream offset of the chunk */
+    u64a obase; /**< user input offset that map entries are relative to */
+    u64a ostart; /**< user input offset reported for matches at dbase */
+};
+
 /** \brief Core information about the current scan, used everywhere. */
 struct core_info {
     void *userContext; /**< user-supplied context */
@@ -177,10 +214,17 @@ struct ALIGN_CL_DIRECTIVE hs_scratch {
     u32 bStateSize; /**< sizeof block mode states */
     u32 tStateSize; /**< sizeof transient rose states */
     u32 fullStateSize; /**< size of uncompressed nfa state */
+    u32 rStateSize; /**< size of resumable scan stream state */
+    u32 transformSize; /**< decoded chunk size for input transforms, or zero */
     struct RoseContext tctxt;
     char *bstate; /**< block mode states */
     char *tstate; /**< state for transient roses */
     char *fullState; /**< uncompressed NFA state */
+    char *rstate; /**< stream (inc header) for a suspended resumable scan */
+    struct resume_info resume;
+    u8 *transform_buf; /**< decoded chunk for input transforms */
+    u32 *transform_map; /**< input offset map for transform_buf */
+    struct transform_info transform;
     struct mq *queues;
     struct fatbit *aqa; /**< active queue array; fatbit of queues that are valid
                          * & active */
@@ -211,6 +255,21 @@ struct ALIGN_CL_DIRECTIVE hs_scratch {
     u64a *fdr_conf; /**< FDR confirm value */
     u8 fdr_conf_offset; /**< offset where FDR/Teddy front end matches
                          * in buffer */
+    u64a work; /**< internal work done by the current (or last) API call;
+                * only counted while work_budget is set */
+    u64a work_limit; /**< work at which the budget action is taken; ~0ULL if
+                      * unlimited or already taken */
+    u64a work_budget; /**< per-call work budget; zero for no limit */
+    u8 work_action; /**< one of the WORK_ACTION_ values above */
+    u8 work_exceeded; /**< non-zero if the last call exceeded the budget */
+    struct trace_header *trace; /**< trace buffer set with
+                                 * hs_set_scratch_trace(), or NULL */
+    u8 trace_call; /**< non-zero if TRACE_CALL_BEGIN has been recorded for
+                    * the current API call */
+    struct profile_slot *profile; /**< profile table set with
+                                   * hs_set_scratch_profile(), or NULL */
+    const struct RoseEngine *profile_rose; /**< bytecode the profile table
+                                            * was sized for */
 };
 
 /* array of fatbit ptr; TODO: why not an array of fatbits? */
@@ -254,9 +313,135 @@ char markScratchInUse(struct hs_scratch *scratch) {
         return 1;
     }
     scratch->in_use = 1;
+    scratch->work = 0;
+    scratch->work_limit = scratch->work_budget ? scratch->work_budget : ~0ULL;
+    scratch->work_exceeded = 0;
     return 0;
 }
 
+/**
+ * \brief Take the configured action when the work budget is exceeded.
+ *
+ * Returns non-zero if the scan has been halted.
+ */
+static really_inline
+char scratchWorkExceeded(struct hs_scratch *scratch) {
+    DEBUG_PRINTF("work budget %llu exceeded\n", scratch->work_budget);
+    scratch->work_limit = ~0ULL; /* act only once per call */
+    scratch->work_exceeded = 1;
+    if (scratch->work_action == WORK_ACTION_FLAG) {
+        return 0;
+    }
+    scratch->core_info.status |= STATUS_TERMINATED | STATUS_WORK_EXCEEDED;
+    return 1;
+}
+
+/**
+ * \brief Account for \a amount units of internal work (literal confirms,
+ * Rose program runs, engine queue events) against the work budget.
+ *
+ * Work is only counted while a budget is set, so that unlimited scans pay a
+ * single predictable branch here rather than a read-modify-write.
+ *
+ * Returns non-zero if the scan has been halted as a result.
+ */
+static really_inline
+char scratchAddWork(struct hs_scratch *scratch, u32 amount) {
+    if (likely(!scratch->work_budget)) {
+        return 0;
+    }
+    scratch->work += amount;
+    if (likely(scratch->work <= scratch->work_limit)) {
+        return 0;
+    }
+    return scratchWorkExceeded(scratch);
+}
+
+#if defined(HS_TRACE)
+/** \brief Append an event to a trace buffer; out of line, as it is only
+ * called with tracing enabled. */
+void traceRecord(struct trace_header *trace, u8 type, u16 aux, u32 id,
+                 u64a offset);
+#endif
+
+/**
+ * \brief Record a trace event if a trace buffer is attached to the scratch.
+ *
+ * Compiles away entirely unless the library is built with BUILD_TRACE.
+ */
+static really_inline
+void traceEvent(struct hs_scratch *scratch, u8 type, u16 aux, u32 id,
+                u64a offset) {
+#if defined(HS_TRACE)
+    if (unlikely(scratch->trace != NULL)) {
+        traceRecord(scratch->trace, type, aux, id, offset);
+    }
+#else
+    (void)scratch;
+    (void)type;
+    (void)aux;
+    (void)id;
+    (void)offset;
+#endif
+}
+
+/**
+ * \brief Record the start of a traced API call, which must have marked the
+ * scratch as in use. The matching TRACE_CALL_END is recorded by
+ * unmarkScratchInUse().
+ */
+static really_inline
+void traceCallBegin(struct hs_scratch *scratch, u16 call, u32 length,
+                    u64a offset) {
+#if defined(HS_TRACE)
+    if (unlikely(scratch->trace != NULL)) {
+        traceRecord(scratch->trace, TRACE_CALL_BEGIN, call, length, offset);
+        scratch->trace_call = 1;
+    }
+#else
+    (void)scratch;
+    (void)call;
+    (void)length;
+    (void)offset;
+#endif
+}
+
+/** \brief Returns the profile slot for the given program, or NULL if no
+ * profile table is attached for the bytecode being scanned. */
+static really_inline
+struct profile_slot *profileSlot(struct hs_scratch *scratch, u32 offset) {
+#if defined(HS_TRACE)
+    if (likely(scratch->profile == NULL) ||
+        scratch->core_info.rose != scratch->profile_rose) {
+        return NULL;
+    }
+    return scratch->profile + offset / PROFILE_SLOT_BYTES;
+#else
+    (void)scratch;
+    (void)offset;
+    return NULL;
+#endif
+}
+
+/** \brief Count a literal match delivered to the program at the given
+ * offset, if profiling. */
+static really_inline
+void profileLiteral(struct hs_scratch *scratch, u32 programOffset) {
+    struct profile_slot *slot = profileSlot(scratch, programOffset);
+    if (slot) {
+        slot->literal_hits++;
+    }
+}
+
+/** \brief Count a run of the program at the given offset, if profiling. */
+static really_inline
+void profileProgram(struct hs_scratch *scratch, u32 programOffset) {
+    struct profile_slot *slot = profileSlot(scratch, programOffset);
+    if (slot) {
+        slot->program_runs++;
+    }
+}
+
 /**
  * \brief Mark scratch as no longer in use.
  */
@@ -265,6 +450,12 @@ void unmarkScratchInUse(struct hs_scratch *scratch) {
     DEBUG_PRINTF("marking scratch as not in use\n");
     assert(scratch && scratch->magic == SCRATCH_MAGIC);
     assert(scratch->in_use == 1);
+#if defined(HS_TRACE)
+    if (scratch->trace_call) {
+        scratch->trace_call = 0;
+        traceEvent(scratch, TRACE_CALL_END, scratch->core_info.status, 0, 0);
+    }
+#endif
     scratch->in_use = 0;
 }
 
@@ -251,4 +251,9 @@ u32 SomSlotManager::addRevNfa(bytecode_ptr<NFA> nfa, u32 maxWidth) {
     return rv;
 }
 
+void SomSlotManager::addOnDemandNfa(u32 id, s32 adjust, bool eod,
+                                    bytecode_ptr<NFA> nfa) {
+    ondemand_nfas.emplace_back(id, adjust, eod, move(nfa));
+}
+
 } // namespace ue2
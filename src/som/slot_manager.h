@@ -52,6 +52,19 @@ class NGHolder;
 struct Grey;
 struct SlotCache;
 
+/** \brief A reverse NFA used to compute the start of a match on demand
+ * (HS_FLAG_SOM_ON_DEMAND). */
+struct SomOnDemandNfa {
+    SomOnDemandNfa(u32 id_in, s32 adjust_in, bool eod_in,
+                   bytecode_ptr<NFA> nfa_in)
+        : id(id_in), adjust(adjust_in), eod(eod_in), nfa(std::move(nfa_in)) {}
+
+    u32 id; //!< external (user) report ID
+    s32 adjust; //!< offset adjustment of the report this NFA was built for
+    bool eod; //!< only for matches at the end of the data
+    bytecode_ptr<NFA> nfa;
+};
+
 /** \brief SOM slot manager. Used to hand out SOM slots and track their
  * relationships during SOM construction. Also stores reverse NFAs used for
  * SOM. */
@@ -85,6 +98,12 @@ public:
 
     u32 addRevNfa(bytecode_ptr<NFA> nfa, u32 maxWidth);
 
+    const std::deque<SomOnDemandNfa> &getOnDemandNfas() const {
+        return ondemand_nfas;
+    }
+
+    void addOnDemandNfa(u32 id, s32 adjust, bool eod, bytecode_ptr<NFA> nfa);
+
     u32 somHistoryRequired() const { return historyRequired; }
 
     u32 somPrecision() const { return precision; }
@@ -100,6 +119,10 @@ private:
     /** \brief Reverse NFAs used for SOM support. */
     std::deque<bytecode_ptr<NFA>> rev_nfas;
 
+    /** \brief Reverse NFAs used for on-demand SOM. These don't commit us to
+     * any history: the caller supplies the data. */
+    std::deque<SomOnDemandNfa> ondemand_nfas;
+
     /** \brief In streaming mode, the amount of history we've committed to
      * using for SOM rev NFAs. */
     u32 historyRequired;
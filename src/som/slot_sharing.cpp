@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * \brief SOM slot sharing: liveness analysis and colouring of SOM slots.
+ *
+ * A SOM slot is written by the internal SOM_LOC reports and read by
+ * EXTERNAL_CALLBACK_SOM_STORED reports and by the source side of
+ * INTERNAL_SOM_LOC_COPY*. A slot is live if its value can reach an external
+ * callback, either directly or through a chain of copies into live slots.
+ *
+ * Each slot is given a lifetime: the range of stream offsets from the
+ * earliest report that can touch it to the latest, taken from the report
+ * offset bounds (so only slots whose reports are bounded, e.g. by max_offset
+ * or an anchored prefix, get a finite lifetime). Two slots interfere unless
+ * one's lifetime ends strictly before the other's begins, and even then the
+ * later slot may only reuse the storage if it is dead or every write to it is
+ * unconditional: the earlier occupant leaves its valid/writable bits behind,
+ * which would defeat the IF_UNSET and IF_WRITABLE write variants. Dead slots
+ * are never observed, so they never interfere with each other.
+ *
+ * The interference graph is coloured greedily in slot order.
+ */
+
+#include "slot_sharing.h"
+
+#include "slot_manager.h"
+#include "util/report.h"
+#include "util/report_manager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+
+using namespace std;
+
+namespace ue2 {
+
+static
+vector<bool> findLiveSlots(const ReportManager &rm, u32 num_slots) {
+    vector<bool> live(num_slots, false);
+
+    // copy_sources[out] is the set of slots copied into slot out.
+    vector<vector<u32>> copy_sources(num_slots);
+    deque<u32> work;
+
+    for (const auto &ir : rm.reports()) {
+        switch (ir.type) {
+        case INTERNAL_SOM_LOC_COPY:
+        case INTERNAL_SOM_LOC_COPY_IF_WRITABLE:
+            if (ir.onmatch < num_slots && ir.somDistance < num_slots) {
+                copy_sources[ir.onmatch].push_back((u32)ir.somDistance);
+            }
+            break;
+        case EXTERNAL_CALLBACK_SOM_STORED:
+            if (ir.somDistance < num_slots && !live[ir.somDistance]) {
+                live[ir.somDistance] = true;
+                work.push_back((u32)ir.somDistance);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    while (!work.empty()) {
+        u32 slot = work.front();
+        work.pop_front();
+        for (u32 src : copy_sources[slot]) {
+            if (!live[src]) {
+                DEBUG_PRINTF("slot %u live via copy into %u\n", src, slot);
+                live[src] = true;
+                work.push_back(src);
+            }
+        }
+    }
+
+    return live;
+}
+
+namespace {
+
+/** \brief Offset range over which a slot may hold a value. */
+struct SlotLifetime {
+    u64a first = MAX_OFFSET;
+    u64a last = 0;
+    bool touched = false;
+
+    /** True if every write to this slot ignores its valid/writable bits. */
+    bool fresh_writes = true;
+
+    void add(const Report &ir) {
+        // Widen by the offset adjustment, as the bounds apply to the
+        // adjusted match offset rather than the offset the engine fires at.
+        u64a adj = ir.offsetAdjust < 0 ? (u64a)(-(s64a)ir.offsetAdjust)
+                                       : (u64a)ir.offsetAdjust;
+        first = min(first, ir.minOffset > adj ? ir.minOffset - adj : 0);
+        last = max(last, ir.maxOffset >= MAX_OFFSET - adj ? MAX_OFFSET
+                                                          : ir.maxOffset + adj);
+        touched = true;
+    }
+
+    /** True if this lifetime ends before \a b begins. */
+    bool before(const SlotLifetime &b) const {
+        return last != MAX_OFFSET && last < b.first;
+    }
+};
+
+} // namespace
+
+static
+bool isUnconditionalWrite(ReportType type) {
+    switch (type) {
+    case INTERNAL_SOM_LOC_SET:
+    case INTERNAL_SOM_LOC_SET_SOM_REV_NFA:
+    case INTERNAL_SOM_LOC_SET_FROM:
+    case INTERNAL_SOM_LOC_COPY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static
+vector<SlotLifetime> findLifetimes(const ReportManager &rm, u32 num_slots) {
+    vector<SlotLifetime> life(num_slots);
+
+    for (const auto &ir : rm.reports()) {
+        switch (ir.type) {
+        case INTERNAL_SOM_LOC_COPY:
+        case INTERNAL_SOM_LOC_COPY_IF_WRITABLE:
+        case EXTERNAL_CALLBACK_SOM_STORED:
+            // somDistance is the slot read from.
+            if (ir.somDistance < num_slots) {
+                life[ir.somDistance].add(ir);
+            }
+            break;
+        default:
+            break;
+        }
+
+        switch (ir.type) {
+        case INTERNAL_SOM_LOC_COPY:
+        case INTERNAL_SOM_LOC_COPY_IF_WRITABLE:
+        case INTERNAL_SOM_LOC_SET:
+        case INTERNAL_SOM_LOC_SET_IF_UNSET:
+        case INTERNAL_SOM_LOC_SET_IF_WRITABLE:
+        case INTERNAL_SOM_LOC_SET_SOM_REV_NFA:
+        case INTERNAL_SOM_LOC_SET_SOM_REV_NFA_IF_UNSET:
+        case INTERNAL_SOM_LOC_SET_SOM_REV_NFA_IF_WRITABLE:
+        case INTERNAL_SOM_LOC_MAKE_WRITABLE:
+        case INTERNAL_SOM_LOC_SET_FROM:
+        case INTERNAL_SOM_LOC_SET_FROM_IF_WRITABLE:
+            if (ir.onmatch < num_slots) {
+                life[ir.onmatch].add(ir);
+                if (!isUnconditionalWrite(ir.type)) {
+                    life[ir.onmatch].fresh_writes = false;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return life;
+}
+
+static
+bool interferes(u32 a, u32 b, const vector<bool> &live,
+                const vector<SlotLifetime> &life) {
+    if (!live[a] && !live[b]) {
+        return false;
+    }
+
+    // A slot that nothing refers to can go anywhere.
+    if (!life[a].touched || !life[b].touched) {
+        return false;
+    }
+
+    // The slot that takes over the storage must not depend on the bits left
+    // behind by the earlier one.
+    auto can_follow = [&](u32 later) {
+        return !live[later] || life[later].fresh_writes;
+    };
+
+    if (life[a].before(life[b]) && can_follow(b)) {
+        return false;
+    }
+    if (life[b].before(life[a]) && can_follow(a)) {
+        return false;
+    }
+    return true;
+}
+
+vector<u32> colourSomSlots(const ReportManager &rm, u32 num_slots) {
+    const auto live = findLiveSlots(rm, num_slots);
+    const auto life = findLifetimes(rm, num_slots);
+
+    vector<u32> colour(num_slots);
+    vector<vector<u32>> members; // slots holding each colour
+
+    for (u32 i = 0; i < num_slots; i++) {
+        DEBUG_PRINTF("slot %u: %s, lifetime [%llu,%llu]\n", i,
+                     live[i] ? "live" : "dead", life[i].first, life[i].last);
+        u32 c = 0;
+        for (; c < members.size(); c++) {
+            if (none_of(members[c].begin(), members[c].end(), [&](u32 j) {
+                    return interferes(i, j, live, life);
+                })) {
+                break;
+            }
+        }
+        if (c == members.size()) {
+            members.emplace_back();
+        }
+        members[c].push_back(i);
+        colour[i] = c;
+    }
+
+    return colour;
+}
+
+u32 shareSomSlots(ReportManager &rm, SomSlotManager &ssm) {
+    const u32 num_slots = ssm.numSomSlots();
+    if (num_slots <= 1) {
+        return 0;
+    }
+
+    const auto colour = colourSomSlots(rm, num_slots);
+    u32 num_colours = 0;
+    for (u32 c : colour) {
+        num_colours = max(num_colours, c + 1);
+    }
+    assert(num_colours <= num_slots);
+
+    if (num_colours == num_slots) {
+        DEBUG_PRINTF("no sharing possible over %u slots\n", num_slots);
+        return 0;
+    }
+
+    DEBUG_PRINTF("sharing %u slots as %u\n", num_slots, num_colours);
+    rm.remapSomSlots(colour);
+    ssm.rollbackSomTo(num_colours);
+    return num_slots - num_colours;
+}
+
+} // namespace ue2
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * \brief SOM slot sharing: liveness analysis and colouring of SOM slots.
+ */
+
+#ifndef SLOT_SHARING_H
+#define SLOT_SHARING_H
+
+#include "ue2common.h"
+
+#include <vector>
+
+namespace ue2 {
+
+class ReportManager;
+class SomSlotManager;
+
+/**
+ * \brief Compute a colouring of the SOM slots referenced by the reports in
+ * \a rm, such that slots with interfering lifetimes receive distinct colours.
+ *
+ * Returns a map from slot to colour, of size \a num_slots. Colours are handed
+ * out in slot order, so the identity map is returned if nothing can share.
+ */
+std::vector<u32> colourSomSlots(const ReportManager &rm, u32 num_slots);
+
+/**
+ * \brief Shrink the SOM slot space by colouring the slots, rewriting the
+ * reports in \a rm to use the shared slots.
+ *
+ * Must be called once all SOM construction is complete, before Rose
+ * bytecode is built. Returns the number of slots saved.
+ */
+u32 shareSomSlots(ReportManager &rm, SomSlotManager &ssm);
+
+} // namespace ue2
+
+#endif // SLOT_SHARING_H
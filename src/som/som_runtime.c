@@ -484,6 +484,7 @@ int clearSomLog(struct hs_scratch *scratch, u64a offset, struct fatbit *log,
              it != MMB_INVALID; it = fatbit_iterate(log, dkeyCount, it)) {
         u64a from_offset = starts[it];
         u32 onmatch = dkey_to_report[it];
+        traceEvent(scratch, TRACE_REPORT, 0, onmatch, offset);
         int halt = ci->userCallback(onmatch, from_offset, offset, flags,
                                     ci->userContext);
         if (halt) {
@@ -533,3 +534,117 @@ int flushStoredSomMatches_i(struct hs_scratch *scratch, u64a offset) {
 
     return halt;
 }
+
+/** \brief Returns the on-demand SOM NFA entries for the given external ID,
+ * setting *count to the number found. */
+static
+const struct RoseSomOnDemand *getSomOnDemand(const struct RoseEngine *t,
+                                             u32 id, u32 *count) {
+    *count = 0;
+    if (!t->somOnDemandCount) {
+        return NULL;
+    }
+
+    const struct RoseSomOnDemand *table = (const struct RoseSomOnDemand *)
+        ((const char *)t + t->somOnDemandOffset);
+
+    // Lower bound: entries are sorted by id.
+    u32 lo = 0, hi = t->somOnDemandCount;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2;
+        if (table[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    u32 end = lo;
+    while (end < t->somOnDemandCount && table[end].id == id) {
+        end++;
+    }
+    *count = end - lo;
+    return table + lo;
+}
+
+static
+int somOnDemandCallback(UNUSED u64a start, u64a end, ReportID id, void *ctx) {
+    // As for the SOM rev NFAs, the id holds the adjustment for virtual
+    // starts.
+    assert(id <= 1);
+    u64a *from_offset = ctx;
+    LIMIT_TO_AT_MOST(from_offset, end + id);
+    return 1; // continue matching.
+}
+
+char somOnDemandHistory(const struct RoseEngine *t, u32 id, u64a *history) {
+    u32 count;
+    const struct RoseSomOnDemand *entries = getSomOnDemand(t, id, &count);
+    if (!count) {
+        return 0;
+    }
+
+    u64a rv = 0;
+    for (u32 i = 0; i < count; i++) {
+        const struct NFA *nfa = (const struct NFA *)
+            ((const char *)t + entries[i].nfaOffset);
+        if (!nfa->maxWidth) {
+            rv = ~0ULL; // unbounded
+            break;
+        }
+        rv = MAX(rv, nfa->maxWidth);
+    }
+
+    *history = rv;
+    return 1;
+}
+
+char findSomOnDemand(const struct RoseEngine *t, u32 id, u64a to,
+                     const u8 *data, size_t len, u64a offset, u64a *from) {
+    assert(to >= offset && to <= offset + len);
+
+    u32 count;
+    const struct RoseSomOnDemand *entries = getSomOnDemand(t, id, &count);
+
+    u64a best = ~0ULL;
+    for (u32 i = 0; i < count; i++) {
+        const struct RoseSomOnDemand *e = &entries[i];
+        if (e->eod && to != offset + len) {
+            continue;
+        }
+
+        // The reverse NFA runs back from the end of its own report, which
+        // may differ from the reported offset.
+        s64a end = (s64a)to - e->adjust;
+        if (end <= (s64a)offset || end > (s64a)(offset + len)) {
+            continue;
+        }
+
+        const struct NFA *nfa = (const struct NFA *)
+            ((const char *)t + e->nfaOffset);
+        assert(ISALIGNED_CL(nfa));
+
+        const u8 *buf = data;
+        size_t buf_bytes = (u64a)end - offset;
+        if (buf_bytes < nfa->minWidth) {
+            continue;
+        }
+        if (nfa->maxWidth && buf_bytes > nfa->maxWidth) {
+            buf += buf_bytes - nfa->maxWidth;
+            buf_bytes = nfa->maxWidth;
+        }
+
+        DEBUG_PRINTF("id %u: rev nfa %u from %lld over %zu bytes\n", id, i,
+                     end, buf_bytes);
+        nfaBlockExecReverse(nfa, end, buf, buf_bytes, NULL, 0,
+                            somOnDemandCallback, &best);
+    }
+
+    if (best > to) {
+        DEBUG_PRINTF("no start found\n");
+        return 0;
+    }
+
+    *from = best;
+    return 1;
+}
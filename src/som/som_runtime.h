@@ -39,6 +39,7 @@
 #include "scratch.h"
 #include "ue2common.h"
 
+struct RoseEngine;
 struct som_operation;
 
 void handleSomInternal(struct hs_scratch *scratch,
@@ -63,5 +64,16 @@ int flushStoredSomMatches(struct hs_scratch *scratch, u64a offset) {
     }
 }
 
+/** \brief Sets *history to the number of bytes before the end of a match of
+ * the given external ID that may be needed to find its start on demand (~0ULL
+ * if unbounded). Returns 0 if the ID has no on-demand SOM support. */
+char somOnDemandHistory(const struct RoseEngine *t, u32 id, u64a *history);
+
+/** \brief Finds the leftmost start of a match of the given external ID that
+ * ends at \a to, scanning the block \a data (of length \a len, starting at
+ * stream offset \a offset) backwards. Returns 0 if there is no such match. */
+char findSomOnDemand(const struct RoseEngine *t, u32 id, u64a to,
+                     const u8 *data, size_t len, u64a offset, u64a *from);
+
 #endif // SOM_RUNTIME_H
 
@@ -132,6 +132,8 @@ size_t JOIN(sc_, FN_SUFFIX)(const struct RoseEngine *rose,
 
     COPY(stream_body + so->longLitState, so->longLitState_size);
 
+    COPY(stream_body + so->transform, so->transform_size);
+
     /* Leftlag table will be handled later, for active leftfixes */
 
     /* anchored table state is not required once we are deep in the stream */
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Scan trace and profile formats, shared by the runtime recorder and
+ * the tools that read them.
+ *
+ * A trace is a flat buffer: a trace_header followed by fixed-size
+ * trace_record entries in the order the events happened. The buffer is
+ * supplied by the caller with hs_set_scratch_trace() and may be written to a
+ * file as is; hs_scratch_trace_size() gives the number of bytes in use.
+ *
+ * Records are stamped with timestamp_ticks(), which is the time stamp counter
+ * where available. The header holds tick and wall-clock samples taken when
+ * the buffer was attached and when its size was last queried, so readers can
+ * convert ticks to nanoseconds by scaling between the two.
+ *
+ * A profile is a table of profile_slot counters indexed by Rose program
+ * offset, attached with hs_set_scratch_profile() from hs_internal.h. Unlike a
+ * trace it never fills up, so it suits long benchmark runs.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "ue2common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define TRACE_MAGIC     0x52545348U /* "HSTR" */
+#define TRACE_VERSION   2
+
+/** \brief Trace event types. The meaning of the id, aux and offset fields of a
+ * trace_record depends on the type, as documented here. */
+enum TraceEventType {
+    /** Start of an API call. id: bytes passed in, or the number of blocks
+     * for a vectored scan; aux: one of the TRACE_CALL_ values; offset: stream
+     * offset before the call. */
+    TRACE_CALL_BEGIN = 1,
+
+    /** End of an API call. aux: the STATUS_ flags from scratch.h, showing
+     * whether the scan was terminated, exhausted or over its work budget. */
+    TRACE_CALL_END = 2,
+
+    /** Literal match from HWLM. id: literal program offset, as in
+     * rose_lit_programs.txt from hsdump; offset: match end. */
+    TRACE_LITERAL = 3,
+
+    /** Rose program run. id: program offset; aux: program flags; offset:
+     * match end. */
+    TRACE_PROGRAM = 4,
+
+    /** Engine queue initialised. id: queue index; aux: NFAEngineType;
+     * offset: queue base offset. */
+    TRACE_QUEUE_INIT = 5,
+
+    /** Engine queue run begins. id: queue index; aux: queued events
+     * (saturating); offset: stream offset of the first queued event. */
+    TRACE_QUEUE_EXEC = 6,
+
+    /** Engine queue run ends. id: queue index; aux: engine still alive. */
+    TRACE_QUEUE_EXEC_END = 7,
+
+    /** Catchup point. aux: TRACE_CATCHUP_ALL or TRACE_CATCHUP_SUF; offset:
+     * location caught up to. */
+    TRACE_CATCHUP = 8,
+
+    /** Match delivered to the user callback. id: pattern id; offset: match
+     * end. */
+    TRACE_REPORT = 9,
+
+    /** Engine queue full, forcing an early run to make room. id: queue
+     * index; offset: location of the event that did not fit. */
+    TRACE_QUEUE_FULL = 10,
+};
+
+/** \brief TRACE_CALL_BEGIN aux values. */
+#define TRACE_CALL_BLOCK    0
+#define TRACE_CALL_STREAM   1
+#define TRACE_CALL_VECTOR   2
+#define TRACE_CALL_CLOSE    3
+
+/** \brief TRACE_CATCHUP aux values. */
+#define TRACE_CATCHUP_ALL   0
+#define TRACE_CATCHUP_SUF   1
+
+/** \brief Header at the start of a trace buffer. */
+struct trace_header {
+    u32 magic; /**< TRACE_MAGIC */
+    u32 version; /**< TRACE_VERSION */
+    u32 record_size; /**< sizeof(struct trace_record) */
+    u32 reserved;
+    u64a capacity; /**< number of records the buffer can hold */
+    u64a count; /**< number of records written */
+    u64a dropped; /**< events lost once the buffer was full */
+    u64a base_ticks; /**< tick count when the buffer was attached */
+    u64a base_ns; /**< wall-clock ns when the buffer was attached */
+    u64a end_ticks; /**< tick count when the buffer was detached */
+    u64a end_ns; /**< wall-clock ns when the buffer was detached */
+};
+
+/** \brief A single trace event. */
+struct trace_record {
+    u64a ticks; /**< timestamp in ticks; see trace_header for the scale */
+    u64a offset; /**< type-specific offset */
+    u32 id; /**< type-specific identifier */
+    u16 aux; /**< type-specific extra value */
+    u8 type; /**< one of TraceEventType */
+    u8 reserved;
+};
+
+/** \brief Bytecode bytes covered by each profile_slot. Rose programs are
+ * aligned to ROSE_INSTR_MIN_ALIGN, so no two programs share a slot. */
+#define PROFILE_SLOT_BYTES  8U
+
+/** \brief Profile counters for the Rose program at byte offset
+ * (index * PROFILE_SLOT_BYTES) of the bytecode. */
+struct profile_slot {
+    u64a literal_hits; /**< literal matches that ran this program */
+    u64a program_runs; /**< runs of this program, for any reason */
+};
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif // TRACE_H
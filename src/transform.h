@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Runtime input transforms: streaming decode stage.
+ *
+ * Databases compiled with a length-changing HS_MODE_TRANSFORM_ flag have their
+ * input decoded in small chunks into scratch before each chunk is fed to the
+ * engines as a stream write, so that the decoded data is still in cache when
+ * it is scanned. For each decoded byte we record where it ended in the user's
+ * input, so that match offsets can be mapped back.
+ */
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "hs_compile.h" /* for HS_MODE_TRANSFORM_* */
+#include "ue2common.h"
+#include "util/unaligned.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** \brief Number of decoded bytes scanned per stream write. */
+#define TRANSFORM_CHUNK_SIZE 2048
+
+/** \brief Longest prefix of an escape sequence held back between writes. */
+#define TRANSFORM_MAX_PENDING 2
+
+/** \brief Bytes of stream state used by an input transform: the user input
+ * offset (8 bytes), then the held-back byte count and bytes. */
+#define TRANSFORM_STATE_SIZE (sizeof(u64a) + 1 + TRANSFORM_MAX_PENDING)
+
+/** \brief Unpacked input transform stream state. */
+struct transform_state {
+    u64a offset; /**< user input bytes consumed, including pending ones */
+    u8 pending_len; /**< bytes of an incomplete escape held back */
+    u8 pending[TRANSFORM_MAX_PENDING]; /**< the held-back bytes */
+};
+
+static really_inline
+void loadTransformState(struct transform_state *ts, const char *state) {
+    ts->offset = unaligned_load_u64a(state);
+    ts->pending_len = (u8)state[sizeof(u64a)];
+    ts->pending[0] = (u8)state[sizeof(u64a) + 1];
+    ts->pending[1] = (u8)state[sizeof(u64a) + 2];
+}
+
+static really_inline
+void storeTransformState(char *state, const struct transform_state *ts) {
+    unaligned_store_u64a(state, ts->offset);
+    state[sizeof(u64a)] = (char)ts->pending_len;
+    state[sizeof(u64a) + 1] = (char)ts->pending[0];
+    state[sizeof(u64a) + 2] = (char)ts->pending[1];
+}
+
+/** \brief Returns non-zero if (decoded) byte \a c is removed by \a transform. */
+static really_inline
+char transformStrips(u32 transform, u8 c) {
+    if (c == 0) {
+        return !!(transform & HS_MODE_TRANSFORM_STRIP_NUL);
+    }
+    if (c == ' ' || (c >= '\t' && c <= '\r')) {
+        return !!(transform & HS_MODE_TRANSFORM_STRIP_SPACE);
+    }
+    return 0;
+}
+
+/** \brief Value of hexadecimal digit \a c, or -1 if it is not one. */
+static really_inline
+int transformHexValue(u8 c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * \brief Decode input \a in of length \a len into \a out, producing at most
+ * \a out_max bytes.
+ *
+ * For each decoded byte out[i], map[i] is set to the offset in \a in just past
+ * the input it was decoded from. Unless \a final is set, an incomplete escape
+ * sequence at the end of the input is left unconsumed.
+ *
+ * \return the number of decoded bytes; \a consumed is set to the number of
+ * input bytes used.
+ */
+static really_inline
+u32 transformDecode(u32 transform, const u8 *in, size_t len, char final,
+                    u8 *out, u32 *map, u32 out_max, size_t *consumed) {
+    const char percent = !!(transform & HS_MODE_TRANSFORM_PERCENT_DECODE);
+    size_t i = 0;
+    u32 o = 0;
+
+    while (i < len && o < out_max) {
+        u8 c = in[i++];
+        if (percent && c == '%') {
+            size_t avail = len - i;
+            if (avail >= 2) {
+                int hi = transformHexValue(in[i]);
+                int lo = transformHexValue(in[i + 1]);
+                if (hi >= 0 && lo >= 0) {
+                    c = (u8)(hi << 4 | lo);
+                    i += 2;
+                }
+            } else if (!final &&
+                       (!avail || transformHexValue(in[i]) >= 0)) {
+                /* may be completed by the next write */
+                i--;
+                break;
+            }
+        }
+
+        if (transformStrips(transform, c)) {
+            continue;
+        }
+
+        out[o] = c;
+        map[o] = (u32)i;
+        o++;
+    }
+
+    *consumed = i;
+    return o;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRANSFORM_H
@@ -32,6 +32,7 @@
 #include "util/charreach.h"
 #include "util/flat_containers.h"
 
+#include <array>
 #include <utility>
 
 namespace ue2 {
@@ -44,6 +45,14 @@ struct AccelScheme {
     CharReach double_cr;
     u32 offset = MAX_ACCEL_DEPTH + 1;
     u32 double_offset = 0;
+
+    /** \brief Three byte escape strings, if a small enough set exists. */
+    flat_set<std::array<u8, 3>> triple_byte;
+
+    /** \brief Byte pairs \ref gap_len apart which cover every escape, if a
+     * small enough set exists. */
+    flat_set<std::pair<u8, u8>> gap_byte;
+    u32 gap_len = 0;
 };
 
 }
@@ -41,5 +41,10 @@
 #define VECTORSIZE 16
 #endif
 
+/* SVE2 matches a whole 16-character set in one instruction. */
+#if defined(HAVE_SVE2)
+#define HAVE_VERM16
+#endif
+
 #endif // UTIL_ARCH_ARM_H_
 
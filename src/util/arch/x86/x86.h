@@ -79,6 +79,11 @@
 #define VECTORSIZE 16
 #endif
 
+/* The 16-character vermicelli family is built from SuperVector compares. */
+#if defined(HAVE_SIMD_128_BITS)
+#define HAVE_VERM16
+#endif
+
 #if defined(__POPCNT__)
 #define HAVE_POPCOUNT_INSTR
 #endif
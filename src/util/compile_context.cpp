@@ -36,11 +36,12 @@ namespace ue2 {
 
 CompileContext::CompileContext(bool in_isStreaming, bool in_isVectored,
                                const target_t &in_target_info,
-                               const Grey &in_grey)
+                               const Grey &in_grey, u32 in_transform)
     : streaming(in_isStreaming || in_isVectored),
       vectored(in_isVectored),
       target_info(in_target_info),
-      grey(in_grey) {
+      grey(in_grey),
+      transform(in_transform) {
 }
 
 } // namespace ue2
@@ -42,7 +42,8 @@ namespace ue2 {
  * target arch, mode flags, etc. */
 struct CompileContext {
     CompileContext(bool isStreaming, bool isVectored,
-                   const target_t &target_info, const Grey &grey);
+                   const target_t &target_info, const Grey &grey,
+                   u32 transform = 0);
 
     const bool streaming; /* streaming or vectored mode */
     const bool vectored;
@@ -52,6 +53,10 @@ struct CompileContext {
 
     /** \brief Greybox structure, allows tuning of all sorts of behaviour. */
     const Grey grey;
+
+    /** \brief Input transforms (HS_MODE_TRANSFORM_* flags) declared for this
+     * database. */
+    const u32 transform;
 };
 
 } // namespace ue2
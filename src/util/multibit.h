@@ -54,6 +54,7 @@
 #include "ue2common.h"
 #include "bitutils.h"
 #include "partial_store.h"
+#include "simd_utils.h"
 #include "unaligned.h"
 #include "multibit_internal.h"
 
@@ -613,6 +614,56 @@ u32 mmbit_iterate(const u8 *bits, u32 total_bits, u32 it_in) {
     return key;
 }
 
+/** \brief Suggested number of keys to request from \ref mmbit_iterate_batch
+ * at a time. */
+#define MMB_ITER_BATCH 8
+
+/** \brief Batched unbounded iterator. Writes up to \a max_keys of the keys
+ * that are on after \a it_in to \a keys, in ascending order, and returns the
+ * number written.
+ *
+ * Keys that share a bottom-level block are extracted together, so the tree is
+ * only walked once per block rather than once per key. A return value less
+ * than \a max_keys means the iteration is complete; otherwise, continue from
+ * the last key written. The same assumptions about \a it_in apply as for
+ * \ref mmbit_iterate.
+ */
+static really_inline
+u32 mmbit_iterate_batch(const u8 *bits, u32 total_bits, u32 it_in, u32 *keys,
+                        u32 max_keys) {
+    assert(max_keys);
+    u32 n = 0;
+
+    for (u32 key = mmbit_iterate(bits, total_bits, it_in); key != MMB_INVALID;
+         key = mmbit_iterate(bits, total_bits, keys[n - 1])) {
+        keys[n++] = key;
+
+        // Drain the rest of this key's bottom-level block.
+        u32 block_key_min = key & ~MMB_KEY_MASK;
+        MMB_TYPE block;
+        if (mmbit_is_flat_model(total_bits)) {
+            const u8 *block_ptr = bits + (key / MMB_KEY_BITS) * sizeof(MMB_TYPE);
+            block = mmbit_get_flat_block(block_ptr,
+                        MIN(MMB_KEY_BITS, total_bits - block_key_min));
+        } else {
+            const u32 max_level = mmbit_maxlevel(total_bits);
+            block = mmb_load(mmbit_get_level_root_const(bits, max_level) +
+                             (key >> MMB_KEY_SHIFT) * sizeof(MMB_TYPE));
+        }
+        block &= ~mmb_mask_zero_to((key & MMB_KEY_MASK) + 1);
+
+        for (; block && n < max_keys; block &= block - 1) {
+            keys[n++] = block_key_min + mmb_ctz(block);
+        }
+        if (n == max_keys) {
+            break;
+        }
+    }
+
+    assert(n <= max_keys);
+    return n;
+}
+
 /** \brief Specialisation of \ref mmbit_any and \ref mmbit_any_precise for flat
  * models. */
 static really_inline
@@ -621,16 +672,16 @@ char mmbit_any_flat(const u8 *bits, u32 total_bits) {
         return !!mmbit_get_flat_block(bits, total_bits);
     }
 
+    // The flat model is at most 256 bits, so two (possibly overlapping)
+    // loads from either end cover all of it.
     const u8 *end = bits + mmbit_flat_size(total_bits);
-    for (const u8 *last = end - sizeof(MMB_TYPE); bits < last;
-         bits += sizeof(MMB_TYPE)) {
-        if (mmb_load(bits)) {
-            return 1;
-        }
+    if (end - bits > 2 * (ptrdiff_t)sizeof(MMB_TYPE)) {
+        assert(end - bits <= 2 * (ptrdiff_t)sizeof(m128));
+        return !!isnonzero128(or128(loadu128(bits),
+                                    loadu128(end - sizeof(m128))));
     }
 
-    // Overlapping load at the end.
-    return !!mmb_load(end - sizeof(MMB_TYPE));
+    return !!(mmb_load(bits) | mmb_load(end - sizeof(MMB_TYPE)));
 }
 
 /** \brief True if any keys are (or might be) on in the given multibit.
@@ -1333,6 +1384,57 @@ u32 mmbit_sparse_iter_next(const u8 *bits, u32 total_bits, u32 last_key,
     return key;
 }
 
+/** \brief Specialisation of \ref mmbit_sparse_iter_any for flat models. */
+static really_inline
+char mmbit_sparse_iter_any_flat(const u8 *bits, u32 total_bits,
+                                const struct mmbit_sparse_iter *it_root) {
+    if (total_bits <= MMB_KEY_BITS) {
+        return !!(mmbit_get_flat_block(bits, total_bits) & it_root->mask);
+    }
+
+    // Intersect every block named by the root mask with its leaf mask and
+    // test the union once, rather than branching on each block.
+    assert(mmbit_maxlevel(total_bits) == 1);
+    MMB_TYPE any = 0;
+    u32 bit_idx = 0;
+    for (MMB_TYPE root = it_root->mask; root; root &= (root - 1), bit_idx++) {
+        u32 bit = mmb_ctz(root);
+        const struct mmbit_sparse_iter *it = it_root + it_root->val + bit_idx;
+        u32 block_key_min = bit * MMB_KEY_BITS;
+        const u8 *block_ptr = bits + (bit * sizeof(MMB_TYPE));
+        MMB_TYPE block = block_key_min + MMB_KEY_BITS > total_bits
+            ? mmbit_get_flat_block(block_ptr, total_bits - block_key_min)
+            : mmb_load(block_ptr);
+        any |= block & it->mask;
+    }
+
+    return !!any;
+}
+
+/** \brief True if any of the keys in the sparse iterator \a it_root are on.
+ *
+ * Equivalent to comparing \ref mmbit_sparse_iter_begin against MMB_INVALID,
+ * but does not compute the key's index or iterator state for flat models,
+ * where the state is intersected with the iterator in one pass. The state
+ * array \a s is only used (as scratch) for non-flat models.
+ */
+static really_inline
+char mmbit_sparse_iter_any(const u8 *bits, u32 total_bits,
+                           const struct mmbit_sparse_iter *it_root,
+                           struct mmbit_sparse_state *s) {
+    assert(ISALIGNED_N(it_root, alignof(struct mmbit_sparse_iter)));
+    assert(it_root->mask != 0);
+
+    MDEBUG_PRINTF("%p total_bits %u\n", bits, total_bits);
+    if (mmbit_is_flat_model(total_bits)) {
+        return mmbit_sparse_iter_any_flat(bits, total_bits, it_root);
+    }
+
+    u32 idx;
+    return mmbit_sparse_iter_begin(bits, total_bits, &idx, it_root, s) !=
+           MMB_INVALID;
+}
+
 /** \brief Specialisation of \ref mmbit_sparse_iter_unset for flat models. */
 static really_inline
 void mmbit_sparse_iter_unset_flat(u8 *bits, u32 total_bits,
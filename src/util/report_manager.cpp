@@ -81,6 +81,49 @@ size_t ReportManager::numReports() const {
     return reportIds.size();
 }
 
+template<typename T>
+static
+void remapSlot(const vector<u32> &slot_map, T &slot) {
+    if (slot < slot_map.size()) {
+        slot = slot_map[slot];
+    }
+}
+
+void ReportManager::remapSomSlots(const vector<u32> &slot_map) {
+    for (auto &ir : reportIds) {
+        switch (ir.type) {
+        case INTERNAL_SOM_LOC_COPY:
+        case INTERNAL_SOM_LOC_COPY_IF_WRITABLE:
+            remapSlot(slot_map, ir.somDistance); // slot read from
+            remapSlot(slot_map, ir.onmatch);
+            break;
+        case INTERNAL_SOM_LOC_SET:
+        case INTERNAL_SOM_LOC_SET_IF_UNSET:
+        case INTERNAL_SOM_LOC_SET_IF_WRITABLE:
+        case INTERNAL_SOM_LOC_SET_SOM_REV_NFA:
+        case INTERNAL_SOM_LOC_SET_SOM_REV_NFA_IF_UNSET:
+        case INTERNAL_SOM_LOC_SET_SOM_REV_NFA_IF_WRITABLE:
+        case INTERNAL_SOM_LOC_MAKE_WRITABLE:
+        case INTERNAL_SOM_LOC_SET_FROM:
+        case INTERNAL_SOM_LOC_SET_FROM_IF_WRITABLE:
+            remapSlot(slot_map, ir.onmatch);
+            break;
+        case EXTERNAL_CALLBACK_SOM_STORED:
+            remapSlot(slot_map, ir.somDistance);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Reports that used to differ only by slot may now be identical; the
+    // lowest ID keeps its place in the lookup map.
+    reportIdToInternalMap.clear();
+    for (size_t i = 0; i < reportIds.size(); i++) {
+        reportIdToInternalMap.emplace(reportIds[i], i);
+    }
+}
+
 u32 ReportManager::getExhaustibleKey(u32 a) {
     auto it = toExhaustibleKeyMap.find(a);
     if (it == toExhaustibleKeyMap.end()) {
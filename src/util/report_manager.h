@@ -102,6 +102,10 @@ public:
      * structures. */
     const std::vector<Report> &reports() const { return reportIds; }
 
+    /** \brief Rewrite the SOM slot references held by all reports, mapping
+     * slot i to slot_map[i]. Slots outside the map are left untouched. */
+    void remapSomSlots(const std::vector<u32> &slot_map);
+
     /**
      * Get a simple internal report corresponding to the expression. An ekey
      * will be setup if required.
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief Cheap timestamps for the runtime's calibration and tracing paths.
+ */
+
+#ifndef UTIL_TIMESTAMP_H
+#define UTIL_TIMESTAMP_H
+
+#include <time.h>
+
+#include "ue2common.h"
+#include "util/intrinsics.h"
+
+#if (defined(ARCH_IA32) || defined(ARCH_X86_64)) && \
+    (defined(USE_X86INTRIN_H) || defined(USE_INTRIN_H))
+#define HAVE_TIMESTAMP_TSC
+#endif
+
+/** \brief Time in nanoseconds from an arbitrary epoch, or zero if the clock
+ * cannot be read. This is the monotonic clock where the C library offers one
+ * to timespec_get(), and the wall clock otherwise. */
+static really_inline
+u64a timestamp_ns(void) {
+    struct timespec ts;
+#if defined(TIME_MONOTONIC)
+    if (!timespec_get(&ts, TIME_MONOTONIC)) {
+        return 0;
+    }
+#else
+    if (!timespec_get(&ts, TIME_UTC)) {
+        return 0;
+    }
+#endif
+    return (u64a)ts.tv_sec * 1000000000ULL + (u64a)ts.tv_nsec;
+}
+
+/**
+ * \brief Monotonic tick count in platform units: the time stamp counter on
+ * x86, the virtual counter on AArch64 and the time base on POWER, or
+ * nanoseconds from timestamp_ns() elsewhere.
+ *
+ * Ticks are converted to time by sampling timestamp_ns() alongside
+ * timestamp_ticks() at two points and scaling between them. Comparing tick
+ * counts taken on one host needs no conversion.
+ */
+static really_inline
+u64a timestamp_ticks(void) {
+#if defined(HAVE_TIMESTAMP_TSC)
+    return __rdtsc();
+#elif defined(ARCH_AARCH64) && defined(__GNUC__)
+    u64a ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#elif defined(ARCH_PPC64EL) && defined(__GNUC__)
+    return __builtin_ppc_get_timebase();
+#else
+    return timestamp_ns();
+#endif
+}
+
+#endif // UTIL_TIMESTAMP_H
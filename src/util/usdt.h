@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * \brief USDT static probes.
+ *
+ * When built with BUILD_USDT, these expand to SystemTap SDT probes under the
+ * "hyperscan" provider: a single nop in the instruction stream plus a note
+ * describing the arguments, so an unattached probe costs nothing measurable.
+ * Tools such as perf and bpftrace can attach to them in a running process,
+ * e.g. \c usdt:libhs.so:hyperscan:scan__start. Otherwise they compile away and
+ * their arguments are not evaluated.
+ *
+ * Probe names use a double underscore, which tools show as a dash.
+ */
+
+#ifndef UTIL_USDT_H
+#define UTIL_USDT_H
+
+#include "config.h"
+
+#if defined(HS_USDT)
+
+#include <sys/sdt.h>
+
+#define HS_PROBE0(name) DTRACE_PROBE(hyperscan, name)
+#define HS_PROBE1(name, a1) DTRACE_PROBE1(hyperscan, name, a1)
+#define HS_PROBE2(name, a1, a2) DTRACE_PROBE2(hyperscan, name, a1, a2)
+#define HS_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(hyperscan, name, a1, a2, a3)
+#define HS_PROBE4(name, a1, a2, a3, a4)                                        \
+    DTRACE_PROBE4(hyperscan, name, a1, a2, a3, a4)
+
+#else
+
+#define HS_PROBE0(name) do { } while (0)
+#define HS_PROBE1(name, a1) do { } while (0)
+#define HS_PROBE2(name, a1, a2) do { } while (0)
+#define HS_PROBE3(name, a1, a2, a3) do { } while (0)
+#define HS_PROBE4(name, a1, a2, a3, a4) do { } while (0)
+
+#endif
+
+#endif // UTIL_USDT_H
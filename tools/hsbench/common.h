@@ -42,6 +42,7 @@ extern bool forceEditDistance;
 extern unsigned editDistance;
 extern bool printCompressSize;
 extern bool useLiteralApi;
+extern std::string profilePath;
 
 /** Structure for the result of a single complete scan. */
 struct ResultEntry {
@@ -33,3 +33,7 @@ EngineContext::~EngineContext() { }
 EngineStream::~EngineStream() { }
 
 Engine::~Engine() { }
+
+void Engine::printProfile() const { }
+
+void Engine::sqlProfile(SqlDB &, u64a) const { }
@@ -91,6 +91,12 @@ public:
     virtual void printCsvStats() const = 0;
 
     virtual void sqlStats(SqlDB &db) const = 0;
+
+    // profile counts gathered during the benchmark, if profiling; engines
+    // that cannot profile print nothing
+    virtual void printProfile() const;
+
+    virtual void sqlProfile(SqlDB &db, u64a scan_id) const;
 };
 
 #endif // ENGINE_H
@@ -42,9 +42,13 @@
 #include "hs_internal.h"
 #include "hs_runtime.h"
 #include "util/database_util.h"
+#include "util/string_util.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <sstream>
@@ -56,13 +60,47 @@
 
 using namespace std;
 
-EngineHSContext::EngineHSContext(const hs_database_t *db) {
+EngineHSContext::EngineHSContext(const hs_database_t *db,
+                                 ProfileHSCounts *totals)
+    : profile_totals(totals) {
     hs_alloc_scratch(db, &scratch);
     assert(scratch);
+
+    if (!profile_totals) {
+        return;
+    }
+
+    size_t size = 0;
+    hs_error_t err = hs_profile_size(db, &size);
+    if (err == HS_SUCCESS) {
+        profile.resize(size / sizeof(profile_slot));
+        err = hs_set_scratch_profile(scratch, db, profile.data(), size);
+    }
+    if (err != HS_SUCCESS) {
+        printf("Fatal error: unable to profile scans (error %d); was the "
+               "library built with BUILD_TRACE?\n", err);
+        abort();
+    }
 }
 
 EngineHSContext::~EngineHSContext() {
     hs_free_scratch(scratch);
+
+    if (!profile_totals) {
+        return;
+    }
+
+    // Fold this thread's counts into the totals.
+    lock_guard<mutex> guard(profile_totals->lock);
+    auto &programs = profile_totals->programs;
+    programs.resize(max(programs.size(), profile.size()));
+    for (size_t i = 0; i < profile.size(); i++) {
+        programs[i].literal_hits += profile[i].literal_hits;
+        programs[i].program_runs += profile[i].program_runs;
+    }
+    for (const auto &m : pattern_matches) {
+        profile_totals->matches[m.first] += m.second;
+    }
 }
 
 EngineHSStream::~EngineHSStream() { }
@@ -77,6 +115,8 @@ struct ScanHSContext {
     unsigned id;
     ResultEntry &result;
     const EngineStream *stream; // nullptr except in streaming mode.
+    // matches per pattern id; nullptr unless profiling.
+    unordered_map<unsigned int, u64a> *pattern_matches = nullptr;
 };
 
 } // namespace
@@ -105,6 +145,9 @@ int HS_CDECL onMatchEcho(unsigned int id, unsigned long long,
     ScanHSContext *sc = static_cast<ScanHSContext *>(ctx);
     assert(sc);
     sc->result.matches++;
+    if (sc->pattern_matches) {
+        (*sc->pattern_matches)[id]++;
+    }
 
     if (sc->stream) {
         printf("Match @%u:%u:%llu for %u\n", sc->stream->sn, sc->id, to, id);
@@ -115,8 +158,38 @@ int HS_CDECL onMatchEcho(unsigned int id, unsigned long long,
     return 0;
 }
 
-EngineHyperscan::EngineHyperscan(hs_database_t *db_in, CompileHSStats cs)
-    : db(db_in), compile_stats(std::move(cs)) {
+/**
+ * Callback function called for every match that Hyperscan produces when
+ * profiling, counting matches per pattern.
+ */
+static
+int HS_CDECL onMatchProfile(unsigned int id, unsigned long long,
+                            unsigned long long, unsigned int, void *ctx) {
+    ScanHSContext *sc = static_cast<ScanHSContext *>(ctx);
+    assert(sc);
+    assert(sc->pattern_matches);
+    sc->result.matches++;
+    (*sc->pattern_matches)[id]++;
+
+    return 0;
+}
+
+/** Pick the callback for a scan, counting matches per pattern if profiling. */
+static
+match_event_handler pickCallback(EngineHSContext &ctx, ScanHSContext &sc) {
+    if (ctx.profile_totals) {
+        sc.pattern_matches = &ctx.pattern_matches;
+    }
+    if (echo_matches) {
+        return onMatchEcho;
+    }
+    return ctx.profile_totals ? onMatchProfile : onMatch;
+}
+
+EngineHyperscan::EngineHyperscan(hs_database_t *db_in, CompileHSStats cs,
+                                 map<u32, ProfileProgramInfo> profile_map_in)
+    : db(db_in), compile_stats(std::move(cs)),
+      profile_map(std::move(profile_map_in)) {
     assert(db);
 }
 
@@ -125,7 +198,8 @@ EngineHyperscan::~EngineHyperscan() {
 }
 
 unique_ptr<EngineContext> EngineHyperscan::makeContext() const {
-    return std::make_unique<EngineHSContext>(db);
+    return std::make_unique<EngineHSContext>(
+        db, profilePath.empty() ? nullptr : &profile_counts);
 }
 
 void EngineHyperscan::scan(const char *data, unsigned int len, unsigned int id,
@@ -134,7 +208,7 @@ void EngineHyperscan::scan(const char *data, unsigned int len, unsigned int id,
 
     EngineHSContext &ctx = static_cast<EngineHSContext &>(ectx);
     ScanHSContext sc(id, result, nullptr);
-    auto callback = echo_matches ? onMatchEcho : onMatch;
+    auto callback = pickCallback(ctx, sc);
     hs_error_t rv = hs_scan(db, data, len, 0, ctx.scratch, callback, &sc);
 
     if (rv != HS_SUCCESS) {
@@ -152,7 +226,7 @@ void EngineHyperscan::scan_vectored(const char *const *data,
 
     EngineHSContext &ctx = static_cast<EngineHSContext &>(ectx);
     ScanHSContext sc(streamId, result, nullptr);
-    auto callback = echo_matches ? onMatchEcho : onMatch;
+    auto callback = pickCallback(ctx, sc);
     hs_error_t rv =
         hs_scan_vector(db, data, len, count, 0, ctx.scratch, callback, &sc);
 
@@ -186,7 +260,7 @@ void EngineHyperscan::streamClose(unique_ptr<EngineStream> stream,
     EngineHSContext &ctx = static_cast<EngineHSContext &>(ectx);
 
     ScanHSContext sc(0, result, &s);
-    auto callback = echo_matches ? onMatchEcho : onMatch;
+    auto callback = pickCallback(ctx, sc);
 
     assert(s.id);
     hs_close_stream(s.id, ctx.scratch, callback, &sc);
@@ -202,7 +276,7 @@ void EngineHyperscan::streamScan(EngineStream &stream, const char *data,
     EngineHSContext &ctx = *s.ctx;
 
     ScanHSContext sc(id, result, &s);
-    auto callback = echo_matches ? onMatchEcho : onMatch;
+    auto callback = pickCallback(ctx, sc);
     hs_error_t rv =
         hs_scan_stream(s.id, data, len, 0, ctx.scratch, callback, &sc);
 
@@ -289,6 +363,199 @@ void EngineHyperscan::sqlStats(SqlDB &sqldb) const {
                      compile_stats.compileSecs, compile_stats.peakMemorySize);
 }
 
+namespace /* anonymous */ {
+
+/** Profile counts for one Rose program, joined with what the compiler
+ * dumped about it. */
+struct ProgramProfile {
+    u32 offset;
+    u64a literal_hits;
+    u64a program_runs;
+    const ProfileProgramInfo *info; // nullptr if not in the dump
+};
+
+/** Profile counts for one pattern. The literal hits and program runs are
+ * summed over the programs that can lead to a match of the pattern. */
+struct PatternProfile {
+    u64a matches = 0;
+    u64a literal_hits = 0;
+    u64a program_runs = 0;
+};
+
+} // namespace
+
+/** Programs that ran, busiest first. */
+static
+vector<ProgramProfile>
+profilePrograms(const ProfileHSCounts &counts,
+                const map<u32, ProfileProgramInfo> &profile_map) {
+    vector<ProgramProfile> out;
+    for (size_t i = 0; i < counts.programs.size(); i++) {
+        const profile_slot &slot = counts.programs[i];
+        if (!slot.literal_hits && !slot.program_runs) {
+            continue;
+        }
+        u32 offset = i * PROFILE_SLOT_BYTES;
+        auto it = profile_map.find(offset);
+        out.push_back({offset, slot.literal_hits, slot.program_runs,
+                       it == profile_map.end() ? nullptr : &it->second});
+    }
+    stable_sort(out.begin(), out.end(),
+                [](const ProgramProfile &a, const ProgramProfile &b) {
+                    return a.program_runs > b.program_runs;
+                });
+    return out;
+}
+
+static
+map<unsigned int, PatternProfile>
+profilePatterns(const ProfileHSCounts &counts,
+                const vector<ProgramProfile> &programs) {
+    map<unsigned int, PatternProfile> out;
+    for (const auto &m : counts.matches) {
+        out[m.first].matches = m.second;
+    }
+    for (const auto &p : programs) {
+        if (!p.info) {
+            continue;
+        }
+        for (unsigned int id : p.info->pattern_ids) {
+            out[id].literal_hits += p.literal_hits;
+            out[id].program_runs += p.program_runs;
+        }
+    }
+    return out;
+}
+
+static
+string joinLiterals(const ProfileProgramInfo *info, const char *sep) {
+    string out;
+    if (!info) {
+        return out;
+    }
+    for (const auto &lit : info->literals) {
+        if (!out.empty()) {
+            out += sep;
+        }
+        out += lit;
+    }
+    return out;
+}
+
+void EngineHyperscan::printProfile() const {
+    static const size_t max_rows = 20;
+
+    auto programs = profilePrograms(profile_counts, profile_map);
+    auto patterns = profilePatterns(profile_counts, programs);
+
+    printf("Profile (totals over all threads and repeats):\n\n");
+    printf("%10s %14s %14s  %-16s %-16s %s\n", "Program", "Literal hits",
+           "Program runs", "Kind", "Patterns", "Literals");
+    for (size_t i = 0; i < programs.size() && i < max_rows; i++) {
+        const auto &p = programs[i];
+        printf("%10u %14llu %14llu  %-16s %-16s %s\n", p.offset,
+               p.literal_hits, p.program_runs,
+               p.info ? p.info->kinds.c_str() : "",
+               p.info ? p.info->patterns.c_str() : "",
+               joinLiterals(p.info, " | ").c_str());
+    }
+    printf("\n");
+
+    vector<pair<unsigned int, PatternProfile>> by_runs(patterns.begin(),
+                                                       patterns.end());
+    stable_sort(by_runs.begin(), by_runs.end(),
+                [](const pair<unsigned int, PatternProfile> &a,
+                   const pair<unsigned int, PatternProfile> &b) {
+                    return a.second.program_runs > b.second.program_runs;
+                });
+    printf("%10s %14s %14s %14s\n", "Pattern", "Matches", "Literal hits",
+           "Program runs");
+    for (size_t i = 0; i < by_runs.size() && i < max_rows; i++) {
+        const auto &p = by_runs[i];
+        printf("%10u %14llu %14llu %14llu\n", p.first, p.second.matches,
+               p.second.literal_hits, p.second.program_runs);
+    }
+    printf("\n");
+}
+
+void EngineHyperscan::sqlProfile(SqlDB &sqldb, u64a scan_id) const {
+    // The profile tables may be missing from databases made by older
+    // versions of hsbench, so create them here rather than in initDB().
+    sqldb.exec("CREATE TABLE IF NOT EXISTS ProfileProgram ("
+                   "id INTEGER PRIMARY KEY, scan_id INTEGER, "
+                   "program INTEGER, kind TEXT, literalHits INTEGER, "
+                   "programRuns INTEGER, patterns TEXT, literals TEXT);"
+               "CREATE TABLE IF NOT EXISTS ProfilePattern ("
+                   "id INTEGER PRIMARY KEY, scan_id INTEGER, "
+                   "pattern INTEGER, matches INTEGER, literalHits INTEGER, "
+                   "programRuns INTEGER);");
+
+    auto programs = profilePrograms(profile_counts, profile_map);
+    auto patterns = profilePatterns(profile_counts, programs);
+
+    static const std::string QP =
+        "INSERT INTO ProfileProgram (scan_id, program, kind, literalHits, "
+            "programRuns, patterns, literals) "
+        "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)";
+
+    for (const auto &p : programs) {
+        sqldb.insert_all(QP, scan_id, p.offset,
+                         p.info ? p.info->kinds : string(), p.literal_hits,
+                         p.program_runs, p.info ? p.info->patterns : string(),
+                         joinLiterals(p.info, "\t"));
+    }
+
+    static const std::string QR =
+        "INSERT INTO ProfilePattern (scan_id, pattern, matches, literalHits, "
+            "programRuns) "
+        "VALUES (?1, ?2, ?3, ?4, ?5)";
+
+    for (const auto &p : patterns) {
+        sqldb.insert_all(QR, scan_id, p.first, p.second.matches,
+                         p.second.literal_hits, p.second.program_runs);
+    }
+}
+
+/**
+ * Read the program map the compiler dumps as rose_profile_map.txt: one line
+ * per program, holding the program offset, its kinds, the ids of the
+ * patterns it can lead to and then its literals, separated by tabs.
+ */
+static
+map<u32, ProfileProgramInfo> loadProfileMap(const string &filename) {
+    map<u32, ProfileProgramInfo> programs;
+    ifstream is(filename);
+    string line;
+    while (getline(is, line)) {
+        vector<string> cols;
+        istringstream ls(line);
+        string col;
+        while (getline(ls, col, '\t')) {
+            cols.push_back(col);
+        }
+
+        u32 offset;
+        if (cols.size() < 2 || !fromString(cols[0], offset)) {
+            continue;
+        }
+
+        ProfileProgramInfo &info = programs[offset];
+        info.kinds = cols[1];
+        if (cols.size() > 2) {
+            info.patterns = cols[2];
+            istringstream ps(cols[2]);
+            unsigned int id;
+            char comma;
+            while (ps >> id) {
+                info.pattern_ids.push_back(id);
+                ps >> comma;
+            }
+            info.literals.assign(cols.begin() + 3, cols.end());
+        }
+    }
+    return programs;
+}
+
 
 static
 unsigned makeModeFlags(ScanMode scan_mode) {
@@ -409,6 +676,11 @@ buildEngineHyperscan(const ExpressionMap &expressions, ScanMode scan_mode,
         hs_compile_error_t *compile_err;
         Timer timer;
 
+        // Don't pick up a stale program map if this compile makes no Rose.
+        if (!profilePath.empty()) {
+            remove((profilePath + "rose_profile_map.txt").c_str());
+        }
+
 #ifndef RELEASE_BUILD
         if (useLiteralApi) {
             // Pattern length computation should be done before timer start.
@@ -533,5 +805,11 @@ buildEngineHyperscan(const ExpressionMap &expressions, ScanMode scan_mode,
     cs.compileSecs = compileSecs;
     cs.peakMemorySize = peakMemorySize;
 
-    return std::make_unique<EngineHyperscan>(db, std::move(cs));
+    map<u32, ProfileProgramInfo> profile_map;
+    if (!profilePath.empty()) {
+        profile_map = loadProfileMap(profilePath + "rose_profile_map.txt");
+    }
+
+    return std::make_unique<EngineHyperscan>(db, std::move(cs),
+                                             std::move(profile_map));
 }
@@ -32,9 +32,13 @@
 #include "expressions.h"
 #include "engine.h"
 #include "hs_runtime.h"
+#include "trace.h"
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /** Infomation about the database compile */
@@ -52,13 +56,34 @@ struct CompileHSStats {
     unsigned int peakMemorySize = 0;
 };
 
+/** What the compiler dumped about a Rose program, for profiling. */
+struct ProfileProgramInfo {
+    std::string kinds;
+    std::string patterns;
+    std::vector<unsigned int> pattern_ids;
+    std::vector<std::string> literals;
+};
+
+/** Profile counts gathered from all threads once their scans are done. */
+struct ProfileHSCounts {
+    std::mutex lock;
+    std::vector<profile_slot> programs; //!< indexed by program offset / 8
+    std::map<unsigned int, u64a> matches; //!< per pattern id
+};
+
 /** Engine context which is allocated on a per-thread basis. */
 class EngineHSContext : public EngineContext {
 public:
-    explicit EngineHSContext(const hs_database_t *db);
+    EngineHSContext(const hs_database_t *db, ProfileHSCounts *totals);
     ~EngineHSContext();
 
     hs_scratch_t *scratch = nullptr;
+
+    /** Profile table attached to the scratch, and matches per pattern id;
+     * unused unless profiling. */
+    std::vector<profile_slot> profile;
+    std::unordered_map<unsigned int, u64a> pattern_matches;
+    ProfileHSCounts *profile_totals = nullptr;
 };
 
 /** Streaming mode scans have persistent stream state associated with them. */
@@ -72,7 +97,8 @@ public:
 /** Hyperscan Engine for scanning data. */
 class EngineHyperscan : public Engine {
 public:
-    explicit EngineHyperscan(hs_database_t *db, CompileHSStats cs);
+    EngineHyperscan(hs_database_t *db, CompileHSStats cs,
+                    std::map<u32, ProfileProgramInfo> profile_map);
     ~EngineHyperscan();
 
     std::unique_ptr<EngineContext> makeContext() const;
@@ -102,9 +128,15 @@ public:
 
     void sqlStats(SqlDB &db) const;
 
+    void printProfile() const;
+
+    void sqlProfile(SqlDB &db, u64a scan_id) const;
+
 private:
     hs_database_t *db;
     CompileHSStats compile_stats;
+    std::map<u32, ProfileProgramInfo> profile_map; //!< by program offset
+    mutable ProfileHSCounts profile_counts;
 };
 
 namespace ue2 {
@@ -47,9 +47,11 @@
 #include "ue2common.h"
 
 #include <algorithm>
+#include <cerrno>
 #include <clocale>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <map>
 #include <numeric>
@@ -59,6 +61,7 @@
 
 #include <getopt.h>
 #include <pthread.h>
+#include <sys/stat.h>
 #if defined(HAVE_PTHREAD_NP_H)
 #include <pthread_np.h>
 #endif
@@ -81,6 +84,7 @@ bool forceEditDistance = false;
 unsigned editDistance = 0;
 bool printCompressSize = false;
 bool useLiteralApi = false;
+string profilePath("");
 
 // Globals local to this file.
 static bool compressStream = false;
@@ -208,6 +212,12 @@ void usage(const char *error) {
     printf("  --echo-matches  Display all matches that occur during scan.\n");
     printf("  --sql-out FILE  Output sqlite db.\n");
     printf("  --literal-on    Use Hyperscan pure literal matching.\n");
+#if !defined(RELEASE_BUILD) && defined(DUMP_SUPPORT)
+    printf("  --profile DIR   Count literal hits, program runs and matches"
+           " per pattern,\n"
+           "                  using the compile dump written to DIR (needs"
+           " BUILD_TRACE).\n");
+#endif
     printf("  -S NAME         Signature set name (for sqlite db).\n");
     printf("\n\n");
 
@@ -239,6 +249,7 @@ void processArgs(int argc, char *argv[], vector<BenchmarkSigs> &sigSets,
     int do_compress_size = 0;
     int do_echo_matches = 0;
     int do_sql_output = 0;
+    int do_profile = 0;
     int option_index = 0;
     int literalFlag = 0;
     vector<string> sigFiles;
@@ -249,6 +260,7 @@ void processArgs(int argc, char *argv[], vector<BenchmarkSigs> &sigSets,
         {"compress-stream", no_argument, &do_compress, 1},
         {"sql-out", required_argument, &do_sql_output, 1},
         {"literal-on", no_argument, &literalFlag, 1},
+        {"profile", required_argument, &do_profile, 1},
         {nullptr, 0, nullptr, 0}
     };
 
@@ -374,6 +386,15 @@ void processArgs(int argc, char *argv[], vector<BenchmarkSigs> &sigSets,
                 sqloutFile.assign(optarg);
                 do_sql_output = 0;
             }
+            if (do_profile) {
+#if !defined(RELEASE_BUILD) && defined(DUMP_SUPPORT)
+                profilePath.assign(optarg);
+                do_profile = 0;
+#else
+                usage("Profiling needs a build with dump support.");
+                exit(1);
+#endif
+            }
             break;
         case 1:
             if (in_sigfile) {
@@ -435,6 +456,31 @@ void processArgs(int argc, char *argv[], vector<BenchmarkSigs> &sigSets,
         exit(1);
     }
 
+#if !defined(RELEASE_BUILD) && defined(DUMP_SUPPORT)
+    // Profiling maps counts back to literals and patterns using the Rose
+    // dump, so we must compile (not load) with dumping on.
+    if (!profilePath.empty()) {
+        if (useHybrid || usePcre || loadDatabases) {
+            usage("Profiling needs databases compiled by Hyperscan.");
+            exit(1);
+        }
+        if (dumpCsvOut) {
+            usage("Profiling output is not available in CSV format.");
+            exit(1);
+        }
+        if (mkdir(profilePath.c_str(), 0777) && errno != EEXIST) {
+            printf("ERROR: could not create profile dump location %s: %s\n",
+                   profilePath.c_str(), strerror(errno));
+            exit(1);
+        }
+        if (profilePath.back() != '/') {
+            profilePath.push_back('/');
+        }
+        grey->dumpFlags |= Grey::DUMP_BASICS;
+        grey->dumpPath = profilePath;
+    }
+#endif
+
     // Constraints on Chimera and PCRE engines
     if (useHybrid || usePcre) {
         if (useHybrid && usePcre) {
@@ -1056,8 +1102,22 @@ int HS_CDECL main(int argc, char *argv[]) {
                 out_db.exec("BEGIN");
                 engine->sqlStats(out_db);
             }
+            // Scan rows are keyed by the Compile row; do the same for the
+            // profile.
+            u64a scan_id = sqloutFile.empty() ? 0 : out_db.lastRowId();
 
             runBenchmark(*engine, corpus_blocks);
+
+            // Profile counts are gathered as the scan threads finish.
+            if (!profilePath.empty()) {
+                if (sqloutFile.empty()) {
+                    engine->printProfile();
+                } else {
+                    out_db.exec("BEGIN");
+                    engine->sqlProfile(out_db, scan_id);
+                    out_db.exec("END");
+                }
+            }
         }
     } catch (const SqlFailure &f) {
         cerr << f.message << '\n';
@@ -0,0 +1,804 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * \brief hsscan: scan files and directory trees with Hyperscan.
+ *
+ * hsscan compiles a set of expressions in the "ID:/regex/flags" form used by
+ * the other tools, then scans every regular file under the paths given on the
+ * command line, reporting the number of matches and the throughput achieved.
+ *
+ * Files are shared between a pool of threads, each with its own scratch
+ * space. Large files are mapped into memory and scanned in chunks through a
+ * streaming mode database, so that a single file never has to be read into a
+ * buffer in one piece; small files are read whole and scanned in block mode,
+ * using io_uring to keep many reads in flight where it is available.
+ *
+ * Use "hsscan -h" for complete usage information.
+ */
+
+#include "config.h"
+
+#include "ExpressionParser.h"
+#include "expressions.h"
+
+#include "hs.h"
+#include "ue2common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(HAVE_MMAP)
+#include <sys/mman.h>
+#endif
+
+#if defined(HAVE_LIBURING)
+#include <liburing.h>
+#endif
+
+using namespace std;
+
+namespace /* anonymous */ {
+
+// Command-line options.
+string g_exprPath;
+string g_signatureFile;
+vector<string> g_paths;
+unsigned int g_threads = 0;
+size_t g_largeFile = 4 * 1024 * 1024;
+size_t g_chunkSize = 1024 * 1024;
+unsigned int g_queueDepth = 32;
+bool g_echoMatches = false;
+bool g_perThread = false;
+bool g_useUring = true;
+
+// Compiled databases: block mode for small files, streaming for large ones.
+hs_database_t *g_blockDb = nullptr;
+hs_database_t *g_streamDb = nullptr;
+
+struct FileEntry {
+    FileEntry(string path_in, size_t size_in)
+        : path(move(path_in)), size(size_in) {}
+    string path;
+    size_t size;
+};
+
+// Files to scan, partitioned by size. Large files are sorted largest first so
+// that the biggest jobs do not end up at the tail of the run.
+vector<FileEntry> g_largeFiles;
+vector<FileEntry> g_smallFiles;
+atomic<size_t> g_nextLarge{0};
+atomic<size_t> g_nextSmall{0};
+
+// Mutex serialising access to stdout for match output.
+mutex lk_output;
+
+struct ScanStats {
+    unsigned long long files = 0;
+    unsigned long long bytes = 0;
+    unsigned long long matches = 0;
+    unsigned long long errors = 0;
+
+    ScanStats &operator+=(const ScanStats &o) {
+        files += o.files;
+        bytes += o.bytes;
+        matches += o.matches;
+        errors += o.errors;
+        return *this;
+    }
+};
+
+struct ThreadContext {
+    explicit ThreadContext(unsigned int num_in) : num(num_in) {}
+    ~ThreadContext() {
+        hs_free_scratch(scratch);
+    }
+
+    unsigned int num;
+    hs_scratch_t *scratch = nullptr;
+    ScanStats stats;
+    vector<char> buf; //!< read buffer for files scanned without mmap
+    thread thr;
+};
+
+/** Context handed to the match callback. */
+struct MatchContext {
+    ThreadContext *ctx;
+    const string *path;
+};
+
+} // namespace
+
+/** Display usage information, with an optional error. */
+static
+void usage(const char *error) {
+    printf("Usage: hsscan [OPTIONS...] PATH...\n\n");
+    printf("Scans the files at each PATH, and every regular file below each"
+           " directory.\n\n");
+    printf("Options:\n\n");
+    printf("  -h              Display help and exit.\n");
+    printf("  -e PATH         Path to expression directory or file.\n");
+    printf("  -s FILE         Signature file to use.\n");
+    printf("  -T NUMBER       Number of scanning threads (default: one per"
+           " CPU).\n");
+    printf("  -L SIZE         Scan files of at least SIZE bytes in streaming"
+           " mode\n");
+    printf("                  (default: %zu).\n", g_largeFile);
+    printf("  -b SIZE         Chunk size for streaming mode scans"
+           " (default: %zu).\n", g_chunkSize);
+#if defined(HAVE_LIBURING)
+    printf("  -q NUMBER       Small file reads in flight per thread"
+           " (default: %u).\n", g_queueDepth);
+    printf("  -U              Don't use io_uring for small files.\n");
+#endif
+    printf("\n");
+    printf("  --echo-matches  Display all matches as FILE:ID:OFFSET.\n");
+    printf("  --per-thread    Display per-thread results.\n");
+    printf("\n\n");
+
+    if (error) {
+        printf("Error: %s\n", error);
+    }
+}
+
+static
+bool parseSize(const char *str, size_t *out) {
+    char *end;
+    errno = 0;
+    unsigned long long val = strtoull(str, &end, 10);
+    if (errno || end == str || val == 0) {
+        return false;
+    }
+    switch (*end) {
+    case 'k': case 'K': val <<= 10; end++; break;
+    case 'm': case 'M': val <<= 20; end++; break;
+    case 'g': case 'G': val <<= 30; end++; break;
+    default: break;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    *out = val;
+    return true;
+}
+
+/** Process command-line arguments. Prints usage and exits on error. */
+static
+void processArgs(int argc, char *argv[]) {
+    const char options[] = "-b:e:hL:q:s:T:U";
+    int echo_matches = 0;
+    int per_thread = 0;
+    static struct option longopts[] = {
+        {"echo-matches", no_argument, &echo_matches, 1},
+        {"per-thread", no_argument, &per_thread, 1},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    for (;;) {
+        int option_index = 0;
+        int c = getopt_long(argc, argv, options, longopts, &option_index);
+        if (c < 0) {
+            break;
+        }
+        switch (c) {
+        case 'b':
+            if (!parseSize(optarg, &g_chunkSize)) {
+                usage("Couldn't parse argument to -b flag, should be a size.");
+                exit(1);
+            }
+            break;
+        case 'e':
+            g_exprPath.assign(optarg);
+            break;
+        case 'h':
+            usage(nullptr);
+            exit(0);
+        case 'L':
+            if (!parseSize(optarg, &g_largeFile)) {
+                usage("Couldn't parse argument to -L flag, should be a size.");
+                exit(1);
+            }
+            break;
+        case 'q': {
+            char *end;
+            unsigned long val = strtoul(optarg, &end, 10);
+            if (*end != '\0' || val == 0 || val > 4096) {
+                usage("Argument to -q flag must be between 1 and 4096.");
+                exit(1);
+            }
+            g_queueDepth = val;
+            break;
+        }
+        case 's':
+            g_signatureFile.assign(optarg);
+            break;
+        case 'T': {
+            char *end;
+            unsigned long val = strtoul(optarg, &end, 10);
+            if (*end != '\0' || val == 0 || val > 1024) {
+                usage("Argument to -T flag must be between 1 and 1024.");
+                exit(1);
+            }
+            g_threads = val;
+            break;
+        }
+        case 'U':
+            g_useUring = false;
+            break;
+        case 1:
+            // Non-option argument: a path to scan.
+            g_paths.emplace_back(optarg);
+            break;
+        case 0:
+            break;
+        default:
+            usage("Unrecognised command line argument.");
+            exit(1);
+        }
+    }
+
+    if (g_exprPath.empty()) {
+        usage("Must specify an expression path with the -e option.");
+        exit(1);
+    }
+    if (g_paths.empty()) {
+        usage("Must specify at least one path to scan.");
+        exit(1);
+    }
+
+    g_echoMatches = echo_matches;
+    g_perThread = per_thread;
+    if (!g_threads) {
+        g_threads = max(thread::hardware_concurrency(), 1U);
+    }
+}
+
+static
+hs_database_t *buildDatabase(const ExpressionMap &exprMap, unsigned int mode) {
+    vector<string> exprs;
+    vector<unsigned int> flags, ids;
+    vector<hs_expr_ext> ext;
+
+    for (const auto &m : exprMap) {
+        string expr;
+        unsigned int f = 0;
+        hs_expr_ext extparam;
+        extparam.flags = 0;
+        if (!readExpression(m.second, expr, &f, &extparam)) {
+            printf("Error parsing PCRE: %s (id %u)\n", m.second.c_str(),
+                   m.first);
+            return nullptr;
+        }
+        if (mode == HS_MODE_STREAM && (f & HS_FLAG_SOM_LEFTMOST)) {
+            mode |= HS_MODE_SOM_HORIZON_LARGE;
+        }
+        exprs.push_back(expr);
+        ids.push_back(m.first);
+        flags.push_back(f);
+        ext.push_back(extparam);
+    }
+
+    const size_t count = exprs.size();
+    vector<const char *> patterns(count);
+    vector<const hs_expr_ext *> ext_ptr(count);
+    for (size_t i = 0; i < count; i++) {
+        patterns[i] = exprs[i].c_str();
+        ext_ptr[i] = &ext[i];
+    }
+
+    hs_database_t *db = nullptr;
+    hs_compile_error_t *compile_err;
+    hs_error_t err = hs_compile_ext_multi(patterns.data(), flags.data(),
+                                          ids.data(), ext_ptr.data(), count,
+                                          mode, nullptr, &db, &compile_err);
+    if (err != HS_SUCCESS) {
+        if (compile_err->expression >= 0) {
+            printf("Compile error for signature #%u: %s\n",
+                   ids[compile_err->expression], compile_err->message);
+        } else {
+            printf("Compile error: %s\n", compile_err->message);
+        }
+        hs_free_compile_error(compile_err);
+        return nullptr;
+    }
+    return db;
+}
+
+/** Recursively collect the regular files at or below the given path. Symbolic
+ * links are not followed below the top level. */
+static
+void collectFiles(const string &path, bool top) {
+    struct stat st;
+    if ((top ? stat(path.c_str(), &st) : lstat(path.c_str(), &st)) != 0) {
+        fprintf(stderr, "Can't stat path '%s': %s\n", path.c_str(),
+                strerror(errno));
+        return;
+    }
+
+    if (S_ISREG(st.st_mode)) {
+        size_t size = st.st_size;
+        if (size >= g_largeFile) {
+            g_largeFiles.emplace_back(path, size);
+        } else {
+            g_smallFiles.emplace_back(path, size);
+        }
+        return;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        return;
+    }
+
+    DIR *d = opendir(path.c_str());
+    if (!d) {
+        fprintf(stderr, "Can't open directory '%s': %s\n", path.c_str(),
+                strerror(errno));
+        return;
+    }
+    for (struct dirent *ent = readdir(d); ent; ent = readdir(d)) {
+        if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) {
+            continue;
+        }
+        string child = path;
+        if (child.back() != '/') {
+            child.push_back('/');
+        }
+        child.append(ent->d_name);
+        collectFiles(child, false);
+    }
+    closedir(d);
+}
+
+static
+int HS_CDECL onMatch(unsigned int id, unsigned long long, unsigned long long to,
+                     unsigned int, void *context) {
+    const MatchContext *mc = static_cast<const MatchContext *>(context);
+    mc->ctx->stats.matches++;
+    if (g_echoMatches) {
+        lock_guard<mutex> lock(lk_output);
+        printf("%s:%u:%llu\n", mc->path->c_str(), id, to);
+    }
+    return 0;
+}
+
+/** Read exactly len bytes from offset off, retrying short reads. */
+static
+bool readFully(int fd, char *buf, size_t len, size_t off) {
+    while (len) {
+        ssize_t rv = pread(fd, buf, len, off);
+        if (rv < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rv <= 0) {
+            return false;
+        }
+        buf += rv;
+        len -= rv;
+        off += rv;
+    }
+    return true;
+}
+
+static
+void reportError(ThreadContext *ctx, const string &path, const char *what) {
+    ctx->stats.errors++;
+    lock_guard<mutex> lock(lk_output);
+    fprintf(stderr, "%s '%s'\n", what, path.c_str());
+}
+
+static
+void scanBlock(ThreadContext *ctx, const string &path, const char *data,
+               size_t len) {
+    MatchContext mc{ctx, &path};
+    hs_error_t err = hs_scan(g_blockDb, data, len, 0, ctx->scratch, onMatch,
+                             &mc);
+    if (err != HS_SUCCESS) {
+        reportError(ctx, path, "Scan failed for");
+        return;
+    }
+    ctx->stats.files++;
+    ctx->stats.bytes += len;
+}
+
+/** Scan a large file in chunks through a stream, mapping it into memory where
+ * possible. */
+static
+void scanLargeFile(ThreadContext *ctx, const FileEntry &fe) {
+    int fd = open(fe.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        reportError(ctx, fe.path, "Can't open file");
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        reportError(ctx, fe.path, "Can't stat file");
+        close(fd);
+        return;
+    }
+    const size_t size = st.st_size;
+
+    const char *map = nullptr;
+#if defined(HAVE_MMAP)
+    if (size) {
+        void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            map = static_cast<const char *>(p);
+            madvise(p, size, MADV_SEQUENTIAL);
+        }
+    }
+#endif
+
+    hs_stream_t *stream = nullptr;
+    if (hs_open_stream(g_streamDb, 0, &stream) != HS_SUCCESS) {
+        reportError(ctx, fe.path, "Can't open stream for");
+#if defined(HAVE_MMAP)
+        if (map) {
+            munmap(const_cast<char *>(map), size);
+        }
+#endif
+        close(fd);
+        return;
+    }
+
+    MatchContext mc{ctx, &fe.path};
+    bool ok = true;
+    for (size_t off = 0; ok && off < size; off += g_chunkSize) {
+        size_t len = min(g_chunkSize, size - off);
+        const char *data;
+        if (map) {
+            data = map + off;
+        } else {
+            ctx->buf.resize(g_chunkSize);
+            if (!readFully(fd, ctx->buf.data(), len, off)) {
+                reportError(ctx, fe.path, "Can't read file");
+                ok = false;
+                break;
+            }
+            data = ctx->buf.data();
+        }
+        if (hs_scan_stream(stream, data, len, 0, ctx->scratch, onMatch,
+                           &mc) != HS_SUCCESS) {
+            reportError(ctx, fe.path, "Scan failed for");
+            ok = false;
+        }
+#if defined(HAVE_MMAP)
+        if (map) {
+            // Scanned pages won't be needed again; don't let a very large
+            // file push everything else out of the page cache. Only whole
+            // pages that have been scanned are dropped: the range starts at
+            // the page holding the chunk and stops short of any page that
+            // the next chunk still has to read.
+            static const size_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+            size_t begin = off & ~page_mask;
+            size_t end = off + len;
+            if (end < size) {
+                end &= ~page_mask;
+            }
+            if (end > begin) {
+                madvise(const_cast<char *>(map) + begin, end - begin,
+                        MADV_DONTNEED);
+            }
+        }
+#endif
+    }
+
+    hs_close_stream(stream, ctx->scratch, ok ? onMatch : nullptr, &mc);
+#if defined(HAVE_MMAP)
+    if (map) {
+        munmap(const_cast<char *>(map), size);
+    }
+#endif
+    close(fd);
+
+    if (ok) {
+        ctx->stats.files++;
+        ctx->stats.bytes += size;
+    }
+}
+
+/** Read a small file whole and scan it in block mode. */
+static
+void scanSmallFile(ThreadContext *ctx, const FileEntry &fe) {
+    int fd = open(fe.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        reportError(ctx, fe.path, "Can't open file");
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        reportError(ctx, fe.path, "Can't stat file");
+        close(fd);
+        return;
+    }
+    const size_t size = st.st_size;
+    ctx->buf.resize(max(size, (size_t)1));
+    bool ok = readFully(fd, ctx->buf.data(), size, 0);
+    close(fd);
+    if (!ok) {
+        reportError(ctx, fe.path, "Can't read file");
+        return;
+    }
+    scanBlock(ctx, fe.path, ctx->buf.data(), size);
+}
+
+#if defined(HAVE_LIBURING)
+/** Scan a batch of small files, with all of their reads submitted to the
+ * kernel at once. Files are scanned as their reads complete. Returns false if
+ * the ring was left holding reads the kernel would not take, in which case it
+ * must be torn down rather than used for another batch. */
+static
+bool scanSmallFilesUring(ThreadContext *ctx, struct io_uring *ring,
+                         vector<vector<char>> &bufs, size_t begin,
+                         size_t end) {
+    struct Pending {
+        const FileEntry *fe;
+        int fd;
+        size_t size;
+    };
+    vector<Pending> pending;
+
+    for (size_t i = begin; i < end; i++) {
+        const FileEntry &fe = g_smallFiles[i];
+        int fd = open(fe.path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            reportError(ctx, fe.path, "Can't open file");
+            continue;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            reportError(ctx, fe.path, "Can't stat file");
+            close(fd);
+            continue;
+        }
+        size_t slot = pending.size();
+        size_t size = st.st_size;
+        bufs[slot].resize(max(size, (size_t)1));
+        pending.push_back(Pending{&fe, fd, size});
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+        assert(sqe); // the ring has room for a whole batch
+        io_uring_prep_read(sqe, fd, bufs[slot].data(), size, 0);
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(slot));
+    }
+
+    if (pending.empty()) {
+        return true;
+    }
+
+    // A partial submit leaves the rest of the batch queued in the ring, so
+    // keep submitting while the kernel is still taking reads.
+    size_t submitted = 0;
+    while (submitted < pending.size()) {
+        int rv = io_uring_submit(ring);
+        if (rv <= 0) {
+            break;
+        }
+        submitted += rv;
+    }
+
+    // Anything the kernel would not take is read synchronously. Its reads
+    // are still queued, so the caller discards the ring after this batch.
+    for (size_t slot = submitted; slot < pending.size(); slot++) {
+        const Pending &p = pending[slot];
+        if (readFully(p.fd, bufs[slot].data(), p.size, 0)) {
+            scanBlock(ctx, p.fe->path, bufs[slot].data(), p.size);
+        } else {
+            reportError(ctx, p.fe->path, "Can't read file");
+        }
+        close(p.fd);
+    }
+
+    for (size_t n = 0; n < submitted; n++) {
+        struct io_uring_cqe *cqe;
+        if (io_uring_wait_cqe(ring, &cqe) < 0) {
+            // Nothing sensible left to do with the outstanding reads.
+            fprintf(stderr, "io_uring_wait_cqe failed\n");
+            exit(1);
+        }
+        size_t slot = reinterpret_cast<size_t>(io_uring_cqe_get_data(cqe));
+        int res = cqe->res;
+        io_uring_cqe_seen(ring, cqe);
+
+        const Pending &p = pending[slot];
+        size_t got = res > 0 ? res : 0;
+        // Finish short reads synchronously.
+        if (res >= 0 && (got == p.size ||
+                         readFully(p.fd, bufs[slot].data() + got,
+                                   p.size - got, got))) {
+            scanBlock(ctx, p.fe->path, bufs[slot].data(), p.size);
+        } else {
+            reportError(ctx, p.fe->path, "Can't read file");
+        }
+        close(p.fd);
+    }
+    return submitted == pending.size();
+}
+#endif
+
+static
+void scanThread(ThreadContext *ctx) {
+    // Large files first, one at a time.
+    for (;;) {
+        size_t i = g_nextLarge.fetch_add(1);
+        if (i >= g_largeFiles.size()) {
+            break;
+        }
+        scanLargeFile(ctx, g_largeFiles[i]);
+    }
+
+    // Then small files, in batches.
+    const size_t batch = g_queueDepth;
+#if defined(HAVE_LIBURING)
+    struct io_uring ring;
+    bool use_uring =
+        g_useUring && io_uring_queue_init(g_queueDepth, &ring, 0) == 0;
+    vector<vector<char>> bufs(use_uring ? batch : 0);
+#endif
+    for (;;) {
+        size_t begin = g_nextSmall.fetch_add(batch);
+        if (begin >= g_smallFiles.size()) {
+            break;
+        }
+        size_t end = min(begin + batch, g_smallFiles.size());
+#if defined(HAVE_LIBURING)
+        if (use_uring) {
+            if (!scanSmallFilesUring(ctx, &ring, bufs, begin, end)) {
+                io_uring_queue_exit(&ring);
+                use_uring = false;
+            }
+            continue;
+        }
+#endif
+        for (size_t i = begin; i < end; i++) {
+            scanSmallFile(ctx, g_smallFiles[i]);
+        }
+    }
+#if defined(HAVE_LIBURING)
+    if (use_uring) {
+        io_uring_queue_exit(&ring);
+    }
+#endif
+}
+
+/** Given a time and a size, compute the throughput in megabits/sec. */
+static
+double calc_mbps(double seconds, unsigned long long bytes) {
+    return seconds > 0 ? (double)bytes / (seconds * 125000) : 0;
+}
+
+static
+void printStats(const char *label, const ScanStats &s, double seconds) {
+    printf("%s%llu files, %llu bytes, %llu matches, %llu errors,"
+           " %.2f Mbit/sec\n", label, s.files, s.bytes, s.matches, s.errors,
+           calc_mbps(seconds, s.bytes));
+}
+
+int HS_CDECL main(int argc, char *argv[]) {
+    processArgs(argc, argv);
+
+    ExpressionMap exprMap;
+    struct stat st;
+    if (stat(g_exprPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        loadExpressions(g_exprPath, exprMap);
+    } else {
+        loadExpressionsFromFile(g_exprPath, exprMap);
+    }
+    if (!g_signatureFile.empty()) {
+        SignatureSet sigs;
+        loadSignatureList(g_signatureFile, sigs);
+        exprMap = limitToSignatures(exprMap, sigs);
+    }
+    if (exprMap.empty()) {
+        usage("No expressions to compile.");
+        return 1;
+    }
+
+    g_blockDb = buildDatabase(exprMap, HS_MODE_BLOCK);
+    g_streamDb = buildDatabase(exprMap, HS_MODE_STREAM);
+    if (!g_blockDb || !g_streamDb) {
+        return 1;
+    }
+
+    for (const auto &path : g_paths) {
+        collectFiles(path, true);
+    }
+    sort(g_largeFiles.begin(), g_largeFiles.end(),
+         [](const FileEntry &a, const FileEntry &b) {
+             return a.size > b.size;
+         });
+
+    // One scratch region big enough for both databases, cloned per thread.
+    hs_scratch_t *proto = nullptr;
+    if (hs_alloc_scratch(g_blockDb, &proto) != HS_SUCCESS ||
+        hs_alloc_scratch(g_streamDb, &proto) != HS_SUCCESS) {
+        printf("Unable to allocate scratch space.\n");
+        return 1;
+    }
+
+    vector<unique_ptr<ThreadContext>> threads;
+    for (unsigned int i = 0; i < g_threads; i++) {
+        threads.push_back(make_unique<ThreadContext>(i));
+        if (hs_clone_scratch(proto, &threads.back()->scratch) != HS_SUCCESS) {
+            printf("Unable to allocate scratch space.\n");
+            return 1;
+        }
+    }
+    hs_free_scratch(proto);
+
+    auto start = chrono::steady_clock::now();
+    for (auto &t : threads) {
+        t->thr = thread(scanThread, t.get());
+    }
+    for (auto &t : threads) {
+        t->thr.join();
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    const double secs = elapsed.count();
+
+    ScanStats total;
+    for (const auto &t : threads) {
+        if (g_perThread) {
+            char label[32];
+            snprintf(label, sizeof(label), "T %2u: ", t->num);
+            printStats(label, t->stats, secs);
+        }
+        total += t->stats;
+    }
+    printf("Threads:    %u\n", g_threads);
+    printf("Files:      %llu (%zu streamed)\n", total.files,
+           g_largeFiles.size());
+    printf("Bytes:      %llu\n", total.bytes);
+    printf("Matches:    %llu\n", total.matches);
+    printf("Errors:     %llu\n", total.errors);
+    printf("Time:       %.3f sec\n", secs);
+    printf("Throughput: %.2f Mbit/sec\n", calc_mbps(secs, total.bytes));
+
+    threads.clear();
+    hs_free_database(g_blockDb);
+    hs_free_database(g_streamDb);
+    return total.errors ? 1 : 0;
+}
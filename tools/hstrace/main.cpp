@@ -0,0 +1,789 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * \brief hstrace: capture and summarise scan traces.
+ *
+ * With a library built with BUILD_TRACE, hstrace can scan input files with a
+ * trace buffer attached to its scratch space, save the trace and summarise
+ * it. It can also summarise a trace saved by an application using
+ * hs_set_scratch_trace(), or replay its events one by one.
+ *
+ * The summary breaks down where the time of the traced calls went: which
+ * engines ran, for how long and how often their queues were run, filled or
+ * reinitialised, which literals and programs fired most, and which patterns
+ * were reported from the costliest literals and engines.
+ *
+ * Use "hstrace -h" for complete usage information.
+ */
+
+#include "config.h"
+
+#include "ExpressionParser.h"
+#include "expressions.h"
+
+#include "hs.h"
+#include "scratch.h"
+#include "trace.h"
+#include "ue2common.h"
+#include "nfa/nfa_internal.h"
+#if defined(DUMP_SUPPORT)
+#include "nfa/nfa_build_util.h"
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace /* anonymous */ {
+
+// Command-line options.
+string g_exprPath;
+string g_signatureFile;
+string g_traceIn;
+string g_traceOut;
+vector<string> g_inputs;
+size_t g_chunkSize = 16 * 1024;
+size_t g_traceSize = 64 * 1024 * 1024;
+bool g_blockMode = false;
+unsigned int g_top = 10;
+bool g_events = false;
+
+/** Time and counts charged to a literal program, engine or other source. */
+struct SourceStats {
+    u64a count = 0; //!< literal matches or engine runs
+    u64a ns = 0; //!< self time
+    map<u32, u64a> reports; //!< pattern id -> matches reported from here
+};
+
+struct EngineStats : SourceStats {
+    int type = -1; //!< NFAEngineType, if seen initialised
+    u64a inits = 0;
+    u64a events = 0;
+    u64a full = 0;
+};
+
+/** An engine run in progress, for attributing nested time. */
+struct OpenExec {
+    u32 qi;
+    u64a start; //!< tick count when the run began
+    u64a child_ns; //!< time spent in engine runs nested inside this one
+};
+
+struct TraceSummary {
+    u64a calls = 0;
+    u64a bytes = 0;
+    u64a call_ns = 0;
+    u64a callback_ns = 0; //!< time from reports to the next event
+    u64a other_ns = 0; //!< time not attributable to a literal or engine
+    u64a matches = 0;
+    u64a programs = 0;
+    u64a catchups = 0;
+    u64a terminated = 0;
+    u64a work_exceeded = 0;
+    unordered_map<u32, SourceStats> literals;
+    unordered_map<u32, u64a> program_counts;
+    map<u32, EngineStats> engines;
+    unordered_map<u32, u64a> patterns;
+};
+
+} // namespace
+
+/** Display usage information, with an optional error. */
+static
+void usage(const char *error) {
+    printf("Usage: hstrace [OPTIONS...] -e PATH FILE...\n");
+    printf("       hstrace [OPTIONS...] -t TRACE\n\n");
+    printf("Scans each FILE with a trace attached and summarises the trace, or"
+           " summarises\n");
+    printf("a saved TRACE.\n\n");
+    printf("Options:\n\n");
+    printf("  -h              Display help and exit.\n");
+    printf("  -e PATH         Path to expression directory or file.\n");
+    printf("  -s FILE         Signature file to use.\n");
+    printf("  -N              Scan each file in block mode (default:"
+           " streaming).\n");
+    printf("  -b SIZE         Chunk size for streaming mode scans"
+           " (default: %zu).\n", g_chunkSize);
+    printf("  -m SIZE         Trace buffer size (default: %zu).\n",
+           g_traceSize);
+    printf("  -o FILE         Save the captured trace to FILE.\n");
+    printf("  -t FILE         Summarise the trace saved in FILE.\n");
+    printf("  -n NUMBER       Entries to show in each table (default: %u).\n",
+           g_top);
+    printf("\n");
+    printf("  --events        Display every event in the trace.\n");
+    printf("\n\n");
+
+    if (error) {
+        printf("Error: %s\n", error);
+    }
+}
+
+static
+bool parseSize(const char *str, size_t *out) {
+    char *end;
+    errno = 0;
+    unsigned long long val = strtoull(str, &end, 10);
+    if (errno || end == str || val == 0) {
+        return false;
+    }
+    switch (*end) {
+    case 'k': case 'K': val <<= 10; end++; break;
+    case 'm': case 'M': val <<= 20; end++; break;
+    case 'g': case 'G': val <<= 30; end++; break;
+    default: break;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    *out = val;
+    return true;
+}
+
+/** Process command-line arguments. Prints usage and exits on error. */
+static
+void processArgs(int argc, char *argv[]) {
+    const char options[] = "-b:e:hm:Nn:o:s:t:";
+    int events = 0;
+    static struct option longopts[] = {
+        {"events", no_argument, &events, 1},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    for (;;) {
+        int option_index = 0;
+        int c = getopt_long(argc, argv, options, longopts, &option_index);
+        if (c < 0) {
+            break;
+        }
+        switch (c) {
+        case 'b':
+            if (!parseSize(optarg, &g_chunkSize)) {
+                usage("Couldn't parse argument to -b flag, should be a size.");
+                exit(1);
+            }
+            break;
+        case 'e':
+            g_exprPath.assign(optarg);
+            break;
+        case 'h':
+            usage(nullptr);
+            exit(0);
+        case 'm':
+            if (!parseSize(optarg, &g_traceSize)) {
+                usage("Couldn't parse argument to -m flag, should be a size.");
+                exit(1);
+            }
+            break;
+        case 'N':
+            g_blockMode = true;
+            break;
+        case 'n': {
+            char *end;
+            unsigned long val = strtoul(optarg, &end, 10);
+            if (*end != '\0' || val == 0) {
+                usage("Argument to -n flag must be a positive number.");
+                exit(1);
+            }
+            g_top = val;
+            break;
+        }
+        case 'o':
+            g_traceOut.assign(optarg);
+            break;
+        case 's':
+            g_signatureFile.assign(optarg);
+            break;
+        case 't':
+            g_traceIn.assign(optarg);
+            break;
+        case 1:
+            // Non-option argument: a file to scan.
+            g_inputs.emplace_back(optarg);
+            break;
+        case 0:
+            break;
+        default:
+            usage("Unrecognised command line argument.");
+            exit(1);
+        }
+    }
+
+    if (g_traceIn.empty()) {
+        if (g_exprPath.empty()) {
+            usage("Must specify an expression path with the -e option, or a"
+                  " trace with -t.");
+            exit(1);
+        }
+        if (g_inputs.empty()) {
+            usage("Must specify at least one file to scan.");
+            exit(1);
+        }
+    } else if (!g_exprPath.empty() || !g_inputs.empty()) {
+        usage("The -t option cannot be combined with scanning.");
+        exit(1);
+    }
+
+    g_events = events;
+}
+
+static
+hs_database_t *buildDatabase(const ExpressionMap &exprMap, unsigned int mode) {
+    vector<string> exprs;
+    vector<unsigned int> flags, ids;
+    vector<hs_expr_ext> ext;
+
+    for (const auto &m : exprMap) {
+        string expr;
+        unsigned int f = 0;
+        hs_expr_ext extparam;
+        extparam.flags = 0;
+        if (!readExpression(m.second, expr, &f, &extparam)) {
+            printf("Error parsing PCRE: %s (id %u)\n", m.second.c_str(),
+                   m.first);
+            return nullptr;
+        }
+        if (mode == HS_MODE_STREAM && (f & HS_FLAG_SOM_LEFTMOST)) {
+            mode |= HS_MODE_SOM_HORIZON_LARGE;
+        }
+        exprs.push_back(expr);
+        ids.push_back(m.first);
+        flags.push_back(f);
+        ext.push_back(extparam);
+    }
+
+    const size_t count = exprs.size();
+    vector<const char *> patterns(count);
+    vector<const hs_expr_ext *> ext_ptr(count);
+    for (size_t i = 0; i < count; i++) {
+        patterns[i] = exprs[i].c_str();
+        ext_ptr[i] = &ext[i];
+    }
+
+    hs_database_t *db = nullptr;
+    hs_compile_error_t *compile_err;
+    hs_error_t err = hs_compile_ext_multi(patterns.data(), flags.data(),
+                                          ids.data(), ext_ptr.data(), count,
+                                          mode, nullptr, &db, &compile_err);
+    if (err != HS_SUCCESS) {
+        if (compile_err->expression >= 0) {
+            printf("Compile error for signature #%u: %s\n",
+                   ids[compile_err->expression], compile_err->message);
+        } else {
+            printf("Compile error: %s\n", compile_err->message);
+        }
+        hs_free_compile_error(compile_err);
+        return nullptr;
+    }
+    return db;
+}
+
+static
+int HS_CDECL onMatch(unsigned int, unsigned long long, unsigned long long,
+                     unsigned int, void *ctx) {
+    (*(unsigned long long *)ctx)++;
+    return 0;
+}
+
+static
+bool readFile(const string &path, vector<char> &data) {
+    ifstream f(path, ios::binary);
+    if (!f) {
+        fprintf(stderr, "Can't open file '%s': %s\n", path.c_str(),
+                strerror(errno));
+        return false;
+    }
+    data.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+    return true;
+}
+
+/** Scan each input file with a trace attached to the scratch space, leaving
+ * the trace in \a trace. Returns false on error. */
+static
+bool capture(const hs_database_t *db, vector<char> &trace) {
+    hs_scratch_t *scratch = nullptr;
+    if (hs_alloc_scratch(db, &scratch) != HS_SUCCESS) {
+        printf("Unable to allocate scratch space.\n");
+        return false;
+    }
+
+    // u64a storage for the alignment the trace buffer requires.
+    vector<u64a> buf(g_traceSize / sizeof(u64a));
+    hs_error_t err = hs_set_scratch_trace(scratch, buf.data(),
+                                          buf.size() * sizeof(u64a));
+    if (err != HS_SUCCESS) {
+        printf("Unable to attach trace buffer (error %d): is the library"
+               " built with BUILD_TRACE?\n", err);
+        hs_free_scratch(scratch);
+        return false;
+    }
+
+    unsigned long long matches = 0;
+    bool ok = true;
+    vector<char> data;
+    for (const auto &path : g_inputs) {
+        if (!readFile(path, data)) {
+            ok = false;
+            continue;
+        }
+
+        if (g_blockMode) {
+            err = hs_scan(db, data.data(), data.size(), 0, scratch, onMatch,
+                          &matches);
+        } else {
+            hs_stream_t *stream = nullptr;
+            err = hs_open_stream(db, 0, &stream);
+            for (size_t i = 0; err == HS_SUCCESS && i < data.size();
+                 i += g_chunkSize) {
+                size_t len = min(g_chunkSize, data.size() - i);
+                err = hs_scan_stream(stream, data.data() + i, len, 0, scratch,
+                                     onMatch, &matches);
+            }
+            if (stream) {
+                hs_error_t close_err = hs_close_stream(stream, scratch,
+                                                       onMatch, &matches);
+                if (err == HS_SUCCESS) {
+                    err = close_err;
+                }
+            }
+        }
+        if (err != HS_SUCCESS && err != HS_SCAN_TERMINATED) {
+            printf("Scan of '%s' failed (error %d).\n", path.c_str(), err);
+            ok = false;
+        }
+    }
+    printf("Scanned %zu file(s), %llu matches.\n", g_inputs.size(), matches);
+
+    size_t used = 0;
+    hs_scratch_trace_size(scratch, &used);
+    hs_set_scratch_trace(scratch, nullptr, 0); // stamps the end time
+    trace.assign((const char *)buf.data(), (const char *)buf.data() + used);
+    hs_free_scratch(scratch);
+    return ok;
+}
+
+/** Check the header of a trace and return its records, or nullptr if the
+ * trace is malformed. The scale from record ticks to nanoseconds is returned
+ * in \a ns_per_tick. */
+static
+const trace_record *checkTrace(const vector<char> &trace, u64a *count,
+                               double *ns_per_tick) {
+    if (trace.size() < sizeof(trace_header)) {
+        printf("Trace is truncated.\n");
+        return nullptr;
+    }
+    trace_header h;
+    memcpy(&h, trace.data(), sizeof(h));
+    if (h.magic != TRACE_MAGIC) {
+        printf("Not a trace file.\n");
+        return nullptr;
+    }
+    if (h.version != TRACE_VERSION || h.record_size != sizeof(trace_record)) {
+        printf("Unsupported trace version %u.\n", h.version);
+        return nullptr;
+    }
+    u64a avail = (trace.size() - sizeof(h)) / sizeof(trace_record);
+    if (h.count > avail) {
+        printf("Trace is truncated: %llu of %llu records present.\n", avail,
+               h.count);
+    }
+    if (h.dropped) {
+        printf("Trace buffer overflowed: %llu events were dropped.\n",
+               h.dropped);
+    }
+    *count = min(h.count, avail);
+
+    // Ticks are nanoseconds unless the runtime used a cycle counter, in which
+    // case the clock samples in the header give the rate.
+    *ns_per_tick = 1.0;
+    if (h.end_ticks > h.base_ticks && h.end_ns > h.base_ns) {
+        *ns_per_tick = (double)(h.end_ns - h.base_ns) /
+                       (double)(h.end_ticks - h.base_ticks);
+    }
+    return (const trace_record *)(trace.data() + sizeof(h));
+}
+
+static
+const char *eventName(u8 type) {
+    switch (type) {
+    case TRACE_CALL_BEGIN: return "CALL_BEGIN";
+    case TRACE_CALL_END: return "CALL_END";
+    case TRACE_LITERAL: return "LITERAL";
+    case TRACE_PROGRAM: return "PROGRAM";
+    case TRACE_QUEUE_INIT: return "QUEUE_INIT";
+    case TRACE_QUEUE_EXEC: return "QUEUE_EXEC";
+    case TRACE_QUEUE_EXEC_END: return "QUEUE_EXEC_END";
+    case TRACE_CATCHUP: return "CATCHUP";
+    case TRACE_REPORT: return "REPORT";
+    case TRACE_QUEUE_FULL: return "QUEUE_FULL";
+    default: return "UNKNOWN";
+    }
+}
+
+static
+string engineName(int type) {
+    if (type < 0) {
+        return "?";
+    }
+#if defined(DUMP_SUPPORT)
+    if (type < INVALID_NFA) {
+        return ue2::nfa_type_name((NFAEngineType)type);
+    }
+#endif
+    return "type " + to_string(type);
+}
+
+static
+u64a ticksToNs(u64a ticks, double ns_per_tick) {
+    return (u64a)((double)ticks * ns_per_tick);
+}
+
+/** Display every event in the trace, with times relative to the first. */
+static
+void replay(const trace_record *recs, u64a count, double ns_per_tick) {
+    u64a base = count ? recs[0].ticks : 0;
+    for (u64a i = 0; i < count; i++) {
+        trace_record r;
+        memcpy(&r, &recs[i], sizeof(r));
+        printf("%12.3f us  %-14s id=%-8u aux=%-5u offset=%llu\n",
+               (double)ticksToNs(r.ticks - base, ns_per_tick) / 1000.0,
+               eventName(r.type), r.id, r.aux,
+               r.offset);
+    }
+    printf("\n");
+}
+
+/** Walk the trace, charging the time between each event and the next to the
+ * engine running at the time, or failing that to the literal whose match is
+ * being processed. */
+static
+void summarise(const trace_record *recs, u64a count, double ns_per_tick,
+               TraceSummary &s) {
+    vector<OpenExec> execs;
+    u32 lit = 0;
+    bool have_lit = false;
+    bool in_call = false;
+    u64a call_start = 0;
+
+    for (u64a i = 0; i < count; i++) {
+        trace_record r;
+        memcpy(&r, &recs[i], sizeof(r));
+
+        switch (r.type) {
+        case TRACE_CALL_BEGIN:
+            s.calls++;
+            s.bytes += r.aux == TRACE_CALL_VECTOR ? 0 : r.id;
+            execs.clear();
+            have_lit = false;
+            in_call = true;
+            call_start = r.ticks;
+            break;
+        case TRACE_CALL_END:
+            if (in_call) {
+                s.call_ns += ticksToNs(r.ticks - call_start, ns_per_tick);
+            }
+            s.terminated += !!(r.aux & STATUS_TERMINATED);
+            s.work_exceeded += !!(r.aux & STATUS_WORK_EXCEEDED);
+            execs.clear();
+            in_call = false;
+            break;
+        case TRACE_LITERAL:
+            lit = r.id;
+            have_lit = true;
+            s.literals[lit].count++;
+            break;
+        case TRACE_PROGRAM:
+            s.programs++;
+            s.program_counts[r.id]++;
+            break;
+        case TRACE_QUEUE_INIT: {
+            EngineStats &e = s.engines[r.id];
+            e.type = r.aux;
+            e.inits++;
+            break;
+        }
+        case TRACE_QUEUE_EXEC: {
+            EngineStats &e = s.engines[r.id];
+            e.count++;
+            e.events += r.aux;
+            execs.push_back(OpenExec{r.id, r.ticks, 0});
+            break;
+        }
+        case TRACE_QUEUE_EXEC_END:
+            if (!execs.empty() && execs.back().qi == r.id) {
+                u64a total = ticksToNs(r.ticks - execs.back().start,
+                                       ns_per_tick);
+                execs.pop_back();
+                if (!execs.empty()) {
+                    execs.back().child_ns += total;
+                }
+            }
+            break;
+        case TRACE_CATCHUP:
+            s.catchups++;
+            break;
+        case TRACE_REPORT:
+            s.matches++;
+            s.patterns[r.id]++;
+            if (!execs.empty()) {
+                s.engines[execs.back().qi].reports[r.id]++;
+            } else if (have_lit) {
+                s.literals[lit].reports[r.id]++;
+            }
+            break;
+        case TRACE_QUEUE_FULL:
+            s.engines[r.id].full++;
+            break;
+        default:
+            break;
+        }
+
+        if (!in_call || i + 1 == count) {
+            continue;
+        }
+        u64a gap = ticksToNs(recs[i + 1].ticks - r.ticks, ns_per_tick);
+        if (r.type == TRACE_REPORT) {
+            s.callback_ns += gap;
+        } else if (!execs.empty()) {
+            s.engines[execs.back().qi].ns += gap;
+        } else if (have_lit) {
+            s.literals[lit].ns += gap;
+        } else {
+            s.other_ns += gap;
+        }
+    }
+}
+
+static
+double pct(u64a part, u64a whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+/** The most frequent patterns reported from a source, as "id(count) ...". */
+static
+string topReports(const map<u32, u64a> &reports) {
+    vector<pair<u64a, u32>> v;
+    for (const auto &m : reports) {
+        v.emplace_back(m.second, m.first);
+    }
+    sort(v.rbegin(), v.rend());
+    string out;
+    for (size_t i = 0; i < v.size() && i < 3; i++) {
+        out += (i ? " " : "") + to_string(v[i].second) + "(" +
+               to_string(v[i].first) + ")";
+    }
+    return out.empty() ? "-" : out;
+}
+
+template<typename Map, typename Key>
+vector<typename Map::key_type> topKeys(const Map &m, Key key) {
+    vector<typename Map::key_type> keys;
+    for (const auto &e : m) {
+        keys.push_back(e.first);
+    }
+    sort(keys.begin(), keys.end(),
+         [&](const typename Map::key_type &a, const typename Map::key_type &b) {
+             auto ka = key(m.at(a)), kb = key(m.at(b));
+             return ka != kb ? ka > kb : a < b;
+         });
+    if (keys.size() > g_top) {
+        keys.resize(g_top);
+    }
+    return keys;
+}
+
+static
+void printSummary(const TraceSummary &s) {
+    const u64a total = s.call_ns;
+    printf("Calls:       %llu (%llu terminated, %llu over work budget)\n",
+           s.calls, s.terminated, s.work_exceeded);
+    printf("Bytes:       %llu\n", s.bytes);
+    printf("Time:        %.3f ms\n", total / 1e6);
+    printf("Matches:     %llu\n", s.matches);
+    printf("Programs:    %llu\n", s.programs);
+    printf("Catchups:    %llu\n", s.catchups);
+    printf("Literals:    %zu distinct\n", s.literals.size());
+    printf("Engines:     %zu active\n", s.engines.size());
+    printf("Callbacks:   %.3f ms (%.1f%%)\n", s.callback_ns / 1e6,
+           pct(s.callback_ns, total));
+    printf("Unassigned:  %.3f ms (%.1f%%)\n\n", s.other_ns / 1e6,
+           pct(s.other_ns, total));
+
+    printf("Time per engine:\n");
+    printf("  %6s %-16s %10s %6s %10s %8s %6s %6s  %s\n", "queue", "type",
+           "time(ms)", "%", "runs", "ev/run", "inits", "full", "patterns");
+    for (u32 qi : topKeys(s.engines,
+                          [](const EngineStats &e) { return e.ns; })) {
+        const EngineStats &e = s.engines.at(qi);
+        printf("  %6u %-16s %10.3f %6.1f %10llu %8.1f %6llu %6llu  %s\n", qi,
+               engineName(e.type).c_str(), e.ns / 1e6, pct(e.ns, total),
+               e.count, e.count ? (double)e.events / e.count : 0.0, e.inits,
+               e.full, topReports(e.reports).c_str());
+    }
+    printf("\n");
+
+    // Queue thrash: engines run most often for the least work each time, or
+    // reinitialised repeatedly.
+    printf("Queue thrash (runs + inits):\n");
+    printf("  %6s %-16s %10s %8s %6s %6s\n", "queue", "type", "runs", "ev/run",
+           "inits", "full");
+    for (u32 qi : topKeys(s.engines, [](const EngineStats &e) {
+             return e.count + e.inits + e.full;
+         })) {
+        const EngineStats &e = s.engines.at(qi);
+        printf("  %6u %-16s %10llu %8.1f %6llu %6llu\n", qi,
+               engineName(e.type).c_str(), e.count,
+               e.count ? (double)e.events / e.count : 0.0, e.inits, e.full);
+    }
+    printf("\n");
+
+    printf("Hottest literals (program offsets, as in rose_lit_programs.txt"
+           " from hsdump):\n");
+    printf("  %10s %10s %10s %6s  %s\n", "program", "matches", "time(ms)", "%",
+           "patterns");
+    for (u32 id : topKeys(s.literals,
+                          [](const SourceStats &l) { return l.ns; })) {
+        const SourceStats &l = s.literals.at(id);
+        printf("  %10u %10llu %10.3f %6.1f  %s\n", id, l.count, l.ns / 1e6,
+               pct(l.ns, total), topReports(l.reports).c_str());
+    }
+    printf("\n");
+
+    printf("Most run programs:\n");
+    printf("  %10s %10s\n", "program", "runs");
+    for (u32 id : topKeys(s.program_counts, [](u64a c) { return c; })) {
+        printf("  %10u %10llu\n", id, s.program_counts.at(id));
+    }
+    printf("\n");
+
+    // Share out the time of each literal and engine between the patterns
+    // reported from it, in proportion to their matches.
+    unordered_map<u32, double> cost;
+    auto share = [&cost](const SourceStats &src) {
+        u64a n = 0;
+        for (const auto &m : src.reports) {
+            n += m.second;
+        }
+        for (const auto &m : src.reports) {
+            cost[m.first] += (double)src.ns * m.second / n;
+        }
+    };
+    for (const auto &l : s.literals) {
+        share(l.second);
+    }
+    for (const auto &e : s.engines) {
+        share(e.second);
+    }
+    printf("Patterns by attributed time:\n");
+    printf("  %10s %10s %10s %6s\n", "pattern", "matches", "time(ms)", "%");
+    for (u32 id : topKeys(cost, [](double c) { return c; })) {
+        double ns = cost.at(id);
+        printf("  %10u %10llu %10.3f %6.1f\n", id, s.patterns.at(id), ns / 1e6,
+               total ? 100.0 * ns / total : 0.0);
+    }
+}
+
+int HS_CDECL main(int argc, char *argv[]) {
+    processArgs(argc, argv);
+
+    vector<char> trace;
+    if (!g_traceIn.empty()) {
+        if (!readFile(g_traceIn, trace)) {
+            return 1;
+        }
+    } else {
+        ExpressionMap exprMap;
+        struct stat st;
+        if (stat(g_exprPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            loadExpressions(g_exprPath, exprMap);
+        } else {
+            loadExpressionsFromFile(g_exprPath, exprMap);
+        }
+        if (!g_signatureFile.empty()) {
+            SignatureSet sigs;
+            loadSignatureList(g_signatureFile, sigs);
+            exprMap = limitToSignatures(exprMap, sigs);
+        }
+        if (exprMap.empty()) {
+            usage("No expressions to compile.");
+            return 1;
+        }
+
+        hs_database_t *db = buildDatabase(exprMap, g_blockMode ? HS_MODE_BLOCK
+                                                               : HS_MODE_STREAM);
+        if (!db) {
+            return 1;
+        }
+        bool ok = capture(db, trace);
+        hs_free_database(db);
+        if (!ok && trace.empty()) {
+            return 1;
+        }
+
+        if (!g_traceOut.empty()) {
+            ofstream out(g_traceOut, ios::binary);
+            out.write(trace.data(), trace.size());
+            if (!out) {
+                printf("Unable to write trace to '%s'.\n", g_traceOut.c_str());
+                return 1;
+            }
+        }
+    }
+
+    u64a count = 0;
+    double ns_per_tick = 1.0;
+    const trace_record *recs = checkTrace(trace, &count, &ns_per_tick);
+    if (!recs) {
+        return 1;
+    }
+    printf("Events:      %llu\n", count);
+
+    if (g_events) {
+        replay(recs, count, ns_per_tick);
+    }
+
+    TraceSummary s;
+    summarise(recs, count, ns_per_tick, s);
+    printSummary(s);
+    return 0;
+}
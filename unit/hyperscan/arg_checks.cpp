@@ -2644,6 +2644,11 @@ static const unsigned badModeValues[] = {
     HS_MODE_STREAM | HS_MODE_SOM_HORIZON_LARGE | HS_MODE_SOM_HORIZON_SMALL,
     HS_MODE_STREAM | HS_MODE_SOM_HORIZON_LARGE | HS_MODE_SOM_HORIZON_MEDIUM,
     HS_MODE_STREAM | HS_MODE_SOM_HORIZON_MEDIUM | HS_MODE_SOM_HORIZON_SMALL,
+    // Length-changing input transforms are only accepted in streaming mode,
+    // without a SOM horizon.
+    HS_MODE_BLOCK | HS_MODE_TRANSFORM_STRIP_NUL,
+    HS_MODE_VECTORED | HS_MODE_TRANSFORM_PERCENT_DECODE,
+    HS_MODE_STREAM | HS_MODE_TRANSFORM_STRIP_SPACE | HS_MODE_SOM_HORIZON_LARGE,
 };
 
 INSTANTIATE_TEST_CASE_P(HyperscanArgChecks, BadModeTest,
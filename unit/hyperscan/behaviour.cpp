@@ -1639,4 +1639,109 @@ TEST(Parser, NewlineTerminatedComment) {
     hs_free_database(db);
 }
 
+// The dot-star state of this pattern can use the gapped pair vermicelli;
+// matches must be the same however the data is split.
+TEST(HyperscanTestBehaviour, GapPairAccel) {
+    const string data =
+        "foo_____________________a_y___b_z___c_x___________________________"
+        "__a_x__________________________________b-y__abcbcz________________"
+        "_____c\nz________________________________________________________aa"
+        "xc_z";
+    const vector<MatchRecord> expected = {
+        MatchRecord(71, 1), MatchRecord(108, 1), MatchRecord(140, 1),
+        MatchRecord(199, 1), MatchRecord(202, 1)};
+
+    hs_database_t *db = buildDB("^foo.*(a.x|b.y|c.z)", HS_FLAG_DOTALL, 1,
+                                HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    CallBackContext c;
+    err = hs_scan(db, data.c_str(), data.size(), 0, scratch, record_cb,
+                  (void *)&c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(expected, c.matches);
+    hs_free_database(db);
+
+    db = buildDB("^foo.*(a.x|b.y|c.z)", HS_FLAG_DOTALL, 1, HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+    err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    // Split the data into chunks of each size from one byte upwards, so that
+    // literals straddle the chunk boundaries.
+    for (size_t chunk = 1; chunk <= 32; chunk++) {
+        hs_stream_t *stream = nullptr;
+        err = hs_open_stream(db, 0, &stream);
+        ASSERT_EQ(HS_SUCCESS, err);
+        ASSERT_NE(nullptr, stream);
+
+        c.clear();
+        for (size_t i = 0; i < data.size(); i += chunk) {
+            size_t len = min(chunk, data.size() - i);
+            err = hs_scan_stream(stream, data.c_str() + i, len, 0, scratch,
+                                 record_cb, (void *)&c);
+            ASSERT_EQ(HS_SUCCESS, err);
+        }
+        err = hs_close_stream(stream, scratch, record_cb, (void *)&c);
+        ASSERT_EQ(HS_SUCCESS, err);
+        EXPECT_EQ(expected, c.matches) << "chunk size " << chunk;
+    }
+
+    // teardown
+    err = hs_free_scratch(scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_database(db);
+}
+
+// These patterns have no usable literal, so each becomes a small outfix DFA.
+// Together they are too big to merge into one DFA, so they are packed into
+// the lanes of one Sheng lanes engine. Both raise id 1 at the end of
+// "X1abcde#", which must be reported once.
+TEST(HyperscanTestBehaviour, SameIdOutfixLanes) {
+    const vector<pattern> patterns = {
+        pattern("[0-9][a-z]{5}#", 0, 1),
+        pattern("[A-Z][a-z0-9]{6}#", 0, 1)};
+    const string pad(100, '_');
+    const string data = pad + "X1abcde#" + pad + "2abcde#" + pad +
+                        "Yzzzzzz#" + pad;
+    const size_t both = pad.size() + 8;
+    const size_t first = both + pad.size() + 7;
+    const size_t second = first + pad.size() + 8;
+    const vector<MatchRecord> expected = {
+        MatchRecord(both, 1), MatchRecord(first, 1), MatchRecord(second, 1)};
+
+    for (unsigned mode : {HS_MODE_BLOCK, HS_MODE_STREAM}) {
+        hs_database_t *db = buildDB(patterns, mode);
+        ASSERT_NE(nullptr, db);
+        hs_scratch_t *scratch = nullptr;
+        hs_error_t err = hs_alloc_scratch(db, &scratch);
+        ASSERT_EQ(HS_SUCCESS, err);
+
+        CallBackContext c;
+        if (mode == HS_MODE_BLOCK) {
+            err = hs_scan(db, data.c_str(), data.size(), 0, scratch,
+                          record_cb, (void *)&c);
+            ASSERT_EQ(HS_SUCCESS, err);
+        } else {
+            hs_stream_t *stream = nullptr;
+            err = hs_open_stream(db, 0, &stream);
+            ASSERT_EQ(HS_SUCCESS, err);
+            err = hs_scan_stream(stream, data.c_str(), data.size(), 0,
+                                 scratch, record_cb, (void *)&c);
+            ASSERT_EQ(HS_SUCCESS, err);
+            err = hs_close_stream(stream, scratch, record_cb, (void *)&c);
+            ASSERT_EQ(HS_SUCCESS, err);
+        }
+        EXPECT_EQ(expected, c.matches) << "mode " << mode;
+
+        // teardown
+        err = hs_free_scratch(scratch);
+        ASSERT_EQ(HS_SUCCESS, err);
+        hs_free_database(db);
+    }
+}
+
 } // namespace
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "test_util.h"
+
+#include "hs.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static
+vector<MatchRecord> scanBlock(const hs_database_t *db, const string &data) {
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    EXPECT_EQ(HS_SUCCESS, err);
+
+    CallBackContext c;
+    err = hs_scan(db, data.c_str(), data.length(), 0, scratch, record_cb, &c);
+    EXPECT_EQ(HS_SUCCESS, err);
+
+    hs_free_scratch(scratch);
+
+    // Several reports at the same offset may come in any order.
+    sort(c.matches.begin(), c.matches.end(),
+         [](const MatchRecord &a, const MatchRecord &b) {
+             return a.to != b.to ? a.to < b.to : a.id < b.id;
+         });
+    return c.matches;
+}
+
+TEST(ExactMatch, Keys) {
+    vector<pattern> patterns;
+    patterns.emplace_back("^GET$", 0, 1);
+    patterns.emplace_back("^post$", HS_FLAG_CASELESS, 2);
+    patterns.emplace_back("^PUT$", HS_FLAG_SINGLEMATCH, 3);
+    patterns.emplace_back("^Get$", 0, 4);
+    hs_database_t *db = buildDB(patterns, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+
+    EXPECT_EQ(vector<MatchRecord>({{3, 1}}), scanBlock(db, "GET"));
+    EXPECT_EQ(vector<MatchRecord>({{3, 4}}), scanBlock(db, "Get"));
+    EXPECT_TRUE(scanBlock(db, "get").empty());
+    EXPECT_EQ(vector<MatchRecord>({{4, 2}}), scanBlock(db, "POST"));
+    EXPECT_EQ(vector<MatchRecord>({{4, 2}}), scanBlock(db, "pOsT"));
+    EXPECT_EQ(vector<MatchRecord>({{3, 3}}), scanBlock(db, "PUT"));
+
+    // '$' also matches before a final newline.
+    EXPECT_EQ(vector<MatchRecord>({{3, 1}}), scanBlock(db, "GET\n"));
+
+    EXPECT_TRUE(scanBlock(db, "GETS").empty());
+    EXPECT_TRUE(scanBlock(db, " GET").empty());
+    EXPECT_TRUE(scanBlock(db, "GE").empty());
+    EXPECT_TRUE(scanBlock(db, "GET\n\n").empty());
+
+    hs_free_database(db);
+}
+
+TEST(ExactMatch, Alternatives) {
+    vector<pattern> patterns;
+    patterns.emplace_back("^(foo|barbaz)$", 0, 1);
+    patterns.emplace_back("^[xy]z\\z", 0, 2);
+    patterns.emplace_back("^foo$", 0, 3);
+    hs_database_t *db = buildDB(patterns, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+
+    EXPECT_EQ(vector<MatchRecord>({{3, 1}, {3, 3}}), scanBlock(db, "foo"));
+    EXPECT_EQ(vector<MatchRecord>({{6, 1}}), scanBlock(db, "barbaz"));
+    EXPECT_EQ(vector<MatchRecord>({{2, 2}}), scanBlock(db, "xz"));
+    EXPECT_EQ(vector<MatchRecord>({{2, 2}}), scanBlock(db, "yz"));
+    EXPECT_TRUE(scanBlock(db, "yz\n").empty());
+    EXPECT_TRUE(scanBlock(db, "zz").empty());
+
+    hs_free_database(db);
+}
+
+TEST(ExactMatch, ManyKeys) {
+    const unsigned num = 5000;
+    vector<pattern> patterns;
+    for (unsigned i = 0; i < num; i++) {
+        patterns.emplace_back("^key-" + to_string(i * 7) + "$", 0, i);
+    }
+    hs_database_t *db = buildDB(patterns, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    for (unsigned i = 0; i < num * 7; i++) {
+        const string key = "key-" + to_string(i);
+        CallBackContext c;
+        hs_error_t err = hs_scan(db, key.c_str(), key.length(), 0, scratch,
+                                 record_cb, &c);
+        ASSERT_EQ(HS_SUCCESS, err);
+        if (i % 7) {
+            EXPECT_TRUE(c.matches.empty()) << key;
+        } else {
+            ASSERT_EQ(1U, c.matches.size()) << key;
+            EXPECT_EQ(MatchRecord(key.length(), i / 7), c.matches[0]);
+        }
+    }
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(ExactMatch, Terminate) {
+    vector<pattern> patterns;
+    patterns.emplace_back("^abc$", 0, 1);
+    patterns.emplace_back("^abc$", 0, 2);
+    hs_database_t *db = buildDB(patterns, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    CallBackContext c;
+    c.halt = true;
+    hs_error_t err = hs_scan(db, "abc", 3, 0, scratch, record_cb, &c);
+    EXPECT_EQ(HS_SCAN_TERMINATED, err);
+    EXPECT_EQ(1U, c.matches.size());
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(ExactMatch, MixedWithFloating) {
+    // One unanchored pattern means the whole set goes to Rose as usual.
+    vector<pattern> patterns;
+    patterns.emplace_back("^abc$", 0, 1);
+    patterns.emplace_back("bc", 0, 2);
+    hs_database_t *db = buildDB(patterns, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+
+    EXPECT_EQ(vector<MatchRecord>({{3, 1}, {3, 2}}), scanBlock(db, "abc"));
+    EXPECT_EQ(vector<MatchRecord>({{3, 2}}), scanBlock(db, "xbc"));
+
+    hs_free_database(db);
+}
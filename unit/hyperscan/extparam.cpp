@@ -28,7 +28,10 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "hs.h"
@@ -159,3 +162,101 @@ TEST(ExtParam, LargeMinLength) {
     ASSERT_EQ(HS_SUCCESS, err);
     hs_free_database(db);
 }
+
+TEST(ExtParam, MaxOffsetStreaming) {
+    // Patterns bounded by max_offset are retired as the stream passes their
+    // bounds; this must not change the matches reported, either for them or
+    // for the unbounded patterns that remain.
+    hs_expr_ext ext;
+    memset(&ext, 0, sizeof(ext));
+    ext.flags = HS_EXT_FLAG_MAX_OFFSET;
+
+    vector<pattern> patterns;
+    ext.max_offset = 64;
+    patterns.emplace_back("hatstand", 0, 1, ext);
+    ext.max_offset = 200;
+    patterns.emplace_back("foo[^x]*bar", 0, 2, ext);
+    patterns.emplace_back("teakettle", 0, 3);
+
+    hs_database_t *db = buildDB(patterns, HS_MODE_STREAM);
+    ASSERT_TRUE(db != nullptr);
+    hs_database_t *block_db = buildDB(patterns, HS_MODE_BLOCK);
+    ASSERT_TRUE(block_db != nullptr);
+
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+    err = hs_alloc_scratch(block_db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    string corpus = "hatstand__foo___teakettle";
+    while (corpus.length() < 1000) {
+        corpus += "_hatstand_bar_foo__bar_teakettle_";
+    }
+
+    CallBackContext expected;
+    err = hs_scan(block_db, corpus.c_str(), corpus.length(), 0, scratch,
+                  record_cb, (void *)&expected);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    CallBackContext c;
+    hs_stream_t *stream = nullptr;
+    err = hs_open_stream(db, 0, &stream);
+    ASSERT_EQ(HS_SUCCESS, err);
+    const size_t chunk = 16;
+    for (size_t i = 0; i < corpus.length(); i += chunk) {
+        size_t len = min(chunk, corpus.length() - i);
+        err = hs_scan_stream(stream, corpus.c_str() + i, len, 0, scratch,
+                             record_cb, (void *)&c);
+        ASSERT_EQ(HS_SUCCESS, err);
+    }
+    err = hs_close_stream(stream, scratch, record_cb, (void *)&c);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    EXPECT_EQ(expected.matches, c.matches);
+    EXPECT_EQ(MatchRecord(8, 1), c.matches.front());
+    EXPECT_EQ(MatchRecord(corpus.length() - 1, 3), c.matches.back());
+
+    err = hs_free_scratch(scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_database(db);
+    hs_free_database(block_db);
+}
+
+TEST(ExtParam, MaxOffsetStreamingEod) {
+    // Retiring the bounded literal must not switch off the boundary group,
+    // which would mark the stream exhausted and lose the match at EOD.
+    vector<pattern> patterns;
+    patterns.emplace_back("^.{0,3}foo", HS_FLAG_DOTALL, 1);
+    patterns.emplace_back("$", HS_FLAG_ALLOWEMPTY, 2);
+
+    hs_database_t *db = buildDB(patterns, HS_MODE_STREAM);
+    ASSERT_TRUE(db != nullptr);
+
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    CallBackContext c;
+    hs_stream_t *stream = nullptr;
+    err = hs_open_stream(db, 0, &stream);
+    ASSERT_EQ(HS_SUCCESS, err);
+    const string data = "xxfoo___";
+    size_t len = 0;
+    for (int i = 0; i < 16; i++) {
+        err = hs_scan_stream(stream, data.c_str(), data.length(), 0, scratch,
+                             record_cb, (void *)&c);
+        ASSERT_EQ(HS_SUCCESS, err);
+        len += data.length();
+    }
+    err = hs_close_stream(stream, scratch, record_cb, (void *)&c);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    ASSERT_EQ(2U, c.matches.size());
+    EXPECT_EQ(MatchRecord(5, 1), c.matches[0]);
+    EXPECT_EQ(MatchRecord(len, 2), c.matches[1]);
+
+    err = hs_free_scratch(scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_database(db);
+}
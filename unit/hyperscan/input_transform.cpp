@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "test_util.h"
+
+#include "hs.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Scan the data as a stream, split into writes of the given size.
+void scanStream(const hs_database_t *db, const string &data, size_t write_len,
+                CallBackContext *c) {
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    hs_stream_t *stream = nullptr;
+    err = hs_open_stream(db, 0, &stream);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    for (size_t i = 0; i < data.length(); i += write_len) {
+        size_t len = min(write_len, data.length() - i);
+        err = hs_scan_stream(stream, data.c_str() + i, len, 0, scratch,
+                             record_cb, c);
+        ASSERT_EQ(HS_SUCCESS, err);
+    }
+
+    err = hs_close_stream(stream, scratch, record_cb, c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_scratch(scratch);
+}
+
+} // namespace
+
+TEST(InputTransform, Lowercase) {
+    hs_database_t *db = buildDB("select", 0, 1,
+                                HS_MODE_BLOCK | HS_MODE_TRANSFORM_LOWERCASE);
+    ASSERT_NE(nullptr, db);
+
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    const string data = "select SELECT SeLeCt";
+    CallBackContext c;
+    err = hs_scan(db, data.c_str(), data.length(), 0, scratch, record_cb, &c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_EQ(3U, c.matches.size());
+    EXPECT_EQ(MatchRecord(6, 1), c.matches[0]);
+    EXPECT_EQ(MatchRecord(13, 1), c.matches[1]);
+    EXPECT_EQ(MatchRecord(20, 1), c.matches[2]);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(InputTransform, LowercaseClasses) {
+    hs_database_t *db = buildDB("a[b-d]+\\d[^x]y", 0, 1,
+                                HS_MODE_BLOCK | HS_MODE_TRANSFORM_LOWERCASE);
+    ASSERT_NE(nullptr, db);
+
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    // The negated class can't match 'X', as it is seen as 'x'.
+    const string data = "ABCD1zY_aBc2Xy";
+    CallBackContext c;
+    err = hs_scan(db, data.c_str(), data.length(), 0, scratch, record_cb, &c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_EQ(1U, c.matches.size());
+    EXPECT_EQ(MatchRecord(7, 1), c.matches[0]);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(InputTransform, LowercaseNeverMatches) {
+    hs_database_t *db = nullptr;
+    hs_compile_error_t *compile_err = nullptr;
+    hs_error_t err = hs_compile("Select", 0,
+                                HS_MODE_BLOCK | HS_MODE_TRANSFORM_LOWERCASE,
+                                nullptr, &db, &compile_err);
+    ASSERT_EQ(HS_COMPILER_ERROR, err);
+    ASSERT_NE(nullptr, compile_err);
+    EXPECT_STREQ("Pattern can never match.", compile_err->message);
+    hs_free_compile_error(compile_err);
+
+    err = hs_compile("[A-Z]+x", 0, HS_MODE_BLOCK | HS_MODE_TRANSFORM_LOWERCASE,
+                     nullptr, &db, &compile_err);
+    ASSERT_EQ(HS_COMPILER_ERROR, err);
+    hs_free_compile_error(compile_err);
+}
+
+TEST(InputTransform, StripNul) {
+    hs_database_t *db = buildDB("foobar", 0, 1,
+                                HS_MODE_STREAM | HS_MODE_TRANSFORM_STRIP_NUL);
+    ASSERT_NE(nullptr, db);
+
+    const string data("f\0o\0o\0b\0a\0r\0__foobar", 20);
+    for (size_t write_len : {1U, 3U, 20U}) {
+        SCOPED_TRACE(write_len);
+        CallBackContext c;
+        scanStream(db, data, write_len, &c);
+        ASSERT_EQ(2U, c.matches.size());
+        EXPECT_EQ(MatchRecord(11, 1), c.matches[0]);
+        EXPECT_EQ(MatchRecord(20, 1), c.matches[1]);
+    }
+
+    hs_free_database(db);
+}
+
+TEST(InputTransform, StripSpace) {
+    hs_database_t *db = buildDB("union\\(", 0, 1,
+                                HS_MODE_STREAM | HS_MODE_TRANSFORM_STRIP_SPACE);
+    ASSERT_NE(nullptr, db);
+
+    const string data = "un ion\t\r\n( union(";
+    CallBackContext c;
+    scanStream(db, data, data.length(), &c);
+    ASSERT_EQ(2U, c.matches.size());
+    EXPECT_EQ(MatchRecord(10, 1), c.matches[0]);
+    EXPECT_EQ(MatchRecord(17, 1), c.matches[1]);
+
+    hs_free_database(db);
+}
+
+TEST(InputTransform, PercentDecode) {
+    hs_database_t *db = buildDB("<script", 0, 1,
+                                HS_MODE_STREAM |
+                                    HS_MODE_TRANSFORM_PERCENT_DECODE |
+                                    HS_MODE_TRANSFORM_LOWERCASE);
+    ASSERT_NE(nullptr, db);
+
+    // Escapes are decoded even when split across writes; a bad escape is
+    // matched as itself.
+    const string data = "%3cScRiPt %3C%73cript %%3cscript %3gscript";
+    for (size_t write_len : {size_t{1}, size_t{2}, size_t{5}, data.length()}) {
+        SCOPED_TRACE(write_len);
+        CallBackContext c;
+        scanStream(db, data, write_len, &c);
+        ASSERT_EQ(3U, c.matches.size());
+        EXPECT_EQ(MatchRecord(9, 1), c.matches[0]);
+        EXPECT_EQ(MatchRecord(21, 1), c.matches[1]);
+        EXPECT_EQ(MatchRecord(32, 1), c.matches[2]);
+    }
+
+    hs_free_database(db);
+}
+
+TEST(InputTransform, PercentDecodeEod) {
+    hs_database_t *db = buildDB("%4$", 0, 1,
+                                HS_MODE_STREAM |
+                                    HS_MODE_TRANSFORM_PERCENT_DECODE);
+    ASSERT_NE(nullptr, db);
+
+    // The incomplete escape at the end of the stream is held back until the
+    // stream is closed, and then matched as itself.
+    const string data = "abc%4";
+    CallBackContext c;
+    scanStream(db, data, 2, &c);
+    ASSERT_EQ(1U, c.matches.size());
+    EXPECT_EQ(MatchRecord(5, 1), c.matches[0]);
+
+    hs_free_database(db);
+}
+
+TEST(InputTransform, Resumable) {
+    hs_database_t *db = buildDB("foo\\d", 0, 1,
+                                HS_MODE_STREAM | HS_MODE_TRANSFORM_STRIP_SPACE |
+                                    HS_MODE_TRANSFORM_PERCENT_DECODE);
+    ASSERT_NE(nullptr, db);
+
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    const string data = "f o%6f1 fo%20o%32";
+    CallBackContext c;
+    err = hs_scan_resumable(db, data.c_str(), data.length(), 0, 4, 0, scratch,
+                            record_cb, &c);
+    while (err == HS_SCAN_SUSPENDED) {
+        err = hs_resume_scan(scratch, 4, 0, record_cb, &c);
+    }
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_EQ(2U, c.matches.size());
+    EXPECT_EQ(MatchRecord(7, 1), c.matches[0]);
+    EXPECT_EQ(MatchRecord(17, 1), c.matches[1]);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
@@ -367,3 +367,96 @@ TEST(MMRoseLiteralPath, issue_141) {
     err = hs_free_scratch(scratch);
     ASSERT_EQ(HS_SUCCESS, err);
 }
+
+static
+void checkExhaustedGroups(const vector<const char *> &expr,
+                          const vector<unsigned> &flags,
+                          const vector<unsigned> &ids, const string &data,
+                          const vector<MatchRecord> &expected) {
+    for (unsigned mode : {HS_MODE_BLOCK, HS_MODE_STREAM}) {
+        SCOPED_TRACE(mode);
+        hs_database_t *db = nullptr;
+        hs_compile_error_t *compile_err = nullptr;
+        hs_error_t err = hs_compile_multi(expr.data(), flags.data(),
+                                          ids.data(), expr.size(), mode,
+                                          nullptr, &db, &compile_err);
+        ASSERT_EQ(HS_SUCCESS, err);
+        ASSERT_TRUE(db != nullptr);
+
+        hs_scratch_t *scratch = nullptr;
+        err = hs_alloc_scratch(db, &scratch);
+        ASSERT_EQ(HS_SUCCESS, err);
+
+        CallBackContext c;
+        if (mode == HS_MODE_BLOCK) {
+            err = hs_scan(db, data.c_str(), data.size(), 0, scratch, record_cb,
+                          (void *)&c);
+            ASSERT_EQ(HS_SUCCESS, err);
+        } else {
+            hs_stream_t *stream = nullptr;
+            err = hs_open_stream(db, 0, &stream);
+            ASSERT_EQ(HS_SUCCESS, err);
+            for (size_t i = 0; i < data.size(); i += 10) {
+                size_t len = min(data.size() - i, size_t{10});
+                err = hs_scan_stream(stream, data.c_str() + i, len, 0, scratch,
+                                     record_cb, (void *)&c);
+                ASSERT_EQ(HS_SUCCESS, err);
+            }
+            err = hs_close_stream(stream, scratch, record_cb, (void *)&c);
+            ASSERT_EQ(HS_SUCCESS, err);
+        }
+
+        EXPECT_EQ(expected, c.matches);
+
+        hs_free_database(db);
+        err = hs_free_scratch(scratch);
+        ASSERT_EQ(HS_SUCCESS, err);
+    }
+}
+
+TEST(MMRoseLiteralPath, exhausted_groups) {
+    // Once single-match patterns have matched, the groups holding their
+    // literals are switched off; the other patterns must keep matching,
+    // including the one reported at EOD.
+    vector<const char *> expr = {"abc[0-9]def", "ghi[0-9]jkl", "mno[0-9]pqr",
+                                 "$"};
+    vector<unsigned> flags = {HS_FLAG_SINGLEMATCH, HS_FLAG_SINGLEMATCH, 0,
+                              HS_FLAG_ALLOWEMPTY};
+    vector<unsigned> ids = {1, 2, 3, 4};
+
+    string data;
+    vector<MatchRecord> expected;
+    for (unsigned i = 0; i < 20; i++) {
+        data += "abc1def_";
+        if (i == 0) {
+            expected.emplace_back(data.size() - 1, 1);
+        }
+        data += "mno2pqr_";
+        expected.emplace_back(data.size() - 1, 3);
+        data += "ghi3jkl_";
+        if (i == 0) {
+            expected.emplace_back(data.size() - 1, 2);
+        }
+    }
+    expected.emplace_back(data.size(), 4);
+
+    checkExhaustedGroups(expr, flags, ids, data, expected);
+}
+
+TEST(MMRoseLiteralPath, exhausted_groups_eod) {
+    // When every literal pattern is exhausted, the stream must stay alive
+    // for the pattern reported at EOD.
+    vector<const char *> expr = {"abc[0-9]def", "ghi[0-9]jkl", "$"};
+    vector<unsigned> flags = {HS_FLAG_SINGLEMATCH, HS_FLAG_SINGLEMATCH,
+                              HS_FLAG_ALLOWEMPTY};
+    vector<unsigned> ids = {1, 2, 3};
+
+    string data = "abc1def_ghi3jkl_";
+    vector<MatchRecord> expected = {{6, 1}, {14, 2}};
+    while (data.size() < 200) {
+        data += "abc1def_ghi3jkl_";
+    }
+    expected.emplace_back(data.size(), 3);
+
+    checkExhaustedGroups(expr, flags, ids, data, expected);
+}
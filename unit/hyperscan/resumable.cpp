@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "test_util.h"
+
+#include "hs.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static
+vector<pattern> resumablePatterns() {
+    vector<pattern> patterns;
+    patterns.emplace_back("foo.*bar", 0, 1);
+    patterns.emplace_back("abc", 0, 2);
+    patterns.emplace_back("[0-9]{4}", 0, 3);
+    patterns.emplace_back("xyz$", 0, 4);
+    return patterns;
+}
+
+static
+string resumableData() {
+    string data;
+    for (unsigned int i = 0; i < 200; i++) {
+        data += "foo__abc_1234__bar_";
+    }
+    return data + "xyz";
+}
+
+// Matches from an uninterrupted vectored scan of a single block.
+static
+vector<MatchRecord> expectedMatches(const hs_database_t *db,
+                                    hs_scratch_t *scratch,
+                                    const string &data) {
+    const char *ptr = data.c_str();
+    unsigned int len = data.length();
+    CallBackContext c;
+    hs_error_t err = hs_scan_vector(db, &ptr, &len, 1, 0, scratch, record_cb,
+                                    &c);
+    EXPECT_EQ(HS_SUCCESS, err);
+    return c.matches;
+}
+
+TEST(Resumable, ByteBudget) {
+    hs_database_t *db = buildDB(resumablePatterns(), HS_MODE_VECTORED);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    const string data = resumableData();
+    const auto expected = expectedMatches(db, scratch, data);
+    ASSERT_FALSE(expected.empty());
+    ASSERT_EQ(MatchRecord(data.length(), 4), expected.back());
+
+    for (unsigned int budget : {1U, 7U, 100U, 4096U}) {
+        SCOPED_TRACE(budget);
+        CallBackContext c;
+        size_t calls = 1;
+        err = hs_scan_resumable(db, data.c_str(), data.length(), 0, budget, 0,
+                                scratch, record_cb, &c);
+        while (err == HS_SCAN_SUSPENDED) {
+            // The scratch may be used for other scans in between.
+            expectedMatches(db, scratch, "foo bar");
+            err = hs_resume_scan(scratch, budget, 0, record_cb, &c);
+            calls++;
+        }
+        ASSERT_EQ(HS_SUCCESS, err);
+        EXPECT_EQ((data.length() + budget - 1) / budget, calls);
+        EXPECT_EQ(expected, c.matches);
+    }
+
+    // Nothing left to resume.
+    err = hs_resume_scan(scratch, 0, 0, record_cb, nullptr);
+    EXPECT_EQ(HS_INVALID, err);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(Resumable, MatchBudget) {
+    hs_database_t *db = buildDB(resumablePatterns(), HS_MODE_VECTORED);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    string data;
+    for (unsigned int i = 0; i < 16; i++) {
+        data += resumableData();
+    }
+    const auto expected = expectedMatches(db, scratch, data);
+
+    CallBackContext c;
+    size_t calls = 1;
+    err = hs_scan_resumable(db, data.c_str(), data.length(), 0, 0, 1, scratch,
+                            record_cb, &c);
+    while (err == HS_SCAN_SUSPENDED) {
+        err = hs_resume_scan(scratch, 0, 1, record_cb, &c);
+        calls++;
+    }
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_LT(1U, calls);
+    EXPECT_EQ(expected, c.matches);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(Resumable, Terminate) {
+    hs_database_t *db = buildDB(resumablePatterns(), HS_MODE_VECTORED);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    const string data = resumableData();
+    CallBackContext c;
+    err = hs_scan_resumable(db, data.c_str(), data.length(), 0, 10, 0, scratch,
+                            record_cb, &c);
+    ASSERT_EQ(HS_SCAN_SUSPENDED, err);
+    const size_t before = c.matches.size();
+    c.halt = true;
+    do {
+        err = hs_resume_scan(scratch, 10, 0, record_cb, &c);
+    } while (err == HS_SCAN_SUSPENDED);
+    ASSERT_EQ(HS_SCAN_TERMINATED, err);
+    EXPECT_EQ(before + 1, c.matches.size());
+
+    // A terminated scan cannot be resumed.
+    err = hs_resume_scan(scratch, 10, 0, record_cb, &c);
+    EXPECT_EQ(HS_INVALID, err);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(Resumable, BadArgs) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    err = hs_scan_resumable(db, "foobar", 6, 0, 1, 0, scratch, dummy_cb,
+                            nullptr);
+    EXPECT_EQ(HS_DB_MODE_ERROR, err);
+    err = hs_scan_resumable(db, "foobar", 6, 0, 1, 0, nullptr, dummy_cb,
+                            nullptr);
+    EXPECT_EQ(HS_INVALID, err);
+    err = hs_scan_resumable(db, nullptr, 6, 0, 1, 0, scratch, dummy_cb,
+                            nullptr);
+    EXPECT_EQ(HS_INVALID, err);
+    err = hs_resume_scan(nullptr, 1, 0, dummy_cb, nullptr);
+    EXPECT_EQ(HS_INVALID, err);
+    err = hs_resume_scan(scratch, 1, 0, dummy_cb, nullptr);
+    EXPECT_EQ(HS_INVALID, err);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
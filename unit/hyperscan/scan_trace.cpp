@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "test_util.h"
+
+#include "hs.h"
+#include "hs_internal.h"
+#include "trace.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST(ScanTrace, BadArgs) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    vector<u64a> buf(64);
+    size_t size;
+    EXPECT_EQ(HS_INVALID, hs_set_scratch_trace(nullptr, buf.data(), 512));
+    EXPECT_EQ(HS_INVALID, hs_scratch_trace_size(nullptr, &size));
+    EXPECT_EQ(HS_INVALID, hs_scratch_trace_size(scratch, &size));
+    EXPECT_EQ(HS_SUCCESS, hs_set_scratch_trace(scratch, nullptr, 0));
+#if defined(HS_TRACE)
+    EXPECT_EQ(HS_INVALID, hs_set_scratch_trace(scratch, buf.data(), 8));
+    EXPECT_EQ(HS_BAD_ALIGN, hs_set_scratch_trace(
+                                scratch, (char *)buf.data() + 1, 256));
+    ASSERT_EQ(HS_SUCCESS, hs_set_scratch_trace(scratch, buf.data(), 512));
+    EXPECT_EQ(HS_INVALID, hs_scratch_trace_size(scratch, nullptr));
+    ASSERT_EQ(HS_SUCCESS, hs_scratch_trace_size(scratch, &size));
+    EXPECT_EQ(sizeof(trace_header), size);
+#else
+    EXPECT_EQ(HS_INVALID, hs_set_scratch_trace(scratch, buf.data(), 512));
+#endif
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(ScanProfile, BadArgs) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    vector<u64a> buf(64);
+    size_t size;
+    EXPECT_EQ(HS_INVALID, hs_profile_size(nullptr, &size));
+    EXPECT_EQ(HS_INVALID, hs_profile_size(db, nullptr));
+    EXPECT_EQ(HS_INVALID, hs_set_scratch_profile(nullptr, db, buf.data(),
+                                                 512));
+    EXPECT_EQ(HS_SUCCESS, hs_set_scratch_profile(scratch, db, nullptr, 0));
+#if defined(HS_TRACE)
+    ASSERT_EQ(HS_SUCCESS, hs_profile_size(db, &size));
+    EXPECT_EQ(0U, size % sizeof(profile_slot));
+    vector<u64a> table(size / sizeof(u64a) + 1);
+    EXPECT_EQ(HS_INVALID, hs_set_scratch_profile(scratch, db, table.data(),
+                                                 size - 1));
+    EXPECT_EQ(HS_BAD_ALIGN, hs_set_scratch_profile(
+                                scratch, db, (char *)table.data() + 1, size));
+    EXPECT_EQ(HS_SUCCESS, hs_set_scratch_profile(scratch, db, table.data(),
+                                                 size));
+#else
+    EXPECT_EQ(HS_INVALID, hs_profile_size(db, &size));
+    EXPECT_EQ(HS_INVALID, hs_set_scratch_profile(scratch, db, buf.data(),
+                                                 512));
+#endif
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+#if defined(HS_TRACE)
+
+static
+vector<trace_record> records(const vector<u64a> &buf, trace_header *h) {
+    memcpy(h, buf.data(), sizeof(*h));
+    const trace_record *r = (const trace_record *)((const char *)buf.data() +
+                                                   sizeof(*h));
+    return vector<trace_record>(r, r + h->count);
+}
+
+TEST(ScanTrace, Block) {
+    hs_database_t *db = buildDB("foo.*bar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    vector<u64a> buf(4096);
+    ASSERT_EQ(HS_SUCCESS, hs_set_scratch_trace(scratch, buf.data(),
+                                               buf.size() * sizeof(u64a)));
+
+    const string data = "xxfooxxbarxxbar";
+    CallBackContext c;
+    ASSERT_EQ(HS_SUCCESS, hs_scan(db, data.c_str(), data.length(), 0, scratch,
+                                  record_cb, &c));
+    ASSERT_EQ(2U, c.matches.size());
+
+    size_t size = 0;
+    ASSERT_EQ(HS_SUCCESS, hs_scratch_trace_size(scratch, &size));
+    ASSERT_EQ(HS_SUCCESS, hs_set_scratch_trace(scratch, nullptr, 0));
+    trace_header h;
+    auto recs = records(buf, &h);
+    EXPECT_EQ((u32)TRACE_MAGIC, h.magic);
+    EXPECT_EQ(0ULL, h.dropped);
+    EXPECT_EQ(sizeof(h) + recs.size() * sizeof(trace_record), size);
+    EXPECT_LE(h.base_ticks, h.end_ticks);
+    EXPECT_LE(h.base_ns, h.end_ns);
+
+    ASSERT_LE(2U, recs.size());
+    EXPECT_EQ(TRACE_CALL_BEGIN, recs.front().type);
+    EXPECT_EQ(TRACE_CALL_BLOCK, recs.front().aux);
+    EXPECT_EQ(data.length(), recs.front().id);
+    EXPECT_EQ(TRACE_CALL_END, recs.back().type);
+
+    vector<u64a> reports;
+    for (const auto &r : recs) {
+        if (r.type == TRACE_REPORT) {
+            EXPECT_EQ(1U, r.id);
+            reports.push_back(r.offset);
+        }
+        EXPECT_LE(recs.front().ticks, r.ticks);
+        EXPECT_LE(h.base_ticks, r.ticks);
+    }
+    EXPECT_EQ(vector<u64a>({10, 15}), reports);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(ScanTrace, Overflow) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    // Room for the header and four records.
+    vector<u64a> buf((sizeof(trace_header) + 4 * sizeof(trace_record)) /
+                     sizeof(u64a));
+    ASSERT_EQ(HS_SUCCESS, hs_set_scratch_trace(scratch, buf.data(),
+                                               buf.size() * sizeof(u64a)));
+
+    hs_stream_t *stream = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_open_stream(db, 0, &stream));
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(HS_SUCCESS, hs_scan_stream(stream, "foobar", 6, 0, scratch,
+                                             dummy_cb, nullptr));
+    }
+    ASSERT_EQ(HS_SUCCESS, hs_close_stream(stream, scratch, nullptr, nullptr));
+
+    trace_header h;
+    auto recs = records(buf, &h);
+    ASSERT_EQ(4U, recs.size());
+    EXPECT_LT(0ULL, h.dropped);
+    EXPECT_EQ(TRACE_CALL_BEGIN, recs[0].type);
+    EXPECT_EQ(TRACE_CALL_STREAM, recs[0].aux);
+
+    // A clone does not share the trace buffer.
+    hs_scratch_t *clone = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_clone_scratch(scratch, &clone));
+    size_t size;
+    EXPECT_EQ(HS_INVALID, hs_scratch_trace_size(clone, &size));
+
+    hs_free_scratch(clone);
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(ScanProfile, Counts) {
+    hs_database_t *db = buildDB("foo.*bar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_database_t *other = buildDB("xyzzy", 0, 2, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, other);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(other, &scratch));
+
+    size_t size = 0;
+    ASSERT_EQ(HS_SUCCESS, hs_profile_size(db, &size));
+    vector<profile_slot> table(size / sizeof(profile_slot));
+    ASSERT_EQ(HS_SUCCESS, hs_set_scratch_profile(scratch, db, table.data(),
+                                                 size));
+
+    const string data = "xxfooxxbarxxbar";
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(HS_SUCCESS, hs_scan(db, data.c_str(), data.length(), 0,
+                                      scratch, dummy_cb, nullptr));
+    }
+
+    u64a hits = 0, runs = 0;
+    for (const auto &slot : table) {
+        hits += slot.literal_hits;
+        runs += slot.program_runs;
+    }
+    EXPECT_LT(0ULL, hits);
+    EXPECT_EQ(0ULL, hits % 3);
+    EXPECT_LE(hits, runs);
+
+    // Scans of another database are not counted.
+    ASSERT_EQ(HS_SUCCESS, hs_scan(other, "xyzzy xyzzy", 11, 0, scratch,
+                                  dummy_cb, nullptr));
+    u64a total = 0;
+    for (const auto &slot : table) {
+        total += slot.literal_hits + slot.program_runs;
+    }
+    EXPECT_EQ(hits + runs, total);
+
+    hs_free_scratch(scratch);
+    hs_free_database(other);
+    hs_free_database(db);
+}
+
+#endif // HS_TRACE
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "test_util.h"
+
+#include "hs.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static
+unsigned long long getCaps(const hs_database_t *db) {
+    unsigned long long caps = ~0ULL;
+    hs_error_t err = hs_database_capabilities(db, &caps);
+    EXPECT_EQ(HS_SUCCESS, err);
+    return caps;
+}
+
+// Scan with and without scratch, and check that the matches agree.
+static
+void checkAgainstScan(const hs_database_t *db, const string &data) {
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    CallBackContext expected;
+    err = hs_scan(db, data.c_str(), data.length(), 0, scratch, record_cb,
+                  &expected);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    CallBackContext actual;
+    err = hs_scan_scratchless(db, data.c_str(), data.length(), 0, record_cb,
+                              &actual);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(expected.matches, actual.matches);
+
+    hs_free_scratch(scratch);
+}
+
+TEST(Scratchless, PureLiteral) {
+    vector<pattern> patterns;
+    patterns.emplace_back("foobar", 0, 1);
+    patterns.emplace_back("bazqux", 0, 2);
+    patterns.emplace_back("quxfoo", HS_FLAG_SINGLEMATCH, 3);
+    hs_database_t *db = buildDB(patterns, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+
+    ASSERT_TRUE(getCaps(db) & HS_DB_CAP_SCRATCHLESS);
+
+    const string data = "xxfoobarbazquxfoobar__quxfoo__bazquxfooquxfoo";
+    CallBackContext c;
+    hs_error_t err = hs_scan_scratchless(db, data.c_str(), data.length(), 0,
+                                         record_cb, &c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_EQ(5U, c.matches.size());
+    EXPECT_EQ(MatchRecord(8, 1), c.matches[0]);
+    EXPECT_EQ(MatchRecord(14, 2), c.matches[1]);
+    EXPECT_EQ(MatchRecord(17, 3), c.matches[2]);
+    EXPECT_EQ(MatchRecord(20, 1), c.matches[3]);
+    EXPECT_EQ(MatchRecord(36, 2), c.matches[4]);
+
+    checkAgainstScan(db, data);
+    hs_free_database(db);
+}
+
+TEST(Scratchless, Terminate) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    ASSERT_TRUE(getCaps(db) & HS_DB_CAP_SCRATCHLESS);
+
+    const string data = "foobar foobar foobar";
+    CallBackContext c;
+    c.halt = true;
+    hs_error_t err = hs_scan_scratchless(db, data.c_str(), data.length(), 0,
+                                         record_cb, &c);
+    ASSERT_EQ(HS_SCAN_TERMINATED, err);
+    ASSERT_EQ(1U, c.matches.size());
+    EXPECT_EQ(MatchRecord(6, 1), c.matches[0]);
+
+    hs_free_database(db);
+}
+
+TEST(Scratchless, MatchesScan) {
+    // Whatever engine these are reduced to, any that advertise scratchless
+    // scanning must agree with hs_scan().
+    const char *exprs[] = {"[a-c][d-f]{2}[g-i]", "a[^x]{3,5}b$",
+                           "^abc", "x.*y", "(foo|bar)baz"};
+    const string data = "adeg__xbfghxa1234bxyzabc__foobaz barbaz aeeh";
+
+    for (const char *expr : exprs) {
+        SCOPED_TRACE(expr);
+        hs_database_t *db = buildDB(expr, 0, 7, HS_MODE_BLOCK);
+        ASSERT_NE(nullptr, db);
+
+        if (getCaps(db) & HS_DB_CAP_SCRATCHLESS) {
+            checkAgainstScan(db, data);
+        } else {
+            hs_error_t err = hs_scan_scratchless(db, data.c_str(),
+                                                 data.length(), 0, record_cb,
+                                                 nullptr);
+            EXPECT_EQ(HS_DB_MODE_ERROR, err);
+        }
+        hs_free_database(db);
+    }
+}
+
+TEST(Scratchless, NotCapable) {
+    const string data = "foobar";
+
+    // Streaming databases always require stream state and scratch.
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+    EXPECT_EQ(0ULL, getCaps(db) & HS_DB_CAP_SCRATCHLESS);
+    hs_error_t err = hs_scan_scratchless(db, data.c_str(), data.length(), 0,
+                                         dummy_cb, nullptr);
+    EXPECT_EQ(HS_DB_MODE_ERROR, err);
+    hs_free_database(db);
+
+    // SOM tracking needs scratch.
+    db = buildDB("foo.*bar", HS_FLAG_SOM_LEFTMOST, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    EXPECT_EQ(0ULL, getCaps(db) & HS_DB_CAP_SCRATCHLESS);
+    err = hs_scan_scratchless(db, data.c_str(), data.length(), 0, dummy_cb,
+                              nullptr);
+    EXPECT_EQ(HS_DB_MODE_ERROR, err);
+    hs_free_database(db);
+}
+
+TEST(Scratchless, BadArgs) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+
+    unsigned long long caps;
+    EXPECT_EQ(HS_INVALID, hs_database_capabilities(db, nullptr));
+    EXPECT_EQ(HS_INVALID, hs_database_capabilities(nullptr, &caps));
+    EXPECT_EQ(HS_INVALID,
+              hs_scan_scratchless(db, nullptr, 6, 0, dummy_cb, nullptr));
+    EXPECT_EQ(HS_INVALID,
+              hs_scan_scratchless(nullptr, "foobar", 6, 0, dummy_cb, nullptr));
+
+    hs_free_database(db);
+}
@@ -570,4 +570,188 @@ TEST(Serialize, DeserializeGarbage) {
     free(bytes);
 }
 
+// Bundle a generic and a host-specific database; the host variant must be
+// selected on deserialization.
+TEST(Serialize, MultiTargetSelectsHost) {
+    static const char *pat = "hatstand.*(badgerbrush|teakettle)";
+
+    hs_platform_info generic;
+    generic.cpu_features = 0;
+    generic.tune = HS_TUNE_FAMILY_GENERIC;
+    hs_database_t *db_generic = buildDB(pat, 0, 1000, HS_MODE_BLOCK, &generic);
+    ASSERT_TRUE(db_generic != nullptr);
+
+    hs_platform_info host;
+    hs_error_t err = hs_populate_platform(&host);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_database_t *db_host = buildDB(pat, 0, 1000, HS_MODE_BLOCK, &host);
+    ASSERT_TRUE(db_host != nullptr);
+
+    char *host_info = nullptr;
+    err = hs_database_info(db_host, &host_info);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    const hs_database_t *dbs[] = {db_generic, db_host};
+    char *bytes = nullptr;
+    size_t length = 0;
+    err = hs_serialize_database_multi(dbs, 2, &bytes, &length);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_NE(nullptr, bytes);
+
+    char *info = nullptr;
+    err = hs_serialized_database_info(bytes, length, &info);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_STREQ(host_info, info);
+    free(info);
+
+    size_t host_len = 0;
+    err = hs_database_size(db_host, &host_len);
+    ASSERT_EQ(HS_SUCCESS, err);
+    size_t ser_len = 0;
+    err = hs_serialized_database_size(bytes, length, &ser_len);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_EQ(host_len, ser_len);
+
+    hs_database_t *db = nullptr;
+    err = hs_deserialize_database(bytes, length, &db);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_TRUE(db != nullptr);
+
+    info = nullptr;
+    err = hs_database_info(db, &info);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_STREQ(host_info, info);
+    free(info);
+
+    // The deserialized database must be usable.
+    hs_scratch_t *scratch = nullptr;
+    err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_scratch(scratch);
+
+    free(host_info);
+    free(bytes);
+    hs_free_database(db);
+    hs_free_database(db_host);
+    hs_free_database(db_generic);
+}
+
+// Identical variants should share their bytecode.
+TEST(Serialize, MultiTargetSharesBytecode) {
+    hs_database_t *db = buildDB("foo.*bar", 0, 1000, HS_MODE_BLOCK);
+    ASSERT_TRUE(db != nullptr);
+
+    char *single = nullptr;
+    size_t single_len = 0;
+    hs_error_t err = hs_serialize_database(db, &single, &single_len);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    const hs_database_t *one[] = {db};
+    char *bytes1 = nullptr;
+    size_t len1 = 0;
+    err = hs_serialize_database_multi(one, 1, &bytes1, &len1);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    const hs_database_t *three[] = {db, db, db};
+    char *bytes3 = nullptr;
+    size_t len3 = 0;
+    err = hs_serialize_database_multi(three, 3, &bytes3, &len3);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    // Each extra variant only costs a table entry.
+    ASSERT_GT(len3, len1);
+    ASSERT_GT(single_len, len3 - len1);
+
+    hs_database_t *db2 = nullptr;
+    err = hs_deserialize_database(bytes3, len3, &db2);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_database(db2);
+
+    free(single);
+    free(bytes1);
+    free(bytes3);
+    hs_free_database(db);
+}
+
+TEST(Serialize, MultiTargetModeMismatch) {
+    hs_database_t *db_block = buildDB("foo.*bar", 0, 1000, HS_MODE_BLOCK);
+    ASSERT_TRUE(db_block != nullptr);
+    hs_database_t *db_stream = buildDB("foo.*bar", 0, 1000, HS_MODE_STREAM);
+    ASSERT_TRUE(db_stream != nullptr);
+
+    const hs_database_t *dbs[] = {db_block, db_stream};
+    char *bytes = nullptr;
+    size_t length = 0;
+    hs_error_t err = hs_serialize_database_multi(dbs, 2, &bytes, &length);
+    ASSERT_EQ(HS_INVALID, err);
+
+    err = hs_serialize_database_multi(dbs, 0, &bytes, &length);
+    ASSERT_EQ(HS_INVALID, err);
+    err = hs_serialize_database_multi(nullptr, 2, &bytes, &length);
+    ASSERT_EQ(HS_INVALID, err);
+
+    hs_free_database(db_block);
+    hs_free_database(db_stream);
+}
+
+TEST(Serialize, CalibratedAlternatives) {
+    const char *exprs[] = {"hatstand", "teakettle", "badger.*brush",
+                           "foobar.{2,50}roobar"};
+    const unsigned ids[] = {1, 2, 3, 4};
+    const unsigned alts[] = {HS_ALT_DEFAULT, HS_ALT_NO_TEDDY, HS_ALT_NO_DFA,
+                             HS_ALT_NO_ACCEL};
+
+    char *bytes = nullptr;
+    size_t length = 0;
+    hs_compile_error_t *compile_err = nullptr;
+    hs_error_t err = hs_compile_ext_multi_alternatives(
+        exprs, nullptr, ids, nullptr, 4, HS_MODE_BLOCK, nullptr, alts, 4,
+        &bytes, &length, &compile_err);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_NE(nullptr, bytes);
+
+    const string sample = "xxhatstandxxbadger...brushxxfoobar___roobarxx";
+
+    // A sample is required.
+    hs_database_t *db = nullptr;
+    err = hs_deserialize_database_calibrated(bytes, length, nullptr, 0, &db);
+    ASSERT_EQ(HS_INVALID, err);
+    err = hs_deserialize_database_calibrated(bytes, length, sample.c_str(), 0,
+                                             &db);
+    ASSERT_EQ(HS_INVALID, err);
+    ASSERT_TRUE(db == nullptr);
+
+    err = hs_deserialize_database_calibrated(bytes, length, sample.c_str(),
+                                             sample.size(), &db);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_TRUE(db != nullptr);
+
+    // Whichever variant won, it must produce the same matches.
+    hs_scratch_t *scratch = nullptr;
+    err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    CallBackContext c;
+    err = hs_scan(db, sample.c_str(), sample.size(), 0, scratch, record_cb,
+                  (void *)&c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_EQ(3U, c.matches.size());
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+
+    // Plain deserialization picks a usable variant as well.
+    err = hs_deserialize_database(bytes, length, &db);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_database(db);
+
+    free(bytes);
+
+    err = hs_compile_ext_multi_alternatives(exprs, nullptr, ids, nullptr, 4,
+                                            HS_MODE_BLOCK, nullptr, alts, 0,
+                                            &bytes, &length, &compile_err);
+    ASSERT_EQ(HS_COMPILER_ERROR, err);
+    hs_free_compile_error(compile_err);
+}
+
 }
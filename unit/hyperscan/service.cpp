@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "test_util.h"
+
+#include "hs.h"
+#include "hs_service.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Per-stream state. Each stream is only scanned by one worker at a time, so
+// the handlers may update it without locking.
+struct StreamRecord {
+    vector<MatchRecord> matches;
+    vector<void *> done;
+    bool closed = false;
+};
+
+int HS_CDECL serviceMatch(unsigned, void *stream_context, unsigned id,
+                          unsigned long long, unsigned long long to, unsigned,
+                          void *) {
+    auto *rec = static_cast<StreamRecord *>(stream_context);
+    rec->matches.emplace_back(to, id);
+    return 0;
+}
+
+void HS_CDECL serviceDone(unsigned, void *stream_context, const char *data,
+                          void *data_context, hs_error_t result, void *) {
+    auto *rec = static_cast<StreamRecord *>(stream_context);
+    EXPECT_EQ(HS_SUCCESS, result);
+    if (data) {
+        rec->done.push_back(data_context);
+    } else {
+        rec->closed = true;
+    }
+}
+
+hs_service_config_t makeConfig(unsigned workers) {
+    hs_service_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.workers = workers;
+    config.on_match = serviceMatch;
+    config.on_done = serviceDone;
+    return config;
+}
+
+} // namespace
+
+TEST(ScanService, MatchesStreaming) {
+    hs_database_t *db = buildDB("foo[^\\n]*bar", 0, 1, HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+
+    const string data = "foobar__foo__bar\nbar foo   bar foobarfoo\nbar";
+    const size_t num_streams = 64;
+
+    // Reference matches from an ordinary stream, one byte per write.
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_stream_t *id = nullptr;
+    err = hs_open_stream(db, 0, &id);
+    ASSERT_EQ(HS_SUCCESS, err);
+    CallBackContext expected;
+    for (size_t i = 0; i < data.size(); i++) {
+        err = hs_scan_stream(id, data.c_str() + i, 1, 0, scratch, record_cb,
+                             &expected);
+        ASSERT_EQ(HS_SUCCESS, err);
+    }
+    err = hs_close_stream(id, scratch, record_cb, &expected);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_EQ(4U, expected.matches.size());
+    hs_free_scratch(scratch);
+
+    hs_service_config_t config = makeConfig(4);
+    config.queue_depth = 4;
+    hs_service_t *svc = nullptr;
+    err = hs_service_create(db, &config, &svc);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    vector<StreamRecord> records(num_streams);
+    vector<hs_service_stream_t *> streams(num_streams);
+    for (size_t i = 0; i < num_streams; i++) {
+        err = hs_service_open_stream(svc, &records[i], &streams[i]);
+        ASSERT_EQ(HS_SUCCESS, err);
+    }
+
+    // Interleave the streams, writing each with a different chunk size.
+    for (size_t pos = 0; pos < data.size(); pos++) {
+        for (size_t i = 0; i < num_streams; i++) {
+            size_t chunk = i % 5 + 1;
+            if (pos % chunk) {
+                continue;
+            }
+            size_t len = min(chunk, data.size() - pos);
+            err = hs_service_submit(svc, streams[i], data.c_str() + pos, len,
+                                    reinterpret_cast<void *>(pos), 0);
+            ASSERT_EQ(HS_SUCCESS, err);
+        }
+    }
+    for (size_t i = 0; i < num_streams; i++) {
+        err = hs_service_close_stream(svc, streams[i]);
+        ASSERT_EQ(HS_SUCCESS, err);
+    }
+    err = hs_service_drain(svc);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    for (size_t i = 0; i < num_streams; i++) {
+        SCOPED_TRACE(i);
+        const StreamRecord &rec = records[i];
+        EXPECT_TRUE(rec.closed);
+        EXPECT_EQ(expected.matches, rec.matches);
+
+        // Buffers complete in submission order.
+        size_t chunk = i % 5 + 1;
+        ASSERT_EQ((data.size() + chunk - 1) / chunk, rec.done.size());
+        for (size_t j = 0; j < rec.done.size(); j++) {
+            EXPECT_EQ(reinterpret_cast<void *>(j * chunk), rec.done[j]);
+        }
+    }
+
+    err = hs_service_destroy(svc);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_database(db);
+}
+
+namespace {
+
+struct BlockingContext {
+    atomic<bool> started{false};
+    atomic<bool> release{false};
+};
+
+void HS_CDECL blockingDone(unsigned, void *, const char *data, void *,
+                           hs_error_t, void *context) {
+    auto *ctx = static_cast<BlockingContext *>(context);
+    if (data && !ctx->started.exchange(true)) {
+        while (!ctx->release.load()) {
+            this_thread::yield();
+        }
+    }
+}
+
+} // namespace
+
+TEST(ScanService, NoWait) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+
+    BlockingContext ctx;
+    hs_service_config_t config = makeConfig(1);
+    config.queue_depth = 1;
+    config.on_match = nullptr;
+    config.on_done = blockingDone;
+    config.context = &ctx;
+    hs_service_t *svc = nullptr;
+    hs_error_t err = hs_service_create(db, &config, &svc);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    hs_service_stream_t *stream = nullptr;
+    err = hs_service_open_stream(svc, nullptr, &stream);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    // The only worker holds on to the first buffer, so the second fills the
+    // stream's queue and the third cannot be accepted.
+    const char data[] = "foobar";
+    err = hs_service_submit(svc, stream, data, 6, nullptr, HS_SERVICE_NOWAIT);
+    ASSERT_EQ(HS_SUCCESS, err);
+    while (!ctx.started.load()) {
+        this_thread::yield();
+    }
+    err = hs_service_submit(svc, stream, data, 6, nullptr, HS_SERVICE_NOWAIT);
+    ASSERT_EQ(HS_SUCCESS, err);
+    err = hs_service_submit(svc, stream, data, 6, nullptr, HS_SERVICE_NOWAIT);
+    EXPECT_EQ(HS_INSUFFICIENT_SPACE, err);
+
+    ctx.release.store(true);
+    err = hs_service_submit(svc, stream, data, 6, nullptr, 0);
+    ASSERT_EQ(HS_SUCCESS, err);
+    err = hs_service_close_stream(svc, stream);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    err = hs_service_destroy(svc);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_database(db);
+}
+
+TEST(ScanService, BadArgs) {
+    hs_service_config_t config = makeConfig(2);
+    config.max_streams = 1;
+    hs_service_t *svc = nullptr;
+
+    // Only streaming databases may be used.
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    EXPECT_EQ(HS_DB_MODE_ERROR, hs_service_create(db, &config, &svc));
+    hs_free_database(db);
+
+    db = buildDB("foobar", 0, 1, HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+    EXPECT_EQ(HS_INVALID, hs_service_create(nullptr, &config, &svc));
+    EXPECT_EQ(HS_INVALID, hs_service_create(db, nullptr, &svc));
+    EXPECT_EQ(HS_INVALID, hs_service_create(db, &config, nullptr));
+    ASSERT_EQ(HS_SUCCESS, hs_service_create(db, &config, &svc));
+
+    StreamRecord rec;
+    hs_service_stream_t *stream = nullptr;
+    EXPECT_EQ(HS_INVALID, hs_service_open_stream(nullptr, &rec, &stream));
+    EXPECT_EQ(HS_INVALID, hs_service_open_stream(svc, &rec, nullptr));
+    ASSERT_EQ(HS_SUCCESS, hs_service_open_stream(svc, &rec, &stream));
+
+    // Only max_streams streams may be open at once.
+    hs_service_stream_t *extra = nullptr;
+    EXPECT_EQ(HS_INSUFFICIENT_SPACE,
+              hs_service_open_stream(svc, &rec, &extra));
+
+    EXPECT_EQ(HS_INVALID, hs_service_submit(svc, stream, nullptr, 6, nullptr,
+                                            0));
+    EXPECT_EQ(HS_INVALID, hs_service_submit(svc, nullptr, "foobar", 6,
+                                            nullptr, 0));
+    EXPECT_EQ(HS_INVALID, hs_service_submit(svc, stream, "foobar", 6,
+                                            nullptr, 0x100));
+    EXPECT_EQ(HS_INVALID, hs_service_close_stream(nullptr, stream));
+    EXPECT_EQ(HS_INVALID, hs_service_drain(nullptr));
+
+    // Streams left open are freed with the service.
+    EXPECT_EQ(HS_SUCCESS, hs_service_submit(svc, stream, "foobar", 6,
+                                            nullptr, 0));
+    EXPECT_EQ(HS_SUCCESS, hs_service_destroy(svc));
+    EXPECT_EQ(1U, rec.matches.size());
+    EXPECT_FALSE(rec.closed);
+    EXPECT_EQ(HS_SUCCESS, hs_service_destroy(nullptr));
+
+    hs_free_database(db);
+}
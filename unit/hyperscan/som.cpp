@@ -196,6 +196,50 @@ TEST_P(SomTest, NearHorizon) {
     hs_free_database(db);
 }
 
+// Bounded-width patterns have their SOM resolved by a reverse search over the
+// window behind the match, which must reach back into history when the data is
+// written a byte at a time.
+TEST_P(SomTest, BoundedReverseSearch) {
+    hs_database_t *db = buildDB("[ab]{1,4}x[0-9]{2}", HS_FLAG_SOM_LEFTMOST,
+                                1000, HS_MODE_STREAM | som_mode);
+    ASSERT_TRUE(db != nullptr);
+
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_TRUE(scratch != nullptr);
+
+    vector<Match> matches;
+
+    hs_stream_t *stream = nullptr;
+    err = hs_open_stream(db, 0, &stream);
+    ASSERT_EQ(HS_SUCCESS, err);
+    ASSERT_TRUE(stream != nullptr);
+
+    const string data("zabbaax12 abx345");
+    for (const char &c : data) {
+        err = hs_scan_stream(stream, &c, 1, 0, scratch, vectorCallback,
+                             &matches);
+        ASSERT_EQ(HS_SUCCESS, err);
+    }
+
+    err = hs_close_stream(stream, scratch, vectorCallback, &matches);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    ASSERT_EQ(2, matches.size());
+    EXPECT_EQ(1000, matches[0].id);
+    EXPECT_EQ(2, matches[0].from);
+    EXPECT_EQ(9, matches[0].to);
+    EXPECT_EQ(1000, matches[1].id);
+    EXPECT_EQ(10, matches[1].from);
+    EXPECT_EQ(15, matches[1].to);
+
+    // teardown
+    err = hs_free_scratch(scratch);
+    ASSERT_EQ(HS_SUCCESS, err);
+    hs_free_database(db);
+}
+
 INSTANTIATE_TEST_CASE_P(Som, SomTest,
                         Values(HS_MODE_SOM_HORIZON_SMALL,
                                HS_MODE_SOM_HORIZON_MEDIUM));
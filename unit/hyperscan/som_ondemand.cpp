@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "test_util.h"
+
+#include "hs.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct SomMatches {
+    vector<pair<unsigned long long, unsigned long long>> matches;
+};
+
+} // namespace
+
+static
+int som_cb(unsigned, unsigned long long from, unsigned long long to,
+           unsigned, void *ctxt) {
+    auto *c = static_cast<SomMatches *>(ctxt);
+    c->matches.emplace_back(from, to);
+    return 0;
+}
+
+static
+SomMatches scanBlock(const hs_database_t *db, const string &data) {
+    hs_scratch_t *scratch = nullptr;
+    hs_error_t err = hs_alloc_scratch(db, &scratch);
+    EXPECT_EQ(HS_SUCCESS, err);
+
+    SomMatches c;
+    err = hs_scan(db, data.c_str(), data.length(), 0, scratch, som_cb, &c);
+    EXPECT_EQ(HS_SUCCESS, err);
+
+    hs_free_scratch(scratch);
+    return c;
+}
+
+TEST(SomOnDemand, MatchesSomLeftmost) {
+    const char *exprs[] = {"foo.*bar", "a[bc]{2,4}d", "(ab|b)+x", "^xy+z",
+                           "q[^q]{3}q$", "ab+c\\b"};
+    const string data = "foofoo_bar abcbd abbcd babx abababx xyyz qwertq "
+                        "abbbc foobar qabcq";
+
+    for (const char *expr : exprs) {
+        SCOPED_TRACE(expr);
+        hs_database_t *som_db = buildDB(expr, HS_FLAG_SOM_LEFTMOST, 1,
+                                        HS_MODE_BLOCK);
+        ASSERT_NE(nullptr, som_db);
+        hs_database_t *db = buildDB(expr, HS_FLAG_SOM_ON_DEMAND, 1,
+                                    HS_MODE_BLOCK);
+        ASSERT_NE(nullptr, db);
+
+        SomMatches expected = scanBlock(som_db, data);
+        SomMatches actual = scanBlock(db, data);
+        ASSERT_EQ(expected.matches.size(), actual.matches.size());
+
+        for (size_t i = 0; i < actual.matches.size(); i++) {
+            unsigned long long to = actual.matches[i].second;
+            ASSERT_EQ(expected.matches[i].second, to);
+            unsigned long long from = ~0ULL;
+            hs_error_t err = hs_find_start(db, 1, to, data.c_str(),
+                                           data.length(), 0, &from);
+            ASSERT_EQ(HS_SUCCESS, err);
+            EXPECT_EQ(expected.matches[i].first, from);
+        }
+
+        hs_free_database(som_db);
+        hs_free_database(db);
+    }
+}
+
+TEST(SomOnDemand, History) {
+    hs_database_t *db = buildDB("a[bc]{2,4}d", HS_FLAG_SOM_ON_DEMAND, 1,
+                                HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+
+    unsigned long long history = 0;
+    hs_error_t err = hs_find_start_history(db, 1, &history);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(6ULL, history);
+
+    // Supply only the retained history, as a streaming application would.
+    const string data = "xxxxxxxxabcbd";
+    const unsigned long long to = data.length();
+    const unsigned long long data_offset = to - history;
+    unsigned long long from = 0;
+    err = hs_find_start(db, 1, to, data.c_str() + data_offset, history,
+                        data_offset, &from);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(8ULL, from);
+
+    // Too little history to be sure of the leftmost start.
+    err = hs_find_start(db, 1, to, data.c_str() + data_offset + 1,
+                        history - 1, data_offset + 1, &from);
+    EXPECT_EQ(HS_INVALID, err);
+
+    hs_free_database(db);
+
+    db = buildDB("foo.*bar", HS_FLAG_SOM_ON_DEMAND, 1, HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+    err = hs_find_start_history(db, 1, &history);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(HS_OFFSET_PAST_HORIZON, history);
+    hs_free_database(db);
+}
+
+TEST(SomOnDemand, BadArgs) {
+    hs_database_t *db = buildDB("foo.*bar", HS_FLAG_SOM_ON_DEMAND, 1,
+                                HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_database_t *plain_db = buildDB("foo.*bar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, plain_db);
+
+    const string data = "xfooxbarx";
+    unsigned long long from = 0, history = 0;
+
+    // Good call, for comparison.
+    ASSERT_EQ(HS_SUCCESS, hs_find_start(db, 1, 8, data.c_str(), data.length(),
+                                        0, &from));
+    EXPECT_EQ(1ULL, from);
+
+    EXPECT_EQ(HS_INVALID, hs_find_start(nullptr, 1, 8, data.c_str(),
+                                        data.length(), 0, &from));
+    EXPECT_EQ(HS_INVALID,
+              hs_find_start(db, 1, 8, nullptr, data.length(), 0, &from));
+    EXPECT_EQ(HS_INVALID, hs_find_start(db, 1, 8, data.c_str(),
+                                        data.length(), 0, nullptr));
+    // Offset outside the data.
+    EXPECT_EQ(HS_INVALID, hs_find_start(db, 1, 10, data.c_str(),
+                                        data.length(), 0, &from));
+    // No match ends here.
+    EXPECT_EQ(HS_INVALID, hs_find_start(db, 1, 7, data.c_str(),
+                                        data.length(), 0, &from));
+    // Unknown ID, and a pattern compiled without the flag.
+    EXPECT_EQ(HS_INVALID, hs_find_start(db, 2, 8, data.c_str(),
+                                        data.length(), 0, &from));
+    EXPECT_EQ(HS_INVALID, hs_find_start(plain_db, 1, 8, data.c_str(),
+                                        data.length(), 0, &from));
+    EXPECT_EQ(HS_INVALID, hs_find_start_history(plain_db, 1, &history));
+    EXPECT_EQ(HS_INVALID, hs_find_start_history(db, 1, nullptr));
+
+    hs_free_database(db);
+    hs_free_database(plain_db);
+}
+
+TEST(SomOnDemand, BadFlags) {
+    hs_database_t *db = nullptr;
+    hs_compile_error_t *compile_err = nullptr;
+    hs_error_t err = hs_compile("foo.*bar",
+                                HS_FLAG_SOM_ON_DEMAND | HS_FLAG_SOM_LEFTMOST,
+                                HS_MODE_BLOCK, nullptr, &db, &compile_err);
+    EXPECT_EQ(HS_COMPILER_ERROR, err);
+    EXPECT_EQ(nullptr, db);
+    hs_free_compile_error(compile_err);
+
+    err = hs_compile("foo.*bar", HS_FLAG_SOM_ON_DEMAND | HS_FLAG_PREFILTER,
+                     HS_MODE_BLOCK, nullptr, &db, &compile_err);
+    EXPECT_EQ(HS_COMPILER_ERROR, err);
+    EXPECT_EQ(nullptr, db);
+    hs_free_compile_error(compile_err);
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "test_util.h"
+
+#include "hs.h"
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace std;
+
+static
+string repeated(const string &s, size_t n) {
+    string out;
+    for (size_t i = 0; i < n; i++) {
+        out += s;
+    }
+    return out;
+}
+
+TEST(WorkLimit, Unlimited) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    const string data = repeated("foobar_", 100);
+    CallBackContext c;
+    hs_error_t err = hs_scan(db, data.c_str(), data.length(), 0, scratch,
+                             record_cb, &c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(100U, c.matches.size());
+
+    // Without a budget, no work is counted.
+    unsigned long long work = 1;
+    int exceeded = 1;
+    ASSERT_EQ(HS_SUCCESS, hs_scratch_work(scratch, &work, &exceeded));
+    EXPECT_EQ(0ULL, work);
+    EXPECT_EQ(0, exceeded);
+
+    // A budget that is never reached measures the work of the call.
+    ASSERT_EQ(HS_SUCCESS, hs_set_scratch_work_limit(scratch, ~0ULL,
+                                                    HS_WORK_ACTION_FLAG));
+    c.matches.clear();
+    err = hs_scan(db, data.c_str(), data.length(), 0, scratch, record_cb, &c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(100U, c.matches.size());
+    exceeded = 1;
+    ASSERT_EQ(HS_SUCCESS, hs_scratch_work(scratch, &work, &exceeded));
+    EXPECT_LE(100ULL, work);
+    EXPECT_EQ(0, exceeded);
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(WorkLimit, Abort) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+    ASSERT_EQ(HS_SUCCESS,
+              hs_set_scratch_work_limit(scratch, 20, HS_WORK_ACTION_ABORT));
+
+    const string data = repeated("foobar_", 100);
+    CallBackContext c;
+    hs_error_t err = hs_scan(db, data.c_str(), data.length(), 0, scratch,
+                             record_cb, &c);
+    ASSERT_EQ(HS_SCAN_WORK_EXCEEDED, err);
+    EXPECT_GE(20U, c.matches.size());
+
+    unsigned long long work = 0;
+    int exceeded = 0;
+    ASSERT_EQ(HS_SUCCESS, hs_scratch_work(scratch, &work, &exceeded));
+    EXPECT_LT(20ULL, work);
+    EXPECT_NE(0, exceeded);
+
+    // The budget applies per call: a short scan fits within it.
+    c.clear();
+    err = hs_scan(db, "foobar", 6, 0, scratch, record_cb, &c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(1U, c.matches.size());
+
+    // Removing the budget lets the long scan complete.
+    ASSERT_EQ(HS_SUCCESS,
+              hs_set_scratch_work_limit(scratch, 0, HS_WORK_ACTION_ABORT));
+    c.clear();
+    err = hs_scan(db, data.c_str(), data.length(), 0, scratch, record_cb, &c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(100U, c.matches.size());
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(WorkLimit, Flag) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    const string data = repeated("foobar_", 100);
+    CallBackContext expected;
+    hs_error_t err = hs_scan(db, data.c_str(), data.length(), 0, scratch,
+                             record_cb, &expected);
+    ASSERT_EQ(HS_SUCCESS, err);
+
+    ASSERT_EQ(HS_SUCCESS,
+              hs_set_scratch_work_limit(scratch, 20, HS_WORK_ACTION_FLAG));
+
+    // Budgets are copied along with the scratch.
+    hs_scratch_t *clone = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_clone_scratch(scratch, &clone));
+
+    CallBackContext c;
+    err = hs_scan(db, data.c_str(), data.length(), 0, clone, record_cb, &c);
+    ASSERT_EQ(HS_SUCCESS, err);
+    EXPECT_EQ(expected.matches, c.matches);
+
+    unsigned long long work = 0;
+    int exceeded = 0;
+    ASSERT_EQ(HS_SUCCESS, hs_scratch_work(clone, &work, &exceeded));
+    EXPECT_LT(20ULL, work);
+    EXPECT_NE(0, exceeded);
+
+    hs_free_scratch(clone);
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(WorkLimit, StreamAbort) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_STREAM);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+    ASSERT_EQ(HS_SUCCESS,
+              hs_set_scratch_work_limit(scratch, 20, HS_WORK_ACTION_ABORT));
+
+    hs_stream_t *stream = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_open_stream(db, 0, &stream));
+
+    const string data = repeated("foobar_", 100);
+    CallBackContext c;
+    hs_error_t err = hs_scan_stream(stream, data.c_str(), data.length(), 0,
+                                    scratch, record_cb, &c);
+    ASSERT_EQ(HS_SCAN_WORK_EXCEEDED, err);
+    size_t seen = c.matches.size();
+
+    // The stream stays halted, even for writes within the budget.
+    err = hs_scan_stream(stream, "foobar", 6, 0, scratch, record_cb, &c);
+    ASSERT_EQ(HS_SCAN_WORK_EXCEEDED, err);
+    EXPECT_EQ(seen, c.matches.size());
+
+    ASSERT_EQ(HS_SUCCESS, hs_close_stream(stream, scratch, nullptr, nullptr));
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
+
+TEST(WorkLimit, BadArgs) {
+    hs_database_t *db = buildDB("foobar", 0, 1, HS_MODE_BLOCK);
+    ASSERT_NE(nullptr, db);
+    hs_scratch_t *scratch = nullptr;
+    ASSERT_EQ(HS_SUCCESS, hs_alloc_scratch(db, &scratch));
+
+    unsigned long long work;
+    EXPECT_EQ(HS_INVALID,
+              hs_set_scratch_work_limit(nullptr, 10, HS_WORK_ACTION_ABORT));
+    EXPECT_EQ(HS_INVALID, hs_set_scratch_work_limit(scratch, 10, 2));
+    EXPECT_EQ(HS_INVALID, hs_scratch_work(nullptr, &work, nullptr));
+    EXPECT_EQ(HS_INVALID, hs_scratch_work(scratch, nullptr, nullptr));
+    EXPECT_EQ(HS_SUCCESS, hs_scratch_work(scratch, &work, nullptr));
+
+    hs_free_scratch(scratch);
+    hs_free_database(db);
+}
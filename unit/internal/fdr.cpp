@@ -179,6 +179,8 @@ TEST_P(FDRp, Simple) {
 
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     fdrExec(fdr.get(), (const u8 *)data, sizeof(data), 0, decentCallback,
             &scratch, HWLM_ALL_GROUPS);
 
@@ -204,6 +206,8 @@ TEST_P(FDRp, SimpleSingle) {
 
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     fdrExec(fdr.get(), (const u8 *)data, sizeof(data) - 1 /* skip nul */, 0,
             decentCallback, &scratch, HWLM_ALL_GROUPS);
 
@@ -232,6 +236,8 @@ TEST_P(FDRp, MultiLocation) {
 
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     for (u32 i = 0; i < testSize - 3; i++) {
         memcpy(data.data() + i, "abc", 3);
         fdrExec(fdr.get(), data.data(), testSize, 0, decentCallback, &scratch,
@@ -258,6 +264,8 @@ TEST_P(FDRp, NoRepeat1) {
 
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     fdrExec(fdr.get(), (const u8 *)data, sizeof(data) - 1 /* skip nul */, 0,
             decentCallback, &scratch, HWLM_ALL_GROUPS);
 
@@ -282,6 +290,8 @@ TEST_P(FDRp, NoRepeat2) {
 
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     fdrExec(fdr.get(), (const u8 *)data, sizeof(data) - 1 /* skip nul */, 0,
             decentCallback, &scratch, HWLM_ALL_GROUPS);
 
@@ -307,6 +317,8 @@ TEST_P(FDRp, NoRepeat3) {
 
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     fdrExec(fdr.get(), (const u8 *)data, sizeof(data) - 1 /* skip nul */, 0,
             decentCallback, &scratch, HWLM_ALL_GROUPS);
 
@@ -332,6 +344,8 @@ hwlm_error_t safeExecStreaming(const FDR *fdr, const u8 *hbuf, size_t hlen,
     }
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     return fdrExecStreaming(fdr, hbuf, hlen, buf, len, start, cb, &scratch,
                             groups);
 }
@@ -433,6 +447,8 @@ TEST_P(FDRp, moveByteStream) {
     // check matches
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
 
     hwlm_error_t fdrStatus = fdrExec(fdrTable.get(), (const u8 *)data,
                                      data_len, 0, decentCallback, &scratch,
@@ -515,6 +531,8 @@ TEST_P(FDRpp, AlignAndTooEarly) {
     vector<hwlmLiteral> lits;
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     for (size_t litLen = 1; litLen <= patLen; litLen++) {
 
         // building literal from pattern substring of variable length 1-patLen
@@ -638,6 +656,8 @@ TEST_P(FDRpa, ShortWritings) {
     // run the literal matching through all generated literals
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
     for (size_t patIdx = 0; patIdx < pats.size();) {
         // group them in the sets of 32
         vector<hwlmLiteral> testSigs;
@@ -734,6 +754,8 @@ TEST(FDR, FDRTermB) {
     // check matches
     struct hs_scratch scratch;
     scratch.fdr_conf = NULL;
+    scratch.work = 0;
+    scratch.work_limit = ~0ULL;
 
     fdrStatus = fdrExec(fdr.get(), (const u8 *)data1, data_len1,
                         0, decentCallbackT, &scratch, HWLM_ALL_GROUPS);
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "ue2common.h"
+#include "grey.h"
+#include "hwlm/hwlm.h"
+#include "hwlm/hwlm_build.h"
+#include "hwlm/hwlm_internal.h"
+#include "hwlm/hwlm_literal.h"
+#include "hwlm/lhash_build.h"
+#include "hwlm/lhash_engine.h"
+#include "scratch.h"
+#include "util/compare.h"
+#include "util/compile_error.h"
+#include "util/compile_context.h"
+#include "util/target_info.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace ue2;
+
+namespace {
+
+using MatchList = vector<pair<size_t, u32>>; // (end, id)
+
+MatchList matches;
+size_t halt_after = ~size_t{0};
+hwlm_group_t cb_groups = HWLM_ALL_GROUPS;
+
+hwlmcb_rv_t record(size_t end, u32 id, UNUSED struct hs_scratch *scratch) {
+    matches.emplace_back(end, id);
+    if (matches.size() >= halt_after) {
+        return HWLM_TERMINATE_MATCHING;
+    }
+    return cb_groups;
+}
+
+struct LhashTest : public ::testing::Test {
+    void SetUp() override {
+        matches.clear();
+        halt_after = ~size_t{0};
+        cb_groups = HWLM_ALL_GROUPS;
+        scratch.fdr_conf = nullptr;
+        scratch.work = 0;
+        scratch.work_limit = ~0ULL;
+    }
+
+    struct hs_scratch scratch;
+};
+
+bool charMatches(u8 c, u8 d, bool nocase) {
+    if (nocase && ourisalpha(c)) {
+        return mytoupper(c) == mytoupper(d);
+    }
+    return c == d;
+}
+
+// Reference matcher over data, reporting literals which end at or after
+// buf_start and begin at or after start. Ends are relative to buf_start.
+MatchList naiveMatches(const vector<hwlmLiteral> &lits, const string &data,
+                       size_t buf_start, size_t start) {
+    MatchList out;
+    for (size_t end = buf_start; end < data.size(); end++) {
+        for (const auto &lit : lits) {
+            const size_t len = lit.s.size();
+            const size_t reach = max(len, lit.msk.size());
+            if (end + 1 < reach || end + 1 - len < start) {
+                continue;
+            }
+            bool ok = true;
+            for (size_t i = 0; ok && i < len; i++) {
+                ok = charMatches(lit.s[i], data[end + 1 - len + i], lit.nocase);
+            }
+            for (size_t i = 0; ok && i < lit.msk.size(); i++) {
+                u8 d = data[end + 1 - lit.msk.size() + i];
+                ok = (d & lit.msk[i]) == lit.cmp[i];
+            }
+            if (ok) {
+                out.emplace_back(end - buf_start, lit.id);
+            }
+        }
+    }
+    sort(out.begin(), out.end());
+    return out;
+}
+
+vector<hwlmLiteral> randomLiterals(size_t count, mt19937 &rng) {
+    const string alphabet = "abcdABCD.-";
+    vector<hwlmLiteral> lits;
+    for (u32 id = 0; id < count; id++) {
+        size_t len = 1 + rng() % 8;
+        if (len == 1 && rng() % 8) {
+            len = 2 + rng() % 7; // keep single bytes rare
+        }
+        string s;
+        for (size_t i = 0; i < len; i++) {
+            s += alphabet[rng() % alphabet.size()];
+        }
+        lits.emplace_back(s, rng() % 2, id);
+    }
+    return lits;
+}
+
+string randomData(size_t len, mt19937 &rng) {
+    const string alphabet = "abcdABCD.-xyz";
+    string data;
+    for (size_t i = 0; i < len; i++) {
+        data += alphabet[rng() % alphabet.size()];
+    }
+    return data;
+}
+
+} // namespace
+
+TEST_F(LhashTest, Block) {
+    mt19937 rng(42);
+    auto lits = randomLiterals(3000, rng);
+    auto lh = lhashBuildTable(lits);
+    ASSERT_TRUE(lh != nullptr);
+
+    const string data = randomData(2000, rng);
+    for (size_t start : {0, 1, 5, 13}) {
+        SCOPED_TRACE(start);
+        matches.clear();
+        hwlm_error_t rv = lhashExec(lh.get(), (const u8 *)data.c_str(),
+                                    data.size(), start, record, &scratch,
+                                    HWLM_ALL_GROUPS);
+        ASSERT_EQ(HWLM_SUCCESS, rv);
+        sort(matches.begin(), matches.end());
+        EXPECT_EQ(naiveMatches(lits, data, 0, start), matches);
+    }
+}
+
+TEST_F(LhashTest, Streaming) {
+    mt19937 rng(7);
+    auto lits = randomLiterals(3000, rng);
+    auto lh = lhashBuildTable(lits);
+    ASSERT_TRUE(lh != nullptr);
+
+    const string data = randomData(600, rng);
+    for (size_t hlen : {1, 3, 7, 8, 20}) {
+        SCOPED_TRACE(hlen);
+        matches.clear();
+        const u8 *p = (const u8 *)data.c_str();
+        hwlm_error_t rv = lhashExecStreaming(lh.get(), p, hlen, p + hlen,
+                                             data.size() - hlen, 0, record,
+                                             &scratch, HWLM_ALL_GROUPS);
+        ASSERT_EQ(HWLM_SUCCESS, rv);
+        sort(matches.begin(), matches.end());
+        EXPECT_EQ(naiveMatches(lits, data, hlen, 0), matches);
+    }
+}
+
+TEST_F(LhashTest, MaskAndGroups) {
+    vector<hwlmLiteral> lits;
+    // "bc" preceded by a byte with its low bit set.
+    lits.emplace_back("bc", false, false, 1, 1, vector<u8>{0x01, 0, 0},
+                      vector<u8>{0x01, 0, 0});
+    lits.emplace_back("bc", true, false, 2, 2, vector<u8>(), vector<u8>());
+    auto lh = lhashBuildTable(lits);
+    ASSERT_TRUE(lh != nullptr);
+
+    const string data = "abc bBC cbc";
+    hwlm_error_t rv = lhashExec(lh.get(), (const u8 *)data.c_str(),
+                                data.size(), 0, record, &scratch,
+                                HWLM_ALL_GROUPS);
+    ASSERT_EQ(HWLM_SUCCESS, rv);
+    sort(matches.begin(), matches.end());
+    MatchList expected = {{2, 1}, {2, 2}, {6, 2}, {10, 1}, {10, 2}};
+    EXPECT_EQ(expected, matches);
+
+    // Only literals in the groups switched on are reported.
+    matches.clear();
+    cb_groups = 2;
+    rv = lhashExec(lh.get(), (const u8 *)data.c_str(), data.size(), 0, record,
+                   &scratch, 2);
+    ASSERT_EQ(HWLM_SUCCESS, rv);
+    expected = {{2, 2}, {6, 2}, {10, 2}};
+    EXPECT_EQ(expected, matches);
+}
+
+TEST_F(LhashTest, Terminate) {
+    vector<hwlmLiteral> lits;
+    lits.emplace_back("foo", false, 1);
+    lits.emplace_back("o", false, 2);
+    auto lh = lhashBuildTable(lits);
+    ASSERT_TRUE(lh != nullptr);
+
+    halt_after = 1;
+    const string data = "foofoofoo";
+    hwlm_error_t rv = lhashExec(lh.get(), (const u8 *)data.c_str(),
+                                data.size(), 0, record, &scratch,
+                                HWLM_ALL_GROUPS);
+    ASSERT_EQ(HWLM_TERMINATED, rv);
+    ASSERT_EQ(1U, matches.size());
+    EXPECT_EQ(make_pair(size_t{1}, 2U), matches[0]);
+}
+
+TEST_F(LhashTest, ChosenAboveThreshold) {
+    Grey grey;
+    grey.allowLhash = true;
+    grey.lhashMinLiterals = 100;
+    CompileContext cc(false, false, get_current_target(), grey);
+
+    mt19937 rng(3);
+    auto few = randomLiterals(50, rng);
+    auto proto = hwlmBuildProto(few, false, cc);
+    ASSERT_TRUE(proto != nullptr);
+    EXPECT_NE(HWLM_ENGINE_LHASH, proto->engType);
+
+    auto lits = randomLiterals(500, rng);
+    proto = hwlmBuildProto(lits, false, cc);
+    ASSERT_TRUE(proto != nullptr);
+    ASSERT_EQ(HWLM_ENGINE_LHASH, proto->engType);
+
+    auto hwlm = hwlmBuild(*proto, cc);
+    ASSERT_TRUE(hwlm != nullptr);
+    EXPECT_LT(0U, hwlmSize(hwlm.get()));
+
+    const string data = randomData(1000, rng);
+    hwlm_error_t rv = hwlmExec(hwlm.get(), (const u8 *)data.c_str(),
+                               data.size(), 0, record, &scratch,
+                               HWLM_ALL_GROUPS);
+    ASSERT_EQ(HWLM_SUCCESS, rv);
+    sort(matches.begin(), matches.end());
+    EXPECT_EQ(naiveMatches(lits, data, 0, 0), matches);
+}
+
+TEST_F(LhashTest, LiteralCountLimits) {
+    Grey grey;
+    grey.allowLhash = true;
+    grey.lhashMinLiterals = 100;
+    grey.limitLiteralCount = 200;
+    grey.limitLhashLiteralCount = 400;
+    CompileContext cc(false, false, get_current_target(), grey);
+
+    // Over the general cap, but within Lhash's own.
+    mt19937 rng(4);
+    auto lits = randomLiterals(300, rng);
+    auto proto = hwlmBuildProto(lits, false, cc);
+    ASSERT_TRUE(proto != nullptr);
+    EXPECT_EQ(HWLM_ENGINE_LHASH, proto->engType);
+
+    auto too_many = randomLiterals(500, rng);
+    EXPECT_THROW(hwlmBuildProto(too_many, false, cc), ResourceLimitError);
+
+    // Without Lhash, the general cap applies.
+    grey.allowLhash = false;
+    CompileContext cc_no_lhash(false, false, get_current_target(), grey);
+    EXPECT_THROW(hwlmBuildProto(lits, false, cc_no_lhash), ResourceLimitError);
+}
@@ -31,6 +31,7 @@
 
 #include "grey.h"
 #include "compiler/compiler.h"
+#include "nfa/accel.h"
 #include "nfa/limex_internal.h"
 #include "nfa/nfa_api.h"
 #include "nfa/nfa_api_util.h"
@@ -41,6 +42,12 @@
 #include "util/bytecode_ptr.h"
 #include "util/target_info.h"
 
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace std;
 using namespace testing;
 using namespace ue2;
@@ -448,3 +455,325 @@ TEST_P(LimExZombieTest, GetZombieStatus) {
     // The .* at the end of the pattern should have turned us into a zombie...
     ASSERT_EQ(NFA_ZOMBIE_ALWAYS_YES, nfaGetZombieStatus(nfa.get(), &q, end));
 }
+
+// Test the gapped pair acceleration of a dot-star state whose escapes are
+// only interesting when followed two bytes later by a second byte.
+
+static const string GAP_SCAN_DATA =
+    "foo_____________________a_y___b_z___c_x_____________________________a_x"
+    "__________________________________b-y__abcbcz_____________________"
+    "c\nz________________________________________________________aaxc_z";
+
+static
+int onMatchEnd(u64a, u64a to, ReportID, void *ctx) {
+    vector<u64a> *ends = (vector<u64a> *)ctx;
+    ends->push_back(to);
+    return MO_CONTINUE_MATCHING;
+}
+
+class LimExGapAccelTest : public TestWithParam<int> {
+protected:
+    virtual void SetUp() {
+        type = GetParam();
+
+        Grey grey;
+        nfa = build(grey);
+        ASSERT_TRUE(nfa != nullptr);
+
+        grey.accelerateNFA = false;
+        plain = build(grey);
+        ASSERT_TRUE(plain != nullptr);
+    }
+
+    bytecode_ptr<NFA> build(const Grey &grey) const {
+        const string expr = "^foo.*(a.x|b.y|c.z)";
+        const unsigned flags = HS_FLAG_DOTALL;
+        CompileContext cc(false, false, get_current_target(), grey);
+        ParsedExpression parsed(0, expr.c_str(), flags, 0);
+        ReportManager rm(cc.grey);
+        auto built_expr = buildGraph(rm, cc, parsed);
+        const auto &g = built_expr.g;
+        if (!g) {
+            return nullptr;
+        }
+        clearReports(*g);
+
+        rm.setProgramOffset(0, MATCH_REPORT);
+
+        const map<u32, u32> fixed_depth_tops;
+        const map<u32, vector<vector<CharReach>>> triggers;
+        bool compress_state = false;
+        bool fast_nfa = false;
+
+        return constructNFA(*g, &rm, fixed_depth_tops, triggers,
+                            compress_state, fast_nfa, type, cc);
+    }
+
+    // Runs the given NFA over data, returning the match end offsets.
+    vector<u64a> run(const NFA *n, const string &data) const {
+        vector<u64a> ends;
+        auto full_state = make_bytecode_ptr<char>(n->scratchStateSize, 64);
+        auto stream_state = make_bytecode_ptr<char>(n->streamStateSize);
+
+        struct mq q;
+        q.nfa = n;
+        q.cur = 0;
+        q.end = 0;
+        q.state = full_state.get();
+        q.streamState = stream_state.get();
+        q.offset = 0;
+        q.buffer = (const u8 *)data.c_str();
+        q.length = data.length();
+        q.history = nullptr;
+        q.hlength = 0;
+        q.scratch = nullptr; /* limex does not use scratch */
+        q.report_current = 0;
+        q.cb = onMatchEnd;
+        q.context = &ends;
+
+        nfaQueueInitState(n, &q);
+        pushQueue(&q, MQE_START, 0);
+        pushQueue(&q, MQE_TOP, 0);
+        pushQueue(&q, MQE_END, data.length());
+        nfaQueueExec(n, &q, data.length());
+        return ends;
+    }
+
+    // NFA type (enum NFAEngineType)
+    int type;
+
+    // Compiled NFA structure, with and without acceleration.
+    bytecode_ptr<NFA> nfa;
+    bytecode_ptr<NFA> plain;
+};
+
+INSTANTIATE_TEST_CASE_P(LimExGapAccel, LimExGapAccelTest,
+                        Range((int)LIMEX_NFA_32, (int)LIMEX_NFA_512));
+
+TEST_P(LimExGapAccelTest, GapPairScheme) {
+    // The aux table fields lead every LimEx model, so the 32-bit layout will
+    // do to find them.
+    const LimExNFA32 *limex = (const LimExNFA32 *)getImplNfa(nfa.get());
+    const AccelAux *aux = (const AccelAux *)((const char *)limex +
+                                             limex->accelAuxOffset);
+    const AccelAux *gap = nullptr;
+    for (u32 i = 0; i < limex->accelAuxCount; i++) {
+        if (aux[i].accel_type == ACCEL_DVERM_GAP) {
+            gap = &aux[i];
+        }
+    }
+    ASSERT_TRUE(gap != nullptr);
+    EXPECT_EQ(0U, gap->gdverm.offset);
+    EXPECT_EQ(2U, gap->gdverm.gap);
+    ASSERT_EQ(3U, gap->gdverm.count);
+
+    set<pair<u8, u8>> lits;
+    for (u32 i = 0; i < gap->gdverm.count; i++) {
+        lits.emplace(gap->gdverm.c1[i], gap->gdverm.c2[i]);
+    }
+    EXPECT_EQ((set<pair<u8, u8>>{{'a', 'x'}, {'b', 'y'}, {'c', 'z'}}), lits);
+}
+
+TEST_P(LimExGapAccelTest, GapPairMatches) {
+    EXPECT_EQ(vector<u64a>({71, 108, 140, 199, 202}),
+              run(nfa.get(), GAP_SCAN_DATA));
+
+    // Every prefix, so that literals straddle the end of the buffer.
+    for (size_t len = 0; len <= GAP_SCAN_DATA.size(); len++) {
+        string prefix = GAP_SCAN_DATA.substr(0, len);
+        EXPECT_EQ(run(plain.get(), prefix), run(nfa.get(), prefix))
+            << "prefix of length " << len;
+    }
+}
+
+// Test that the fast path for exceptions which only switch on successors
+// gives the same results as running every exception through the full
+// routine. Each piece of the pattern has a backward loop (simple exceptions)
+// and an accept, a squashing dot-star and a bounded repeat (complex ones);
+// enough pieces are used to spread exceptions across every chunk of the
+// state.
+
+static const u32 SIMPLE_EXCEPTION_PIECES[] = {1, 3, 7, 15, 23, 31};
+
+static
+string exceptionPiece(u32 i) {
+    const string alpha = "abcdefghijklmnopqrstuvwxyz";
+    string s;
+    for (u32 j = 0; j < 5; j++) {
+        s += alpha[(i * 5 + j) % alpha.size()];
+    }
+    return s;
+}
+
+static
+string exceptionPattern(u32 pieces) {
+    string expr;
+    for (u32 i = 0; i < pieces; i++) {
+        const string p = exceptionPiece(i);
+        if (i) {
+            expr += "|";
+        }
+        expr += p.substr(0, 1) + "(" + p.substr(1, 3) + ")+" + p.substr(4, 1) +
+                "[^!]*![0-9]{4,6}";
+    }
+    return expr;
+}
+
+static
+string exceptionData(u32 pieces) {
+    const string alpha = "abcdefghijklmnopqrstuvwxyz!0123456789";
+    mt19937 rng(pieces);
+    string data;
+    for (u32 i = 0; i < 2048; i++) {
+        data += alpha[rng() % alpha.size()];
+        if (rng() % 64 == 0) {
+            const string p = exceptionPiece(rng() % pieces);
+            data += p.substr(0, 1) + p.substr(1, 3) + p.substr(1, 3) +
+                    p.substr(4, 1) + "_!" + to_string(rng() % 1000000);
+        }
+    }
+    return data;
+}
+
+// Finds whether the NFA has exceptions taking the fast path (simple) and
+// exceptions taking the full routine (complex).
+template<typename limex_t>
+static
+void exceptionKinds(const NFA *n, bool *has_simple, bool *has_complex) {
+    const limex_t *limex = (const limex_t *)getImplNfa(n);
+    const u8 *all = (const u8 *)&limex->exceptionMask;
+    const u8 *cplx = (const u8 *)&limex->exceptionComplexMask;
+    *has_simple = false;
+    *has_complex = false;
+    for (size_t i = 0; i < sizeof(limex->exceptionMask); i++) {
+        *has_simple |= (all[i] & ~cplx[i]) != 0;
+        *has_complex |= cplx[i] != 0;
+    }
+}
+
+static
+void exceptionKinds(const NFA *n, bool *has_simple, bool *has_complex) {
+    switch (n->type) {
+    case LIMEX_NFA_32:
+        return exceptionKinds<LimExNFA32>(n, has_simple, has_complex);
+    case LIMEX_NFA_64:
+        return exceptionKinds<LimExNFA64>(n, has_simple, has_complex);
+    case LIMEX_NFA_128:
+        return exceptionKinds<LimExNFA128>(n, has_simple, has_complex);
+    case LIMEX_NFA_256:
+        return exceptionKinds<LimExNFA256>(n, has_simple, has_complex);
+    case LIMEX_NFA_384:
+        return exceptionKinds<LimExNFA384>(n, has_simple, has_complex);
+    case LIMEX_NFA_512:
+        return exceptionKinds<LimExNFA512>(n, has_simple, has_complex);
+    default:
+        FAIL() << "not a LimEx NFA";
+    }
+}
+
+class LimExSimpleExceptionTest : public TestWithParam<int> {
+protected:
+    virtual void SetUp() {
+        type = GetParam();
+    }
+
+    bytecode_ptr<NFA> build(const string &expr, bool simple) const {
+        Grey grey;
+        grey.simpleNFAExceptions = simple;
+        grey.minExtBoundedRepeatSize = 4;
+        CompileContext cc(false, false, get_current_target(), grey);
+        ParsedExpression parsed(0, expr.c_str(), 0, 0);
+        ReportManager rm(cc.grey);
+        auto built_expr = buildGraph(rm, cc, parsed);
+        const auto &g = built_expr.g;
+        if (!g) {
+            return nullptr;
+        }
+        clearReports(*g);
+
+        rm.setProgramOffset(0, MATCH_REPORT);
+
+        const map<u32, u32> fixed_depth_tops;
+        const map<u32, vector<vector<CharReach>>> triggers;
+        bool compress_state = false;
+        bool fast_nfa = false;
+
+        return constructNFA(*g, &rm, fixed_depth_tops, triggers,
+                            compress_state, fast_nfa, type, cc);
+    }
+
+    // Runs the given NFA over data, returning the match end offsets.
+    vector<u64a> run(const NFA *n, const string &data) const {
+        vector<u64a> ends;
+        auto full_state = make_bytecode_ptr<char>(n->scratchStateSize, 64);
+        auto stream_state = make_bytecode_ptr<char>(n->streamStateSize);
+
+        struct mq q;
+        q.nfa = n;
+        q.cur = 0;
+        q.end = 0;
+        q.state = full_state.get();
+        q.streamState = stream_state.get();
+        q.offset = 0;
+        q.buffer = (const u8 *)data.c_str();
+        q.length = data.length();
+        q.history = nullptr;
+        q.hlength = 0;
+        q.scratch = nullptr; /* limex does not use scratch */
+        q.report_current = 0;
+        q.cb = onMatchEnd;
+        q.context = &ends;
+
+        nfaQueueInitState(n, &q);
+        pushQueue(&q, MQE_START, 0);
+        pushQueue(&q, MQE_TOP, 0);
+        pushQueue(&q, MQE_END, data.length());
+        nfaQueueExec(n, &q, data.length());
+        return ends;
+    }
+
+    // NFA type (enum NFAEngineType)
+    int type;
+};
+
+INSTANTIATE_TEST_CASE_P(LimExSimpleException, LimExSimpleExceptionTest,
+                        Values((int)LIMEX_NFA_32, (int)LIMEX_NFA_64,
+                               (int)LIMEX_NFA_128, (int)LIMEX_NFA_256,
+                               (int)LIMEX_NFA_384, (int)LIMEX_NFA_512));
+
+TEST_P(LimExSimpleExceptionTest, FastPathMatches) {
+    u32 built = 0;
+    for (u32 pieces : SIMPLE_EXCEPTION_PIECES) {
+        SCOPED_TRACE(pieces);
+        const string expr = exceptionPattern(pieces);
+        auto fast = build(expr, true);
+        auto full = build(expr, false);
+        // Larger patterns do not fit the smaller models.
+        ASSERT_EQ(fast == nullptr, full == nullptr);
+        if (!fast) {
+            continue;
+        }
+        built++;
+
+        bool has_simple, has_complex;
+        exceptionKinds(fast.get(), &has_simple, &has_complex);
+        EXPECT_TRUE(has_simple);
+        EXPECT_TRUE(has_complex);
+        exceptionKinds(full.get(), &has_simple, &has_complex);
+        EXPECT_FALSE(has_simple);
+        EXPECT_TRUE(has_complex);
+
+        const string data = exceptionData(pieces);
+        auto ends = run(full.get(), data);
+        EXPECT_FALSE(ends.empty());
+        EXPECT_EQ(ends, run(fast.get(), data));
+
+        // Shorter scans, which end with other exceptions switched on.
+        for (size_t len = 1; len < data.size(); len += 97) {
+            string prefix = data.substr(0, len);
+            EXPECT_EQ(run(full.get(), prefix), run(fast.get(), prefix))
+                << "prefix of length " << len;
+        }
+    }
+    ASSERT_LT(0U, built);
+}
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "gtest/gtest.h"
+
+#include "grey.h"
+#include "compiler/compiler.h"
+#include "nfa/accel.h"
+#include "nfa/mcclellan_internal.h"
+#include "nfa/mcclellancompile.h"
+#include "nfa/mcclellancompile_util.h"
+#include "nfa/mcsheng_compile.h"
+#include "nfa/nfa_api.h"
+#include "nfa/nfa_api_queue.h"
+#include "nfa/nfa_internal.h"
+#include "nfa/rdfa.h"
+#include "nfagraph/ng.h"
+#include "nfagraph/ng_mcclellan.h"
+#include "util/bytecode_ptr.h"
+#include "util/target_info.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace testing;
+using namespace ue2;
+
+static const string SCAN_DATA = "__foo123bar_abxxc_abcabdxyzq__aXbYc_zz\n"
+                                "foo9bar__xyzabcq_qabcx_foo12ba_abc";
+static const u32 MATCH_REPORT = 1024;
+
+using MatchList = vector<pair<u64a, ReportID>>;
+
+static
+int onMatch(u64a, u64a to, ReportID id, void *ctx) {
+    MatchList *matches = (MatchList *)ctx;
+    matches->emplace_back(to, id);
+    return MO_CONTINUE_MATCHING;
+}
+
+// Runs the given engine over data in one queue, collecting matches.
+static
+MatchList runQueue(const NFA *nfa, const string &data) {
+    MatchList matches;
+    auto full_state = make_bytecode_ptr<char>(nfa->scratchStateSize, 64);
+    auto stream_state = make_bytecode_ptr<char>(max(nfa->streamStateSize, 1U));
+
+    struct mq q;
+    q.nfa = nfa;
+    q.cur = 0;
+    q.end = 0;
+    q.state = full_state.get();
+    q.streamState = stream_state.get();
+    q.offset = 0;
+    q.buffer = (const u8 *)data.c_str();
+    q.length = data.size();
+    q.history = nullptr;
+    q.hlength = 0;
+    q.scratch = nullptr;
+    q.report_current = 0;
+    q.cb = onMatch;
+    q.context = &matches;
+
+    nfaQueueInitState(nfa, &q);
+    pushQueue(&q, MQE_START, 0);
+    pushQueue(&q, MQE_TOP, 0);
+    pushQueue(&q, MQE_END, data.size());
+    nfaQueueExec(nfa, &q, data.size());
+    return matches;
+}
+
+class McClellanTest : public TestWithParam<const char *> {
+protected:
+    virtual void SetUp() {
+        hs_platform_info plat;
+        hs_error_t err = hs_populate_platform(&plat);
+        ASSERT_EQ(HS_SUCCESS, err);
+        target = make_unique<target_t>(plat);
+
+        cc = makeContext(Grey());
+        rm = make_unique<ReportManager>(cc->grey);
+
+        ParsedExpression parsed(0, GetParam(), 0, 0);
+        auto built_expr = buildGraph(*rm, *cc, parsed);
+        ASSERT_TRUE(built_expr.g != nullptr);
+        rdfa = buildMcClellan(*built_expr.g, rm.get(), cc->grey);
+        ASSERT_TRUE(rdfa != nullptr);
+
+        for (u32 i = 0; i < rm->numReports(); i++) {
+            rm->setProgramOffset(i, MATCH_REPORT + i);
+        }
+    }
+
+    unique_ptr<CompileContext> makeContext(const Grey &grey) const {
+        return make_unique<CompileContext>(false, false, *target, grey);
+    }
+
+    // Compiles a fresh copy of the DFA, as compilation may modify it.
+    bytecode_ptr<NFA> compile(const CompileContext &ctx) const {
+        raw_dfa copy = *rdfa;
+        return mcclellanCompile(copy, ctx, *rm, false);
+    }
+
+    unique_ptr<target_t> target;
+    unique_ptr<CompileContext> cc;
+    unique_ptr<ReportManager> rm;
+    unique_ptr<raw_dfa> rdfa;
+};
+
+static const char *exprs[] = {"foo[0-9]+bar", "a.*b.*c", "(abc|abd|xyz)+q",
+                              "[^\\n]{3}x", "q[a-z]{2,5}x"};
+
+INSTANTIATE_TEST_CASE_P(McClellan, McClellanTest, ValuesIn(exprs));
+
+TEST_P(McClellanTest, RankStartsWithStartState) {
+    auto rank = rank_states_by_depth(*rdfa);
+    ASSERT_EQ(rdfa->states.size(), rank.size());
+
+    // The ranks are a permutation of the states.
+    auto sorted = rank;
+    sort(sorted.begin(), sorted.end());
+    for (u32 i = 0; i < sorted.size(); i++) {
+        EXPECT_EQ(i, sorted[i]);
+    }
+
+    dstate_id_t hottest = find(rank.begin(), rank.end(), 0U) - rank.begin();
+    EXPECT_TRUE(hottest == rdfa->start_floating
+                || hottest == rdfa->start_anchored);
+}
+
+TEST_P(McClellanTest, OrderByDepth) {
+    vector<dstate_id_t> states;
+    for (dstate_id_t i = rdfa->states.size(); i-- > 1;) {
+        states.push_back(i);
+    }
+
+    // Ordering disabled leaves the states alone.
+    Grey grey;
+    grey.orderDfaStatesByDepth = false;
+    auto rank = state_order_ranks(*rdfa, grey);
+    EXPECT_TRUE(rank.empty());
+    auto unchanged = states;
+    order_by_depth(unchanged, rank);
+    EXPECT_EQ(states, unchanged);
+
+    rank = state_order_ranks(*rdfa, Grey());
+    order_by_depth(states, rank);
+    EXPECT_TRUE(is_sorted(states.begin(), states.end(),
+                          [&rank](dstate_id_t a, dstate_id_t b) {
+                              return rank[a] < rank[b];
+                          }));
+}
+
+TEST_P(McClellanTest, OrderedNumbering) {
+    auto nfa = compile(*cc);
+    ASSERT_TRUE(nfa != nullptr);
+    ASSERT_EQ(MCCLELLAN_NFA_8, nfa->type);
+    const mcclellan *m = (const mcclellan *)getImplNfa(nfa.get());
+
+    // The hottest state takes the lowest id of its partition.
+    raw_dfa copy = *rdfa;
+    auto rank = rank_states_by_depth(copy);
+    dstate_id_t hottest = find(rank.begin(), rank.end(), 0U) - rank.begin();
+    u16 hot_id = hottest == rdfa->start_floating ? m->start_floating
+                                                 : m->start_anchored;
+    u16 base = hot_id >= m->accept_limit_8 ? m->accept_limit_8
+             : hot_id >= m->accel_limit_8  ? m->accel_limit_8
+                                           : 1;
+    EXPECT_EQ(base, hot_id);
+
+    // Numbering is deterministic.
+    auto again = compile(*cc);
+    ASSERT_TRUE(again != nullptr);
+    ASSERT_EQ(nfa->length, again->length);
+    EXPECT_EQ(0, memcmp(nfa.get(), again.get(), nfa->length));
+}
+
+TEST_P(McClellanTest, OrderingKeepsMatches) {
+    Grey grey;
+    grey.orderDfaStatesByDepth = false;
+    auto cc_off = makeContext(grey);
+
+    auto ordered = compile(*cc);
+    auto unordered = compile(*cc_off);
+    ASSERT_TRUE(ordered != nullptr);
+    ASSERT_TRUE(unordered != nullptr);
+
+    MatchList expected = runQueue(unordered.get(), SCAN_DATA);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(expected, runQueue(ordered.get(), SCAN_DATA));
+
+    // McSheng numbers its non-sheng states the same way.
+    raw_dfa copy_on = *rdfa;
+    raw_dfa copy_off = *rdfa;
+    auto sheng_ordered = mcshengCompile(copy_on, *cc, *rm);
+    auto sheng_unordered = mcshengCompile(copy_off, *cc_off, *rm);
+    ASSERT_EQ(!sheng_ordered, !sheng_unordered);
+    if (sheng_ordered) {
+        EXPECT_EQ(expected, runQueue(sheng_ordered.get(), SCAN_DATA));
+        EXPECT_EQ(expected, runQueue(sheng_unordered.get(), SCAN_DATA));
+    }
+}
+
+// Compares the engine with and without the byte-pair table over every prefix
+// and suffix of the scan data, so that pairs straddle each match, accel and
+// accept exit at both even and odd offsets.
+static
+void checkStride2(const NFA *with, const NFA *without) {
+    const mcclellan *m = (const mcclellan *)getImplNfa(without);
+    EXPECT_EQ(0U, m->stride2_offset);
+
+    for (size_t len = 0; len <= SCAN_DATA.size(); len++) {
+        string prefix = SCAN_DATA.substr(0, len);
+        EXPECT_EQ(runQueue(without, prefix), runQueue(with, prefix))
+            << "prefix of length " << len;
+        string suffix = SCAN_DATA.substr(len);
+        EXPECT_EQ(runQueue(without, suffix), runQueue(with, suffix))
+            << "suffix from " << len;
+    }
+}
+
+TEST_P(McClellanTest, Stride2Disabled) {
+    Grey grey;
+    grey.allowMcClellanStride2 = false;
+    auto nfa = compile(*makeContext(grey));
+    ASSERT_TRUE(nfa != nullptr);
+    const mcclellan *m = (const mcclellan *)getImplNfa(nfa.get());
+    EXPECT_EQ(0U, m->stride2_offset);
+
+    grey = Grey();
+    grey.mcclellanStride2Limit = 0;
+    nfa = compile(*makeContext(grey));
+    ASSERT_TRUE(nfa != nullptr);
+    m = (const mcclellan *)getImplNfa(nfa.get());
+    EXPECT_EQ(0U, m->stride2_offset);
+}
+
+TEST_P(McClellanTest, Stride2Matches) {
+    Grey grey;
+    grey.allowMcClellanStride2 = false;
+    auto without = compile(*makeContext(grey));
+    auto with = compile(*cc);
+    ASSERT_TRUE(without != nullptr);
+    ASSERT_TRUE(with != nullptr);
+    checkStride2(with.get(), without.get());
+}
+
+TEST_P(McClellanTest, Stride2MatchesNoAccel) {
+    // Without accel states nearly every transition can pair, so the table is
+    // always built and accept states are the only exits from a pair.
+    Grey grey;
+    grey.accelerateDFA = false;
+    auto with = compile(*makeContext(grey));
+    ASSERT_TRUE(with != nullptr);
+    const mcclellan *m = (const mcclellan *)getImplNfa(with.get());
+    EXPECT_NE(0U, m->stride2_offset);
+
+    grey.allowMcClellanStride2 = false;
+    auto without = compile(*makeContext(grey));
+    ASSERT_TRUE(without != nullptr);
+    checkStride2(with.get(), without.get());
+}
+
+// The start state of this DFA leaves on 'a', 'b' or 'c', but that only matters
+// where each is followed two bytes later by its partner, so it should use the
+// gapped pair vermicelli rather than stopping on every one of them.
+static const char *GAP_EXPR = "a.x|b.y|c.z";
+static const string GAP_DATA =
+    "foo_____________________a_y___b_z___c_x_____________________________a_x"
+    "__________________________________b-y__abcbcz_____________________"
+    "c\nz________________________________________________________aaxc_z";
+
+static
+bytecode_ptr<NFA> buildGapDfa(const Grey &grey) {
+    hs_platform_info plat;
+    if (hs_populate_platform(&plat) != HS_SUCCESS) {
+        return nullptr;
+    }
+    target_t target(plat);
+    CompileContext cc(false, false, target, grey);
+    ReportManager rm(cc.grey);
+    ParsedExpression parsed(0, GAP_EXPR, 0, 0);
+    auto built_expr = buildGraph(rm, cc, parsed);
+    if (!built_expr.g) {
+        return nullptr;
+    }
+    auto rdfa = buildMcClellan(*built_expr.g, &rm, cc.grey);
+    if (!rdfa) {
+        return nullptr;
+    }
+    for (u32 i = 0; i < rm.numReports(); i++) {
+        rm.setProgramOffset(i, MATCH_REPORT + i);
+    }
+    return mcclellanCompile(*rdfa, cc, rm, false);
+}
+
+static
+vector<u64a> matchEnds(const MatchList &matches) {
+    vector<u64a> ends;
+    for (const auto &m : matches) {
+        ends.push_back(m.first);
+    }
+    return ends;
+}
+
+TEST(McClellanAccel, GapPairScheme) {
+    auto nfa = buildGapDfa(Grey());
+    ASSERT_TRUE(nfa != nullptr);
+    ASSERT_EQ(MCCLELLAN_NFA_8, nfa->type);
+    const mcclellan *m = (const mcclellan *)getImplNfa(nfa.get());
+    ASSERT_TRUE(m->has_accel);
+
+    const mstate_aux *aux = (const mstate_aux *)((const char *)nfa.get() +
+                                                 m->aux_offset);
+    const AccelAux *gap = nullptr;
+    for (u32 s = 0; s < m->state_count; s++) {
+        if (!aux[s].accel_offset) {
+            continue;
+        }
+        const AccelAux *accel =
+            (const AccelAux *)((const char *)m + aux[s].accel_offset);
+        if (accel->accel_type == ACCEL_DVERM_GAP) {
+            gap = accel;
+        }
+    }
+    ASSERT_TRUE(gap != nullptr);
+    EXPECT_EQ(0U, gap->gdverm.offset);
+    EXPECT_EQ(2U, gap->gdverm.gap);
+    ASSERT_EQ(3U, gap->gdverm.count);
+
+    set<pair<u8, u8>> lits;
+    for (u32 i = 0; i < gap->gdverm.count; i++) {
+        lits.emplace(gap->gdverm.c1[i], gap->gdverm.c2[i]);
+    }
+    EXPECT_EQ((set<pair<u8, u8>>{{'a', 'x'}, {'b', 'y'}, {'c', 'z'}}), lits);
+}
+
+TEST(McClellanAccel, GapPairMatches) {
+    auto with = buildGapDfa(Grey());
+    ASSERT_TRUE(with != nullptr);
+    Grey grey;
+    grey.accelerateDFA = false;
+    auto without = buildGapDfa(grey);
+    ASSERT_TRUE(without != nullptr);
+
+    EXPECT_EQ(vector<u64a>({71, 108, 199, 202}),
+              matchEnds(runQueue(with.get(), GAP_DATA)));
+
+    // Every prefix and suffix, so that literals straddle the end of the
+    // buffer and the scan starts at each alignment.
+    for (size_t len = 0; len <= GAP_DATA.size(); len++) {
+        string prefix = GAP_DATA.substr(0, len);
+        EXPECT_EQ(runQueue(without.get(), prefix),
+                  runQueue(with.get(), prefix))
+            << "prefix of length " << len;
+        string suffix = GAP_DATA.substr(len);
+        EXPECT_EQ(runQueue(without.get(), suffix),
+                  runQueue(with.get(), suffix))
+            << "suffix from " << len;
+    }
+}
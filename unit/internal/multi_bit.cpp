@@ -536,6 +536,35 @@ TEST_P(MultiBitTest, IterAll) {
     }
 }
 
+TEST_P(MultiBitTest, IterBatch) {
+    SCOPED_TRACE(test_size);
+    ASSERT_TRUE(ba != nullptr);
+
+    u32 keys[MMB_ITER_BATCH];
+    mmbit_clear(ba, test_size);
+    ASSERT_EQ(0U, mmbit_iterate_batch(ba, test_size, MMB_INVALID, keys,
+                                      MMB_ITER_BATCH));
+
+    vector<u32> expected;
+    for (u64a i = 0; i < test_size; i += stride) {
+        mmbit_set(ba, test_size, i);
+        expected.push_back(i);
+    }
+
+    // Batches must return exactly the keys that mmbit_iterate would.
+    vector<u32> found;
+    u32 n = 0;
+    do {
+        n = mmbit_iterate_batch(ba, test_size,
+                                n ? keys[n - 1] : MMB_INVALID, keys,
+                                MMB_ITER_BATCH);
+        ASSERT_LE(n, (u32)MMB_ITER_BATCH);
+        found.insert(found.end(), keys, keys + n);
+    } while (n == MMB_ITER_BATCH);
+
+    ASSERT_EQ(expected, found);
+}
+
 TEST_P(MultiBitTest, AnyPrecise) {
     SCOPED_TRACE(test_size);
     ASSERT_TRUE(ba != nullptr);
@@ -1227,6 +1256,35 @@ TEST_P(MultiBitTest, SparseIteratorNextNone) {
     ASSERT_EQ(MMB_INVALID, val);
 }
 
+TEST_P(MultiBitTest, SparseIteratorAny) {
+    SCOPED_TRACE(test_size);
+    ASSERT_TRUE(ba != nullptr);
+
+    // Put every other strided key into the sparse iterator.
+    vector<u32> bits;
+    for (u64a i = 0; i < test_size; i += 2 * stride) {
+        bits.push_back(i);
+    }
+    auto it = mmbBuildSparseIterator(bits, test_size);
+    vector<mmbit_sparse_state> state(mmbit_sparse_iter_state_size(test_size));
+
+    mmbit_clear(ba, test_size);
+    ASSERT_FALSE(mmbit_sparse_iter_any(ba, test_size, &it[0], &state[0]));
+
+    // Keys outside the iterator must not be seen.
+    for (u64a i = stride; i < test_size; i += 2 * stride) {
+        mmbit_set(ba, test_size, i);
+    }
+    ASSERT_FALSE(mmbit_sparse_iter_any(ba, test_size, &it[0], &state[0]));
+
+    for (const auto &key : bits) {
+        SCOPED_TRACE(key);
+        mmbit_set(ba, test_size, key);
+        ASSERT_TRUE(mmbit_sparse_iter_any(ba, test_size, &it[0], &state[0]));
+        mmbit_unset(ba, test_size, key);
+    }
+}
+
 TEST_P(MultiBitTest, SparseIteratorUnsetAll) {
     SCOPED_TRACE(test_size);
     ASSERT_TRUE(ba != nullptr);
@@ -306,7 +306,7 @@ TEST(RDoubleVermicelli, Exec5) {
     }
 }
 
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
 
 #include "nfa/vermicellicompile.h"
 using namespace ue2;
@@ -563,4 +563,4 @@ TEST(RNVermicelli16, Exec5) {
     }
 }
 
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "gtest/gtest.h"
+
+#include "grey.h"
+#include "compiler/compiler.h"
+#include "nfa/mcclellancompile.h"
+#include "nfa/nfa_api.h"
+#include "nfa/nfa_api_queue.h"
+#include "nfa/nfa_internal.h"
+#include "nfa/rdfa.h"
+#include "nfa/shenglanescompile.h"
+#include "nfagraph/ng.h"
+#include "nfagraph/ng_mcclellan.h"
+#include "nfagraph/ng_util.h"
+#include "util/bytecode_ptr.h"
+#include "util/target_info.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace testing;
+using namespace ue2;
+
+static const string SCAN_DATA = "___foo___barbaz__qux_x_\n_foofoo_bazq?x_ba"
+                                "__qqx___xfoo__bar";
+static const u32 MATCH_REPORT = 1024;
+
+using MatchList = vector<pair<u64a, ReportID>>;
+
+static
+int onMatch(u64a, u64a to, ReportID id, void *ctx) {
+    MatchList *matches = (MatchList *)ctx;
+    matches->emplace_back(to, id);
+    return MO_CONTINUE_MATCHING;
+}
+
+class ShengLanesTest : public Test {
+protected:
+    virtual void SetUp() {
+        hs_platform_info plat;
+        hs_error_t err = hs_populate_platform(&plat);
+        ASSERT_EQ(HS_SUCCESS, err);
+
+        target_t target(plat);
+        cc = make_unique<CompileContext>(false, false, target, Grey());
+        rm = make_unique<ReportManager>(cc->grey);
+
+        const char *exprs[] = {"foo", "ba[rz]", "q.x"};
+        for (u32 i = 0; i < ARRAY_LENGTH(exprs); i++) {
+            ParsedExpression parsed(i, exprs[i], 0, i);
+            auto built_expr = buildGraph(*rm, *cc, parsed);
+            const auto &g = built_expr.g;
+            ASSERT_TRUE(g != nullptr);
+            auto rdfa = buildMcClellan(*g, rm.get(), cc->grey);
+            ASSERT_TRUE(rdfa != nullptr);
+            ASSERT_TRUE(fitsShengLane(*rdfa));
+            dfas.push_back(std::move(rdfa));
+        }
+
+        for (u32 i = 0; i < rm->numReports(); i++) {
+            rm->setProgramOffset(i, MATCH_REPORT + i);
+        }
+    }
+
+    // Runs the given engine over SCAN_DATA in one queue, collecting matches.
+    void runQueue(const NFA *nfa, MatchList &matches) {
+        auto full_state = make_bytecode_ptr<char>(nfa->scratchStateSize, 64);
+        auto stream_state = make_bytecode_ptr<char>(
+            max(nfa->streamStateSize, 1U));
+
+        struct mq q;
+        q.nfa = nfa;
+        q.cur = 0;
+        q.end = 0;
+        q.state = full_state.get();
+        q.streamState = stream_state.get();
+        q.offset = 0;
+        q.buffer = (const u8 *)SCAN_DATA.c_str();
+        q.length = SCAN_DATA.size();
+        q.history = nullptr;
+        q.hlength = 0;
+        q.scratch = nullptr;
+        q.report_current = 0;
+        q.cb = onMatch;
+        q.context = &matches;
+
+        nfaQueueInitState(nfa, &q);
+        pushQueue(&q, MQE_START, 0);
+        pushQueue(&q, MQE_TOP, 0);
+        pushQueue(&q, MQE_END, SCAN_DATA.size());
+        nfaQueueExec(nfa, &q, SCAN_DATA.size());
+        sort(matches.begin(), matches.end());
+    }
+
+    // The matches produced by running each DFA as its own McClellan engine.
+    MatchList expectedMatches() {
+        MatchList expected;
+        for (auto &rdfa : dfas) {
+            auto nfa = mcclellanCompile(*rdfa, *cc, *rm, false);
+            EXPECT_TRUE(nfa != nullptr);
+            if (!nfa) {
+                continue;
+            }
+            runQueue(nfa.get(), expected);
+        }
+        sort(expected.begin(), expected.end());
+        return expected;
+    }
+
+    bytecode_ptr<NFA> buildLanes() {
+        vector<raw_dfa *> ptrs;
+        for (auto &rdfa : dfas) {
+            ptrs.push_back(rdfa.get());
+        }
+        return shengLanesCompile(ptrs, *cc, *rm);
+    }
+
+    unique_ptr<CompileContext> cc;
+    unique_ptr<ReportManager> rm;
+    vector<unique_ptr<raw_dfa>> dfas;
+};
+
+TEST_F(ShengLanesTest, Build) {
+    auto nfa = buildLanes();
+    ASSERT_TRUE(nfa != nullptr);
+    EXPECT_EQ(SHENG_LANES_NFA, nfa->type);
+    EXPECT_EQ(0U, nfa->length % 64);
+    EXPECT_EQ(dfas.size(), nfa->streamStateSize);
+}
+
+TEST_F(ShengLanesTest, MatchesSeparateEngines) {
+    auto nfa = buildLanes();
+    ASSERT_TRUE(nfa != nullptr);
+
+    MatchList expected = expectedMatches();
+    ASSERT_FALSE(expected.empty());
+
+    MatchList matches;
+    runQueue(nfa.get(), matches);
+    EXPECT_EQ(expected, matches);
+}
+
+TEST_F(ShengLanesTest, Disabled) {
+    Grey grey;
+    grey.allowShengLanes = false;
+    CompileContext cc_off(false, false, cc->target_info, grey);
+
+    vector<raw_dfa *> ptrs;
+    for (auto &rdfa : dfas) {
+        ptrs.push_back(rdfa.get());
+    }
+    EXPECT_TRUE(shengLanesCompile(ptrs, cc_off, *rm) == nullptr);
+}
+
+TEST_F(ShengLanesTest, TooManyStates) {
+    ParsedExpression parsed(3, "a[^x]{20}b", 0, 3);
+    auto built_expr = buildGraph(*rm, *cc, parsed);
+    ASSERT_TRUE(built_expr.g != nullptr);
+    auto rdfa = buildMcClellan(*built_expr.g, rm.get(), cc->grey);
+    ASSERT_TRUE(rdfa != nullptr);
+    EXPECT_FALSE(fitsShengLane(*rdfa));
+}
+
+TEST_F(ShengLanesTest, Widths) {
+    auto nfa = buildLanes();
+    ASSERT_TRUE(nfa != nullptr);
+
+    // All lanes are floating with three byte matches.
+    EXPECT_EQ(3U, nfa->minWidth);
+    EXPECT_EQ(0U, nfa->maxWidth);
+    EXPECT_EQ(0U, nfa->maxOffset);
+}
+
+TEST_F(ShengLanesTest, AnchoredWidths) {
+    vector<unique_ptr<raw_dfa>> anchored;
+    vector<raw_dfa *> ptrs;
+    const char *exprs[] = {"^ab", "^x[yz]{2,4}"};
+    for (u32 i = 0; i < ARRAY_LENGTH(exprs); i++) {
+        ParsedExpression parsed(i, exprs[i], 0, i);
+        auto built_expr = buildGraph(*rm, *cc, parsed);
+        ASSERT_TRUE(built_expr.g != nullptr);
+        auto rdfa = buildMcClellan(*built_expr.g, rm.get(), cc->grey);
+        ASSERT_TRUE(rdfa != nullptr);
+        ASSERT_TRUE(fitsShengLane(*rdfa));
+        ptrs.push_back(rdfa.get());
+        anchored.push_back(std::move(rdfa));
+    }
+
+    // Widths and the max offset span all lanes.
+    auto nfa = shengLanesCompile(ptrs, *cc, *rm);
+    ASSERT_TRUE(nfa != nullptr);
+    EXPECT_EQ(2U, nfa->minWidth);
+    EXPECT_EQ(5U, nfa->maxWidth);
+    EXPECT_EQ(5U, nfa->maxOffset);
+}
+
+TEST_F(ShengLanesTest, AccelGate) {
+    // A single escape byte is better served by accelerating the DFA.
+    EXPECT_TRUE(shengLaneLosesAccel(*dfas[0], *rm, cc->grey));
+
+    Grey grey;
+    grey.accelerateDFA = false;
+    EXPECT_FALSE(shengLaneLosesAccel(*dfas[0], *rm, grey));
+
+    // A wide start reach leaves nothing to accelerate.
+    ParsedExpression parsed(3, "[^x]y", 0, 3);
+    auto built_expr = buildGraph(*rm, *cc, parsed);
+    ASSERT_TRUE(built_expr.g != nullptr);
+    auto rdfa = buildMcClellan(*built_expr.g, rm.get(), cc->grey);
+    ASSERT_TRUE(rdfa != nullptr);
+    EXPECT_FALSE(shengLaneLosesAccel(*rdfa, *rm, cc->grey));
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2024, VectorCamp PC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "gtest/gtest.h"
+
+#include "grey.h"
+#include "som/slot_manager.h"
+#include "som/slot_sharing.h"
+#include "util/report.h"
+#include "util/report_manager.h"
+
+#include <vector>
+
+using namespace std;
+using namespace ue2;
+
+static
+u32 addSet(ReportManager &rm, u32 slot) {
+    return rm.getInternalId(Report(INTERNAL_SOM_LOC_SET, slot));
+}
+
+static
+u32 addCopy(ReportManager &rm, u32 slot_in, u32 slot_out) {
+    Report ir(INTERNAL_SOM_LOC_COPY, slot_out);
+    ir.somDistance = slot_in;
+    return rm.getInternalId(ir);
+}
+
+static
+u32 addStored(ReportManager &rm, u32 slot, u32 report) {
+    Report ir(EXTERNAL_CALLBACK_SOM_STORED, report);
+    ir.somDistance = slot;
+    return rm.getInternalId(ir);
+}
+
+static
+u32 addBounded(ReportManager &rm, Report ir, u64a min_offset,
+               u64a max_offset) {
+    ir.minOffset = min_offset;
+    ir.maxOffset = max_offset;
+    return rm.getInternalId(ir);
+}
+
+static
+Report stored(u32 slot, u32 report) {
+    Report ir(EXTERNAL_CALLBACK_SOM_STORED, report);
+    ir.somDistance = slot;
+    return ir;
+}
+
+TEST(SomSlotSharing, AllLive) {
+    Grey grey;
+    ReportManager rm(grey);
+    for (u32 i = 0; i < 4; i++) {
+        addSet(rm, i);
+        addStored(rm, i, i);
+    }
+
+    auto colour = colourSomSlots(rm, 4);
+    EXPECT_EQ(vector<u32>({0, 1, 2, 3}), colour);
+}
+
+TEST(SomSlotSharing, DeadSlotsShare) {
+    Grey grey;
+    ReportManager rm(grey);
+    addSet(rm, 0);
+    addSet(rm, 1);
+    addSet(rm, 2);
+    addSet(rm, 3);
+    addStored(rm, 1, 10);
+    addStored(rm, 3, 11);
+
+    auto colour = colourSomSlots(rm, 4);
+    EXPECT_EQ(vector<u32>({0, 1, 0, 2}), colour);
+}
+
+TEST(SomSlotSharing, LiveThroughCopies) {
+    Grey grey;
+    ReportManager rm(grey);
+    addSet(rm, 0);
+    addCopy(rm, 0, 1);
+    addCopy(rm, 1, 2);
+    addStored(rm, 2, 10);
+
+    // Slot 3 is only copied into dead slot 4, so both are dead.
+    addSet(rm, 3);
+    addCopy(rm, 3, 4);
+
+    auto colour = colourSomSlots(rm, 5);
+    EXPECT_EQ(vector<u32>({0, 1, 2, 3, 3}), colour);
+}
+
+TEST(SomSlotSharing, RewritesReports) {
+    Grey grey;
+    ReportManager rm(grey);
+    SomSlotManager ssm(8);
+    for (u32 i = 0; i < 4; i++) {
+        ssm.getPrivateSomSlot();
+    }
+
+    u32 set0 = addSet(rm, 0);
+    u32 set1 = addSet(rm, 1);
+    u32 set2 = addSet(rm, 2);
+    u32 copy = addCopy(rm, 2, 3);
+    u32 stored = addStored(rm, 3, 10);
+
+    EXPECT_EQ(1U, shareSomSlots(rm, ssm));
+    EXPECT_EQ(3U, ssm.numSomSlots());
+
+    // Dead slots 0 and 1 now share a slot.
+    EXPECT_EQ(0U, rm.getReport(set0).onmatch);
+    EXPECT_EQ(0U, rm.getReport(set1).onmatch);
+    EXPECT_EQ(1U, rm.getReport(set2).onmatch);
+    EXPECT_EQ(1U, rm.getReport(copy).somDistance);
+    EXPECT_EQ(2U, rm.getReport(copy).onmatch);
+    EXPECT_EQ(2U, rm.getReport(stored).somDistance);
+
+    // The merged reports resolve to the same ID.
+    EXPECT_EQ(set0, addSet(rm, 0));
+}
+
+TEST(SomSlotSharing, DisjointLifetimesShare) {
+    Grey grey;
+    ReportManager rm(grey);
+
+    // Slot 0 is used up to offset 20, slot 1 only from offset 30 on.
+    addBounded(rm, Report(INTERNAL_SOM_LOC_SET, 0), 0, 20);
+    addBounded(rm, stored(0, 10), 5, 20);
+    addBounded(rm, Report(INTERNAL_SOM_LOC_SET, 1), 30, 40);
+    addBounded(rm, stored(1, 11), 30, 50);
+
+    // Slot 2 overlaps both.
+    addBounded(rm, Report(INTERNAL_SOM_LOC_SET, 2), 10, 35);
+    addBounded(rm, stored(2, 12), 10, 35);
+
+    auto colour = colourSomSlots(rm, 3);
+    EXPECT_EQ(vector<u32>({0, 0, 1}), colour);
+}
+
+TEST(SomSlotSharing, ConditionalWritesDoNotFollow) {
+    Grey grey;
+    ReportManager rm(grey);
+
+    // Slot 1 lives after slot 0, but its IF_UNSET write would see the valid
+    // bit left behind by slot 0.
+    addBounded(rm, Report(INTERNAL_SOM_LOC_SET, 0), 0, 20);
+    addBounded(rm, stored(0, 10), 0, 20);
+    addBounded(rm, Report(INTERNAL_SOM_LOC_SET_IF_UNSET, 1), 30, 40);
+    addBounded(rm, stored(1, 11), 30, 40);
+
+    auto colour = colourSomSlots(rm, 2);
+    EXPECT_EQ(vector<u32>({0, 1}), colour);
+
+    // The other way round is fine: an unconditional write overwrites
+    // whatever slot 0 left behind.
+    ReportManager rm2(grey);
+    addBounded(rm2, Report(INTERNAL_SOM_LOC_SET_IF_UNSET, 0), 0, 20);
+    addBounded(rm2, stored(0, 10), 0, 20);
+    addBounded(rm2, Report(INTERNAL_SOM_LOC_SET, 1), 30, 40);
+    addBounded(rm2, stored(1, 11), 30, 40);
+
+    colour = colourSomSlots(rm2, 2);
+    EXPECT_EQ(vector<u32>({0, 0}), colour);
+}
+
+TEST(SomSlotSharing, DisjointLifetimesRewriteReports) {
+    Grey grey;
+    ReportManager rm(grey);
+    SomSlotManager ssm(8);
+    for (u32 i = 0; i < 2; i++) {
+        ssm.getPrivateSomSlot();
+    }
+
+    addBounded(rm, Report(INTERNAL_SOM_LOC_SET, 0), 0, 10);
+    u32 stored0 = addBounded(rm, stored(0, 10), 0, 10);
+    u32 set1 = addBounded(rm, Report(INTERNAL_SOM_LOC_SET, 1), 11, 20);
+    u32 stored1 = addBounded(rm, stored(1, 11), 11, 20);
+
+    EXPECT_EQ(1U, shareSomSlots(rm, ssm));
+    EXPECT_EQ(1U, ssm.numSomSlots());
+    EXPECT_EQ(0U, rm.getReport(stored0).somDistance);
+    EXPECT_EQ(0U, rm.getReport(set1).onmatch);
+    EXPECT_EQ(0U, rm.getReport(stored1).somDistance);
+}
@@ -523,7 +523,7 @@ TEST(DoubleVermicelliMasked, Exec4) {
     }
 }
 
-#ifdef HAVE_SVE2
+#ifdef HAVE_VERM16
 
 #include "nfa/vermicellicompile.h"
 using namespace ue2;
@@ -1150,4 +1150,111 @@ TEST(DoubleVermicelliMasked16,  Exec5) {
     }
 }
 
-#endif // HAVE_SVE2
+#endif // HAVE_VERM16
+
+TEST(TripleVermicelli, ExecNoMatch1) {
+    char t1[] = "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb";
+    const u8 c1[] = {'a', 'b'};
+    const u8 c2[] = {'b', 'b'};
+    const u8 c3[] = {'b', 'a'};
+
+    for (size_t i = 0; i < 16; i++) {
+        for (size_t j = 0; j < 16; j++) {
+            const u8 *t1_end = (u8 *)t1 + strlen(t1) - j;
+            const u8 *rv = vermicelliTripleExec(c1, c2, c3, 2, (u8 *)t1 + i,
+                                                t1_end);
+            ASSERT_EQ(t1_end, rv);
+        }
+    }
+}
+
+TEST(TripleVermicelli, Exec1) {
+    char t1[] = "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb";
+    const u8 c1[] = {'x', 'a', 'b'};
+    const u8 c2[] = {'y', 'b', 'c'};
+    const u8 c3[] = {'z', 'c', 'd'};
+
+    for (size_t i = 0; i < 40; i++) {
+        t1[i] = 'a';
+        t1[i + 1] = 'b';
+        t1[i + 2] = 'c';
+
+        for (size_t j = 0; j <= i; j++) {
+            const u8 *rv = vermicelliTripleExec(c1, c2, c3, 3, (u8 *)t1 + j,
+                                                (u8 *)t1 + strlen(t1));
+            ASSERT_EQ((u8 *)t1 + i, rv);
+        }
+
+        t1[i] = 'b';
+        t1[i + 1] = 'b';
+        t1[i + 2] = 'b';
+    }
+}
+
+TEST(TripleVermicelli, ExecStraddlesEnd) {
+    char t1[] = "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb";
+    const u8 c1[] = {'a'};
+    const u8 c2[] = {'b'};
+    const u8 c3[] = {'c'};
+    size_t len = strlen(t1);
+
+    // only the first two bytes of the literal are in the buffer
+    t1[len - 3] = 'a';
+    t1[len - 1] = 'c';
+    for (size_t j = 0; j < 16; j++) {
+        const u8 *rv = vermicelliTripleExec(c1, c2, c3, 1, (u8 *)t1 + j,
+                                            (u8 *)t1 + len - 1);
+        ASSERT_EQ((u8 *)t1 + len - 1, rv);
+
+        rv = vermicelliTripleExec(c1, c2, c3, 1, (u8 *)t1 + j,
+                                  (u8 *)t1 + len);
+        ASSERT_EQ((u8 *)t1 + len - 3, rv);
+    }
+}
+
+TEST(DoubleVermicelliGap, ExecNoMatch1) {
+    char t1[] = "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb";
+    const u8 c1[] = {'a', 'b'};
+    const u8 c2[] = {'b', 'a'};
+
+    for (u32 gap = 2; gap <= 3; gap++) {
+        for (size_t i = 0; i < 16; i++) {
+            for (size_t j = 0; j < 16; j++) {
+                const u8 *t1_end = (u8 *)t1 + strlen(t1) - j;
+                const u8 *rv = vermicelliDoubleGapExec(c1, c2, 2, gap,
+                                                       (u8 *)t1 + i, t1_end);
+                ASSERT_EQ(t1_end, rv);
+            }
+        }
+    }
+}
+
+TEST(DoubleVermicelliGap, Exec1) {
+    char t1[] = "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb";
+    const u8 c1[] = {'a', 'x'};
+    const u8 c2[] = {'c', 'y'};
+
+    for (u32 gap = 2; gap <= 3; gap++) {
+        for (size_t i = 0; i < 40; i++) {
+            t1[i] = 'a';
+            t1[i + gap] = 'c';
+
+            for (size_t j = 0; j <= i; j++) {
+                const u8 *rv = vermicelliDoubleGapExec(c1, c2, 2, gap,
+                                                       (u8 *)t1 + j,
+                                                       (u8 *)t1 + strlen(t1));
+                ASSERT_EQ((u8 *)t1 + i, rv);
+            }
+
+            // the bytes in between don't matter, the gap does
+            t1[i + gap] = 'b';
+            t1[i + gap - 1] = 'c';
+            const u8 *rv = vermicelliDoubleGapExec(c1, c2, 2, gap, (u8 *)t1,
+                                                   (u8 *)t1 + strlen(t1));
+            ASSERT_EQ((u8 *)t1 + strlen(t1), rv);
+
+            t1[i] = 'b';
+            t1[i + gap - 1] = 'b';
+        }
+    }
+}
@@ -78,6 +78,7 @@ enum ParamKey {
             case 'L': *flags |= HS_FLAG_SOM_LEFTMOST; break;
             case 'C': *flags |= HS_FLAG_COMBINATION; break;
             case 'Q': *flags |= HS_FLAG_QUIET; break;
+            case 'D': *flags |= HS_FLAG_SOM_ON_DEMAND; break;
             default: fbreak;
         }
     }
@@ -161,7 +162,7 @@ bool HS_CDECL readExpression(const std::string &input, std::string &expr,
     enum ParamKey key = PARAM_NONE;
 
     %%{
-        single_flag = [ismW8HPLVOCQ];
+        single_flag = [ismW8HPLVOCQD];
         param = ('min_offset' @{ key = PARAM_MIN_OFFSET; } |
                  'max_offset' @{ key = PARAM_MAX_OFFSET; } |
                  'min_length' @{ key = PARAM_MIN_LENGTH; } |